@@ -20,6 +20,7 @@
 #include <atomic>
 
 #include "AittException.h"
+#include "TopicTrie.h"
 #include "aitt_internal.h"
 
 namespace aitt {
@@ -116,7 +117,7 @@ void AittDiscovery::RemoveDiscoveryCB(int callback_id)
 
 bool AittDiscovery::CompareTopic(const std::string &left, const std::string &right)
 {
-    return discovery_mq->CompareTopic(left, right);
+    return TopicFilter::Matches(left, right);
 }
 
 void AittDiscovery::DiscoveryMessageCallback(AittMsg *info, const void *msg, const int szmsg,
@@ -15,10 +15,35 @@
  */
 #include "AittMsg.h"
 
-AittMsg::AittMsg() : sequence(0), end_sequence(true), id_(nullptr), protocol_(AITT_TYPE_MQTT)
+struct AittMsg::Header {
+    Header() : sequence(0), end_sequence(true) {}
+
+    std::string topic;
+    std::string correlation;
+    std::string reply_topic;
+    int sequence;
+    bool end_sequence;
+};
+
+AittMsg::AittMsg() : id_(nullptr), protocol_(AITT_TYPE_MQTT), chunk_(0), last_chunk_(true)
 {
 }
 
+const AittMsg::Header &AittMsg::GetHeader() const
+{
+    static const Header empty_header;
+    return header_ ? *header_ : empty_header;
+}
+
+AittMsg::Header &AittMsg::MutableHeader()
+{
+    if (header_ == nullptr)
+        header_ = std::make_shared<Header>();
+    else if (header_.use_count() > 1)
+        header_ = std::make_shared<Header>(*header_);
+    return *header_;
+}
+
 void AittMsg::SetID(AittSubscribeID id)
 {
     id_ = id;
@@ -31,57 +56,77 @@ AittSubscribeID AittMsg::GetID() const
 
 void AittMsg::SetTopic(const std::string& topic)
 {
-    topic_ = topic;
+    MutableHeader().topic = topic;
 }
 
 const std::string& AittMsg::GetTopic() const
 {
-    return topic_;
+    return GetHeader().topic;
 }
 
 void AittMsg::SetCorrelation(const std::string& correlation)
 {
-    correlation_ = correlation;
+    MutableHeader().correlation = correlation;
 }
 
 const std::string& AittMsg::GetCorrelation() const
 {
-    return correlation_;
+    return GetHeader().correlation;
 }
 
 void AittMsg::SetResponseTopic(const std::string& replyTopic)
 {
-    reply_topic_ = replyTopic;
+    MutableHeader().reply_topic = replyTopic;
 }
 
 const std::string& AittMsg::GetResponseTopic() const
 {
-    return reply_topic_;
+    return GetHeader().reply_topic;
 }
 
 void AittMsg::SetSequence(int num)
 {
-    sequence = num;
+    MutableHeader().sequence = num;
 }
 
 void AittMsg::IncreaseSequence()
 {
-    sequence++;
+    MutableHeader().sequence++;
 }
 
 int AittMsg::GetSequence() const
 {
-    return sequence;
+    return GetHeader().sequence;
 }
 
 void AittMsg::SetEndSequence(bool end)
 {
-    end_sequence = end;
+    MutableHeader().end_sequence = end;
 }
 
 bool AittMsg::IsEndSequence() const
 {
-    return end_sequence;
+    return GetHeader().end_sequence;
+}
+
+void AittMsg::SetChunk(int num)
+{
+    chunk_ = num;
+}
+
+int AittMsg::GetChunk() const
+{
+    return chunk_;
+}
+
+void AittMsg::SetLastChunk(bool last)
+{
+    last_chunk_ = last;
+}
+
+bool AittMsg::IsLastChunk() const
+{
+    return last_chunk_;
 }
 
 void AittMsg::SetProtocol(AittProtocol protocol)
@@ -93,3 +138,13 @@ AittProtocol AittMsg::GetProtocol() const
 {
     return protocol_;
 }
+
+void AittMsg::SetPayload(const AittMsgBuffer& payload)
+{
+    payload_ = payload;
+}
+
+const AittMsgBuffer& AittMsg::GetPayload() const
+{
+    return payload_;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "AittMsgBuffer.h"
+
+#include <cstdlib>
+#include <cstring>
+
+AittMsgBuffer::AittMsgBuffer()
+{
+}
+
+AittMsgBuffer::AittMsgBuffer(const std::shared_ptr<Storage> &storage) : storage_(storage)
+{
+}
+
+AittMsgBuffer AittMsgBuffer::Wrap(const void *data, int datalen)
+{
+    // Nothing is kept from an empty payload.
+    if (datalen <= 0)
+        data = nullptr;
+    return AittMsgBuffer(std::make_shared<Storage>(data, datalen, nullptr));
+}
+
+AittMsgBuffer AittMsgBuffer::Adopt(void *data, int datalen)
+{
+    return AittMsgBuffer(std::make_shared<Storage>(data, datalen, data));
+}
+
+const void *AittMsgBuffer::GetData() const
+{
+    if (storage_ == nullptr)
+        return nullptr;
+
+    void *owned = storage_->owned.load(std::memory_order_acquire);
+    return owned ? owned : storage_->borrowed;
+}
+
+int AittMsgBuffer::GetSize() const
+{
+    return storage_ ? storage_->datalen : 0;
+}
+
+bool AittMsgBuffer::IsRetained() const
+{
+    return storage_ == nullptr || storage_->borrowed == nullptr
+           || storage_->owned.load(std::memory_order_acquire) != nullptr;
+}
+
+// Subscribers of a message may retain it on many threads. The first copy published wins,
+// and the others are freed.
+bool AittMsgBuffer::Retain() const
+{
+    if (IsRetained())
+        return true;
+
+    void *copy = malloc(storage_->datalen);
+    if (copy == nullptr)
+        return false;
+
+    memcpy(copy, storage_->borrowed, storage_->datalen);
+    void *expected = nullptr;
+    if (storage_->owned.compare_exchange_strong(expected, copy, std::memory_order_acq_rel)
+          == false)
+        free(copy);
+    return true;
+}
+
+AittMsgBuffer::Storage::Storage(const void *in_borrowed, int in_datalen, void *in_owned)
+      : borrowed(in_borrowed), datalen(in_datalen), owned(in_owned)
+{
+}
+
+AittMsgBuffer::Storage::~Storage()
+{
+    free(owned.load());
+}
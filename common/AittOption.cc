@@ -17,12 +17,35 @@
 
 #include "aitt_internal.h"
 
-AittOption::AittOption() : clean_session_(false), use_custom_broker(false)
+#define AITT_SEND_QUEUE_SIZE 256
+
+AittOption::AittOption()
+      : clean_session_(false),
+        use_custom_broker(false),
+        worker_threads(1),
+        work_stealing(false),
+        send_queue_size(AITT_SEND_QUEUE_SIZE),
+        send_overflow(AITT_SEND_OVERFLOW_BLOCK),
+        max_inflight(0),
+        inflight_blocking(true),
+        local_delivery(false),
+        stream_chunks(false),
+        receive_threads(1)
 {
 }
 
 AittOption::AittOption(bool clean_session, bool use_custom_mqtt_broker)
-      : clean_session_(clean_session), use_custom_broker(use_custom_mqtt_broker)
+      : clean_session_(clean_session),
+        use_custom_broker(use_custom_mqtt_broker),
+        worker_threads(1),
+        work_stealing(false),
+        send_queue_size(AITT_SEND_QUEUE_SIZE),
+        send_overflow(AITT_SEND_OVERFLOW_BLOCK),
+        max_inflight(0),
+        inflight_blocking(true),
+        local_delivery(false),
+        stream_chunks(false),
+        receive_threads(1)
 {
 }
 
@@ -95,3 +118,104 @@ const char* AittOption::GetCustomRWFile() const
 {
     return custom_rw_file.c_str();
 }
+
+int AittOption::SetWorkerThreads(int num)
+{
+    RETV_IF(num < 1, AITT_ERROR_INVALID_PARAMETER);
+    worker_threads = num;
+    return AITT_ERROR_NONE;
+}
+
+int AittOption::GetWorkerThreads() const
+{
+    return worker_threads;
+}
+
+void AittOption::SetWorkStealing(bool val)
+{
+    work_stealing = val;
+}
+
+bool AittOption::GetWorkStealing() const
+{
+    return work_stealing;
+}
+
+int AittOption::SetSendQueueSize(int size)
+{
+    RETV_IF(size < 1, AITT_ERROR_INVALID_PARAMETER);
+    send_queue_size = size;
+    return AITT_ERROR_NONE;
+}
+
+int AittOption::GetSendQueueSize() const
+{
+    return send_queue_size;
+}
+
+int AittOption::SetSendOverflowPolicy(AittSendOverflow policy)
+{
+    RETV_IF(policy < AITT_SEND_OVERFLOW_BLOCK || AITT_SEND_OVERFLOW_DROP_NEWEST < policy,
+          AITT_ERROR_INVALID_PARAMETER);
+    send_overflow = policy;
+    return AITT_ERROR_NONE;
+}
+
+AittSendOverflow AittOption::GetSendOverflowPolicy() const
+{
+    return send_overflow;
+}
+
+int AittOption::SetMaxInflight(int num)
+{
+    RETV_IF(num < 0, AITT_ERROR_INVALID_PARAMETER);
+    max_inflight = num;
+    return AITT_ERROR_NONE;
+}
+
+int AittOption::GetMaxInflight() const
+{
+    return max_inflight;
+}
+
+void AittOption::SetInflightBlocking(bool val)
+{
+    inflight_blocking = val;
+}
+
+bool AittOption::GetInflightBlocking() const
+{
+    return inflight_blocking;
+}
+
+void AittOption::SetLocalDelivery(bool val)
+{
+    local_delivery = val;
+}
+
+bool AittOption::GetLocalDelivery() const
+{
+    return local_delivery;
+}
+
+void AittOption::SetStreamChunks(bool val)
+{
+    stream_chunks = val;
+}
+
+bool AittOption::GetStreamChunks() const
+{
+    return stream_chunks;
+}
+
+int AittOption::SetReceiveThreads(int num)
+{
+    RETV_IF(num < 0, AITT_ERROR_INVALID_PARAMETER);
+    receive_threads = num;
+    return AITT_ERROR_NONE;
+}
+
+int AittOption::GetReceiveThreads() const
+{
+    return receive_threads;
+}
@@ -17,8 +17,10 @@
 
 #include <AittDiscovery.h>
 #include <AittMsg.h>
+#include <AittOption.h>
 #include <AittTypes.h>
 
+#include <map>
 #include <string>
 
 #define AITT_TRANSPORT_NEW aitt_transport_new
@@ -29,8 +31,8 @@ namespace aitt {
 
 class AittTransport {
   public:
-    typedef void *(
-          *ModuleEntry)(AittProtocol type, AittDiscovery &discovery, const std::string &my_ip);
+    typedef void *(*ModuleEntry)(AittProtocol type, AittDiscovery &discovery,
+          const std::string &my_ip, const AittOption &option);
     using SubscribeCallback = AittMsgCB;
 
     static constexpr const char *const MODULE_ENTRY_NAME = DEFINE_TO_STR(AITT_TRANSPORT_NEW);
@@ -43,6 +45,13 @@ class AittTransport {
 
     virtual void Publish(const std::string &topic, const void *data, const int datalen,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false) = 0;
+    // It publishes the messages in order. A module overrides it to send them together.
+    virtual void PublishBatch(const AittBatchMessage *messages, int count,
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false)
+    {
+        for (int i = 0; i < count; i++)
+            Publish(messages[i].topic, messages[i].data, messages[i].datalen, qos, retain);
+    }
     virtual void *Subscribe(const std::string &topic, const SubscribeCallback &cb,
           void *cbdata = nullptr, AittQoS qos = AITT_QOS_AT_MOST_ONCE) = 0;
     virtual void *Unsubscribe(void *handle) = 0;
@@ -52,6 +61,12 @@ class AittTransport {
     virtual void SendReply(AittMsg *msg, const void *data, const int datalen, AittQoS qos,
           bool retain) = 0;
     virtual int CountSubscriber(const std::string &topic) = 0;
+    // Counters of the send queues by the client IDs of the peers. A module without the queues
+    // returns none.
+    virtual std::map<std::string, AittPeerStats> GetPeerStats(void)
+    {
+        return std::map<std::string, AittPeerStats>();
+    }
 
     AittProtocol GetProtocol() { return protocol; }
 
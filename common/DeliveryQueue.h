@@ -0,0 +1,108 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include "MPSCQueue.h"
+#include "MainLoopIface.h"
+
+#define AITT_DELIVERY_QUEUE_SIZE 1024
+
+namespace aitt {
+
+// Hands items over from any thread to the thread running the main loop.
+// Only one idle source is added for a batch of items and it drains the queue completely,
+// instead of adding an idle source for every item.
+// When the ring is full, items are kept in an overflow list, so that Push() never blocks.
+template <typename T>
+class DeliveryQueue {
+  public:
+    using Handler = std::function<void(T &item)>;
+
+    DeliveryQueue(MainLoopIface *loop, const Handler &handler,
+          size_t capacity = AITT_DELIVERY_QUEUE_SIZE)
+          : loop_(loop), handler_(handler), ring_(capacity), has_overflow_(false),
+            scheduled_(false)
+    {
+    }
+
+    void Push(T &&item)
+    {
+        if (has_overflow_.load() || ring_.TryPush(std::move(item)) == false) {
+            std::lock_guard<std::mutex> lock(overflow_lock_);
+            overflow_.push_back(std::move(item));
+            has_overflow_.store(true);
+        }
+
+        if (scheduled_.exchange(true) == false) {
+            loop_->AddIdle(std::bind(&DeliveryQueue::Drain, this, std::placeholders::_1,
+                                 std::placeholders::_2, std::placeholders::_3),
+                  nullptr);
+        }
+    }
+
+  private:
+    int Drain(MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+    {
+        do {
+            DrainAll();
+            scheduled_.store(false);
+            // Items pushed after DrainAll() either are seen here or schedule a new idle.
+        } while (IsEmpty() == false && scheduled_.exchange(true) == false);
+
+        return AITT_LOOP_EVENT_REMOVE;
+    }
+
+    void DrainAll(void)
+    {
+        T item;
+        for (;;) {
+            while (ring_.TryPop(item))
+                handler_(item);
+
+            if (has_overflow_.load() == false)
+                break;
+
+            // While the overflow is in use, producers append to it instead of the ring,
+            // so it holds older items than the ones pushed after it's cleared.
+            std::deque<T> overflow;
+            {
+                std::lock_guard<std::mutex> lock(overflow_lock_);
+                overflow.swap(overflow_);
+                has_overflow_.store(false);
+            }
+            for (auto &it : overflow)
+                handler_(it);
+        }
+    }
+
+    bool IsEmpty(void) const { return ring_.IsEmpty() && has_overflow_.load() == false; }
+
+    MainLoopIface *loop_;
+    Handler handler_;
+    MPSCQueue<T> ring_;
+    std::mutex overflow_lock_;
+    std::deque<T> overflow_;
+    std::atomic_bool has_overflow_;
+    std::atomic_bool scheduled_;
+};
+
+}  // namespace aitt
@@ -0,0 +1,401 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "EpollMainLoop.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include <stdexcept>
+
+#include "aitt_internal.h"
+
+// epoll_data of the registered fds. A watch has its fd.
+#define AITT_EPOLL_TIMER_KEY (UINT64_MAX - 1)
+#define AITT_EPOLL_WAKEUP_KEY UINT64_MAX
+
+namespace aitt {
+
+EpollMainLoop::EpollMainLoop()
+      : timer_wheel(TimerWheel::Now()), timer_armed(UINT64_MAX), next_timeout_id(1), epoll_fd(-1),
+        wakeup_fd(-1), timer_fd(-1), is_running(false), polling(false)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        ERR("epoll_create1() Fail(%d)", errno);
+        throw std::runtime_error("EpollMainLoop() Fail");
+    }
+
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd == -1) {
+        ERR("eventfd() Fail(%d)", errno);
+        close(epoll_fd);
+        throw std::runtime_error("EpollMainLoop() Fail");
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd == -1) {
+        ERR("timerfd_create() Fail(%d)", errno);
+        close(wakeup_fd);
+        close(epoll_fd);
+        throw std::runtime_error("EpollMainLoop() Fail");
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = AITT_EPOLL_WAKEUP_KEY;
+    int ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &event);
+    if (ret == 0) {
+        event.data.u64 = AITT_EPOLL_TIMER_KEY;
+        ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &event);
+    }
+    if (ret == -1) {
+        ERR("epoll_ctl() Fail(%d)", errno);
+        close(timer_fd);
+        close(wakeup_fd);
+        close(epoll_fd);
+        throw std::runtime_error("EpollMainLoop() Fail");
+    }
+}
+
+EpollMainLoop::~EpollMainLoop()
+{
+    if (is_running)
+        Quit();
+
+    std::lock_guard<std::mutex> lock(table_lock);
+    timeout_table.clear();
+    watch_table.clear();
+    idle_table.clear();
+
+    close(timer_fd);
+    close(wakeup_fd);
+    close(epoll_fd);
+}
+
+void EpollMainLoop::Run()
+{
+    struct epoll_event events[AITT_EPOLL_MAX_EVENTS];
+    bool quit = false;
+    is_running = true;
+
+    // It returns after reading the wakeup of Quit(), not to return while Quit() is writing it.
+    while (quit == false) {
+        // AddIdle() wakes up the loop only while it may sleep in epoll_wait().
+        polling = true;
+        int timeout;
+        {
+            std::lock_guard<std::mutex> lock(table_lock);
+            timeout = idle_table.empty() ? -1 : 0;
+        }
+
+        int num = epoll_wait(epoll_fd, events, AITT_EPOLL_MAX_EVENTS, timeout);
+        polling = false;
+        if (num == -1) {
+            if (errno == EINTR)
+                continue;
+            ERR("epoll_wait() Fail(%d)", errno);
+            break;
+        }
+
+        bool handled = false;
+        for (int idx = 0; idx < num; idx++) {
+            uint64_t key = events[idx].data.u64;
+            if (key == AITT_EPOLL_WAKEUP_KEY) {
+                eventfd_t value;
+                eventfd_read(wakeup_fd, &value);
+                quit = (is_running == false);
+            } else if (is_running == false) {
+                continue;
+            } else if (key == AITT_EPOLL_TIMER_KEY) {
+                handled |= DispatchTimeouts();
+            } else {
+                int fd = static_cast<int>(key);
+                uint32_t revents = events[idx].events;
+                if (revents & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                    handled |= DispatchWatch(fd, revents, false);
+                if (revents & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+                    handled |= DispatchWatch(fd, revents, true);
+            }
+        }
+
+        if (is_running && handled == false)
+            DispatchIdle();
+    }
+    INFO("Terminating");
+}
+
+bool EpollMainLoop::Quit()
+{
+    if (is_running == false) {
+        ERR("main loop is not running");
+        return false;
+    }
+
+    is_running = false;
+    Wakeup();
+    return true;
+}
+
+void EpollMainLoop::AddIdle(const mainLoopCB &cb, MainLoopData *user_data)
+{
+    {
+        std::lock_guard<std::mutex> lock(table_lock);
+        idle_table.push_back(std::make_shared<CbData>(cb, user_data));
+    }
+
+    if (polling)
+        Wakeup();
+}
+
+void EpollMainLoop::AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
+{
+    AddFdWatch(fd, cb, user_data, false);
+}
+
+EpollMainLoop::MainLoopData *EpollMainLoop::RemoveWatch(int fd)
+{
+    return RemoveFdWatch(fd, false);
+}
+
+void EpollMainLoop::AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
+{
+    AddFdWatch(fd, cb, user_data, true);
+}
+
+EpollMainLoop::MainLoopData *EpollMainLoop::RemoveWriteWatch(int fd)
+{
+    return RemoveFdWatch(fd, true);
+}
+
+unsigned int EpollMainLoop::AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *data)
+{
+    if (interval <= 0) {
+        ERR("Invalid interval(%d)", interval);
+        return 0;
+    }
+
+    CbDataPtr cb_data = std::make_shared<CbData>(cb, data);
+    cb_data->interval = interval;
+
+    std::lock_guard<std::mutex> lock(table_lock);
+    unsigned int id = next_timeout_id++;
+    if (next_timeout_id == 0)
+        next_timeout_id = 1;
+
+    timeout_table.insert(TimeoutMap::value_type(id, cb_data));
+    timer_wheel.Add(id, TimerWheel::Deadline(interval));
+    ArmTimer();
+
+    return id;
+}
+
+void EpollMainLoop::RemoveTimeout(unsigned int id)
+{
+    std::lock_guard<std::mutex> lock(table_lock);
+    // The timerfd stays armed. An early wakeup finds nothing expired.
+    if (timeout_table.erase(id))
+        timer_wheel.Cancel(id);
+}
+
+void EpollMainLoop::AddFdWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data,
+      bool write)
+{
+    CbDataPtr cb_data = std::make_shared<CbData>(cb, user_data);
+    cb_data->fd = fd;
+
+    std::lock_guard<std::mutex> lock(table_lock);
+    FdWatch &watch = watch_table[fd];
+    bool registered = watch.read || watch.write;
+    if (write)
+        watch.write = cb_data;
+    else
+        watch.read = cb_data;
+    UpdateInterest(fd, watch, registered);
+}
+
+EpollMainLoop::MainLoopData *EpollMainLoop::RemoveFdWatch(int fd, bool write)
+{
+    std::lock_guard<std::mutex> lock(table_lock);
+    auto iter = watch_table.find(fd);
+    CbDataPtr *cb_data = nullptr;
+    if (iter != watch_table.end())
+        cb_data = write ? &iter->second.write : &iter->second.read;
+    if (cb_data == nullptr || *cb_data == nullptr) {
+        ERR("Unknown fd(%d)", fd);
+        return nullptr;
+    }
+
+    MainLoopData *user_data = (*cb_data)->data;
+    cb_data->reset();
+    UpdateInterest(fd, iter->second, true);
+    if (iter->second.read == nullptr && iter->second.write == nullptr)
+        watch_table.erase(iter);
+
+    return user_data;
+}
+
+// It's called with table_lock.
+void EpollMainLoop::UpdateInterest(int fd, const FdWatch &watch, bool registered)
+{
+    if (watch.read == nullptr && watch.write == nullptr) {
+        // The fd may be closed already.
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1)
+            DBG("epoll_ctl(DEL, %d) Fail(%d)", fd, errno);
+        return;
+    }
+
+    struct epoll_event event = {};
+    event.events = (watch.read ? EPOLLIN : 0) | (watch.write ? EPOLLOUT : 0);
+    event.data.u64 = static_cast<uint32_t>(fd);
+
+    int ret = epoll_ctl(epoll_fd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event);
+    // The fd was closed and opened again without removing the watch.
+    if (ret == -1 && registered && errno == ENOENT)
+        ret = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    if (ret == -1)
+        ERR("epoll_ctl(%d) Fail(%d)", fd, errno);
+}
+
+bool EpollMainLoop::DispatchWatch(int fd, uint32_t events, bool write)
+{
+    CbDataPtr cb_data;
+    {
+        std::lock_guard<std::mutex> lock(table_lock);
+        auto iter = watch_table.find(fd);
+        if (iter != watch_table.end())
+            cb_data = write ? iter->second.write : iter->second.read;
+    }
+    if (cb_data == nullptr)
+        return false;
+
+    if (events & (EPOLLHUP | EPOLLERR))
+        cb_data->result = (EPOLLHUP & events) ? Event::HANGUP : Event::ERROR;
+
+    int ret = cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
+
+    if (AITT_LOOP_EVENT_REMOVE == ret) {
+        std::lock_guard<std::mutex> lock(table_lock);
+        auto iter = watch_table.find(fd);
+        if (iter == watch_table.end())
+            return true;
+
+        CbDataPtr &current = write ? iter->second.write : iter->second.read;
+        if (current != cb_data)
+            return true;
+
+        current.reset();
+        UpdateInterest(fd, iter->second, true);
+        if (iter->second.read == nullptr && iter->second.write == nullptr)
+            watch_table.erase(iter);
+    }
+    return true;
+}
+
+// It's called with table_lock.
+void EpollMainLoop::ArmTimer(void)
+{
+    uint64_t next = timer_wheel.NextExpire();
+    if (next >= timer_armed)
+        return;
+
+    struct itimerspec its = {};
+    its.it_value.tv_sec = next / 1000;
+    its.it_value.tv_nsec = (next % 1000) * 1000 * 1000;
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        ERR("timerfd_settime() Fail(%d)", errno);
+        return;
+    }
+    timer_armed = next;
+}
+
+bool EpollMainLoop::DispatchTimeouts(void)
+{
+    std::vector<unsigned int> expired;
+    {
+        std::lock_guard<std::mutex> lock(table_lock);
+        uint64_t expirations;
+        if (read(timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            return false;
+
+        timer_armed = UINT64_MAX;
+        timer_wheel.Expire(TimerWheel::Now(), expired);
+    }
+
+    bool handled = false;
+    for (unsigned int id : expired) {
+        CbDataPtr cb_data;
+        {
+            std::lock_guard<std::mutex> lock(table_lock);
+            auto iter = timeout_table.find(id);
+            if (iter == timeout_table.end())
+                continue;
+            cb_data = iter->second;
+        }
+
+        int ret = cb_data->cb(cb_data->result, -1, cb_data->data);
+        handled = true;
+
+        std::lock_guard<std::mutex> lock(table_lock);
+        auto iter = timeout_table.find(id);
+        if (iter == timeout_table.end() || iter->second != cb_data)
+            continue;
+
+        if (AITT_LOOP_EVENT_REMOVE == ret)
+            timeout_table.erase(iter);
+        else
+            timer_wheel.Add(id, TimerWheel::Deadline(cb_data->interval));
+    }
+
+    std::lock_guard<std::mutex> lock(table_lock);
+    ArmTimer();
+    return handled;
+}
+
+void EpollMainLoop::DispatchIdle(void)
+{
+    CbDataPtr cb_data;
+    {
+        std::lock_guard<std::mutex> lock(table_lock);
+        if (idle_table.empty())
+            return;
+        cb_data = idle_table.front();
+    }
+
+    int ret = cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
+
+    if (AITT_LOOP_EVENT_REMOVE == ret) {
+        std::lock_guard<std::mutex> lock(table_lock);
+        if (idle_table.empty() == false && idle_table.front() == cb_data)
+            idle_table.pop_front();
+    }
+}
+
+void EpollMainLoop::Wakeup(void)
+{
+    if (eventfd_write(wakeup_fd, 1) == -1)
+        ERR("eventfd_write() Fail(%d)", errno);
+}
+
+EpollMainLoop::CbData::CbData(const mainLoopCB &callback, MainLoopData *user_data)
+      : cb(callback), data(user_data), result(Event::OKAY), fd(-1), interval(0)
+{
+}
+
+}  // namespace aitt
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "MainLoopIface.h"
+#include "TimerWheel.h"
+
+#define AITT_EPOLL_MAX_EVENTS 64
+
+namespace aitt {
+
+// Main loop on epoll. Fds are registered to the kernel only when a watch is added or removed,
+// so an event costs O(1) regardless of the number of watches.
+// Idle callbacks run one at a time while no fd is ready, as PosixMainLoop does.
+// Timeouts share a timer wheel and one timerfd armed for the next expiration of the wheel.
+class EpollMainLoop : public MainLoopIface {
+  public:
+    EpollMainLoop();
+    virtual ~EpollMainLoop();
+
+    void Run() override;
+    bool Quit() override;
+    void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) override;
+    void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
+    MainLoopData *RemoveWatch(int fd) override;
+    void AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
+    MainLoopData *RemoveWriteWatch(int fd) override;
+    unsigned int AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *user_data) override;
+    void RemoveTimeout(unsigned int id) override;
+
+  private:
+    struct CbData {
+        CbData(const mainLoopCB &cb, MainLoopData *data);
+
+        mainLoopCB cb;
+        MainLoopData *data;
+        Event result;
+        int fd;
+        int interval;
+    };
+    using CbDataPtr = std::shared_ptr<CbData>;
+
+    // A fd is registered once with both of its watches.
+    struct FdWatch {
+        CbDataPtr read;
+        CbDataPtr write;
+    };
+
+    using WatchMap = std::unordered_map<int, FdWatch>;
+    using TimeoutMap = std::map<unsigned int, CbDataPtr>;
+    using IdleQueue = std::deque<CbDataPtr>;
+
+    void AddFdWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data, bool write);
+    MainLoopData *RemoveFdWatch(int fd, bool write);
+    void UpdateInterest(int fd, const FdWatch &watch, bool registered);
+    bool DispatchWatch(int fd, uint32_t events, bool write);
+    void ArmTimer(void);
+    bool DispatchTimeouts(void);
+    void DispatchIdle(void);
+    void Wakeup(void);
+
+    WatchMap watch_table;
+    TimeoutMap timeout_table;
+    IdleQueue idle_table;
+    TimerWheel timer_wheel;
+    uint64_t timer_armed;
+    std::mutex table_lock;
+    unsigned int next_timeout_id;
+    int epoll_fd;
+    int wakeup_fd;
+    int timer_fd;
+    std::atomic_bool is_running;
+    std::atomic_bool polling;
+};
+
+}  // namespace aitt
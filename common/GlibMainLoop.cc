@@ -73,6 +73,28 @@ void GlibMainLoop::AddIdle(const mainLoopCB &cb, MainLoopData *user_data)
 }
 
 void GlibMainLoop::AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
+{
+    AddIOWatch(fd, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR), cb, user_data, callback_table);
+}
+
+GlibMainLoop::MainLoopData *GlibMainLoop::RemoveWatch(int fd)
+{
+    return RemoveIOWatch(fd, callback_table);
+}
+
+void GlibMainLoop::AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
+{
+    AddIOWatch(fd, (GIOCondition)(G_IO_OUT | G_IO_HUP | G_IO_ERR), cb, user_data,
+          write_callback_table);
+}
+
+GlibMainLoop::MainLoopData *GlibMainLoop::RemoveWriteWatch(int fd)
+{
+    return RemoveIOWatch(fd, write_callback_table);
+}
+
+void GlibMainLoop::AddIOWatch(int fd, GIOCondition cond, const mainLoopCB &cb,
+      MainLoopData *user_data, CallbackMap &table)
 {
     MainLoopCbData *cb_data = new MainLoopCbData();
     GMainContext *ctx = g_main_loop_get_context(loop);
@@ -82,29 +104,29 @@ void GlibMainLoop::AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_dat
     cb_data->fd = fd;
 
     GIOChannel *channel = g_io_channel_unix_new(fd);
-    GSource *source = g_io_create_watch(channel, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR));
+    GSource *source = g_io_create_watch(channel, cond);
     g_source_set_callback(source, (GSourceFunc)EventHandler, cb_data, DestroyNotify);
 
     g_source_attach(source, ctx);
     g_source_unref(source);
 
     callback_table_lock.lock();
-    callback_table.insert(CallbackMap::value_type(fd, std::make_pair(source, cb_data)));
+    table.insert(CallbackMap::value_type(fd, std::make_pair(source, cb_data)));
     callback_table_lock.unlock();
 }
 
-GlibMainLoop::MainLoopData *GlibMainLoop::RemoveWatch(int fd)
+GlibMainLoop::MainLoopData *GlibMainLoop::RemoveIOWatch(int fd, CallbackMap &table)
 {
     GSource *source;
     MainLoopData *user_data = nullptr;
 
     std::lock_guard<std::mutex> autoLock(callback_table_lock);
-    auto it = callback_table.find(fd);
-    if (it == callback_table.end())
+    auto it = table.find(fd);
+    if (it == table.end())
         return user_data;
     source = it->second.first;
     user_data = it->second.second->data;
-    callback_table.erase(it);
+    table.erase(it);
 
     g_source_destroy(source);
     return user_data;
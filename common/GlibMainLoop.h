@@ -34,6 +34,8 @@ class GlibMainLoop : public MainLoopIface {
     void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) override;
     void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
     MainLoopData *RemoveWatch(int fd) override;
+    void AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
+    MainLoopData *RemoveWriteWatch(int fd) override;
     unsigned int AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *user_data) override;
     void RemoveTimeout(unsigned int id) override;
 
@@ -48,12 +50,16 @@ class GlibMainLoop : public MainLoopIface {
     };
     using CallbackMap = std::map<int, std::pair<GSource *, MainLoopCbData *>>;
 
+    void AddIOWatch(int fd, GIOCondition cond, const mainLoopCB &cb, MainLoopData *user_data,
+          CallbackMap &table);
+    MainLoopData *RemoveIOWatch(int fd, CallbackMap &table);
     static gboolean CallbackHandler(gpointer user_data);
     static gboolean EventHandler(GIOChannel *src, GIOCondition cond, gpointer user_data);
     static void DestroyNotify(gpointer data);
 
     GMainLoop *loop;
     CallbackMap callback_table;
+    CallbackMap write_callback_table;
     std::mutex callback_table_lock;
 };
 }  // namespace aitt
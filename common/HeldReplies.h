@@ -0,0 +1,94 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <AittMsg.h>
+#include <AittTypes.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "aitt_internal.h"
+
+namespace aitt {
+
+// A requester subscribes its reply topic on the first request, so a responder may get the
+// request before it discovers the subscription. The transports hold such replies and send them
+// when the reply topic is discovered, up to AITT_REPLY_HOLD_TIMEOUT_MS.
+// It isn't thread-safe, the transports guard it with the lock of their peers.
+class HeldReplies {
+  public:
+    struct Reply {
+        AittMsg msg;  // without the payload
+        std::vector<uint8_t> payload;
+        AittQoS qos;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void Hold(const AittMsg &msg, const void *data, int datalen, AittQoS qos)
+    {
+        auto now = std::chrono::steady_clock::now();
+        Expire(now);
+        if (AITT_REPLY_HOLD_MAX <= replies_.size()) {
+            ERR("Too many replies held, drop one to %s",
+                  replies_.front().msg.GetResponseTopic().c_str());
+            replies_.pop_front();
+        }
+
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        replies_.push_back(Reply{msg, std::vector<uint8_t>(bytes, bytes + datalen), qos,
+              now + std::chrono::milliseconds(AITT_REPLY_HOLD_TIMEOUT_MS)});
+        // The payload of a received message is released after its callbacks.
+        replies_.back().msg.SetPayload(AittMsgBuffer());
+    }
+
+    // It takes the replies whose reply topic is discovered(func returns true with it).
+    template <typename Func>
+    std::vector<Reply> Take(Func discovered)
+    {
+        std::vector<Reply> taken;
+        if (replies_.empty())
+            return taken;
+
+        Expire(std::chrono::steady_clock::now());
+        for (auto it = replies_.begin(); it != replies_.end();) {
+            if (discovered(it->msg.GetResponseTopic())) {
+                taken.push_back(std::move(*it));
+                it = replies_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return taken;
+    }
+
+  private:
+    void Expire(std::chrono::steady_clock::time_point now)
+    {
+        while (replies_.empty() == false && replies_.front().deadline <= now) {
+            ERR("The reply topic(%s) isn't discovered, drop the reply",
+                  replies_.front().msg.GetResponseTopic().c_str());
+            replies_.pop_front();
+        }
+    }
+
+    std::deque<Reply> replies_;
+};
+
+}  // namespace aitt
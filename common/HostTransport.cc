@@ -0,0 +1,145 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "HostTransport.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <fstream>
+
+#include "aitt_internal.h"
+
+#define HOST_BLOB_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE)
+
+namespace aitt {
+
+std::string HostTransport::GetHostId(const char *ns)
+{
+    std::string boot_id;
+    std::ifstream boot_id_file("/proc/sys/kernel/random/boot_id");
+    std::getline(boot_id_file, boot_id);
+
+    std::string path = std::string("/proc/self/ns/") + ns;
+    char ns_link[PATH_MAX] = {0};
+    if (readlink(path.c_str(), ns_link, sizeof(ns_link) - 1) < 0)
+        ERR("readlink(%s) Fail(%d)", path.c_str(), errno);
+
+    return boot_id + "/" + ns_link;
+}
+
+void HostTransport::PackMsgInfo(flexbuffers::Builder &fbb, const AittMsg &msg, bool is_reply,
+      const std::function<void(flexbuffers::Builder &)> &extra)
+{
+    fbb.Map([&]() {
+        if (is_reply) {
+            if (!msg.GetResponseTopic().empty())
+                fbb.String("topic", msg.GetResponseTopic().c_str());
+        } else {
+            if (!msg.GetTopic().empty())
+                fbb.String("topic", msg.GetTopic().c_str());
+            if (!msg.GetResponseTopic().empty())
+                fbb.String("reply_topic", msg.GetResponseTopic().c_str());
+        }
+        if (!msg.GetCorrelation().empty())
+            fbb.String("correlation", msg.GetCorrelation().c_str());
+        if (msg.GetSequence() != 0)
+            fbb.UInt("sequence", msg.GetSequence());
+        // A received message ends the sequence by default.
+        if (is_reply)
+            fbb.Bool("end_sequence", msg.IsEndSequence());
+        if (extra)
+            extra(fbb);
+    });
+
+    fbb.Finish();
+}
+
+void HostTransport::UnpackMsgInfo(AittMsg &msg, const void *data, const size_t datalen)
+{
+    auto map = flexbuffers::GetRoot(static_cast<const uint8_t *>(data), datalen).AsMap();
+
+    if (map["topic"].IsString())
+        msg.SetTopic(map["topic"].AsString().str());
+    if (map["reply_topic"].IsString())
+        msg.SetResponseTopic(map["reply_topic"].AsString().str());
+    if (map["correlation"].IsString())
+        msg.SetCorrelation(map["correlation"].AsString().str());
+    if (map["sequence"].IsUInt())
+        msg.SetSequence(map["sequence"].AsUInt64());
+    if (map["end_sequence"].IsBool())
+        msg.SetEndSequence(map["end_sequence"].AsBool());
+}
+
+int HostTransport::NewBlob(const void *data, size_t size)
+{
+    int fd = memfd_create("aitt-blob", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        ERR("memfd_create() Fail(%d)", errno);
+        return -1;
+    }
+
+    const char *pos = static_cast<const char *>(data);
+    size_t remain = size;
+    while (remain) {
+        ssize_t ret = write(fd, pos, remain);
+        if (ret < 0 && errno == EINTR)
+            continue;
+        if (ret <= 0) {
+            ERR("write(%zu) Fail(%d)", size, errno);
+            close(fd);
+            return -1;
+        }
+        pos += ret;
+        remain -= ret;
+    }
+
+    // Receivers map it without worrying about changes or SIGBUS.
+    if (fcntl(fd, F_ADD_SEALS, HOST_BLOB_SEALS | F_SEAL_SEAL) < 0) {
+        ERR("fcntl(F_ADD_SEALS) Fail(%d)", errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void *HostTransport::MapBlob(int fd, size_t &size)
+{
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals < 0 || (seals & HOST_BLOB_SEALS) != HOST_BLOB_SEALS) {
+        ERR("Unsealed blob(0x%x)", seals);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        ERR("Invalid blob(%d)", errno);
+        return nullptr;
+    }
+    size = st.st_size;
+
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ERR("mmap(%zu) Fail(%d)", size, errno);
+        return nullptr;
+    }
+    return addr;
+}
+
+}  // namespace aitt
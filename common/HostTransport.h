@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <AittMsg.h>
+#include <flatbuffers/flexbuffers.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "TopicTrie.h"
+
+namespace aitt {
+
+// Helpers of the transports to the peers on the same host(SHM and UDS)
+class HostTransport {
+  public:
+    // Processes with the same ID share the namespace(e.g. "pid", "net") of the same kernel.
+    static std::string GetHostId(const char *ns);
+
+    // Message header (flexbuffers)
+    // map {
+    //   "topic": "$topic",               // the reply topic of a reply
+    //   "reply_topic": "$reply_topic",   // of a request
+    //   "correlation": "$correlation",
+    //   "sequence": $sequence,
+    //   "end_sequence": $end,            // of a reply
+    // }
+    // extra adds the fields of the transport into the map.
+    static void PackMsgInfo(flexbuffers::Builder &fbb, const AittMsg &msg, bool is_reply = false,
+          const std::function<void(flexbuffers::Builder &)> &extra = nullptr);
+    static void UnpackMsgInfo(AittMsg &msg, const void *data, const size_t datalen);
+
+    // A sealed memfd of the data, it's mapped by receivers without a copy.
+    static int NewBlob(const void *data, size_t size);
+    // Map the blob read-only. It returns nullptr if it's not sealed.
+    static void *MapBlob(int fd, size_t &size);
+};
+
+// Peers on the same host with the topic filters they subscribe.
+// A message goes once to a peer, which calls every matched callback.
+// It isn't thread-safe, the transports guard it with their own lock.
+template <typename Peer>
+class HostPeerTable {
+  public:
+    using PeerPtr = std::shared_ptr<Peer>;
+    using Topics = std::map<std::string /* topic filter */, uint32_t /* number of callbacks */>;
+
+    PeerPtr Find(const std::string &clientId) const
+    {
+        auto it = peers_.find(clientId);
+        return (it == peers_.end()) ? nullptr : it->second.peer;
+    }
+
+    // The peer and its topics replace the ones of the client.
+    void Update(const std::string &clientId, const PeerPtr &peer, const Topics &topics)
+    {
+        Remove(clientId);
+        Entry &entry = peers_[clientId];
+        entry.peer = peer;
+        entry.topics = topics;
+        for (auto &topic : topics)
+            trie_.Insert(topic.first, Subscription(clientId, topic.second));
+    }
+
+    // It returns the peer removed, or nullptr.
+    PeerPtr Remove(const std::string &clientId)
+    {
+        auto it = peers_.find(clientId);
+        if (it == peers_.end())
+            return nullptr;
+
+        for (auto &topic : it->second.topics)
+            trie_.Remove(topic.first, Subscription(clientId, topic.second));
+        PeerPtr peer = it->second.peer;
+        peers_.erase(it);
+        return peer;
+    }
+
+    // Peers subscribing the topic, except for the client skipped
+    void Match(const std::string &topic, const std::string &skipped,
+          std::vector<PeerPtr> &peers) const
+    {
+        std::vector<const std::string *> clients;
+        trie_.Match(topic, [&](const Subscription &subscription) {
+            if (subscription.first != skipped)
+                clients.push_back(&subscription.first);
+        });
+        std::sort(clients.begin(), clients.end(),
+              [](const std::string *a, const std::string *b) { return *a < *b; });
+        clients.erase(std::unique(clients.begin(), clients.end(),
+                            [](const std::string *a, const std::string *b) { return *a == *b; }),
+              clients.end());
+
+        for (auto client : clients)
+            peers.push_back(peers_.at(*client).peer);
+    }
+
+    // Callbacks subscribing the topic
+    int Count(const std::string &topic) const
+    {
+        int count = 0;
+        trie_.Match(topic, [&count](const Subscription &subscription) {
+            count += subscription.second;
+        });
+        return count;
+    }
+
+    // func(clientId, peer)
+    template <typename Func>
+    void ForEach(Func func) const
+    {
+        for (auto &entry : peers_)
+            func(entry.first, entry.second.peer);
+    }
+
+  private:
+    using Subscription = std::pair<std::string /* clientId */, uint32_t /* number of callbacks */>;
+
+    struct Entry {
+        PeerPtr peer;
+        Topics topics;
+    };
+
+    std::map<std::string /* clientId */, Entry> peers_;
+    TopicTrie<Subscription> trie_;
+};
+
+}  // namespace aitt
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#define AITT_CACHE_LINE_SIZE 64
+
+namespace aitt {
+
+// Bounded lock-free ring for multiple producers and a single consumer.
+// Each cell carries a sequence number telling whether it is ready to be written or read,
+// so producers only contend on the tail index and the consumer never takes a lock.
+template <typename T>
+class MPSCQueue {
+  public:
+    explicit MPSCQueue(size_t capacity) : mask_(RoundUp(capacity) - 1), tail_(0), head_(0)
+    {
+        cells_.reset(new Cell[mask_ + 1]);
+        for (size_t i = 0; i <= mask_; i++)
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // The item is moved only when it returns true.
+    bool TryPush(T &&item)
+    {
+        Cell *cell;
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only the consumer thread is allowed to call it.
+    bool TryPop(T &item)
+    {
+        Cell *cell = &cells_[head_ & mask_];
+        size_t seq = cell->sequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(head_ + 1) < 0)
+            return false;  // empty
+
+        item = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        head_++;
+        return true;
+    }
+
+    bool IsEmpty(void) const
+    {
+        return tail_.load(std::memory_order_acquire) == head_;
+    }
+
+  private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    static size_t RoundUp(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    std::unique_ptr<Cell[]> cells_;
+    const size_t mask_;
+    char pad0_[AITT_CACHE_LINE_SIZE];
+    std::atomic<size_t> tail_;
+    char pad1_[AITT_CACHE_LINE_SIZE];
+    size_t head_;
+};
+
+}  // namespace aitt
@@ -20,14 +20,21 @@
 #else
 #include "PosixMainLoop.h"
 #endif
+#ifndef TIZEN_RT
+#include "EpollMainLoop.h"
+#endif
 #include "aitt_internal.h"
 
 namespace aitt {
 
-MainLoopIface *MainLoopHandler::new_loop()
+MainLoopIface *MainLoopHandler::new_loop(Backend backend)
 {
     MainLoopIface *loop;
 
+#ifndef TIZEN_RT
+    if (backend == Backend::EPOLL)
+        return new EpollMainLoop();
+#endif
 #ifdef USE_GLIB
     loop = new GlibMainLoop();
 #else
@@ -23,10 +23,18 @@ namespace aitt {
 
 class MainLoopHandler {
   public:
+    // DEFAULT is GlibMainLoop with USE_GLIB, PosixMainLoop otherwise.
+    // A backend not built for the platform falls back to DEFAULT.
+    enum class Backend {
+        DEFAULT,
+        POLL,
+        EPOLL,
+    };
+
     MainLoopHandler() = default;
     virtual ~MainLoopHandler() = default;
 
-    static MainLoopIface *new_loop();
+    static MainLoopIface *new_loop(Backend backend = Backend::DEFAULT);
 };
 
 }  // namespace aitt
@@ -45,6 +45,9 @@ class MainLoopIface {
     virtual void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) = 0;
     virtual void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) = 0;
     virtual MainLoopData *RemoveWatch(int fd) = 0;
+    // The callback is called while the fd is writable.
+    virtual void AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) = 0;
+    virtual MainLoopData *RemoveWriteWatch(int fd) = 0;
     // @param interval milliseconds(1/1000ths of a second)
     virtual unsigned int AddTimeout(int interval, const mainLoopCB &cb,
           MainLoopData *user_data) = 0;
@@ -16,17 +16,20 @@
 #include "PosixMainLoop.h"
 
 #include <fcntl.h>
+#include <limits.h>
 #include <poll.h>
-#include <signal.h>
 #include <string.h>
-#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "aitt_internal.h"
 
 namespace aitt {
 
-PosixMainLoop::PosixMainLoop() : timeout_pipe{}, idle_pipe{}, is_running(false)
+PosixMainLoop::PosixMainLoop()
+      : timer_wheel(TimerWheel::Now()), next_timeout_id(TIMEOUT_START), timeout_pipe{},
+        idle_pipe{}, is_running(false)
 {
     if (pipe(idle_pipe) == -1 || pipe(timeout_pipe) == -1) {
         ERR("pipe() Fail(%d)", errno);
@@ -37,14 +40,6 @@ PosixMainLoop::PosixMainLoop() : timeout_pipe{}, idle_pipe{}, is_running(false)
         ERR("fcntl(O_NONBLOCK) Fail(%d)", errno);
         throw std::runtime_error("PosixMainLoop() Fail");
     }
-    struct sigaction sa;
-    sa.sa_flags = SA_SIGINFO;
-    sa.sa_sigaction = TimerHandler;
-    sigemptyset(&sa.sa_mask);
-    if (sigaction(SIGUSR1, &sa, NULL) == -1) {
-        ERR("sigaction() Fail(%d)", errno);
-        throw std::runtime_error("PosixMainLoop() Fail");
-    }
 }
 
 PosixMainLoop::~PosixMainLoop()
@@ -61,6 +56,7 @@ PosixMainLoop::~PosixMainLoop()
 
     timeout_table.clear();
     watch_table.clear();
+    write_watch_table.clear();
     idle_table.clear();
 
     for (int iter = 0; iter < 2; iter++) {
@@ -73,7 +69,9 @@ void PosixMainLoop::Run()
 {
     is_running = true;
 
-    while (is_running) {
+    // It returns after reading QUIT of Quit(). QUIT written in a callback would be left in the pipe
+    // and stop the next Run() at once if it returned with is_running.
+    while (true) {
         table_lock.lock();
         struct pollfd pfd = {0};
         std::vector<struct pollfd> pfds;
@@ -84,6 +82,14 @@ void PosixMainLoop::Run()
             pfd.revents = 0;
             pfds.push_back(pfd);
         }
+        nfds_t nfds_read = pfds.size();
+        for (auto iter = write_watch_table.begin(); iter != write_watch_table.end(); iter++) {
+            pfd.fd = iter->second->fd;
+            pfd.events = POLLOUT | POLLHUP | POLLERR;
+            pfd.revents = 0;
+            pfds.push_back(pfd);
+        }
+        int timeout = PollTimeout();
         table_lock.unlock();
 
         pfd.fd = idle_pipe[0];
@@ -96,16 +102,25 @@ void PosixMainLoop::Run()
         pfd.revents = 0;
         pfds.push_back(pfd);
 
-        if (0 < poll(pfds.data(), pfds.size(), -1)) {
-            bool handled = false;
-            int ret = CheckTimeout(pfds[pfds.size() - 1], POLLIN);
-            if (ret < 0)
-                break;
-            handled |= !!ret;
-            handled |= CheckWatch(pfds, pfds.size() - 2, POLLIN | POLLHUP | POLLERR);
-            if (!handled)
-                CheckIdle(pfds[pfds.size() - 2], POLLIN);
+        if (poll(pfds.data(), pfds.size(), timeout) == -1) {
+            if (errno == EINTR)
+                continue;
+            ERR("poll() Fail(%d)", errno);
+            break;
         }
+
+        bool handled = false;
+        int ret = CheckTimeout(pfds[pfds.size() - 1], POLLIN);
+        if (ret < 0)
+            break;
+        handled |= !!ret;
+        handled |= CheckWatch(pfds, 0, nfds_read, watch_table, POLLIN | POLLHUP | POLLERR);
+        handled |= CheckWatch(pfds, nfds_read, pfds.size() - 2, write_watch_table,
+              POLLOUT | POLLHUP | POLLERR);
+        if (!handled)
+            CheckIdle(pfds[pfds.size() - 2], POLLIN);
+
+        std::lock_guard<std::mutex> lock(table_lock);
         if (false == idle_table.empty())
             WriteToPipe(idle_pipe[1], IDLE);
     }
@@ -161,29 +176,56 @@ PosixMainLoop::MainLoopData *PosixMainLoop::RemoveWatch(int fd)
     return user_data;
 }
 
-unsigned int PosixMainLoop::AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *data)
+void PosixMainLoop::AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data)
+{
+    MainLoopCbData *cb_data = new MainLoopCbData();
+    cb_data->cb = cb;
+    cb_data->data = user_data;
+    cb_data->fd = fd;
+
+    std::lock_guard<std::mutex> lock(table_lock);
+    write_watch_table.insert(WatchMap::value_type(cb_data->fd, cb_data));
+    WriteToPipe(idle_pipe[1], PING);
+}
+
+PosixMainLoop::MainLoopData *PosixMainLoop::RemoveWriteWatch(int fd)
 {
-    static int identifier = TIMEOUT_START;
+    std::lock_guard<std::mutex> lock(table_lock);
+    WatchMap::iterator iter = write_watch_table.find(fd);
+    if (iter == write_watch_table.end()) {
+        ERR("Unknown fd(%d)", fd);
+        return nullptr;
+    }
+    MainLoopData *user_data = iter->second->data;
+    write_watch_table.erase(iter);
+    WriteToPipe(idle_pipe[1], PING);
 
+    return user_data;
+}
+
+unsigned int PosixMainLoop::AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *data)
+{
     if (interval <= 0) {
         ERR("Invalid interval(%d)", interval);
         return 0;
     }
 
-    TimeoutData *timeout_data = SetTimer(interval, identifier);
-    if (nullptr != timeout_data) {
-        MainLoopCbData *cb_data = new MainLoopCbData();
-        cb_data->cb = cb;
-        cb_data->data = data;
-        cb_data->timeout_interval = interval;
-        cb_data->timeout_data = timeout_data;
-        TimeoutTableInsert(identifier, cb_data);
-    } else {
-        ERR("SetTimer() Fail");
-        return 0;
-    }
+    MainLoopCbData *cb_data = new MainLoopCbData();
+    cb_data->cb = cb;
+    cb_data->data = data;
+    cb_data->timeout_interval = interval;
+
+    std::lock_guard<std::mutex> lock(table_lock);
+    unsigned int identifier = next_timeout_id++;
+    if (next_timeout_id < TIMEOUT_START)
+        next_timeout_id = TIMEOUT_START;
 
-    return identifier++;
+    timeout_table.insert(TimeoutMap::value_type(identifier, cb_data));
+    timer_wheel.Add(identifier, TimerWheel::Deadline(interval));
+    // poll() has to wake up earlier for the new timeout.
+    WriteToPipe(idle_pipe[1], PING);
+
+    return identifier;
 }
 
 void PosixMainLoop::RemoveTimeout(unsigned int id)
@@ -193,6 +235,7 @@ void PosixMainLoop::RemoveTimeout(unsigned int id)
     if (iter != timeout_table.end()) {
         delete iter->second;
         timeout_table.erase(iter);
+        timer_wheel.Cancel(id);
     }
 }
 
@@ -204,32 +247,30 @@ void PosixMainLoop::WriteToPipe(int pipe_fd, unsigned int identifier)
     }
 }
 
-void PosixMainLoop::TimerHandler(int sig, siginfo_t *si, void *uc)
+// It's called with table_lock.
+int PosixMainLoop::PollTimeout(void)
 {
-    TimeoutData *timeout_data = static_cast<TimeoutData *>(si->si_value.sival_ptr);
-    if (timeout_data == NULL) {
-        ERR("timeout_data is NULL");
-        return;
-    }
-    WriteToPipe(timeout_data->pipe_fd, timeout_data->timeout_id);
-}
+    uint64_t next = timer_wheel.NextExpire();
+    if (next == UINT64_MAX)
+        return -1;
 
-void PosixMainLoop::TimeoutTableInsert(unsigned int identifier, MainLoopCbData *cb_data)
-{
-    std::lock_guard<std::mutex> lock(table_lock);
-    timeout_table.insert(TimeoutMap::value_type(identifier, cb_data));
+    uint64_t now = TimerWheel::Now();
+    if (next <= now)
+        return 0;
+    return static_cast<int>(std::min<uint64_t>(next - now, INT_MAX));
 }
 
-bool PosixMainLoop::CheckWatch(const std::vector<struct pollfd> &pfds, nfds_t nfds, short int event)
+bool PosixMainLoop::CheckWatch(const std::vector<struct pollfd> &pfds, nfds_t begin, nfds_t end,
+      WatchMap &table, short int event)
 {
     bool handled = false;
-    for (nfds_t idx = 0; idx < nfds; idx++) {
+    for (nfds_t idx = begin; idx < end; idx++) {
         if (false == (pfds[idx].revents & event))
             continue;
 
         table_lock.lock();
-        auto iter = watch_table.find(pfds[idx].fd);
-        auto cb_data = (watch_table.end() == iter) ? nullptr : iter->second;
+        auto iter = table.find(pfds[idx].fd);
+        auto cb_data = (table.end() == iter) ? nullptr : iter->second;
         table_lock.unlock();
 
         if (cb_data) {
@@ -239,8 +280,12 @@ bool PosixMainLoop::CheckWatch(const std::vector<struct pollfd> &pfds, nfds_t nf
             int ret = cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
             handled = true;
 
-            if (AITT_LOOP_EVENT_REMOVE == ret)
-                RemoveWatch(pfds[idx].fd);
+            if (AITT_LOOP_EVENT_REMOVE == ret) {
+                std::lock_guard<std::mutex> lock(table_lock);
+                auto it = table.find(pfds[idx].fd);
+                if (it != table.end() && it->second == cb_data)
+                    table.erase(it);
+            }
         }
     }
     return handled;
@@ -248,19 +293,25 @@ bool PosixMainLoop::CheckWatch(const std::vector<struct pollfd> &pfds, nfds_t nf
 
 int PosixMainLoop::CheckTimeout(pollfd pfd, short int event)
 {
-    if (false == (pfd.revents & event))
-        return false;
-
-    bool handled = false;
+    // The pipe carries only QUIT. Timeouts expire on the timer wheel.
     int identifier = PING;
-    while (read(pfd.fd, &identifier, sizeof(identifier)) == sizeof(identifier)) {
+    while ((pfd.revents & event)
+          && read(pfd.fd, &identifier, sizeof(identifier)) == sizeof(identifier)) {
         if (identifier == QUIT) {
             INFO("Terminating");
             return -1;
         }
+    }
+
+    std::vector<unsigned int> expired;
+    table_lock.lock();
+    timer_wheel.Expire(TimerWheel::Now(), expired);
+    table_lock.unlock();
 
+    bool handled = false;
+    for (unsigned int id : expired) {
         table_lock.lock();
-        TimeoutMap::iterator iter = timeout_table.find(identifier);
+        TimeoutMap::iterator iter = timeout_table.find(id);
         MainLoopCbData *cb_data = iter == timeout_table.end() ? NULL : iter->second;
         table_lock.unlock();
 
@@ -268,17 +319,13 @@ int PosixMainLoop::CheckTimeout(pollfd pfd, short int event)
             int ret = cb_data->cb(cb_data->result, cb_data->fd, cb_data->data);
             handled = true;
 
-            if (AITT_LOOP_EVENT_REMOVE == ret)
-                RemoveTimeout(identifier);
-            else {
-                if (nullptr != cb_data->timeout_data) {
-                    delete cb_data->timeout_data;
-                }
-                cb_data->timeout_data = SetTimer(cb_data->timeout_interval, identifier);
-                if (nullptr == cb_data->timeout_data) {
-                    ERR("SetTimer() Fail");
-                    return -1;
-                }
+            if (AITT_LOOP_EVENT_REMOVE == ret) {
+                RemoveTimeout(id);
+            } else {
+                std::lock_guard<std::mutex> lock(table_lock);
+                iter = timeout_table.find(id);
+                if (iter != timeout_table.end() && iter->second == cb_data)
+                    timer_wheel.Add(id, TimerWheel::Deadline(cb_data->timeout_interval));
             }
         }
     }
@@ -311,64 +358,9 @@ void PosixMainLoop::CheckIdle(pollfd pfd, short int event)
     }
 }
 
-PosixMainLoop::TimeoutData *PosixMainLoop::SetTimer(int interval, unsigned int identifier)
-{
-    TimeoutData *data = new TimeoutData;
-    data->pipe_fd = timeout_pipe[1];
-    data->timeout_id = identifier;
-
-    struct sigevent se;
-    memset(&se, 0, sizeof(se));
-    se.sigev_notify = SIGEV_SIGNAL;
-    se.sigev_signo = SIGUSR1;
-    se.sigev_value.sival_ptr = static_cast<void *>(data);
-
-    timer_t timerid;
-    if (timer_create(CLOCK_MONOTONIC, &se, &timerid) == -1) {
-        ERR("timer_create() Fail(%d)", errno);
-        delete data;
-        return nullptr;
-    }
-    data->timerid = timerid;
-
-    struct itimerspec its;
-    memset(&its, 0, sizeof(its));
-
-    long sec = interval / 1000;
-    long msec = interval % 1000;
-
-    its.it_value.tv_sec = sec;
-    its.it_value.tv_nsec = msec * 1000 * 1000;
-    if (timer_settime(timerid, 0, &its, NULL) == -1) {
-        ERR("timer_settime() Fail(%d)", errno);
-        delete data;
-        return nullptr;
-    }
-    return data;
-}
-
-PosixMainLoop::TimeoutData::TimeoutData() : timerid(nullptr), timeout_id(0), pipe_fd(-1)
-{
-}
-PosixMainLoop::TimeoutData::~TimeoutData()
-{
-    if (nullptr != timerid) {
-        if (timer_delete(timerid) == -1) {
-            ERR("timer_delete() Fail(%d)", errno);
-        }
-    }
-}
-
 PosixMainLoop::MainLoopCbData::MainLoopCbData()
-      : data(nullptr), result(Event::OKAY), fd(IDLE), timeout_interval(0), timeout_data(nullptr)
+      : data(nullptr), result(Event::OKAY), fd(IDLE), timeout_interval(0)
 {
 }
 
-PosixMainLoop::MainLoopCbData::~MainLoopCbData()
-{
-    if (nullptr != timeout_data) {
-        delete timeout_data;
-    }
-}
-
 }  // namespace aitt
@@ -16,9 +16,8 @@
 #pragma once
 
 #include <poll.h>
-#include <signal.h>
-#include <time.h>
 
+#include <atomic>
 #include <deque>
 #include <map>
 #include <memory>
@@ -26,6 +25,7 @@
 #include <vector>
 
 #include "MainLoopIface.h"
+#include "TimerWheel.h"
 
 namespace aitt {
 
@@ -39,6 +39,8 @@ class PosixMainLoop : public MainLoopIface {
     void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) override;
     void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
     MainLoopData *RemoveWatch(int fd) override;
+    void AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override;
+    MainLoopData *RemoveWriteWatch(int fd) override;
     unsigned int AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *user_data) override;
     void RemoveTimeout(unsigned int id) override;
 
@@ -49,23 +51,13 @@ class PosixMainLoop : public MainLoopIface {
         TIMEOUT_START = 2,
     };
 
-    struct TimeoutData {
-        TimeoutData();
-        ~TimeoutData();
-        timer_t timerid;
-        unsigned int timeout_id;
-        int pipe_fd;
-    };
-
     struct MainLoopCbData {
         MainLoopCbData();
-        ~MainLoopCbData();
         mainLoopCB cb;
         MainLoopData *data;
         Event result;
         int fd;
         int timeout_interval;
-        TimeoutData *timeout_data;
     };
 
     using WatchMap = std::map<int, std::shared_ptr<MainLoopCbData>>;
@@ -73,22 +65,24 @@ class PosixMainLoop : public MainLoopIface {
     using IdleQueue = std::deque<MainLoopCbData *>;
 
     static void WriteToPipe(int pipe_fd, unsigned int identifier);
-    static void TimerHandler(int sig, siginfo_t *si, void *uc);
 
   private:
-    void TimeoutTableInsert(unsigned int identifier, MainLoopCbData *cb_data);
-    bool CheckWatch(const std::vector<struct pollfd> &pfds, nfds_t nfds, short int event);
+    int PollTimeout(void);
+    bool CheckWatch(const std::vector<struct pollfd> &pfds, nfds_t begin, nfds_t end,
+          WatchMap &table, short int event);
     int CheckTimeout(pollfd pfd, short int event);
     void CheckIdle(pollfd pfd, short int event);
-    TimeoutData *SetTimer(int interval, unsigned int identifier);
 
     WatchMap watch_table;
+    WatchMap write_watch_table;
     TimeoutMap timeout_table;
     IdleQueue idle_table;
+    TimerWheel timer_wheel;
+    unsigned int next_timeout_id;
     std::mutex table_lock;
     int timeout_pipe[2];
     int idle_pipe[2];
-    bool is_running;
+    std::atomic_bool is_running;
 };
 
 }  // namespace aitt
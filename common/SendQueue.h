@@ -0,0 +1,180 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <AittTypes.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace aitt {
+
+// Bounded queue of messages waiting to be sent to one peer.
+// Publishers push and the loop thread of the module pops.
+// When it's full, the overflow policy decides what happens to a new message.
+template <typename T>
+class SendQueue {
+  public:
+    struct Stats {
+        Stats() : enqueued(0), sent(0), dropped(0), blocked(0), depth(0) {}
+
+        uint64_t enqueued;
+        uint64_t sent;
+        uint64_t dropped;
+        uint64_t blocked;  // how many times a publisher waited for room
+        size_t depth;
+    };
+
+    SendQueue(size_t capacity, AittSendOverflow policy)
+          : capacity_(capacity ? capacity : 1), policy_(policy), closed_(false)
+    {
+    }
+
+    // It returns false when the item is dropped.
+    // If can_block is false, AITT_SEND_OVERFLOW_BLOCK lets the queue grow over the capacity.
+    // It's for the loop thread which can't wait for itself.
+    bool Push(T &&item, bool can_block = true)
+    {
+        std::unique_lock<std::mutex> lock(lock_);
+        if (closed_ == false && items_.size() >= capacity_) {
+            switch (policy_) {
+            case AITT_SEND_OVERFLOW_DROP_NEWEST:
+                stats_.dropped++;
+                return false;
+            case AITT_SEND_OVERFLOW_DROP_OLDEST:
+                items_.pop_front();
+                stats_.dropped++;
+                break;
+            case AITT_SEND_OVERFLOW_BLOCK:
+            default:
+                if (can_block == false)
+                    break;
+                stats_.blocked++;
+                cond_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+                break;
+            }
+        }
+
+        if (closed_) {
+            stats_.dropped++;
+            return false;
+        }
+
+        items_.push_back(std::move(item));
+        stats_.enqueued++;
+        return true;
+    }
+
+    bool Pop(T &item)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (items_.empty())
+            return false;
+
+        item = std::move(items_.front());
+        items_.pop_front();
+        cond_.notify_one();
+        return true;
+    }
+
+    // Count a message popped and written to the peer completely.
+    void Sent(void)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        stats_.sent++;
+    }
+
+    // Count a message popped and failed to be sent.
+    void Dropped(void)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        stats_.dropped++;
+    }
+
+    // Drop every queued message and count them with the given number of in-flight ones.
+    void Clear(size_t in_flight = 0)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        stats_.dropped += items_.size() + in_flight;
+        items_.clear();
+        cond_.notify_all();
+    }
+
+    // Drop queued messages but the ones kept, and count them with the in-flight ones.
+    template <typename Keep>
+    void Clear(size_t in_flight, Keep keep)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        size_t size = items_.size();
+        items_.erase(std::remove_if(items_.begin(), items_.end(),
+                           [&keep](const T &item) { return keep(item) == false; }),
+              items_.end());
+        stats_.dropped += size - items_.size() + in_flight;
+        cond_.notify_all();
+    }
+
+    // Wake up the blocked publishers. Items pushed after it are dropped.
+    void Close(void)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        closed_ = true;
+        cond_.notify_all();
+    }
+
+    size_t GetCapacity(void) const { return capacity_; }
+
+    bool IsEmpty(void)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        return items_.empty();
+    }
+
+    Stats GetStats(void)
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        Stats stats = stats_;
+        stats.depth = items_.size();
+        return stats;
+    }
+
+    // The counters reported by AITT::GetPeerStats()
+    AittPeerStats GetPeerStats(void)
+    {
+        Stats stats = GetStats();
+        AittPeerStats peer_stats;
+        peer_stats.enqueued = stats.enqueued;
+        peer_stats.sent = stats.sent;
+        peer_stats.dropped = stats.dropped;
+        peer_stats.blocked = stats.blocked;
+        peer_stats.depth = static_cast<int>(stats.depth);
+        return peer_stats;
+    }
+
+  private:
+    const size_t capacity_;
+    const AittSendOverflow policy_;
+    std::mutex lock_;
+    std::condition_variable cond_;
+    std::deque<T> items_;
+    bool closed_;
+    Stats stats_;
+};
+
+}  // namespace aitt
@@ -0,0 +1,189 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#define AITT_TIMER_WHEEL_LEVELS 4
+#define AITT_TIMER_WHEEL_SLOT_BITS 6
+#define AITT_TIMER_WHEEL_SLOTS (1 << AITT_TIMER_WHEEL_SLOT_BITS)
+
+namespace aitt {
+
+// Hierarchical timer wheel with a tick of a millisecond.
+// Adding, cancelling and re-arming a timer cost O(1). Timers of an upper level move down
+// to the lower levels as the time goes, and the ones beyond the top level wait there
+// until they come within range. It isn't thread-safe.
+class TimerWheel {
+  public:
+    explicit TimerWheel(uint64_t now) : current_(now), size_(0), level_size_() {}
+
+    static uint64_t Now(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / (1000 * 1000);
+    }
+
+    // Now() drops the fraction of a millisecond, so it rounds up not to expire early.
+    static uint64_t Deadline(int interval) { return Now() + interval + 1; }
+
+    // A timer added again with the same id is re-armed.
+    void Add(unsigned int id, uint64_t expire)
+    {
+        Cancel(id);
+        Insert(Timer{id, std::max(expire, current_ + 1)});
+    }
+
+    bool Cancel(unsigned int id)
+    {
+        auto it = index_.find(id);
+        if (it == index_.end())
+            return false;
+
+        const Position &pos = it->second;
+        slots_[pos.level][pos.slot].erase(pos.timer);
+        level_size_[pos.level]--;
+        size_--;
+        index_.erase(it);
+        return true;
+    }
+
+    // Append ids of the timers expired until now in the order of their expiration.
+    void Expire(uint64_t now, std::vector<unsigned int> &expired)
+    {
+        if (size_ == 0)
+            current_ = std::max(current_, now);
+
+        while (current_ < now) {
+            // Jump over the ticks of the empty lower levels to the next cascade.
+            int empty_levels = 0;
+            while (empty_levels < AITT_TIMER_WHEEL_LEVELS - 1 && level_size_[empty_levels] == 0)
+                empty_levels++;
+            if (empty_levels) {
+                uint64_t boundary = current_ | (Span(empty_levels) - 1);
+                current_ = std::min(boundary, now - 1);
+            }
+
+            current_++;
+            for (int level = Cascades(current_); 0 < level; level--)
+                Cascade(level);
+
+            std::list<Timer> &slot = slots_[0][SlotIndex(current_, 0)];
+            while (slot.empty() == false) {
+                expired.push_back(slot.front().id);
+                index_.erase(slot.front().id);
+                slot.pop_front();
+                level_size_[0]--;
+                size_--;
+            }
+        }
+    }
+
+    // The time to call Expire() next, or UINT64_MAX without timers.
+    // It can be earlier than the first timer when timers of an upper level have to move down.
+    uint64_t NextExpire(void) const
+    {
+        uint64_t next = UINT64_MAX;
+        for (int level = 0; level < AITT_TIMER_WHEEL_LEVELS; level++) {
+            if (level_size_[level] == 0)
+                continue;
+
+            uint64_t base = current_ >> (AITT_TIMER_WHEEL_SLOT_BITS * level);
+            for (uint64_t i = 1; i <= AITT_TIMER_WHEEL_SLOTS; i++) {
+                if (slots_[level][(base + i) % AITT_TIMER_WHEEL_SLOTS].empty())
+                    continue;
+                next = std::min(next, (base + i) << (AITT_TIMER_WHEEL_SLOT_BITS * level));
+                break;
+            }
+        }
+        return next;
+    }
+
+    size_t Size(void) const { return size_; }
+
+  private:
+    struct Timer {
+        unsigned int id;
+        uint64_t expire;
+    };
+
+    struct Position {
+        int level;
+        size_t slot;
+        std::list<Timer>::iterator timer;
+    };
+
+    static uint64_t Span(int level)
+    {
+        return static_cast<uint64_t>(1) << (AITT_TIMER_WHEEL_SLOT_BITS * level);
+    }
+
+    static size_t SlotIndex(uint64_t time, int level)
+    {
+        return (time >> (AITT_TIMER_WHEEL_SLOT_BITS * level)) % AITT_TIMER_WHEEL_SLOTS;
+    }
+
+    // The highest level whose slot moves down at the time
+    static int Cascades(uint64_t time)
+    {
+        int level = 0;
+        while (level < AITT_TIMER_WHEEL_LEVELS - 1 && time % Span(level + 1) == 0)
+            level++;
+        return level;
+    }
+
+    void Insert(const Timer &timer)
+    {
+        uint64_t delta = timer.expire - current_;
+        int level = 0;
+        while (level < AITT_TIMER_WHEEL_LEVELS - 1 && Span(level + 1) <= delta)
+            level++;
+
+        // Beyond the top level, it waits in the farthest slot and is inserted again later.
+        uint64_t expire = std::min(timer.expire, current_ + Span(level + 1) - 1);
+        size_t slot = SlotIndex(expire, level);
+        std::list<Timer> &list = slots_[level][slot];
+        list.push_back(timer);
+        index_[timer.id] = Position{level, slot, std::prev(list.end())};
+        level_size_[level]++;
+        size_++;
+    }
+
+    void Cascade(int level)
+    {
+        std::list<Timer> timers;
+        timers.swap(slots_[level][SlotIndex(current_, level)]);
+        level_size_[level] -= timers.size();
+        size_ -= timers.size();
+        for (const auto &timer : timers)
+            Insert(timer);
+    }
+
+    std::list<Timer> slots_[AITT_TIMER_WHEEL_LEVELS][AITT_TIMER_WHEEL_SLOTS];
+    std::unordered_map<unsigned int, Position> index_;
+    uint64_t current_;
+    size_t size_;
+    size_t level_size_[AITT_TIMER_WHEEL_LEVELS];
+};
+
+}  // namespace aitt
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define AITT_TOPIC_SEPARATOR '/'
+#define AITT_TOPIC_SINGLE_LEVEL "+"
+#define AITT_TOPIC_MULTI_LEVEL "#"
+
+namespace aitt {
+
+// Helpers to handle MQTT topics level by level.
+// As MQTT defines, wildcards on the first level don't match topics beginning with '$'.
+class TopicFilter {
+  public:
+    // Compare one filter with a topic.
+    static bool Matches(const std::string &filter, const std::string &topic)
+    {
+        bool is_system = IsSystemTopic(topic);
+        size_t filter_pos = 0;
+        size_t topic_pos = 0;
+        bool first = true;
+
+        while (filter_pos != std::string::npos) {
+            std::string filter_level = NextLevel(filter, filter_pos);
+            if (filter_level == AITT_TOPIC_MULTI_LEVEL)
+                return !(first && is_system);
+            if (topic_pos == std::string::npos)
+                return false;
+
+            std::string topic_level = NextLevel(topic, topic_pos);
+            if (filter_level == AITT_TOPIC_SINGLE_LEVEL) {
+                if (first && is_system)
+                    return false;
+            } else if (filter_level != topic_level) {
+                return false;
+            }
+            first = false;
+        }
+        return topic_pos == std::string::npos;
+    }
+
+    static bool IsSystemTopic(const std::string &topic)
+    {
+        return topic.empty() == false && topic[0] == '$';
+    }
+
+    // It returns the level beginning at start and moves start to the next level,
+    // or to npos after the last one.
+    static std::string NextLevel(const std::string &topic, size_t &start)
+    {
+        size_t end = topic.find(AITT_TOPIC_SEPARATOR, start);
+        std::string level = topic.substr(start, end - start);
+        start = (end == std::string::npos) ? std::string::npos : end + 1;
+        return level;
+    }
+};
+
+// MQTT topic filters split by levels.
+// Looking up the filters matched with a topic costs O(depth of the topic)
+// instead of comparing the topic with every filter.
+template <typename T>
+class TopicTrie {
+  public:
+    TopicTrie() : root_(new Node()), size_(0) {}
+
+    void Insert(const std::string &filter, const T &value)
+    {
+        Node *node = root_.get();
+        size_t start = 0;
+        do {
+            std::unique_ptr<Node> &child = node->children[TopicFilter::NextLevel(filter, start)];
+            if (child == nullptr)
+                child.reset(new Node());
+            node = child.get();
+        } while (start != std::string::npos);
+
+        node->values.push_back(value);
+        size_++;
+    }
+
+    // It removes one value inserted with the same filter.
+    bool Remove(const std::string &filter, const T &value)
+    {
+        bool removed = false;
+        Remove(root_.get(), filter, 0, value, removed);
+        if (removed)
+            size_--;
+        return removed;
+    }
+
+    void Clear(void)
+    {
+        root_.reset(new Node());
+        size_ = 0;
+    }
+
+    // func is called with every value whose filter matches the topic.
+    template <typename Func>
+    void Match(const std::string &topic, Func func) const
+    {
+        Match(root_.get(), topic, 0, TopicFilter::IsSystemTopic(topic), func);
+    }
+
+    size_t Count(const std::string &topic) const
+    {
+        size_t count = 0;
+        Match(topic, [&count](const T &) { count++; });
+        return count;
+    }
+
+    size_t Size(void) const { return size_; }
+
+  private:
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        std::vector<T> values;
+    };
+
+    const Node *Child(const Node *node, const char *level) const
+    {
+        auto it = node->children.find(level);
+        return (it == node->children.end()) ? nullptr : it->second.get();
+    }
+
+    // start is the beginning of the current level, npos when every level is consumed.
+    template <typename Func>
+    void Match(const Node *node, const std::string &topic, size_t start, bool system_first,
+          Func &func) const
+    {
+        // "a/#" matches "a" as well as "a/b/c".
+        const Node *multi = Child(node, AITT_TOPIC_MULTI_LEVEL);
+        if (multi && system_first == false) {
+            for (const auto &value : multi->values)
+                func(value);
+        }
+
+        if (start == std::string::npos) {
+            for (const auto &value : node->values)
+                func(value);
+            return;
+        }
+
+        std::string level = TopicFilter::NextLevel(topic, start);
+        auto it = node->children.find(level);
+        if (it != node->children.end() && level != AITT_TOPIC_SINGLE_LEVEL
+              && level != AITT_TOPIC_MULTI_LEVEL)
+            Match(it->second.get(), topic, start, false, func);
+
+        const Node *single = Child(node, AITT_TOPIC_SINGLE_LEVEL);
+        if (single && system_first == false)
+            Match(single, topic, start, false, func);
+    }
+
+    // It returns true when the node has nothing and can be pruned.
+    bool Remove(Node *node, const std::string &filter, size_t start, const T &value,
+          bool &removed)
+    {
+        if (start == std::string::npos) {
+            auto it = std::find(node->values.begin(), node->values.end(), value);
+            if (it != node->values.end()) {
+                node->values.erase(it);
+                removed = true;
+            }
+        } else {
+            auto it = node->children.find(TopicFilter::NextLevel(filter, start));
+            if (it == node->children.end())
+                return false;
+            if (Remove(it->second.get(), filter, start, value, removed))
+                node->children.erase(it);
+        }
+        return node->values.empty() && node->children.empty();
+    }
+
+    std::unique_ptr<Node> root_;
+    size_t size_;
+};
+
+}  // namespace aitt
@@ -25,6 +25,10 @@
 #define AITT_MANAGED_TOPIC_PREFIX "/v1/custom/f5c7b34e48c1918f/"
 #define DISCOVERY_TOPIC_BASE std::string(AITT_MANAGED_TOPIC_PREFIX "discovery/")
 #define RESPONSE_POSTFIX "_AittRe_"
+#define REPLY_TOPIC_BASE std::string(AITT_MANAGED_TOPIC_PREFIX "reply/")
+// How long a responder holds a reply until it discovers the reply topic, and replies held at most
+#define AITT_REPLY_HOLD_TIMEOUT_MS 1000
+#define AITT_REPLY_HOLD_MAX 256
 
 // Specification MQTT-4.7.3-3
 #define AITT_TOPIC_NAME_MAX 65535
@@ -22,6 +22,7 @@
 #include <AittTypes.h>
 
 #include <functional>
+#include <map>
 #include <memory>
 #include <string>
 
@@ -35,6 +36,7 @@ class API AITT {
   public:
     using SubscribeCallback = AittMsgCB;
     using ConnectionCallback = std::function<void(AITT &, int, void *user_data)>;
+    using PublishCallback = std::function<void(int result, void *user_data)>;
 
     explicit AITT(const std::string notice);
     explicit AITT(const std::string &id, const std::string &ip_addr,
@@ -53,10 +55,23 @@ class API AITT {
     void Publish(const std::string &topic, const void *data, const int datalen,
           AittProtocol protocols = AITT_TYPE_MQTT, AittQoS qos = AITT_QOS_AT_MOST_ONCE,
           bool retain = false);
+    // It publishes through the MQTT, and the callback is called on the AITT thread with
+    // AITT_ERROR_NONE when the broker acknowledges the message or the message of
+    // AITT_QOS_AT_MOST_ONCE is sent.
+    void PublishAsync(const std::string &topic, const void *data, const int datalen, AittQoS qos,
+          bool retain, const PublishCallback &cb, void *user_data = nullptr);
+    // It publishes the messages in order with one check of the state, and the transports
+    // look up the subscribers once for each topic and send them together.
+    void PublishBatch(const AittBatchMessage *messages, int count,
+          AittProtocol protocols = AITT_TYPE_MQTT, AittQoS qos = AITT_QOS_AT_MOST_ONCE,
+          bool retain = false);
     void PublishWithReply(const std::string &topic, const void *data, const int datalen,
           AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb,
           void *cbdata, const std::string &correlation);
 
+    // It returns AITT_ERROR_TIMED_OUT when no reply comes in timeout_ms. Called in a subscriber
+    // callback of a transport protocol, it returns AITT_ERROR_NOT_SUPPORTED for the same
+    // protocol, whose replies would come on the waiting thread.
     int PublishWithReplySync(const std::string &topic, const void *data, const int datalen,
           AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb,
           void *cbdata, const std::string &correlation, int timeout_ms = 0);
@@ -65,6 +80,8 @@ class API AITT {
           void *cbdata = nullptr, AittProtocol protocol = AITT_TYPE_MQTT,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE);
     void *Unsubscribe(AittSubscribeID handle);
+    // It works with AittOption::SetLocalDelivery(). The default is AITT_REMOTE_ALWAYS.
+    void SetRemotePolicy(const std::string &topic, AittRemotePolicy policy);
 
     void SendReply(AittMsg *msg, const void *data, const int datalen, bool end = true);
 
@@ -73,7 +90,11 @@ class API AITT {
     void DestroyStream(AittStream *aitt_stream);
     int CountSubscriber(const std::string &topic,
           AittProtocol protocols = (AittProtocol)(AITT_TYPE_MQTT | AITT_TYPE_TCP
-                                                  | AITT_TYPE_TCP_SECURE));
+                                                  | AITT_TYPE_TCP_SECURE | AITT_TYPE_SHM
+                                                  | AITT_TYPE_UDS));
+    AittPublishStats GetPublishStats(void);
+    // Send queue counters of the peers of a transport protocol, by their client IDs
+    std::map<std::string, AittPeerStats> GetPeerStats(AittProtocol protocol);
 
   private:
     class Impl;
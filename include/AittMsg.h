@@ -15,11 +15,16 @@
  */
 #pragma once
 
+#include <AittMsgBuffer.h>
 #include <AittTypes.h>
 
 #include <functional>
+#include <memory>
 #include <string>
 
+// Copies of an AittMsg share the header(topic, correlation, response topic and sequence).
+// It's copied only when a copy modifies it, so handing a received message to many subscribers
+// doesn't rebuild the header for each of them.
 class API AittMsg {
   public:
     AittMsg();
@@ -37,17 +42,29 @@ class API AittMsg {
     int GetSequence() const;
     void SetEndSequence(bool end);
     bool IsEndSequence() const;
+    // The number of a chunk delivered by itself with AittOption::SetStreamChunks(), from 1.
+    // It's 0 for a whole payload.
+    void SetChunk(int num);
+    int GetChunk() const;
+    void SetLastChunk(bool last);
+    bool IsLastChunk() const;
     void SetProtocol(AittProtocol protocol);
     AittProtocol GetProtocol() const;
+    void SetPayload(const AittMsgBuffer &payload);
+    const AittMsgBuffer &GetPayload() const;
 
   private:
-    std::string topic_;
-    std::string correlation_;
-    std::string reply_topic_;
-    int sequence;
-    bool end_sequence;
+    struct Header;
+
+    const Header &GetHeader() const;
+    Header &MutableHeader();
+
+    std::shared_ptr<Header> header_;
     AittSubscribeID id_;
     AittProtocol protocol_;
+    int chunk_;
+    bool last_chunk_;
+    AittMsgBuffer payload_;
 };
 
 using AittMsgCB =
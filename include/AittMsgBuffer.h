@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <AittTypes.h>
+
+#include <atomic>
+#include <memory>
+
+// Reference-counted payload of a received message.
+// Copies of an AittMsgBuffer share the same memory. A transport may lend its own memory for
+// the delivery only, so to keep the payload after the callback returns, a subscriber calls
+// Retain() in the callback and keeps a copy of AittMsg::GetPayload().
+class API AittMsgBuffer {
+  public:
+    AittMsgBuffer();
+
+    // Borrow the memory of the transport. It's only valid while the message is delivered.
+    static AittMsgBuffer Wrap(const void *data, int datalen);
+    // Take the ownership of the memory allocated by malloc().
+    static AittMsgBuffer Adopt(void *data, int datalen);
+
+    const void *GetData() const;
+    int GetSize() const;
+    bool IsRetained() const;
+    // Make the payload owned by the buffer. Borrowed memory is copied at most once and
+    // the copy is shared with every other AittMsgBuffer of the same message.
+    // It must be called while the message is delivered, and subscribers on other threads may
+    // call it at the same time.
+    bool Retain() const;
+
+  private:
+    struct Storage {
+        Storage(const void *borrowed, int datalen, void *owned);
+        ~Storage();
+
+        const void *borrowed;
+        int datalen;
+        std::atomic<void *> owned;  // set once, by Adopt() or the first Retain()
+    };
+
+    explicit AittMsgBuffer(const std::shared_ptr<Storage> &storage);
+
+    std::shared_ptr<Storage> storage_;
+};
@@ -37,6 +37,38 @@ class API AittOption {
     const char *GetRootCA() const;
     int SetCustomRWFile(const std::string &file);
     const char *GetCustomRWFile() const;
+    // Number of threads running MQTT subscription callbacks. The default is 1.
+    int SetWorkerThreads(int num);
+    int GetWorkerThreads() const;
+    // Let an idle worker thread take subscriptions queued on a busy one.
+    void SetWorkStealing(bool val);
+    bool GetWorkStealing() const;
+    // Number of messages queued for each TCP peer. The default is 256.
+    int SetSendQueueSize(int size);
+    int GetSendQueueSize() const;
+    // What to do when the send queue of a TCP peer is full. The default is blocking the publisher.
+    int SetSendOverflowPolicy(AittSendOverflow policy);
+    AittSendOverflow GetSendOverflowPolicy() const;
+    // Number of MQTT messages waiting for their acknowledgements. The default is 0, unlimited.
+    int SetMaxInflight(int num);
+    int GetMaxInflight() const;
+    // Block the publisher while the MQTT in-flight window is full. Otherwise, Publish() throws
+    // AittException::RESOURCE_BUSY_ERR. The default is true.
+    void SetInflightBlocking(bool val);
+    bool GetInflightBlocking() const;
+    // Deliver messages to the subscribers of the same AITT in the process, not through
+    // the transports. Transports leave those subscribers out. The default is false.
+    void SetLocalDelivery(bool val);
+    bool GetLocalDelivery() const;
+    // Deliver a TCP message larger than a chunk as its chunks arrive, instead of reassembling it.
+    // The callback gets the chunks in order, numbered by AittMsg::GetChunk() and the last one
+    // marked by AittMsg::IsLastChunk(). Requests are still reassembled. The default is false.
+    void SetStreamChunks(bool val);
+    bool GetStreamChunks() const;
+    // Number of threads receiving TCP messages, with the connections accepted spread over them.
+    // 0 is one for each CPU, pinned to it. The default is 1, the thread sending messages.
+    int SetReceiveThreads(int num);
+    int GetReceiveThreads() const;
 
   private:
     bool clean_session_;
@@ -45,4 +77,13 @@ class API AittOption {
     std::string location_id;
     std::string root_ca;
     std::string custom_rw_file;
+    int worker_threads;
+    bool work_stealing;
+    int send_queue_size;
+    AittSendOverflow send_overflow;
+    int max_inflight;
+    bool inflight_blocking;
+    bool local_delivery;
+    bool stream_chunks;
+    int receive_threads;
 };
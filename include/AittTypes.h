@@ -24,6 +24,8 @@ enum AittProtocol {
     AITT_TYPE_MQTT = (0x1 << 0),        // Publish message through the MQTT
     AITT_TYPE_TCP = (0x1 << 1),         // Publish message to peers using the TCP
     AITT_TYPE_TCP_SECURE = (0x1 << 2),  // Publish message to peers using the Secure TCP
+    AITT_TYPE_SHM = (0x1 << 3),         // Publish message to peers on the same host using the SHM
+    AITT_TYPE_UDS = (0x1 << 4),         // Publish message to peers on the same host using the UDS
 };
 
 enum AittStreamProtocol {
@@ -53,6 +55,46 @@ enum AittQoS {
     AITT_QOS_EXACTLY_ONCE = 2,   // Receiver only receives exactly once
 };
 
+// What a publisher does when the send queue of a TCP peer is full.
+enum AittSendOverflow {
+    AITT_SEND_OVERFLOW_BLOCK = 0,        // Wait until the queue has room
+    AITT_SEND_OVERFLOW_DROP_OLDEST = 1,  // Drop the oldest queued message
+    AITT_SEND_OVERFLOW_DROP_NEWEST = 2,  // Drop the new message
+};
+
+// Where a message goes besides the subscribers of the same AITT, with the local delivery
+enum AittRemotePolicy {
+    AITT_REMOTE_ALWAYS = 0,        // Send to remote subscribers as well
+    AITT_REMOTE_NEVER = 1,         // Deliver only to the subscribers of the same AITT
+    AITT_REMOTE_UNLESS_LOCAL = 2,  // Send to remote subscribers when there is no local one
+};
+
+// A message of a batch publish. The topic and the data are used only during the call.
+struct AittBatchMessage {
+    const char *topic;
+    const void *data;
+    int datalen;
+};
+
+// Counters of the messages published through the MQTT. Without the in-flight window
+// (AittOption::SetMaxInflight()), only the messages with a completion callback are counted.
+struct AittPublishStats {
+    int inflight;                   // Messages waiting for their completions
+    int peak_inflight;              // The highest number of in-flight messages
+    unsigned long long completed;   // Messages acknowledged, or sent with AITT_QOS_AT_MOST_ONCE
+    unsigned long long failed;      // Messages refused by the broker or lost by a disconnection
+    unsigned long long overflowed;  // Publishes failed with the full in-flight window
+};
+
+// Counters of the send queue to a peer of TCP, TCP_SECURE or UDS, from its connection
+struct AittPeerStats {
+    unsigned long long enqueued;  // Messages pushed to the queue
+    unsigned long long sent;      // Messages written to the peer completely
+    unsigned long long dropped;   // Messages dropped by the overflow policy or a send failure
+    unsigned long long blocked;   // How many times a publisher waited for room
+    int depth;                    // Messages waiting in the queue now
+};
+
 enum AittConnectionState {
     AITT_DISCONNECTED = 0,    // The connection is disconnected.
     AITT_CONNECTED = 1,       // A connection was successfully established to the mqtt broker.
@@ -33,6 +33,8 @@ class MQ {
 
     using SubscribeCallback = AittMsgCB;
     using MQConnectionCallback = std::function<void(int)>;
+    // The result is AITT_ERROR_NONE, or an error of AittError.
+    using PublishCallback = std::function<void(int result)>;
 
     static constexpr const char *const MODULE_ENTRY_NAME = DEFINE_TO_STR(AITT_MQ_NEW);
 
@@ -47,6 +49,23 @@ class MQ {
     virtual void Disconnect(void) = 0;
     virtual void Publish(const std::string &topic, const void *data, const int datalen, int qos = 0,
           bool retain = false) = 0;
+    // The callback is called when the broker acknowledges the message(PUBACK of QoS 1 and
+    // PUBCOMP of QoS 2) or the message of QoS 0 is sent.
+    // A module without completions calls back at once, AITT_ERROR_NOT_SUPPORTED with QoS 1 and 2.
+    virtual void PublishAsync(const std::string &topic, const void *data, const int datalen,
+          int qos, bool retain, const PublishCallback &cb)
+    {
+        Publish(topic, data, datalen, qos, retain);
+        if (cb)
+            cb(qos == AITT_QOS_AT_MOST_ONCE ? AITT_ERROR_NONE : AITT_ERROR_NOT_SUPPORTED);
+    }
+    // It publishes the messages in order and stops at the first one failed.
+    virtual void PublishBatch(const AittBatchMessage *messages, int count, int qos = 0,
+          bool retain = false)
+    {
+        for (int i = 0; i < count; i++)
+            Publish(messages[i].topic, messages[i].data, messages[i].datalen, qos, retain);
+    }
     virtual void PublishWithReply(const std::string &topic, const void *data, const int datalen,
           int qos, bool retain, const std::string &reply_topic, const std::string &correlation) = 0;
     virtual void SendReply(AittMsg *msg, const void *data, const int datalen, int qos,
@@ -55,6 +74,8 @@ class MQ {
           void *user_data = nullptr, int qos = 0) = 0;
     virtual void *Unsubscribe(void *handle) = 0;
     virtual bool CompareTopic(const std::string &left, const std::string &right) = 0;
+    // A module without the counters returns them zeroed.
+    virtual AittPublishStats GetPublishStats(void) { return AittPublishStats(); }
 };
 
 }  // namespace aitt
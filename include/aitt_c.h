@@ -63,6 +63,17 @@ typedef enum AittProtocol aitt_protocol_e;
  */
 typedef enum AittQoS aitt_qos_e;
 
+/**
+ * @brief Enumeration for where a message goes besides the subscribers of the same AITT.
+ * @see aitt_set_remote_policy()
+ */
+typedef enum AittRemotePolicy aitt_remote_policy_e;
+
+/**
+ * @brief @a aitt_batch_msg_s is a message of aitt_publish_batch().
+ */
+typedef struct AittBatchMessage aitt_batch_msg_s;
+
 /**
  * @brief Enumeration for AITT error code.
  */
@@ -153,6 +164,22 @@ typedef enum {
     AITT_OPT_ROOT_CA = 6, /**< Root CA of Custom broker. Must set after @a AITT_OPT_CUSTOM_BROKER */
     AITT_OPT_CUSTOM_RW_FILE =
           7, /**< Custom read/write file path. Must set after @a AITT_OPT_CUSTOM_BROKER */
+    AITT_OPT_WORKER_THREADS = 8, /**< Number of threads running subscription callbacks */
+    AITT_OPT_WORK_STEALING = 9,  /**< A Boolean value whether idle worker threads steal
+                                    callbacks queued on busy ones */
+    AITT_OPT_SEND_QUEUE_SIZE = 10, /**< Number of messages queued for each TCP peer */
+    AITT_OPT_SEND_OVERFLOW = 11,   /**< What to do when the send queue of a TCP peer is full.
+                                      One of "block", "drop_oldest" and "drop_newest" */
+    AITT_OPT_LOCAL_DELIVERY = 12,  /**< A Boolean value whether messages to the subscribers of
+                                      the same AITT are delivered in the process */
+    AITT_OPT_MAX_INFLIGHT = 13,    /**< Number of MQTT messages waiting for their
+                                      acknowledgements. 0 is unlimited */
+    AITT_OPT_STREAM_CHUNKS = 14,   /**< A Boolean value whether a large TCP message is
+                                      delivered in chunks as they arrive */
+    AITT_OPT_RECEIVE_THREADS = 15, /**< Number of threads receiving TCP messages.
+                                      0 is one for each CPU */
+    AITT_OPT_INFLIGHT_BLOCKING = 16, /**< A Boolean value whether publishers wait while the
+                                        MQTT in-flight window is full */
 
 } aitt_option_e;
 
@@ -294,6 +321,26 @@ int aitt_publish(aitt_h handle, const char *topic, const void *msg, const int ms
 int aitt_publish_full(aitt_h handle, const char *topic, const void *msg, const int msg_len,
       int protocols, aitt_qos_e qos);
 
+/**
+ * @brief Publish messages in order as aitt_publish_full() with one call.
+ * @details Subscribers are looked up once for each topic, and the messages to a subscriber are
+ *          sent together.
+ * @privlevel public
+ * @param[in] handle Handle of AITT service
+ * @param[in] msgs array of the messages. The size of each message is between 0 and 268,435,455.
+ * @param[in] count the number of the messages in @c msgs.
+ * @param[in] protocols value of @a aitt_protocol_e. The value can be bitwise-or'd.
+ * @param[in] qos integer value 0, 1 or 2 indicating the Quality of Service.
+ * @return @c 0 on success
+ *         otherwise a negative error value
+ * @retval #AITT_ERROR_NONE  Success
+ * @retval #AITT_ERROR_INVALID_PARAMETER Invalid parameter
+ * @retval #AITT_ERROR_NOT_READY Not connected
+ * @retval #AITT_ERROR_SYSTEM System errors
+ */
+int aitt_publish_batch(aitt_h handle, const aitt_batch_msg_s *msgs, int count, int protocols,
+      aitt_qos_e qos);
+
 /**
  * @brief Publish a message on a given topic as aitt_publish_full(),
  *        but takes reply topic and callback for the reply.
@@ -397,6 +444,22 @@ int aitt_subscribe_full(aitt_h handle, const char *topic, aitt_sub_fn cb, void *
  */
 int aitt_unsubscribe(aitt_h handle, aitt_sub_h sub_handle);
 
+/**
+ * @brief Set whether messages of a topic go to remote subscribers.
+ * @details It works with the @a AITT_OPT_LOCAL_DELIVERY. Messages are delivered to the
+ *          subscribers of the same AITT in the process, and the policy decides whether
+ *          they are sent through the transports as well.
+ * @privlevel public
+ * @param[in] handle Handle of AITT service
+ * @param[in] topic null terminated string of the topic. Wildcards are not allowed.
+ * @param[in] policy value of @a aitt_remote_policy_e. The default is @a AITT_REMOTE_ALWAYS.
+ * @return @c 0 on success
+ *         otherwise a negative error value
+ * @retval #AITT_ERROR_NONE  Success
+ * @retval #AITT_ERROR_INVALID_PARAMETER Invalid parameter
+ */
+int aitt_set_remote_policy(aitt_h handle, const char *topic, aitt_remote_policy_e policy);
+
 /**
  * @}
  */
@@ -0,0 +1,499 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Module.h"
+
+#include <AittException.h>
+#include <fcntl.h>
+#include <flatbuffers/flexbuffers.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include "aitt_internal.h"
+
+#define SHM_READ_WAIT_MS 1000
+
+namespace AittSHMNamespace {
+
+// Reader threads don't wait for room in the rings. Two processes sending to each other
+// in their callbacks would wait for each other.
+static thread_local bool on_reader_thread = false;
+
+Module::Module(AittProtocol type, AittDiscovery &manager, const std::string &my_ip,
+      const AittOption &option)
+      : AittTransport(type, manager),
+        // A pid is valid in the pid namespace of the same kernel.
+        host_id(aitt::HostTransport::GetHostId("pid")),
+        can_block(option.GetSendOverflowPolicy() == AITT_SEND_OVERFLOW_BLOCK),
+        local_id(option.GetLocalDelivery() ? manager.GetId() : std::string())
+{
+    discovery_cb = discovery.AddDiscoveryCB(NAME,
+          std::bind(&Module::DiscoveryMessageCallback, this, std::placeholders::_1,
+                std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    DBG("Discovery Callback : %p, %d", this, discovery_cb);
+}
+
+Module::~Module(void)
+{
+    try {
+        discovery.RemoveDiscoveryCB(discovery_cb);
+    } catch (std::exception &e) {
+        ERR("RemoveDiscoveryCB() Fail(%s)", e.what());
+    }
+
+    // Wake up the publishers waiting for room in the rings of peers.
+    {
+        std::lock_guard<std::mutex> autoLock(peerTableLock);
+        peerTable.ForEach([](const std::string &clientId, const PeerPtr &peer) {
+            if (peer->ring)
+                peer->ring->Detach();
+        });
+    }
+
+    {
+        std::lock_guard<std::mutex> autoLock(blobLock);
+        for (auto &blob : blobs)
+            close(blob.fd);
+        blobs.clear();
+    }
+
+    if (ring)
+        ring->Close();
+    if (readerThread.joinable())
+        readerThread.join();
+}
+
+void Module::ThreadMain(void)
+{
+    pthread_setname_np(pthread_self(), "SHMReader");
+    on_reader_thread = true;
+
+    ShmRing::ReadCallback cb = std::bind(&Module::ReceiveMessage, this, std::placeholders::_1,
+          std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+    while (ring->Read(cb, SHM_READ_WAIT_MS)) {
+    }
+}
+
+void Module::PublishFull(const AittMsg &msg, const void *data, const int datalen, bool is_reply)
+{
+    RET_IF(datalen < 0);
+
+    std::vector<std::shared_ptr<ShmRing>> rings;
+    size_t peers;
+    {
+        std::lock_guard<std::mutex> autoLock(peerTableLock);
+        peers = FindRings(is_reply ? msg.GetResponseTopic() : msg.GetTopic(), rings);
+        if (peers == 0 && is_reply)
+            held_replies.Hold(msg, data, datalen, AITT_QOS_AT_MOST_ONCE);
+    }
+
+    int ret = WriteRings(rings, msg, data, datalen, is_reply, can_block && !on_reader_thread);
+    // Some peers have rings which can't be opened.
+    if (ret == 0 && rings.size() < peers)
+        ret = -ENOTCONN;
+    if (ret == -EAGAIN)
+        throw aitt::AittException(aitt::AittException::RESOURCE_BUSY_ERR);
+    if (ret < 0)
+        throw aitt::AittException(aitt::AittException::OPERATION_FAILED);
+}
+
+// Rings of the peers subscribing the topic. It returns the number of the peers, and rings of
+// some peers may not be opened. peerTableLock must be held.
+size_t Module::FindRings(const std::string &topic, std::vector<std::shared_ptr<ShmRing>> &rings)
+{
+    std::vector<PeerPtr> peers;
+    peerTable.Match(topic, local_id, peers);
+    for (auto &peer : peers) {
+        std::shared_ptr<ShmRing> peer_ring = OpenRing(*peer);
+        if (peer_ring)
+            rings.push_back(peer_ring);
+    }
+    return peers.size();
+}
+
+// It returns 0, or an error of the rings. -EAGAIN means only full rings failed.
+int Module::WriteRings(const std::vector<std::shared_ptr<ShmRing>> &rings, const AittMsg &msg,
+      const void *data, const int datalen, bool is_reply, bool block)
+{
+    if (rings.empty())
+        return 0;
+
+    ReleaseBlobs();
+
+    PendingBlob blob;
+    blob.fd = -1;
+    struct stat st;
+    if (AITT_SHM_INLINE_MAX < datalen) {
+        // The payload is copied once into the blob, and every peer maps it.
+        blob.fd = aitt::HostTransport::NewBlob(data, datalen);
+        if (blob.fd < 0 || fstat(blob.fd, &st) < 0) {
+            if (0 <= blob.fd)
+                close(blob.fd);
+            return -ENOMEM;
+        }
+    }
+
+    flexbuffers::Builder fbb;
+    aitt::HostTransport::PackMsgInfo(fbb, msg, is_reply, [&](flexbuffers::Builder &builder) {
+        if (blob.fd < 0)
+            return;
+        builder.Vector("blob", [&]() {
+            builder.Int(getpid());
+            builder.Int(blob.fd);
+            builder.UInt(st.st_ino);
+        });
+    });
+    const std::vector<uint8_t> &header = fbb.GetBuffer();
+    const void *payload = (blob.fd < 0) ? data : nullptr;
+    size_t payload_size = (blob.fd < 0) ? datalen : 0;
+
+    const std::string &topic = is_reply ? msg.GetResponseTopic() : msg.GetTopic();
+    int result = 0;
+    for (auto &peer_ring : rings) {
+        uint64_t end = 0;
+        int ret = peer_ring->Write(header.data(), header.size(), payload, payload_size, block,
+              &end);
+        if (ret < 0) {
+            ERR("Writing a message(%s, %d) Fail(%d)", topic.c_str(), datalen, ret);
+            if (result == 0 || result == -EAGAIN)
+                result = ret;
+        } else if (0 <= blob.fd) {
+            blob.rings.push_back(std::make_pair(peer_ring, end));
+        }
+    }
+
+    if (0 <= blob.fd)
+        KeepBlob(std::move(blob));
+    return result;
+}
+
+void Module::KeepBlob(PendingBlob &&blob)
+{
+    if (blob.rings.empty()) {
+        close(blob.fd);
+        return;
+    }
+
+    std::lock_guard<std::mutex> autoLock(blobLock);
+    if (AITT_SHM_BLOB_MAX <= blobs.size()) {
+        ERR("Too many blobs kept, close the oldest");
+        close(blobs.front().fd);
+        blobs.pop_front();
+    }
+    blobs.push_back(std::move(blob));
+}
+
+// Close the blobs whose messages are read by every ring.
+void Module::ReleaseBlobs(void)
+{
+    std::lock_guard<std::mutex> autoLock(blobLock);
+    for (auto it = blobs.begin(); it != blobs.end();) {
+        auto &rings = it->rings;
+        rings.erase(std::remove_if(rings.begin(), rings.end(),
+                          [](const std::pair<std::shared_ptr<ShmRing>, uint64_t> &entry) {
+                              return entry.first->IsRead(entry.second);
+                          }),
+              rings.end());
+        if (rings.empty()) {
+            close(it->fd);
+            it = blobs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// A ring that can't be opened is tried again after the backoff, which is doubled on every
+// failure.
+std::shared_ptr<ShmRing> Module::OpenRing(PeerData &peer)
+{
+    if (peer.ring)
+        return peer.ring;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now < peer.retry_time)
+        return nullptr;
+
+    try {
+        peer.ring = std::make_shared<ShmRing>(peer.pid, peer.fd, peer.token, peer.size);
+        peer.retry_delay = 0;
+    } catch (std::exception &e) {
+        ERR("Opening the ring of %d Fail(%s)", peer.pid, e.what());
+        if (peer.retry_delay == 0)
+            peer.retry_delay = AITT_SHM_OPEN_BACKOFF_MIN;
+        else
+            peer.retry_delay = std::min(peer.retry_delay * 2, AITT_SHM_OPEN_BACKOFF_MAX);
+        peer.retry_time = now + std::chrono::milliseconds(peer.retry_delay);
+    }
+    return peer.ring;
+}
+
+// The blob of a peer is reopened, it needs the same permission as the ring.
+void *Module::MapBlob(pid_t pid, int fd, uint64_t inode, size_t &size)
+{
+    std::string path = "/proc/" + std::to_string(pid) + "/fd/" + std::to_string(fd);
+    int blob = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (blob < 0) {
+        ERR("open(%s) Fail(%d)", path.c_str(), errno);
+        return nullptr;
+    }
+
+    void *addr = nullptr;
+    struct stat st;
+    if (fstat(blob, &st) < 0 || st.st_ino != inode)
+        ERR("The blob(%s) is closed", path.c_str());
+    else
+        addr = aitt::HostTransport::MapBlob(blob, size);
+    close(blob);
+    return addr;
+}
+
+void Module::Publish(const std::string &topic, const void *data, const int datalen, AittQoS qos,
+      bool retain)
+{
+    AittMsg msg;
+    msg.SetTopic(topic);
+    PublishFull(msg, data, datalen);
+}
+
+void *Module::Subscribe(const std::string &topic, const AittTransport::SubscribeCallback &cb,
+      void *cbdata, AittQoS qos)
+{
+    std::unique_ptr<Subscribe_CB_Info> cb_info(new Subscribe_CB_Info(cb, cbdata));
+    Subscribe_CB_Info *info_ptr = cb_info.get();
+
+    std::lock_guard<std::mutex> autoLock(subscribeTableLock);
+    if (ring == nullptr) {
+        ring = std::unique_ptr<ShmRing>(new ShmRing());
+        readerThread = std::thread(&Module::ThreadMain, this);
+    }
+
+    subscribeTable[topic].push_back(std::move(cb_info));
+    subscribe_handles.insert(SubscribeHandles::value_type(info_ptr, topic));
+
+    UpdateDiscoveryMsg();
+
+    return info_ptr;
+}
+
+void *Module::Unsubscribe(void *handlePtr)
+{
+    std::lock_guard<std::mutex> autoLock(subscribeTableLock);
+
+    auto handle_it = subscribe_handles.find(static_cast<Subscribe_CB_Info *>(handlePtr));
+    if (handle_it == subscribe_handles.end()) {
+        ERR("Unknown handle(%p)", handlePtr);
+        return nullptr;
+    }
+
+    void *cbdata = handle_it->first->second;
+    auto it = subscribeTable.find(handle_it->second);
+    subscribe_handles.erase(handle_it);
+    if (it == subscribeTable.end())
+        throw std::runtime_error("Invalid Callback Info");
+
+    auto cb_it = std::find_if(it->second.begin(), it->second.end(),
+          [&](const std::unique_ptr<Subscribe_CB_Info> &cb_info) {
+              return cb_info.get() == handlePtr;
+          });
+    if (cb_it == it->second.end())
+        throw std::runtime_error("Invalid Callback Info");
+    it->second.erase(cb_it);
+    if (it->second.empty())
+        subscribeTable.erase(it);
+
+    UpdateDiscoveryMsg();
+
+    return cbdata;
+}
+
+void Module::PublishWithReply(const std::string &topic, const void *data, const int datalen,
+      AittQoS qos, bool retain, const std::string &reply_topic, const std::string &correlation)
+{
+    AittMsg msg;
+    msg.SetTopic(topic);
+    msg.SetResponseTopic(reply_topic);
+    msg.SetCorrelation(correlation);
+    PublishFull(msg, data, datalen);
+}
+
+void Module::SendReply(AittMsg *msg, const void *data, const int datalen, AittQoS qos, bool retain)
+{
+    if (msg == nullptr) {
+        ERR("Invalid message(msg is nullptr)");
+        throw std::runtime_error("Invalid message");
+    }
+
+    PublishFull(*msg, data, datalen, true);
+}
+
+// Discovery Message (flexbuffers)
+// map {
+//   "host": "$boot_id/$pid_namespace",
+//   "ring": [pid, fd, token, size],
+//   "topics": {"$topic": cb_list_size, ...}
+// }
+void Module::DiscoveryMessageCallback(const std::string &clientId, const std::string &status,
+      const void *msg, const int szmsg)
+{
+    if (!status.compare(AittDiscovery::WILL_LEAVE_NETWORK)) {
+        std::lock_guard<std::mutex> autoLock(peerTableLock);
+        PeerPtr peer = peerTable.Remove(clientId);
+        if (peer && peer->ring)
+            peer->ring->Detach();
+        return;
+    }
+
+    auto map = flexbuffers::GetRoot(static_cast<const uint8_t *>(msg), szmsg).AsMap();
+    // Peers on other hosts are reached by other transports.
+    if (map["host"].AsString().str() != host_id)
+        return;
+
+    auto ring_info = map["ring"].AsVector();
+    if (ring_info.size() != RING_INFO_MAX) {
+        ERR("Unknown Message");
+        return;
+    }
+
+    PeerPtr peer = std::make_shared<PeerData>();
+    peer->pid = ring_info[RING_INFO_PID].AsInt32();
+    peer->fd = ring_info[RING_INFO_FD].AsInt32();
+    peer->token = ring_info[RING_INFO_TOKEN].AsUInt64();
+    peer->size = ring_info[RING_INFO_SIZE].AsUInt64();
+
+    PeerTable::Topics topics;
+    auto topic_map = map["topics"].AsMap();
+    auto keys = topic_map.Keys();
+    for (size_t idx = 0; idx < keys.size(); ++idx) {
+        std::string topic = keys[idx].AsString().str();
+        topics[topic] = topic_map[topic].AsUInt32();
+    }
+
+    std::lock_guard<std::mutex> autoLock(peerTableLock);
+    UpdatePeer(clientId, peer, topics);
+    SendHeldReplies();
+}
+
+// peerTableLock must be held.
+void Module::UpdatePeer(const std::string &clientId, const PeerPtr &peer,
+      const PeerTable::Topics &topics)
+{
+    PeerPtr old_peer = peerTable.Find(clientId);
+    if (old_peer && old_peer->pid == peer->pid && old_peer->fd == peer->fd
+          && old_peer->token == peer->token) {
+        // The ring opened is kept.
+        peerTable.Update(clientId, old_peer, topics);
+        return;
+    }
+
+    if (old_peer && old_peer->ring)
+        old_peer->ring->Detach();
+    peerTable.Update(clientId, peer, topics);
+}
+
+// Replies to the reply topics discovered now. peerTableLock must be held, so it doesn't wait
+// for room in the rings.
+void Module::SendHeldReplies(void)
+{
+    std::vector<std::shared_ptr<ShmRing>> rings;
+    auto replies = held_replies.Take([&](const std::string &topic) {
+        rings.clear();
+        return FindRings(topic, rings) != 0;
+    });
+    for (auto &reply : replies) {
+        rings.clear();
+        FindRings(reply.msg.GetResponseTopic(), rings);
+        WriteRings(rings, reply.msg, reply.payload.data(), reply.payload.size(), true, false);
+    }
+}
+
+void Module::UpdateDiscoveryMsg(void)
+{
+    flexbuffers::Builder fbb;
+    fbb.Map([this, &fbb]() {
+        fbb.String("host", host_id);
+        fbb.Vector("ring", [&]() {
+            fbb.Int(getpid());
+            fbb.Int(ring->GetHandle());
+            fbb.UInt(ring->GetToken());
+            fbb.UInt(ring->GetSize());
+        });
+        fbb.Map("topics", [&]() {
+            for (auto it = subscribeTable.begin(); it != subscribeTable.end(); ++it)
+                fbb.UInt(it->first.c_str(), it->second.size());
+        });
+    });
+    fbb.Finish();
+
+    auto buf = fbb.GetBuffer();
+    discovery.UpdateDiscoveryMsg(NAME, buf.data(), buf.size());
+}
+
+// The payload is delivered in the ring or the mapped blob,
+// it's released after the callbacks return.
+void Module::ReceiveMessage(const void *header, size_t header_size, const void *payload,
+      size_t payload_size)
+{
+    AittMsg msg;
+    aitt::HostTransport::UnpackMsgInfo(msg, header, header_size);
+    if (msg.GetTopic().empty()) {
+        ERR("A topic is empty.");
+        return;
+    }
+
+    void *blob = nullptr;
+    auto map = flexbuffers::GetRoot(static_cast<const uint8_t *>(header), header_size).AsMap();
+    auto blob_info = map["blob"].AsVector();
+    if (blob_info.size() == BLOB_INFO_MAX) {
+        blob = MapBlob(blob_info[BLOB_INFO_PID].AsInt32(), blob_info[BLOB_INFO_FD].AsInt32(),
+              blob_info[BLOB_INFO_INODE].AsUInt64(), payload_size);
+        if (blob == nullptr)
+            return;
+        payload = blob;
+    }
+
+    const void *data = payload_size ? payload : nullptr;
+    msg.SetPayload(AittMsgBuffer::Wrap(data, payload_size));
+
+    std::vector<Subscribe_CB_Info> cb_list;
+    {
+        std::lock_guard<std::mutex> autoLock(subscribeTableLock);
+        for (auto it = subscribeTable.begin(); it != subscribeTable.end(); ++it) {
+            if (!discovery.CompareTopic(it->first, msg.GetTopic()))
+                continue;
+            for (auto &cb_info : it->second)
+                cb_list.push_back(*cb_info);
+        }
+    }
+
+    for (auto const &it : cb_list)
+        it.first(&msg, data, payload_size, it.second);
+
+    if (blob)
+        munmap(blob, payload_size);
+}
+
+int Module::CountSubscriber(const std::string &topic)
+{
+    std::lock_guard<std::mutex> autoLock(peerTableLock);
+    return peerTable.Count(topic);
+}
+
+}  // namespace AittSHMNamespace
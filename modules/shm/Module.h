@@ -0,0 +1,156 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <AittTransport.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HeldReplies.h"
+#include "HostTransport.h"
+#include "ShmRing.h"
+
+using AittTransport = aitt::AittTransport;
+using AittDiscovery = aitt::AittDiscovery;
+
+// Payloads bigger than it are passed in a sealed memfd, and the ring takes only the header.
+#define AITT_SHM_INLINE_MAX (1024 * 1024)
+// Blobs kept open for the peers to map at most, the oldest is closed over it.
+#define AITT_SHM_BLOB_MAX 64
+
+// Delay of opening the ring of a peer again after a failure(ms), doubled up to the max
+#define AITT_SHM_OPEN_BACKOFF_MIN 100
+#define AITT_SHM_OPEN_BACKOFF_MAX 10000
+
+#define MODULE_NAMESPACE AittSHMNamespace
+namespace AittSHMNamespace {
+
+// Peers on the same host get messages through their shared memory rings.
+// A subscriber process advertises its ring, and publishers copy messages into it.
+class Module : public AittTransport {
+  public:
+    explicit Module(AittProtocol type, AittDiscovery &manager, const std::string &ip,
+          const AittOption &option = AittOption());
+    virtual ~Module(void);
+
+    void Publish(const std::string &topic, const void *data, const int datalen,
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false) override;
+
+    void *Subscribe(const std::string &topic, const SubscribeCallback &cb, void *cbdata = nullptr,
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE) override;
+    void *Unsubscribe(void *handle) override;
+    void PublishWithReply(const std::string &topic, const void *data, const int datalen,
+          AittQoS qos, bool retain, const std::string &reply_topic, const std::string &correlation);
+    void SendReply(AittMsg *msg, const void *data, const int datalen, AittQoS qos, bool retain);
+    int CountSubscriber(const std::string &topic);
+
+  private:
+    using Subscribe_CB_Info = std::pair<SubscribeCallback, void *>;
+
+    // SubscribeTable
+    // map {
+    //    "/customTopic/mytopic": [$callback, ...],
+    //    ...
+    // }
+    using SubscribeMap =
+          std::map<std::string /* topic */, std::vector<std::unique_ptr<Subscribe_CB_Info>>>;
+    using SubscribeHandles = std::map<Subscribe_CB_Info *, std::string /* topic */>;
+
+    enum RingInfo {
+        RING_INFO_PID,
+        RING_INFO_FD,
+        RING_INFO_TOKEN,
+        RING_INFO_SIZE,
+        RING_INFO_MAX,
+    };
+
+    enum BlobInfo {
+        BLOB_INFO_PID,
+        BLOB_INFO_FD,
+        BLOB_INFO_INODE,  // The fd may be reused after the blob is closed.
+        BLOB_INFO_MAX,
+    };
+
+    // Ring of a subscriber process on the same host
+    struct PeerData {
+        PeerData(void) : pid(0), fd(-1), token(0), size(0), retry_delay(0) {}
+
+        pid_t pid;
+        int fd;
+        uint64_t token;
+        size_t size;
+        std::shared_ptr<ShmRing> ring;  // opened at the first message to the peer
+        int retry_delay;                // backoff after the last failure(ms), 0 with a ring
+        std::chrono::steady_clock::time_point retry_time;
+    };
+    using PeerTable = aitt::HostPeerTable<PeerData>;
+    using PeerPtr = PeerTable::PeerPtr;
+
+    // A blob is kept open until every ring it's written to reads the message.
+    struct PendingBlob {
+        int fd;
+        std::vector<std::pair<std::shared_ptr<ShmRing>, uint64_t /* end of the message */>> rings;
+    };
+
+    void PublishFull(const AittMsg &msg, const void *data, const int datalen,
+          bool is_reply = false);
+    size_t FindRings(const std::string &topic, std::vector<std::shared_ptr<ShmRing>> &rings);
+    int WriteRings(const std::vector<std::shared_ptr<ShmRing>> &rings, const AittMsg &msg,
+          const void *data, const int datalen, bool is_reply, bool block);
+    void KeepBlob(PendingBlob &&blob);
+    void ReleaseBlobs(void);
+    std::shared_ptr<ShmRing> OpenRing(PeerData &peer);
+    void DiscoveryMessageCallback(const std::string &clientId, const std::string &status,
+          const void *msg, const int szmsg);
+    void UpdatePeer(const std::string &clientId, const PeerPtr &peer,
+          const PeerTable::Topics &topics);
+    void SendHeldReplies(void);
+    void UpdateDiscoveryMsg(void);
+    void ReceiveMessage(const void *header, size_t header_size, const void *payload,
+          size_t payload_size);
+    void ThreadMain(void);
+    static void *MapBlob(pid_t pid, int fd, uint64_t inode, size_t &size);
+
+    const char *const NAME = "SHM";
+    int discovery_cb;
+    const std::string host_id;
+    const bool can_block;
+    // Own subscribers get messages in the process with the local delivery, so they are skipped.
+    const std::string local_id;
+
+    std::unique_ptr<ShmRing> ring;  // created at the first subscription
+    std::thread readerThread;
+    SubscribeMap subscribeTable;
+    SubscribeHandles subscribe_handles;
+    std::mutex subscribeTableLock;
+
+    PeerTable peerTable;
+    aitt::HeldReplies held_replies;  // guarded by peerTableLock
+    std::mutex peerTableLock;
+
+    std::list<PendingBlob> blobs;  // released by the next publish
+    std::mutex blobLock;
+};
+
+}  // namespace AittSHMNamespace
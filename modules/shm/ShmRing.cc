@@ -0,0 +1,391 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "ShmRing.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include "aitt_internal.h"
+
+#define SHM_RING_MAGIC 0x4149545452494e47ULL  // "AITTRING"
+#define SHM_RING_ALIGN 8
+#define SHM_RING_PAD UINT32_MAX  // The rest of the ring is skipped, it continues at the start.
+#define SHM_WRITE_WAIT_MS 100    // Blocked writers check whether the ring is closed.
+
+namespace AittSHMNamespace {
+
+// It's at the start of the memfd, and the messages follow it.
+struct ShmRing::Shared {
+    uint64_t magic;
+    uint64_t token;  // A writer checks it's the ring advertised by the reader.
+    uint64_t capacity;
+    pthread_mutex_t lock;
+    pthread_cond_t readable;
+    pthread_cond_t writable;
+    uint64_t head;  // bytes read so far
+    uint64_t tail;  // bytes written so far
+    uint32_t closed;
+};
+
+namespace {
+struct Record {
+    uint32_t header_size;
+    uint32_t payload_size;
+};
+
+size_t Align(size_t size, size_t align)
+{
+    return (size + align - 1) / align * align;
+}
+}  // namespace
+
+const size_t ShmRing::DATA_OFFSET = Align(sizeof(ShmRing::Shared), 64);
+
+ShmRing::ShmRing(size_t ring_capacity)
+      : fd(-1),
+        size(0),
+        capacity(Align(ring_capacity, SHM_RING_ALIGN)),
+        shared(nullptr),
+        data(nullptr),
+        owner(true),
+        detached(false)
+{
+    if (capacity < sizeof(Record) * 2) {
+        ERR("Invalid capacity(%zu)", ring_capacity);
+        throw std::runtime_error("Invalid capacity");
+    }
+    size = DATA_OFFSET + capacity;
+
+    fd = memfd_create("aitt-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        ERR("memfd_create() Fail(%d)", errno);
+        throw std::runtime_error("memfd_create() Fail");
+    }
+
+    // Writers never get SIGBUS of a shrunk memfd.
+    if (ftruncate(fd, size) < 0
+          || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        ERR("Resizing the memfd(%zu) Fail(%d)", size, errno);
+        Release();
+        throw std::runtime_error("ftruncate() Fail");
+    }
+    Map();
+
+    pthread_mutexattr_t mutex_attr;
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    // A writer may die holding the lock.
+    pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&shared->lock, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&shared->readable, &cond_attr);
+    pthread_cond_init(&shared->writable, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    std::random_device rd;
+    shared->token = (static_cast<uint64_t>(rd()) << 32) | rd();
+    shared->capacity = capacity;
+    shared->head = 0;
+    shared->tail = 0;
+    shared->closed = 0;
+    shared->magic = SHM_RING_MAGIC;
+}
+
+ShmRing::ShmRing(pid_t pid, int peer_fd, uint64_t token, size_t ring_size)
+      : fd(-1),
+        size(ring_size),
+        capacity(0),
+        shared(nullptr),
+        data(nullptr),
+        owner(false),
+        detached(false)
+{
+    // The memfd of the peer is reopened, it needs the same permission as ptrace.
+    std::string path = "/proc/" + std::to_string(pid) + "/fd/" + std::to_string(peer_fd);
+    fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        ERR("open(%s) Fail(%d)", path.c_str(), errno);
+        throw std::runtime_error("open() Fail: " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) != size || size <= DATA_OFFSET) {
+        ERR("Invalid ring(%s, %zu)", path.c_str(), size);
+        Release();
+        throw std::runtime_error("Invalid ring: " + path);
+    }
+    Map();
+
+    capacity = size - DATA_OFFSET;
+    if (shared->magic != SHM_RING_MAGIC || shared->token != token
+          || shared->capacity != capacity) {
+        ERR("Unknown ring(%s)", path.c_str());
+        Release();
+        throw std::runtime_error("Unknown ring: " + path);
+    }
+}
+
+ShmRing::~ShmRing(void)
+{
+    if (owner)
+        Close();
+    Release();
+}
+
+void ShmRing::Map(void)
+{
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        ERR("mmap(%zu) Fail(%d)", size, errno);
+        Release();
+        throw std::runtime_error("mmap() Fail");
+    }
+    shared = static_cast<Shared *>(addr);
+    data = static_cast<uint8_t *>(addr) + DATA_OFFSET;
+}
+
+void ShmRing::Release(void)
+{
+    if (shared)
+        munmap(shared, size);
+    shared = nullptr;
+    data = nullptr;
+
+    if (0 <= fd)
+        close(fd);
+    fd = -1;
+}
+
+uint64_t ShmRing::GetToken(void) const
+{
+    return shared->token;
+}
+
+int ShmRing::Write(const void *header, size_t header_size, const void *payload,
+      size_t payload_size, bool block, uint64_t *end)
+{
+    size_t record_size = Align(sizeof(Record) + header_size + payload_size, SHM_RING_ALIGN);
+    if (capacity < record_size || UINT32_MAX <= header_size || UINT32_MAX < payload_size) {
+        ERR("Too large message(%zu) for the ring(%zu)", header_size + payload_size, capacity);
+        return -EMSGSIZE;
+    }
+
+    Lock();
+    uint64_t tail;
+    size_t pos;
+    size_t room;
+    while (true) {
+        if (shared->closed || detached) {
+            Unlock();
+            return -EPIPE;
+        }
+
+        tail = shared->tail;
+        uint64_t used = tail - shared->head;
+        if (capacity < used) {
+            ERR("Broken ring(head:%" PRIu64 ", tail:%" PRIu64 ")", shared->head, tail);
+            Unlock();
+            return -EPIPE;
+        }
+        pos = tail % capacity;
+        room = capacity - pos;
+        if (used == 0 && room < record_size) {
+            // An empty ring starts over, so that any message up to the capacity fits.
+            tail += room;
+            shared->head = shared->tail = tail;
+            pos = 0;
+            room = capacity;
+        }
+        // A message isn't split at the end of the ring.
+        size_t needed = (record_size <= room) ? record_size : room + record_size;
+        if (needed <= capacity - used)
+            break;
+
+        if (block == false) {
+            Unlock();
+            return -EAGAIN;
+        }
+        WaitUntil(&shared->writable, Deadline(SHM_WRITE_WAIT_MS));
+    }
+
+    if (room < record_size) {
+        Record pad = {SHM_RING_PAD, 0};
+        memcpy(data + pos, &pad, sizeof(pad));
+        tail += room;
+        pos = 0;
+    }
+
+    Record record = {static_cast<uint32_t>(header_size), static_cast<uint32_t>(payload_size)};
+    uint8_t *dest = data + pos;
+    memcpy(dest, &record, sizeof(record));
+    if (header_size)
+        memcpy(dest + sizeof(record), header, header_size);
+    if (payload_size)
+        memcpy(dest + sizeof(record) + header_size, payload, payload_size);
+
+    shared->tail = tail + record_size;
+    if (end)
+        *end = shared->tail;
+    pthread_cond_signal(&shared->readable);
+    Unlock();
+    return 0;
+}
+
+bool ShmRing::IsRead(uint64_t position)
+{
+    Lock();
+    bool read = shared->closed || detached || position <= shared->head;
+    Unlock();
+    return read;
+}
+
+bool ShmRing::Read(const ReadCallback &cb, int timeout_ms)
+{
+    struct timespec deadline = Deadline(timeout_ms);
+
+    Lock();
+    while (shared->closed == 0 && shared->head == shared->tail) {
+        if (WaitUntil(&shared->readable, deadline) == ETIMEDOUT)
+            break;
+    }
+    if (shared->closed) {
+        Unlock();
+        return false;
+    }
+    uint64_t head = shared->head;
+    uint64_t tail = shared->tail;
+    Unlock();
+
+    uint64_t released = head;
+    if (capacity < tail - head) {
+        ERR("Broken ring(head:%" PRIu64 ", tail:%" PRIu64 ")", head, tail);
+        head = tail;
+    }
+
+    // Writers don't touch the messages until the head passes them.
+    while (head != tail) {
+        size_t pos = head % capacity;
+        size_t room = capacity - pos;
+        Record record;
+        memcpy(&record, data + pos, sizeof(record));
+        if (record.header_size == SHM_RING_PAD) {
+            head += room;
+            continue;
+        }
+
+        size_t record_size = Align(sizeof(Record) + static_cast<size_t>(record.header_size)
+                                         + record.payload_size,
+              SHM_RING_ALIGN);
+        if (room < record_size || tail - head < record_size) {
+            ERR("Broken message(%u, %u)", record.header_size, record.payload_size);
+            head = tail;
+            break;
+        }
+
+        const uint8_t *header = data + pos + sizeof(record);
+        cb(header, record.header_size, header + record.header_size, record.payload_size);
+        head += record_size;
+
+        // Blocked writers get the room as soon as possible.
+        Lock();
+        shared->head = released = head;
+        pthread_cond_broadcast(&shared->writable);
+        Unlock();
+    }
+
+    if (released != head) {
+        Lock();
+        shared->head = head;
+        pthread_cond_broadcast(&shared->writable);
+        Unlock();
+    }
+    return true;
+}
+
+void ShmRing::Close(void)
+{
+    Lock();
+    shared->closed = 1;
+    pthread_cond_broadcast(&shared->readable);
+    pthread_cond_broadcast(&shared->writable);
+    Unlock();
+}
+
+void ShmRing::Detach(void)
+{
+    detached = true;
+
+    Lock();
+    pthread_cond_broadcast(&shared->writable);
+    Unlock();
+}
+
+void ShmRing::Lock(void)
+{
+    int ret = pthread_mutex_lock(&shared->lock);
+    if (ret == EOWNERDEAD) {
+        // The tail moves after a message is written, so the ring is still consistent.
+        ERR("The owner of the lock died");
+        pthread_mutex_consistent(&shared->lock);
+    } else if (ret != 0) {
+        ERR("pthread_mutex_lock() Fail(%d)", ret);
+    }
+}
+
+void ShmRing::Unlock(void)
+{
+    pthread_mutex_unlock(&shared->lock);
+}
+
+int ShmRing::WaitUntil(pthread_cond_t *cond, const struct timespec &deadline)
+{
+    int ret = pthread_cond_timedwait(cond, &shared->lock, &deadline);
+    if (ret == EOWNERDEAD) {
+        ERR("The owner of the lock died");
+        pthread_mutex_consistent(&shared->lock);
+    }
+    return ret;
+}
+
+struct timespec ShmRing::Deadline(int timeout_ms)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (1000000000L <= ts.tv_nsec) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+}  // namespace AittSHMNamespace
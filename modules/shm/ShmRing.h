@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <pthread.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Default bytes of the ring a subscriber process receives messages with
+#define AITT_SHM_RING_SIZE (16 * 1024 * 1024)
+
+namespace AittSHMNamespace {
+
+// A ring buffer of messages in the shared memory(memfd).
+// A process reads its own ring, and other processes on the host write messages to it.
+// A message is copied once into the ring, and the reader gets it in place.
+class ShmRing {
+  public:
+    // (header, header_size, payload, payload_size) of a message in the ring
+    using ReadCallback = std::function<void(const void *, size_t, const void *, size_t)>;
+
+    // Create a ring to read
+    explicit ShmRing(size_t capacity = AITT_SHM_RING_SIZE);
+    // Open the ring of another process(pid, fd) to write
+    ShmRing(pid_t pid, int fd, uint64_t token, size_t size);
+    ~ShmRing(void);
+
+    int GetHandle(void) const { return fd; }
+    uint64_t GetToken(void) const;
+    size_t GetSize(void) const { return size; }
+    size_t GetCapacity(void) const { return capacity; }
+
+    // It returns 0, -EAGAIN when there's no room for the message without blocking,
+    // -EMSGSIZE when the message can't fit in the ring, or -EPIPE when the ring is closed.
+    // end is the position after the message, which is read when IsRead(end) returns true.
+    int Write(const void *header, size_t header_size, const void *payload, size_t payload_size,
+          bool block, uint64_t *end = nullptr);
+    // The reader has passed the position, or it'll never read it.
+    bool IsRead(uint64_t position);
+    // Wait for messages up to timeout_ms, and call back on each of them in place.
+    // The messages are released after the callbacks return. It returns false when closed.
+    bool Read(const ReadCallback &cb, int timeout_ms);
+    // The owner stops the reader and the writers.
+    void Close(void);
+    // A writer stops waiting for room in the ring.
+    void Detach(void);
+
+  private:
+    struct Shared;
+    static const size_t DATA_OFFSET;  // The messages follow the shared states.
+
+    void Map(void);
+    void Release(void);
+    void Lock(void);
+    void Unlock(void);
+    int WaitUntil(pthread_cond_t *cond, const struct timespec &deadline);
+    static struct timespec Deadline(int timeout_ms);
+
+    int fd;
+    size_t size;
+    size_t capacity;
+    Shared *shared;
+    uint8_t *data;
+    bool owner;
+    std::atomic_bool detached;
+};
+
+}  // namespace AittSHMNamespace
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../ShmRing.h"
+
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TEST_RING_SIZE 256
+#define TEST_WAIT_MS 10
+
+using namespace AittSHMNamespace;
+
+class ShmRingTest : public testing::Test {
+  protected:
+    void SetUp() override
+    {
+        reader = std::unique_ptr<ShmRing>(new ShmRing(TEST_RING_SIZE));
+        writer = std::unique_ptr<ShmRing>(new ShmRing(getpid(), reader->GetHandle(),
+              reader->GetToken(), reader->GetSize()));
+    }
+
+    int Write(const std::string &header, const std::string &payload, bool block = false,
+          uint64_t *end = nullptr)
+    {
+        return writer->Write(header.data(), header.size(), payload.data(), payload.size(), block,
+              end);
+    }
+
+    std::vector<std::string> Read(int timeout_ms = TEST_WAIT_MS)
+    {
+        std::vector<std::string> messages;
+        reader->Read(
+              [&](const void *header, size_t header_size, const void *payload,
+                    size_t payload_size) {
+                  messages.push_back(std::string(static_cast<const char *>(header), header_size)
+                                     + ":"
+                                     + std::string(static_cast<const char *>(payload),
+                                           payload_size));
+              },
+              timeout_ms);
+        return messages;
+    }
+
+    std::unique_ptr<ShmRing> reader;
+    std::unique_ptr<ShmRing> writer;
+};
+
+TEST_F(ShmRingTest, WriteRead_P_Anytime)
+{
+    EXPECT_EQ(reader->GetCapacity(), (size_t)TEST_RING_SIZE);
+    EXPECT_EQ(Write("a", "hello"), 0);
+    EXPECT_EQ(Write("b", ""), 0);
+    EXPECT_EQ(Write("", "world"), 0);
+
+    EXPECT_EQ(Read(), std::vector<std::string>({"a:hello", "b:", ":world"}));
+    EXPECT_TRUE(Read().empty());
+}
+
+TEST_F(ShmRingTest, Wrap_P_Anytime)
+{
+    // Messages of various sizes go around the ring many times.
+    for (int i = 0; i < 100; i++) {
+        std::string payload(i % 50, 'a' + i % 26);
+        std::string header = std::to_string(i);
+        ASSERT_EQ(Write(header, payload), 0);
+        ASSERT_EQ(Write(header, payload), 0);
+        EXPECT_EQ(Read(), std::vector<std::string>(2, header + ":" + payload));
+    }
+}
+
+TEST_F(ShmRingTest, WholeRing_P_Anytime)
+{
+    // An empty ring takes a message of its capacity wherever it stopped.
+    std::string payload(TEST_RING_SIZE - 8, 'x');
+    EXPECT_EQ(Write("", "abc"), 0);
+    EXPECT_EQ(Read().size(), 1U);
+    EXPECT_EQ(Write("", payload), 0);
+    EXPECT_EQ(Write("", "a"), -EAGAIN);
+    EXPECT_EQ(Read(), std::vector<std::string>({":" + payload}));
+}
+
+TEST_F(ShmRingTest, Full_N_Anytime)
+{
+    std::string payload(TEST_RING_SIZE / 4, 'x');
+    int written = 0;
+    while (Write("h", payload) == 0)
+        written++;
+    EXPECT_EQ(written, 3);
+    EXPECT_EQ(Write("h", std::string(TEST_RING_SIZE, 'x')), -EMSGSIZE);
+
+    EXPECT_EQ(Read().size(), 3U);
+    EXPECT_EQ(Write("h", payload), 0);
+}
+
+TEST_F(ShmRingTest, BlockingWrite_P_Anytime)
+{
+    std::string payload(TEST_RING_SIZE / 2, 'x');
+    ASSERT_EQ(Write("", payload), 0);
+
+    std::atomic_bool written(false);
+    std::thread thread([&]() {
+        EXPECT_EQ(Write("", payload, true), 0);
+        written = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(written);
+
+    EXPECT_EQ(Read().size(), 1U);
+    thread.join();
+    EXPECT_TRUE(written);
+    EXPECT_EQ(Read().size(), 1U);
+}
+
+TEST_F(ShmRingTest, IsRead_P_Anytime)
+{
+    uint64_t first = 0;
+    uint64_t second = 0;
+    ASSERT_EQ(Write("a", "first", false, &first), 0);
+    ASSERT_EQ(Write("b", "second", false, &second), 0);
+    EXPECT_LT(first, second);
+    EXPECT_FALSE(writer->IsRead(first));
+
+    EXPECT_EQ(Read().size(), 2U);
+    EXPECT_TRUE(writer->IsRead(first));
+    EXPECT_TRUE(writer->IsRead(second));
+
+    // A closed ring never reads the rest.
+    ASSERT_EQ(Write("c", "third", false, &second), 0);
+    EXPECT_FALSE(writer->IsRead(second));
+    reader->Close();
+    EXPECT_TRUE(writer->IsRead(second));
+}
+
+TEST_F(ShmRingTest, Detach_N_Anytime)
+{
+    std::string payload(TEST_RING_SIZE / 2, 'x');
+    ASSERT_EQ(Write("", payload), 0);
+
+    std::thread thread([&]() { EXPECT_EQ(Write("", payload, true), -EPIPE); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    writer->Detach();
+    thread.join();
+}
+
+TEST_F(ShmRingTest, Close_N_Anytime)
+{
+    std::thread thread([&]() {
+        EXPECT_FALSE(reader->Read([](const void *, size_t, const void *, size_t) {}, 10000));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    reader->Close();
+    thread.join();
+    EXPECT_EQ(Write("h", "data", true), -EPIPE);
+}
+
+TEST_F(ShmRingTest, InvalidToken_N_Anytime)
+{
+    EXPECT_THROW(ShmRing(getpid(), reader->GetHandle(), reader->GetToken() + 1,
+                       reader->GetSize()),
+          std::exception);
+    EXPECT_THROW(ShmRing(getpid(), reader->GetHandle(), reader->GetToken(), reader->GetSize() + 1),
+          std::exception);
+    EXPECT_THROW(ShmRing(getpid(), -1, reader->GetToken(), reader->GetSize()), std::exception);
+}
+
+TEST(ShmRing, CrossProcess_P_Anytime)
+{
+    const int count = 1000;
+    ShmRing ring;
+
+    pid_t parent = getpid();
+    pid_t child = fork();
+    ASSERT_LE(0, child);
+    if (child == 0) {
+        ShmRing writer(parent, ring.GetHandle(), ring.GetToken(), ring.GetSize());
+        std::vector<char> payload(64 * 1024);
+        for (int i = 0; i < count; i++) {
+            payload[0] = static_cast<char>(i);
+            if (writer.Write(&i, sizeof(i), payload.data(), payload.size(), true) != 0)
+                _exit(1);
+        }
+        _exit(0);
+    }
+
+    int received = 0;
+    int idle = 0;
+    bool ordered = true;
+    while (received < count && idle < 10) {
+        int before = received;
+        ring.Read(
+              [&](const void *header, size_t header_size, const void *payload,
+                    size_t payload_size) {
+                  int seq = *static_cast<const int *>(header);
+                  ordered = ordered && seq == received
+                            && static_cast<const char *>(payload)[0] == static_cast<char>(seq)
+                            && payload_size == 64 * 1024;
+                  received++;
+              },
+              1000);
+        idle = (received == before) ? idle + 1 : 0;
+    }
+    EXPECT_EQ(received, count);
+
+    int status;
+    ASSERT_EQ(child, waitpid(child, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    EXPECT_TRUE(ordered);
+}
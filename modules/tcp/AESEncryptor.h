@@ -21,6 +21,9 @@
 #define AITT_TCP_ENCRYPTOR_KEY_LEN 32
 #define AITT_TCP_ENCRYPTOR_BLOCK_SIZE 16
 #define AITT_TCP_ENCRYPTOR_IV_LEN AITT_TCP_ENCRYPTOR_BLOCK_SIZE
+// AES-256-GCM
+#define AITT_TCP_ENCRYPTOR_NONCE_LEN 12
+#define AITT_TCP_ENCRYPTOR_TAG_LEN 16
 
 namespace AittTCPNamespace {
 
@@ -38,6 +41,21 @@ class AESEncryptor {
     virtual int Decrypt(const unsigned char *ciphertext, int ciphertext_len,
           unsigned char *plaintext) = 0;
 
+    // AEAD with AES-256-GCM. The head and the body are encrypted in one pass as one message
+    // and the tag authenticates both of them. A nonce must not be used twice with the same key.
+    // Seal() writes the ciphertext of the head followed by the one of the body.
+    virtual int Seal(const unsigned char *nonce, const unsigned char *head, int head_len,
+          const unsigned char *body, int body_len, unsigned char *ciphertext,
+          unsigned char *tag) = 0;
+    // Decrypt the head only, to know the size of the body. It's not authenticated yet.
+    virtual int OpenHead(const unsigned char *nonce, const unsigned char *cipher_head,
+          int head_len, unsigned char *head) = 0;
+    // It returns the length of the body, or -1 if the tag doesn't match.
+    // The body can be decrypted in place.
+    virtual int Open(const unsigned char *nonce, const unsigned char *cipher_head, int head_len,
+          const unsigned char *cipher_body, int body_len, const unsigned char *tag,
+          unsigned char *head, unsigned char *body) = 0;
+
   protected:
     std::vector<unsigned char> key_;
     std::vector<unsigned char> iv_;
@@ -16,52 +16,102 @@
 #include "AESEncryptorMbedTLS.h"
 
 #include <mbedtls/aes.h>
+#include <mbedtls/gcm.h>
+#include <mbedtls/version.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "aitt_internal.h"
 
 namespace AittTCPNamespace {
 
+AESEncryptorMbedTLS::AESEncryptorMbedTLS() : enc_ctx_(nullptr), dec_ctx_(nullptr), gcm_ctx_(nullptr)
+{
+}
+
+AESEncryptorMbedTLS::~AESEncryptorMbedTLS(void)
+{
+    if (enc_ctx_) {
+        mbedtls_aes_free(enc_ctx_);
+        delete enc_ctx_;
+    }
+    if (dec_ctx_) {
+        mbedtls_aes_free(dec_ctx_);
+        delete dec_ctx_;
+    }
+    if (gcm_ctx_) {
+        mbedtls_gcm_free(gcm_ctx_);
+        delete gcm_ctx_;
+    }
+}
+
+bool AESEncryptorMbedTLS::SetupKeys(void)
+{
+    if (gcm_ctx_)
+        return true;
+    RETV_IF(key_.size() == 0, false);
+
+    mbedtls_gcm_context *gcm_ctx = new mbedtls_gcm_context;
+    mbedtls_gcm_init(gcm_ctx);
+    int ret = mbedtls_gcm_setkey(gcm_ctx, MBEDTLS_CIPHER_ID_AES, key_.data(),
+          AITT_TCP_ENCRYPTOR_KEY_LEN * 8);
+    if (ret != 0) {
+        ERR("mbedtls_gcm_setkey() Fail(%d)", ret);
+        mbedtls_gcm_free(gcm_ctx);
+        delete gcm_ctx;
+        return false;
+    }
+
+    enc_ctx_ = new mbedtls_aes_context;
+    mbedtls_aes_init(enc_ctx_);
+    mbedtls_aes_setkey_enc(enc_ctx_, key_.data(), AITT_TCP_ENCRYPTOR_KEY_LEN * 8);
+
+    dec_ctx_ = new mbedtls_aes_context;
+    mbedtls_aes_init(dec_ctx_);
+    mbedtls_aes_setkey_dec(dec_ctx_, key_.data(), AITT_TCP_ENCRYPTOR_KEY_LEN * 8);
+
+    gcm_ctx_ = gcm_ctx;
+    return true;
+}
+
 int AESEncryptorMbedTLS::Encrypt(const unsigned char *plaintext, int plaintext_len,
       unsigned char *ciphertext)
 {
-    if (key_.size() == 0)
+    if (SetupKeys() == false)
         return -1;
 
     const int BLOCKSIZE = AITT_TCP_ENCRYPTOR_BLOCK_SIZE;
-    int padding_len = BLOCKSIZE - (plaintext_len % BLOCKSIZE);
-    unsigned char *padding_buffer =
-          static_cast<unsigned char *>(malloc(plaintext_len + padding_len));
-
-    memcpy(padding_buffer, plaintext, plaintext_len);
-    for (int i = 0; i < padding_len; i++)
-        padding_buffer[plaintext_len + i] = padding_len;
-
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx);
-    mbedtls_aes_setkey_enc(&ctx, key_.data(), AITT_TCP_ENCRYPTOR_KEY_LEN * 8);
+    int full_len = plaintext_len - (plaintext_len % BLOCKSIZE);
     unsigned char iv[AITT_TCP_ENCRYPTOR_IV_LEN];
     std::copy(iv_.begin(), iv_.end(), iv);
-    mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, plaintext_len + padding_len, iv,
-          padding_buffer, ciphertext);
+    if (full_len)
+        mbedtls_aes_crypt_cbc(enc_ctx_, MBEDTLS_AES_ENCRYPT, full_len, iv, plaintext, ciphertext);
+
+    // Only the last block is padded, the others are encrypted without copying.
+    unsigned char last_block[BLOCKSIZE];
+    int rest_len = plaintext_len - full_len;
+    int padding_len = BLOCKSIZE - rest_len;
+    memcpy(last_block, plaintext + full_len, rest_len);
+    memset(last_block + rest_len, padding_len, padding_len);
+    mbedtls_aes_crypt_cbc(enc_ctx_, MBEDTLS_AES_ENCRYPT, BLOCKSIZE, iv, last_block,
+          ciphertext + full_len);
 
-    free(padding_buffer);
-    return plaintext_len + padding_len;
+    return full_len + BLOCKSIZE;
 }
 
 int AESEncryptorMbedTLS::Decrypt(const unsigned char *ciphertext, int ciphertext_len,
       unsigned char *plaintext)
 {
-    if (key_.size() == 0)
+    if (SetupKeys() == false)
         return -1;
+    RETV_IF(ciphertext_len <= 0 || ciphertext_len % AITT_TCP_ENCRYPTOR_BLOCK_SIZE, -1);
 
     unsigned char iv[AITT_TCP_ENCRYPTOR_IV_LEN];
     std::copy(iv_.begin(), iv_.end(), iv);
-    mbedtls_aes_context ctx;
-    mbedtls_aes_init(&ctx);
-
-    mbedtls_aes_setkey_dec(&ctx, key_.data(), AITT_TCP_ENCRYPTOR_KEY_LEN * 8);
-    mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_DECRYPT, ciphertext_len, iv, ciphertext, plaintext);
+    mbedtls_aes_crypt_cbc(dec_ctx_, MBEDTLS_AES_DECRYPT, ciphertext_len, iv, ciphertext,
+          plaintext);
 
     int padding_size = plaintext[ciphertext_len - 1];
     for (int i = 0; i < padding_size; i++) {
@@ -75,4 +125,103 @@ int AESEncryptorMbedTLS::Decrypt(const unsigned char *ciphertext, int ciphertext
     return ciphertext_len - padding_size;
 }
 
+static int UpdateGCM(mbedtls_gcm_context *ctx, const unsigned char *input, size_t length,
+      unsigned char *output)
+{
+#if MBEDTLS_VERSION_MAJOR >= 3
+    size_t output_length;
+    return mbedtls_gcm_update(ctx, input, length, output, length, &output_length);
+#else
+    return mbedtls_gcm_update(ctx, length, input, output);
+#endif
+}
+
+// mbedtls 2.x takes only whole blocks except for the last update.
+// The head is joined with the beginning of the body into the first block.
+int AESEncryptorMbedTLS::CryptGCM(int mode, const unsigned char *nonce,
+      const unsigned char *in_head, int head_len, const unsigned char *in_body, int body_len,
+      unsigned char *out_head, unsigned char *out_body, unsigned char *tag)
+{
+    const int BLOCKSIZE = AITT_TCP_ENCRYPTOR_BLOCK_SIZE;
+    RETV_IF(SetupKeys() == false || BLOCKSIZE < head_len, -1);
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+    int ret = mbedtls_gcm_starts(gcm_ctx_, mode, nonce, AITT_TCP_ENCRYPTOR_NONCE_LEN);
+#else
+    int ret = mbedtls_gcm_starts(gcm_ctx_, mode, nonce, AITT_TCP_ENCRYPTOR_NONCE_LEN, NULL, 0);
+#endif
+    if (ret != 0) {
+        ERR("mbedtls_gcm_starts() Fail(%d)", ret);
+        return -1;
+    }
+
+    unsigned char in_block[BLOCKSIZE];
+    unsigned char out_block[BLOCKSIZE];
+    int first_len = std::min(BLOCKSIZE - head_len, body_len);
+    memcpy(in_block, in_head, head_len);
+    if (first_len)
+        memcpy(in_block + head_len, in_body, first_len);
+    ret = UpdateGCM(gcm_ctx_, in_block, head_len + first_len, out_block);
+    if (ret == 0 && first_len < body_len)
+        ret = UpdateGCM(gcm_ctx_, in_body + first_len, body_len - first_len, out_body + first_len);
+    if (ret != 0) {
+        ERR("mbedtls_gcm_update() Fail(%d)", ret);
+        return -1;
+    }
+    memcpy(out_head, out_block, head_len);
+    if (first_len)
+        memcpy(out_body, out_block + head_len, first_len);
+
+#if MBEDTLS_VERSION_MAJOR >= 3
+    size_t output_length;
+    ret = mbedtls_gcm_finish(gcm_ctx_, NULL, 0, &output_length, tag, AITT_TCP_ENCRYPTOR_TAG_LEN);
+#else
+    ret = mbedtls_gcm_finish(gcm_ctx_, tag, AITT_TCP_ENCRYPTOR_TAG_LEN);
+#endif
+    if (ret != 0) {
+        ERR("mbedtls_gcm_finish() Fail(%d)", ret);
+        return -1;
+    }
+    return body_len;
+}
+
+int AESEncryptorMbedTLS::Seal(const unsigned char *nonce, const unsigned char *head,
+      int head_len, const unsigned char *body, int body_len, unsigned char *ciphertext,
+      unsigned char *tag)
+{
+    int ret = CryptGCM(MBEDTLS_GCM_ENCRYPT, nonce, head, head_len, body, body_len, ciphertext,
+          ciphertext + head_len, tag);
+    return (ret < 0) ? ret : head_len + body_len;
+}
+
+int AESEncryptorMbedTLS::OpenHead(const unsigned char *nonce, const unsigned char *cipher_head,
+      int head_len, unsigned char *head)
+{
+    // GCM encrypts in counter mode. The head is decrypted alone by skipping the tag.
+    unsigned char tag[AITT_TCP_ENCRYPTOR_TAG_LEN];
+    int ret = CryptGCM(MBEDTLS_GCM_DECRYPT, nonce, cipher_head, head_len, nullptr, 0, head,
+          nullptr, tag);
+    return (ret < 0) ? ret : head_len;
+}
+
+int AESEncryptorMbedTLS::Open(const unsigned char *nonce, const unsigned char *cipher_head,
+      int head_len, const unsigned char *cipher_body, int body_len, const unsigned char *tag,
+      unsigned char *head, unsigned char *body)
+{
+    unsigned char expected[AITT_TCP_ENCRYPTOR_TAG_LEN];
+    int ret = CryptGCM(MBEDTLS_GCM_DECRYPT, nonce, cipher_head, head_len, cipher_body, body_len,
+          head, body, expected);
+    if (ret < 0)
+        return ret;
+
+    unsigned char diff = 0;
+    for (int i = 0; i < AITT_TCP_ENCRYPTOR_TAG_LEN; i++)
+        diff |= expected[i] ^ tag[i];
+    if (diff) {
+        ERR("Authentication Fail");
+        return -1;
+    }
+    return body_len;
+}
+
 }  // namespace AittTCPNamespace
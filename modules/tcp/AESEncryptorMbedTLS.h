@@ -17,17 +17,40 @@
 
 #include "AESEncryptor.h"
 
+struct mbedtls_aes_context;
+struct mbedtls_gcm_context;
+
 namespace AittTCPNamespace {
 
 class AESEncryptorMbedTLS : public AESEncryptor {
   public:
-    AESEncryptorMbedTLS() = default;
-    ~AESEncryptorMbedTLS(void) = default;
+    AESEncryptorMbedTLS();
+    AESEncryptorMbedTLS(const AESEncryptorMbedTLS &) = delete;
+    ~AESEncryptorMbedTLS(void);
 
     int Encrypt(const unsigned char *plaintext, int plaintext_len,
           unsigned char *ciphertext) override;
     int Decrypt(const unsigned char *ciphertext, int ciphertext_len,
           unsigned char *plaintext) override;
+    int Seal(const unsigned char *nonce, const unsigned char *head, int head_len,
+          const unsigned char *body, int body_len, unsigned char *ciphertext,
+          unsigned char *tag) override;
+    int OpenHead(const unsigned char *nonce, const unsigned char *cipher_head, int head_len,
+          unsigned char *head) override;
+    int Open(const unsigned char *nonce, const unsigned char *cipher_head, int head_len,
+          const unsigned char *cipher_body, int body_len, const unsigned char *tag,
+          unsigned char *head, unsigned char *body) override;
+
+  private:
+    bool SetupKeys(void);
+    int CryptGCM(int mode, const unsigned char *nonce, const unsigned char *in_head, int head_len,
+          const unsigned char *in_body, int body_len, unsigned char *out_head,
+          unsigned char *out_body, unsigned char *tag);
+
+    // Keys are scheduled at the first use and kept for the other messages.
+    mbedtls_aes_context *enc_ctx_;
+    mbedtls_aes_context *dec_ctx_;
+    mbedtls_gcm_context *gcm_ctx_;
 };
 
 }  // namespace AittTCPNamespace
@@ -18,13 +18,57 @@
 #include <openssl/err.h>
 #include <openssl/evp.h>
 
-#include <memory>
 #include <stdexcept>
 
 #include "aitt_internal.h"
 
 namespace AittTCPNamespace {
 
+AESEncryptorOpenSSL::AESEncryptorOpenSSL() : cbc_ctx_(nullptr), gcm_ctx_(nullptr)
+{
+}
+
+AESEncryptorOpenSSL::~AESEncryptorOpenSSL(void)
+{
+    EVP_CIPHER_CTX_free(cbc_ctx_);
+    EVP_CIPHER_CTX_free(gcm_ctx_);
+}
+
+EVP_CIPHER_CTX *AESEncryptorOpenSSL::GetCBCContext(void)
+{
+    if (cbc_ctx_ == nullptr) {
+        cbc_ctx_ = EVP_CIPHER_CTX_new();
+        if (cbc_ctx_ == nullptr)
+            ERR("EVP_CIPHER_CTX_new() Fail(%d)", errno);
+    }
+    return cbc_ctx_;
+}
+
+// The key is scheduled once. Only the nonce is set for each message.
+EVP_CIPHER_CTX *AESEncryptorOpenSSL::GetGCMContext(void)
+{
+    if (gcm_ctx_)
+        return gcm_ctx_;
+
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (ctx == nullptr) {
+        ERR("EVP_CIPHER_CTX_new() Fail(%d)", errno);
+        return nullptr;
+    }
+
+    if (1 != EVP_CipherInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL, 1)
+          || 1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, AITT_TCP_ENCRYPTOR_NONCE_LEN,
+                   NULL)
+          || 1 != EVP_CipherInit_ex(ctx, NULL, NULL, key_.data(), NULL, 1)) {
+        ERR("EVP_CipherInit_ex() Fail(%lu)", ERR_get_error());
+        EVP_CIPHER_CTX_free(ctx);
+        return nullptr;
+    }
+
+    gcm_ctx_ = ctx;
+    return gcm_ctx_;
+}
+
 int AESEncryptorOpenSSL::Encrypt(const unsigned char *plaintext, int plaintext_len,
       unsigned char *ciphertext)
 {
@@ -34,24 +78,21 @@ int AESEncryptorOpenSSL::Encrypt(const unsigned char *plaintext, int plaintext_l
     if (key_.size() == 0)
         return 0;
 
-    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX *)> ctx(EVP_CIPHER_CTX_new(),
-          [](EVP_CIPHER_CTX *c) { EVP_CIPHER_CTX_free(c); });
-    if (ctx.get() == nullptr) {
-        ERR("EVP_CIPHER_CTX_new() Fail(%d)", errno);
+    EVP_CIPHER_CTX *ctx = GetCBCContext();
+    if (ctx == nullptr)
         return -1;
-    }
 
-    if (1 != EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_cbc(), NULL, key_.data(), iv_.data())) {
+    if (1 != EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key_.data(), iv_.data())) {
         ERR("EVP_EncryptInit_ex() Fail(%d)", errno);
         return -1;
     }
 
-    if (1 != EVP_EncryptUpdate(ctx.get(), ciphertext, &ciphertext_len, plaintext, plaintext_len)) {
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &ciphertext_len, plaintext, plaintext_len)) {
         ERR("EVP_EncryptUpdate() Fail(%d)", errno);
         return -1;
     }
 
-    if (1 != EVP_EncryptFinal_ex(ctx.get(), ciphertext + ciphertext_len, &len)) {
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + ciphertext_len, &len)) {
         ERR("EVP_EncryptFinal_ex() Fail(%d)", errno);
         return -1;
     }
@@ -68,24 +109,21 @@ int AESEncryptorOpenSSL::Decrypt(const unsigned char *ciphertext, int ciphertext
     if (key_.size() == 0)
         return 0;
 
-    std::unique_ptr<EVP_CIPHER_CTX, void (*)(EVP_CIPHER_CTX *)> ctx(EVP_CIPHER_CTX_new(),
-          [](EVP_CIPHER_CTX *c) { EVP_CIPHER_CTX_free(c); });
-    if (ctx.get() == nullptr) {
-        ERR("EVP_CIPHER_CTX_new() Fail(%d)", errno);
+    EVP_CIPHER_CTX *ctx = GetCBCContext();
+    if (ctx == nullptr)
         return -1;
-    }
 
-    if (1 != EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_cbc(), NULL, key_.data(), iv_.data())) {
+    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, key_.data(), iv_.data())) {
         ERR("EVP_DecryptInit_ex() Fail(%d)", errno);
         return -1;
     }
 
-    if (1 != EVP_DecryptUpdate(ctx.get(), plaintext, &plaintext_len, ciphertext, ciphertext_len)) {
+    if (1 != EVP_DecryptUpdate(ctx, plaintext, &plaintext_len, ciphertext, ciphertext_len)) {
         ERR("EVP_DecryptUpdate() Fail(%d)", errno);
         return -1;
     }
 
-    if (1 != EVP_DecryptFinal_ex(ctx.get(), plaintext + plaintext_len, &len)) {
+    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + plaintext_len, &len)) {
         ERR("EVP_DecryptFinal_ex() Fail(%d)", errno);
         return -1;
     }
@@ -94,4 +132,86 @@ int AESEncryptorOpenSSL::Decrypt(const unsigned char *ciphertext, int ciphertext
     return plaintext_len;
 }
 
+int AESEncryptorOpenSSL::Seal(const unsigned char *nonce, const unsigned char *head,
+      int head_len, const unsigned char *body, int body_len, unsigned char *ciphertext,
+      unsigned char *tag)
+{
+    int len;
+
+    RETV_IF(key_.size() == 0, -1);
+
+    EVP_CIPHER_CTX *ctx = GetGCMContext();
+    if (ctx == nullptr)
+        return -1;
+
+    if (1 != EVP_CipherInit_ex(ctx, NULL, NULL, NULL, nonce, 1)) {
+        ERR("EVP_CipherInit_ex() Fail(%lu)", ERR_get_error());
+        return -1;
+    }
+
+    if (1 != EVP_EncryptUpdate(ctx, ciphertext, &len, head, head_len)
+          || (body_len
+                && 1 != EVP_EncryptUpdate(ctx, ciphertext + head_len, &len, body, body_len))) {
+        ERR("EVP_EncryptUpdate() Fail(%lu)", ERR_get_error());
+        return -1;
+    }
+
+    if (1 != EVP_EncryptFinal_ex(ctx, ciphertext + head_len + body_len, &len)
+          || 1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, AITT_TCP_ENCRYPTOR_TAG_LEN, tag)) {
+        ERR("EVP_EncryptFinal_ex() Fail(%lu)", ERR_get_error());
+        return -1;
+    }
+
+    return head_len + body_len;
+}
+
+int AESEncryptorOpenSSL::OpenHead(const unsigned char *nonce, const unsigned char *cipher_head,
+      int head_len, unsigned char *head)
+{
+    int len;
+
+    RETV_IF(key_.size() == 0, -1);
+
+    EVP_CIPHER_CTX *ctx = GetGCMContext();
+    if (ctx == nullptr)
+        return -1;
+
+    if (1 != EVP_CipherInit_ex(ctx, NULL, NULL, NULL, nonce, 0)
+          || 1 != EVP_DecryptUpdate(ctx, head, &len, cipher_head, head_len)) {
+        ERR("EVP_DecryptUpdate() Fail(%lu)", ERR_get_error());
+        return -1;
+    }
+
+    return head_len;
+}
+
+int AESEncryptorOpenSSL::Open(const unsigned char *nonce, const unsigned char *cipher_head,
+      int head_len, const unsigned char *cipher_body, int body_len, const unsigned char *tag,
+      unsigned char *head, unsigned char *body)
+{
+    int len;
+
+    RETV_IF(key_.size() == 0, -1);
+
+    EVP_CIPHER_CTX *ctx = GetGCMContext();
+    if (ctx == nullptr)
+        return -1;
+
+    if (1 != EVP_CipherInit_ex(ctx, NULL, NULL, NULL, nonce, 0)
+          || 1 != EVP_DecryptUpdate(ctx, head, &len, cipher_head, head_len)
+          || (body_len && 1 != EVP_DecryptUpdate(ctx, body, &len, cipher_body, body_len))) {
+        ERR("EVP_DecryptUpdate() Fail(%lu)", ERR_get_error());
+        return -1;
+    }
+
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, AITT_TCP_ENCRYPTOR_TAG_LEN,
+                const_cast<unsigned char *>(tag))
+          || 1 != EVP_DecryptFinal_ex(ctx, body + body_len, &len)) {
+        ERR("Authentication Fail");
+        return -1;
+    }
+
+    return body_len;
+}
+
 }  // namespace AittTCPNamespace
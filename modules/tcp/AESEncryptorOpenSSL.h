@@ -17,17 +17,36 @@
 
 #include "AESEncryptor.h"
 
+struct evp_cipher_ctx_st;
+
 namespace AittTCPNamespace {
 
 class AESEncryptorOpenSSL : public AESEncryptor {
   public:
-    AESEncryptorOpenSSL() = default;
-    ~AESEncryptorOpenSSL(void) = default;
+    AESEncryptorOpenSSL();
+    AESEncryptorOpenSSL(const AESEncryptorOpenSSL &) = delete;
+    ~AESEncryptorOpenSSL(void);
 
     int Encrypt(const unsigned char *plaintext, int plaintext_len,
           unsigned char *ciphertext) override;
     int Decrypt(const unsigned char *ciphertext, int ciphertext_len,
           unsigned char *plaintext) override;
+    int Seal(const unsigned char *nonce, const unsigned char *head, int head_len,
+          const unsigned char *body, int body_len, unsigned char *ciphertext,
+          unsigned char *tag) override;
+    int OpenHead(const unsigned char *nonce, const unsigned char *cipher_head, int head_len,
+          unsigned char *head) override;
+    int Open(const unsigned char *nonce, const unsigned char *cipher_head, int head_len,
+          const unsigned char *cipher_body, int body_len, const unsigned char *tag,
+          unsigned char *head, unsigned char *body) override;
+
+  private:
+    evp_cipher_ctx_st *GetCBCContext(void);
+    evp_cipher_ctx_st *GetGCMContext(void);
+
+    // Created at the first use and kept not to allocate them for every message
+    evp_cipher_ctx_st *cbc_ctx_;
+    evp_cipher_ctx_st *gcm_ctx_;
 };
 
 }  // namespace AittTCPNamespace
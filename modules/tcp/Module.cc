@@ -16,6 +16,8 @@
 #include "Module.h"
 
 #include <flatbuffers/flexbuffers.h>
+#include <inttypes.h>
+#include <sched.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -26,12 +28,48 @@
 
 namespace AittTCPNamespace {
 
-Module::Module(AittProtocol type, AittDiscovery &manager, const std::string &my_ip)
+Module::Module(AittProtocol type, AittDiscovery &manager, const std::string &my_ip,
+      const AittOption &option)
       : AittTransport(type, manager),
-        main_loop(aitt::MainLoopHandler::new_loop()),
+        main_loop(aitt::MainLoopHandler::new_loop(aitt::MainLoopHandler::Backend::EPOLL)),
+        next_reactor(0),
+        next_topic_id(std::random_device()()),
         ip(my_ip),
-        secure(type == AITT_TYPE_TCP_SECURE)
+        secure(type == AITT_TYPE_TCP_SECURE),
+        send_queue_size(option.GetSendQueueSize()),
+        send_overflow(option.GetSendOverflowPolicy()),
+        local_id(option.GetLocalDelivery() ? manager.GetId() : std::string()),
+        stream_chunks(option.GetStreamChunks()),
+        heartbeat(PackHeartbeat())
 {
+    server_data.impl = this;
+
+    // With 0, a receive thread runs on each CPU the process may run on.
+    int threads = option.GetReceiveThreads();
+    std::vector<int> cpus;
+    cpu_set_t allowed;
+    if (threads == 0 && sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        }
+        threads = cpus.size();
+    }
+    threads = std::min(std::max(threads, 1), AITT_TCP_RECEIVE_THREADS_MAX);
+
+    for (int i = 0; i < threads; i++) {
+        std::unique_ptr<Reactor> reactor(new Reactor);
+        if (threads == 1) {
+            reactor->loop = main_loop.get();
+        } else {
+            reactor->own_loop = std::unique_ptr<MainLoopIface>(
+                  aitt::MainLoopHandler::new_loop(aitt::MainLoopHandler::Backend::EPOLL));
+            reactor->loop = reactor->own_loop.get();
+            reactor->thread = std::thread(&Module::ReactorMain, this, reactor.get(),
+                  (size_t(i) < cpus.size()) ? cpus[i] : -1);
+        }
+        reactors.push_back(std::move(reactor));
+    }
     aittThread = std::thread(&Module::ThreadMain, this);
 
     discovery_cb = discovery.AddDiscoveryCB(NAME[secure],
@@ -48,6 +86,13 @@ Module::~Module(void)
         ERR("RemoveDiscoveryCB() Fail(%s)", e.what());
     }
 
+    // Wake up the publishers waiting for room in the send queues.
+    {
+        std::lock_guard<std::mutex> autoLock(publishTableLock);
+        for (auto it = peerTable.begin(); it != peerTable.end(); ++it)
+            ClosePeer(it->second);
+    }
+
     while (main_loop->Quit() == false) {
         // wait when called before the thread has completely created.
         usleep(1000);
@@ -55,6 +100,18 @@ Module::~Module(void)
 
     if (aittThread.joinable())
         aittThread.join();
+
+    for (auto &reactor : reactors) {
+        if (reactor->own_loop) {
+            while (reactor->own_loop->Quit() == false)
+                usleep(1000);
+            if (reactor->thread.joinable())
+                reactor->thread.join();
+        }
+
+        for (auto tcp_data : reactor->connections)
+            delete tcp_data;
+    }
 }
 
 void Module::ThreadMain(void)
@@ -66,65 +123,593 @@ void Module::ThreadMain(void)
     main_loop->Run();
 }
 
+// A receive thread is pinned to the CPU unless it's -1.
+void Module::ReactorMain(Reactor *reactor, int cpu)
+{
+    if (secure)
+        pthread_setname_np(pthread_self(), "SecureTCPRecv");
+    else
+        pthread_setname_np(pthread_self(), "NormalTCPRecv");
+
+    if (0 <= cpu) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if (sched_setaffinity(0, sizeof(cpu_set), &cpu_set) != 0)
+            ERR_CODE(errno, "sched_setaffinity(%d) Fail", cpu);
+    }
+    reactor->loop->Run();
+}
+
+// The reactor with the fewest connections. Ties go round-robin. It runs on the loop thread.
+Module::Reactor *Module::ChooseReactor(void)
+{
+    size_t start = next_reactor++ % reactors.size();
+    Reactor *chosen = reactors[start].get();
+    for (size_t i = 1; i < reactors.size(); i++) {
+        Reactor *reactor = reactors[(start + i) % reactors.size()].get();
+        if (reactor->load < chosen->load)
+            chosen = reactor;
+    }
+    return chosen;
+}
+
 void Module::PublishFull(const AittMsg &msg, const void *data, const int datalen, AittQoS qos,
       bool retain, bool is_reply)
 {
     RET_IF(datalen < 0);
 
-    std::lock_guard<std::mutex> auto_lock_publish(publishTableLock);
+    Destinations destinations;
+    {
+        std::lock_guard<std::mutex> auto_lock_publish(publishTableLock);
+        destinations = is_reply ? LookupDestinations(msg.GetResponseTopic(), false)
+                                : LookupDestinations(msg.GetTopic());
+        if (destinations->empty() && is_reply)
+            held_replies.Hold(msg, data, datalen, qos);
+    }
+    if (destinations->empty())
+        return;
+
+    std::shared_ptr<const std::vector<uint8_t>> payload = CopyPayload(data, datalen);
+
+    // The loop thread(e.g. SendReply() in a callback) can't wait for itself to send.
+    bool can_block = (std::this_thread::get_id() != aittThread.get_id());
+    for (auto &destination : *destinations) {
+        const PortInfo &peer = destination.peer;
+        if (peer->queue.Push(PackMessage(msg, destination, payload, qos, is_reply), can_block))
+            ScheduleFlush(peer);
+    }
+}
+
+// Every peer gets all its messages of the batch before the flush, so they are written together.
+void Module::PublishBatch(const AittBatchMessage *messages, int count, AittQoS qos, bool retain)
+{
+    RET_IF(messages == nullptr);
+
+    std::vector<Destinations> destinations(count);
+    {
+        std::lock_guard<std::mutex> auto_lock_publish(publishTableLock);
+        for (int i = 0; i < count; i++)
+            destinations[i] = LookupDestinations(messages[i].topic);
+    }
+
+    std::map<PortInfo, std::vector<SendMessagePtr>> outbox;
+    for (int i = 0; i < count; i++) {
+        if (destinations[i]->empty() || messages[i].datalen < 0)
+            continue;
+
+        AittMsg msg;
+        msg.SetTopic(messages[i].topic);
+        std::shared_ptr<const std::vector<uint8_t>> payload =
+              CopyPayload(messages[i].data, messages[i].datalen);
+        for (auto &destination : *destinations[i])
+            outbox[destination.peer].push_back(PackMessage(msg, destination, payload, qos));
+    }
+
+    bool can_block = (std::this_thread::get_id() != aittThread.get_id());
+    for (auto &entry : outbox) {
+        const PortInfo &peer = entry.first;
+        // A publisher waiting for room must have its messages flushed.
+        size_t pending = 0;
+        for (auto &message : entry.second) {
+            if (pending == peer->queue.GetCapacity()) {
+                ScheduleFlush(peer);
+                pending = 0;
+            }
+            if (peer->queue.Push(SendMessagePtr(message), can_block))
+                pending++;
+        }
+        if (pending)
+            ScheduleFlush(peer);
+    }
+}
+
+// Peers subscribing the topic. publishTableLock must be held.
+// Reply topics are unique to each request, so they aren't cached.
+Module::Destinations Module::LookupDestinations(const std::string &topic, bool cache)
+{
+    if (cache) {
+        auto cacheIt = destinationCache.find(topic);
+        if (cacheIt != destinationCache.end()) {
+            destinationLru.splice(destinationLru.begin(), destinationLru, cacheIt->second.lru);
+            return cacheIt->second.destinations;
+        }
+    }
+
+    std::shared_ptr<std::vector<Destination>> destinations =
+          std::make_shared<std::vector<Destination>>();
+    std::map<PeerData *, size_t> index;
     for (PublishMap::iterator it = publishTable.begin(); it != publishTable.end(); ++it) {
         // NOTE: Find entries that have matched with the given topic
-        if (!discovery.CompareTopic(it->first, is_reply ? msg.GetResponseTopic() : msg.GetTopic()))
+        if (!discovery.CompareTopic(it->first, topic))
             continue;
 
-        for (HostMap::iterator hostIt = it->second.begin(); hostIt != it->second.end(); ++hostIt) {
-            PortInfo &port_info = hostIt->second;
-            if (!port_info.second) {
-                std::string host;
-                {
-                    ClientMap::iterator clientIt;
-                    std::lock_guard<std::mutex> auto_lock_client(clientTableLock);
-
-                    clientIt = clientTable.find(hostIt->first);
-                    if (clientIt != clientTable.end())
-                        host = clientIt->second;
-
-                    // NOTE:
-                    // otherwise, it is a critical error
-                    // The broken clientTable or subscribeTable
-                }
+        for (HostMap::iterator hostIt = it->second.begin(); hostIt != it->second.end();
+              ++hostIt) {
+            if (hostIt->first == local_id)
+                continue;
 
-                std::unique_ptr<TCP> client(new TCP(host, port_info.first));
-                port_info.second = std::move(client);
-            }
+            const RemoteTopic &remote = hostIt->second;
+            auto ret = index.insert(std::make_pair(remote.peer.get(), destinations->size()));
+            if (ret.second)
+                destinations->push_back(Destination{remote.peer, {}, true});
+            Destination &destination = (*destinations)[ret.first->second];
+            destination.ids.push_back(remote.id);
+            destination.exact = (destination.ids.size() == 1 && it->first == topic);
+        }
+    }
+
+    if (cache == false)
+        return destinations;
+
+    // The topic published least recently makes room.
+    if (AITT_TCP_DESTINATION_CACHE_MAX <= destinationCache.size()) {
+        destinationCache.erase(destinationLru.back());
+        destinationLru.pop_back();
+    }
+    destinationLru.push_front(topic);
+    destinationCache.insert(DestinationCache::value_type(topic,
+          CachedDestinations{destinations, destinationLru.begin()}));
+    return destinations;
+}
 
-            if (!port_info.second) {
-                ERR("Failed to create a new client instance");
+// Drop the cached topics matched with the topic filter whose peers changed.
+// publishTableLock must be held.
+void Module::InvalidateDestinations(const std::string &filter)
+{
+    for (auto it = destinationCache.begin(); it != destinationCache.end();) {
+        if (discovery.CompareTopic(filter, it->first)) {
+            destinationLru.erase(it->second.lru);
+            it = destinationCache.erase(it);
+        } else
+            ++it;
+    }
+}
+
+// It returns before sending, so the message keeps its own copy of the data.
+std::shared_ptr<const std::vector<uint8_t>> Module::CopyPayload(const void *data,
+      const int datalen)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    return std::make_shared<const std::vector<uint8_t>>(bytes, bytes + datalen);
+}
+
+// AITT_QOS_EXACTLY_ONCE is sent as AITT_QOS_AT_LEAST_ONCE.
+Module::SendMessagePtr Module::PackMessage(const AittMsg &msg, const Destination &destination,
+      const std::shared_ptr<const std::vector<uint8_t>> &payload, AittQoS qos, bool is_reply)
+{
+    std::shared_ptr<SendMessage> message = std::make_shared<SendMessage>();
+    message->reliable = (qos != AITT_QOS_AT_MOST_ONCE);
+    message->chunked = (destination.peer->chunked && AITT_TCP_CHUNK_SIZE < payload->size());
+    flexbuffers::Builder fbb;
+    PackMsgInfo(fbb, msg, destination, message->reliable, message->chunked ? payload->size() : 0,
+          is_reply);
+    message->header = fbb.GetBuffer();
+    message->payload = payload;
+    return message;
+}
+
+Module::PortInfo Module::NewPeer(const std::string &clientId, const TCP::ConnectInfo &info,
+      bool chunked)
+{
+    return std::make_shared<PeerData>(clientId, info, chunked, send_queue_size, send_overflow);
+}
+
+// The peer is disconnected on the loop thread.
+void Module::ClosePeer(const PortInfo &peer)
+{
+    peer->closed = true;
+    peer->queue.Close();
+    ScheduleFlush(peer);
+}
+
+void Module::ScheduleFlush(const PortInfo &peer)
+{
+    if (peer->flush_scheduled.exchange(true))
+        return;
+
+    main_loop->AddIdle(
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              peer->flush_scheduled = false;
+              FlushPeer(peer);
+              return AITT_LOOP_EVENT_REMOVE;
+          },
+          nullptr);
+}
+
+// Send queued messages until the socket buffer is full. It runs on the loop thread.
+// Frames of up to AITT_TCP_SEND_BATCH messages are written with one system call.
+void Module::FlushPeer(const PortInfo &peer)
+{
+    if (peer->closed) {
+        peer->queue.Clear(peer->InFlight() + peer->unacked.size());
+        peer->unacked.clear();
+        DisconnectPeer(*peer);
+        return;
+    }
+
+    if (peer->client == nullptr) {
+        if (peer->queue.IsEmpty() && peer->unacked.empty())
+            return;
+        // In the backoff, messages wait in the queue for the retry, which sends or drops them.
+        if (peer->retry_timer)
+            return;
+        if (ConnectPeer(peer) == false) {
+            DropMessages(*peer);
+            return;
+        }
+    }
+
+    std::vector<struct iovec> iov;
+    while (true) {
+        while (peer->sending.size() < AITT_TCP_SEND_BATCH) {
+            // Chunks of a message go before any other message.
+            if (peer->chunking) {
+                if (AddChunk(*peer) == false)
+                    break;
                 continue;
             }
 
-            try {
-                flexbuffers::Builder fbb;
-                PackMsgInfo(fbb, msg, is_reply);
-                auto buffer = fbb.GetBuffer();
-                port_info.second->SendSizedData(buffer.data(), buffer.size());
-
-                port_info.second->SendSizedData(data, datalen);
-            } catch (std::exception &e) {
-                ERR("An exception(%s) occurs during Send().", e.what());
+            // Messages not acknowledged on the last connection are sent again first.
+            SendMessagePtr message;
+            bool queued = false;
+            if (peer->replayed < peer->unacked.size()) {
+                message = peer->unacked[peer->replayed++];
+            } else if (AITT_TCP_RETRANSMIT_MAX <= peer->unacked.size()) {
+                break;
+            } else if (peer->queue.Pop(message)) {
+                queued = (message->reliable == false);
+                if (message->reliable) {
+                    peer->unacked.push_back(message);
+                    peer->replayed++;
+                }
+            } else {
+                break;
             }
+            AddMessage(*peer, message, queued);
         }
-    }  // publishTable
+        if (peer->sending.empty())
+            break;
+
+        iov.clear();
+        size_t offset = peer->sent_offset;
+        for (const auto &out : peer->sending) {
+            out.frames.GetSegments(offset, iov);
+            offset = 0;
+        }
+
+        ssize_t ret = peer->client->TrySend(iov.data(), iov.size());
+        if (ret < 0) {
+            ERR("Sending to %s Fail(%zd)", peer->clientId.c_str(), ret);
+            FailPeer(peer);
+            return;
+        }
+        if (ret == 0) {
+            WatchPeer(peer);
+            return;
+        }
+        peer->retry_delay = 0;
+        peer->active = true;
+
+        size_t sent = peer->sent_offset + ret;
+        while (peer->sending.empty() == false
+              && peer->sending.front().frames.GetLength() <= sent) {
+            sent -= peer->sending.front().frames.GetLength();
+            if (peer->sending.front().queued)
+                peer->queue.Sent();
+            peer->sending.pop_front();
+        }
+        peer->sent_offset = sent;
+    }
+
+    if (peer->watching) {
+        main_loop->RemoveWriteWatch(peer->client->GetHandle());
+        peer->watching = false;
+    }
+}
+
+// Messages are sent again when the socket is writable.
+void Module::WatchPeer(const PortInfo &peer)
+{
+    if (peer->watching)
+        return;
+
+    peer->watching = true;
+    main_loop->AddWriteWatch(
+          peer->client->GetHandle(),
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              if (result != MainLoopIface::Event::OKAY) {
+                  ERR("The connection to %s is broken", peer->clientId.c_str());
+                  FailPeer(peer);
+                  return AITT_LOOP_EVENT_REMOVE;
+              }
+
+              peer->retry_delay = 0;
+              FlushPeer(peer);
+              return peer->watching ? AITT_LOOP_EVENT_CONTINUE : AITT_LOOP_EVENT_REMOVE;
+          },
+          nullptr);
+}
+
+// A payload in chunks is added with its first chunk, and the rest as the peer grants them.
+void Module::AddMessage(PeerData &peer, const SendMessagePtr &message, bool queued)
+{
+    peer.sending.emplace_back();
+    OutMessage &out = peer.sending.back();
+    out.message = message;
+    peer.client->AddSizedData(message->header.data(), message->header.size(), out.frames);
+    if (message->chunked) {
+        peer.chunking = message;
+        peer.chunk_pos = 0;
+        peer.chunking_queued = queued;
+        AddChunk(peer);
+        return;
+    }
+
+    out.queued = queued;
+    peer.client->AddSizedData(message->payload->data(), message->payload->size(), out.frames);
+}
+
+// It returns false when the peer has no credit left.
+bool Module::AddChunk(PeerData &peer)
+{
+    if (AITT_TCP_CHUNK_CREDIT <= peer.chunks_sent - peer.chunks_taken)
+        return false;
+
+    const std::vector<uint8_t> &payload = *peer.chunking->payload;
+    size_t size = std::min(payload.size() - peer.chunk_pos, size_t(AITT_TCP_CHUNK_SIZE));
+    peer.sending.emplace_back();
+    OutMessage &out = peer.sending.back();
+    out.message = peer.chunking;
+    peer.client->AddSizedData(payload.data() + peer.chunk_pos, size, out.frames);
+    peer.chunk_pos += size;
+    peer.chunks_sent++;
+    if (peer.chunk_pos == payload.size()) {
+        out.queued = peer.chunking_queued;
+        peer.chunking.reset();
+    }
+    return true;
+}
+
+// The peer acknowledges the number of messages with AITT_QOS_AT_LEAST_ONCE it has received on
+// the connection, and they are dropped from the retransmit buffer. It grants the chunks it has
+// taken with them.
+int Module::ReceiveAck(const PortInfo &peer, MainLoopIface::Event result)
+{
+    uint64_t received = peer->acked;
+    uint64_t taken = peer->chunks_taken;
+    int ret = -ENOTCONN;
+    if (result == MainLoopIface::Event::OKAY) {
+        ret = peer->client->RecvFrames([&](void *frame, int32_t frame_size) {
+            if (frame == nullptr)
+                return;
+            auto map =
+                  flexbuffers::GetRoot(static_cast<const uint8_t *>(frame), frame_size).AsMap();
+            received = std::max(received, map["ack"].AsUInt64());
+            taken = std::max(taken, map["taken"].AsUInt64());
+            free(frame);
+        });
+    }
+
+    bool stalled =
+          (peer->chunking && AITT_TCP_CHUNK_CREDIT <= peer->chunks_sent - peer->chunks_taken);
+    taken = std::min(taken, peer->chunks_sent);
+    bool granted = (peer->chunks_taken < taken);
+    peer->chunks_taken = taken;
+
+    size_t count = std::min(static_cast<size_t>(received - peer->acked), peer->replayed);
+    bool was_full = (AITT_TCP_RETRANSMIT_MAX <= peer->unacked.size());
+    for (size_t i = 0; i < count; i++) {
+        peer->unacked.pop_front();
+        peer->queue.Sent();
+    }
+    peer->replayed -= count;
+    peer->acked = received;
+
+    if (ret < 0) {
+        ERR("The connection to %s is closed(%d)", peer->clientId.c_str(), ret);
+        FailPeer(peer);
+        return AITT_LOOP_EVENT_REMOVE;
+    }
+
+    if ((was_full && count) || (stalled && granted))
+        FlushPeer(peer);
+    return AITT_LOOP_EVENT_CONTINUE;
+}
+
+// Best-effort messages are dropped with the connection. Messages with AITT_QOS_AT_LEAST_ONCE
+// are kept to be sent after connecting again.
+void Module::DropMessages(PeerData &peer)
+{
+    peer.queue.Clear(peer.InFlight(),
+          [](const SendMessagePtr &message) { return message->reliable; });
+}
+
+void Module::FailPeer(const PortInfo &peer)
+{
+    DropMessages(*peer);
+    DisconnectPeer(*peer);
+    RetryPeer(peer);
+}
+
+// It connects before the first message, so publishing doesn't wait for it.
+void Module::PrewarmPeer(const PortInfo &peer)
+{
+    main_loop->AddIdle(
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              if (peer->closed == false && peer->client == nullptr && ConnectPeer(peer))
+                  WatchPeer(peer);
+              return AITT_LOOP_EVENT_REMOVE;
+          },
+          nullptr);
+}
+
+bool Module::ConnectPeer(const PortInfo &peer)
+{
+    if (peer->retry_timer)
+        return false;
+
+    std::string host;
+    {
+        std::lock_guard<std::mutex> auto_lock_client(clientTableLock);
+        ClientMap::iterator clientIt = clientTable.find(peer->clientId);
+        if (clientIt != clientTable.end())
+            host = clientIt->second;
+    }
+
+    try {
+        peer->client = std::unique_ptr<TCP>(new TCP(host, peer->info, true));
+    } catch (std::exception &e) {
+        ERR("Connecting to %s Fail(%s)", peer->clientId.c_str(), e.what());
+        RetryPeer(peer);
+        return false;
+    }
+
+    main_loop->AddWatch(
+          peer->client->GetHandle(),
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              return ReceiveAck(peer, result);
+          },
+          nullptr);
+    peer->active = false;
+    peer->misses = 0;
+    peer->heartbeat_timer = main_loop->AddTimeout(
+          AITT_TCP_HEARTBEAT_INTERVAL,
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              return CheckHeartbeat(peer);
+          },
+          nullptr);
+    return true;
+}
+
+// Connect again after the backoff, which is doubled on every failure. Best-effort messages
+// queued in the backoff are dropped if it fails again.
+void Module::RetryPeer(const PortInfo &peer)
+{
+    if (peer->closed || peer->retry_timer)
+        return;
+
+    if (peer->retry_delay == 0)
+        peer->retry_delay = AITT_TCP_CONNECT_BACKOFF_MIN;
+    else
+        peer->retry_delay = std::min(peer->retry_delay * 2, AITT_TCP_CONNECT_BACKOFF_MAX);
+
+    peer->retry_timer = main_loop->AddTimeout(
+          peer->retry_delay,
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              peer->retry_timer = 0;
+              if (peer->closed || peer->client)
+                  return AITT_LOOP_EVENT_REMOVE;
+              if (ConnectPeer(peer))
+                  WatchPeer(peer);
+              else
+                  DropMessages(*peer);
+              return AITT_LOOP_EVENT_REMOVE;
+          },
+          nullptr);
+}
+
+void Module::DisconnectPeer(PeerData &peer)
+{
+    if (peer.retry_timer)
+        main_loop->RemoveTimeout(peer.retry_timer);
+    peer.retry_timer = 0;
+    if (peer.heartbeat_timer)
+        main_loop->RemoveTimeout(peer.heartbeat_timer);
+    peer.heartbeat_timer = 0;
+    if (peer.watching)
+        main_loop->RemoveWriteWatch(peer.client->GetHandle());
+    peer.watching = false;
+    if (peer.client)
+        main_loop->RemoveWatch(peer.client->GetHandle());
+    peer.client.reset();
+    peer.sending.clear();
+    peer.sent_offset = 0;
+    // The retransmit buffer is sent again from the start.
+    peer.replayed = 0;
+    peer.acked = 0;
+    peer.chunking.reset();
+    peer.chunk_pos = 0;
+    peer.chunks_sent = 0;
+    peer.chunks_taken = 0;
+}
+
+// An idle connection sends a heartbeat, so a broken one fails without waiting for a message.
+// A peer that takes nothing for AITT_TCP_HEARTBEAT_MISSES intervals is dropped and connected
+// again, not to keep the publishers waiting for it.
+int Module::CheckHeartbeat(const PortInfo &peer)
+{
+    if (peer->active) {
+        peer->active = false;
+        peer->misses = 0;
+        return AITT_LOOP_EVENT_CONTINUE;
+    }
+
+    // A heartbeat can't go between the chunks of a message.
+    if (peer->sending.empty() == false || peer->chunking) {
+        if (++peer->misses < AITT_TCP_HEARTBEAT_MISSES)
+            return AITT_LOOP_EVENT_CONTINUE;
+
+        ERR("%s takes nothing for %d ms", peer->clientId.c_str(),
+              AITT_TCP_HEARTBEAT_INTERVAL * AITT_TCP_HEARTBEAT_MISSES);
+        FailPeer(peer);
+        return AITT_LOOP_EVENT_REMOVE;
+    }
+
+    AddMessage(*peer, heartbeat, false);
+    FlushPeer(peer);
+    return peer->heartbeat_timer ? AITT_LOOP_EVENT_CONTINUE : AITT_LOOP_EVENT_REMOVE;
+}
+
+// A heartbeat has no topic ID and no payload, so the receivers drop it.
+Module::SendMessagePtr Module::PackHeartbeat(void)
+{
+    std::shared_ptr<SendMessage> message = std::make_shared<SendMessage>();
+    flexbuffers::Builder fbb;
+    fbb.Map([]() {});
+    fbb.Finish();
+    message->header = fbb.GetBuffer();
+    message->payload = std::make_shared<const std::vector<uint8_t>>();
+    return message;
 }
 
-void Module::PackMsgInfo(flexbuffers::Builder &fbb, const AittMsg &msg, bool is_reply)
+void Module::PackMsgInfo(flexbuffers::Builder &fbb, const AittMsg &msg,
+      const Destination &destination, bool reliable, size_t chunked_size, bool is_reply)
 {
     fbb.Map([&]() {
+        fbb.Vector("ids", destination.ids.data(), destination.ids.size());
+        // The receiver acknowledges it.
+        if (reliable)
+            fbb.UInt("qos", AITT_QOS_AT_LEAST_ONCE);
+        // The payload of the size follows in chunks.
+        if (chunked_size)
+            fbb.UInt("size", chunked_size);
+        // The receiver takes the topic of the ID if it's the topic.
         if (is_reply) {
-            if (!msg.GetResponseTopic().empty())
+            if (!destination.exact && !msg.GetResponseTopic().empty())
                 fbb.String("topic", msg.GetResponseTopic().c_str());
         } else {
-            if (!msg.GetTopic().empty())
+            if (!destination.exact && !msg.GetTopic().empty())
                 fbb.String("topic", msg.GetTopic().c_str());
             if (!msg.GetResponseTopic().empty())
                 fbb.String("reply_topic", msg.GetResponseTopic().c_str());
@@ -133,7 +718,8 @@ void Module::PackMsgInfo(flexbuffers::Builder &fbb, const AittMsg &msg, bool is_
             fbb.String("correlation", msg.GetCorrelation().c_str());
         if (msg.GetSequence() != 0)
             fbb.UInt("sequence", msg.GetSequence());
-        if (msg.IsEndSequence())
+        // A received message ends the sequence by default.
+        if (is_reply)
             fbb.Bool("end_sequence", msg.IsEndSequence());
     });
 
@@ -151,38 +737,33 @@ void Module::Publish(const std::string &topic, const void *data, const int datal
 void *Module::Subscribe(const std::string &topic, const AittTransport::SubscribeCallback &cb,
       void *cbdata, AittQoS qos)
 {
-    TCPServerData *listen_info;
     std::unique_ptr<Subscribe_CB_Info> cb_info(new Subscribe_CB_Info(cb, cbdata));
     Subscribe_CB_Info *info_ptr = cb_info.get();
 
     std::lock_guard<std::mutex> lock_from_here(subscribeTableLock);
+    if (server == nullptr) {
+        unsigned short port = 0;
+        server = std::unique_ptr<TCP::Server>(new TCP::Server("0.0.0.0", port, secure));
+        main_loop->AddWatch(server->GetHandle(), AcceptConnection, &server_data);
+    }
+
     auto it = std::find_if(subscribeTable.begin(), subscribeTable.end(),
-          [&](const SubscribeMap::value_type &entry) { return entry.first->topic == topic; });
+          [&](const SubscribeMap::value_type &entry) { return entry.second->topic == topic; });
+    TopicData *topic_data;
     if (it != subscribeTable.end()) {
-        listen_info = it->first;
-        listen_info->cb_list.push_back(std::move(cb_info));
+        topic_data = it->second.get();
     } else {
-        unsigned short port = 0;
-        std::unique_ptr<TCP::Server> tcpServer(new TCP::Server("0.0.0.0", port, secure));
-
-        listen_info = new TCPServerData;
-        listen_info->impl = this;
-        listen_info->cb_list.push_back(std::move(cb_info));
-        listen_info->topic = topic;
-
-        main_loop->AddWatch(tcpServer->GetHandle(), AcceptConnection, listen_info);
-
-        auto ret =
-              subscribeTable.insert(SubscribeMap::value_type(listen_info, std::move(tcpServer)));
-        if (false == ret.second) {
-            ERR("insert(%s) Fail", topic.c_str());
-            throw std::runtime_error("insert() Fail: " + listen_info->topic);
-        }
+        topic_data = new TopicData;
+        topic_data->id = next_topic_id++;
+        topic_data->topic = topic;
+        subscribeTable.insert(
+              SubscribeMap::value_type(topic_data->id, std::unique_ptr<TopicData>(topic_data)));
     }
+    topic_data->cb_list.push_back(std::move(cb_info));
 
     UpdateDiscoveryMsg();
 
-    subscribe_handles.insert(SubscribeHandles::value_type(info_ptr, listen_info));
+    subscribe_handles.insert(SubscribeHandles::value_type(info_ptr, topic_data));
 
     return info_ptr;
 }
@@ -197,34 +778,21 @@ void *Module::Unsubscribe(void *handlePtr)
         return nullptr;
     }
 
-    TCPServerData *listen_info = handle_it->second;
+    TopicData *topic_data = handle_it->second;
     void *cbdata = handle_it->first->second;
     subscribe_handles.erase(handle_it);
 
-    if (1 < listen_info->cb_list.size()) {
-        auto cb_it = std::find_if(listen_info->cb_list.begin(), listen_info->cb_list.end(),
-              [&](const std::unique_ptr<Subscribe_CB_Info> &cb_info) {
-                  return cb_info.get() == handlePtr;
-              });
-        if (cb_it != listen_info->cb_list.end())
-            listen_info->cb_list.erase(cb_it);
-        else
-            throw std::runtime_error("Invalid Callback Info");
-        return cbdata;
-    }
+    auto cb_it = std::find_if(topic_data->cb_list.begin(), topic_data->cb_list.end(),
+          [&](const std::unique_ptr<Subscribe_CB_Info> &cb_info) {
+              return cb_info.get() == handlePtr;
+          });
+    if (cb_it == topic_data->cb_list.end())
+        throw std::runtime_error("Invalid Callback Info");
+    topic_data->cb_list.erase(cb_it);
 
-    for (auto fd : listen_info->client_list) {
-        TCPData *tcp_data = dynamic_cast<TCPData *>(main_loop->RemoveWatch(fd));
-        delete tcp_data;
-    }
-    listen_info->client_list.clear();
-
-    auto it = subscribeTable.find(listen_info);
-    if (it == subscribeTable.end())
-        throw std::runtime_error("Not subscribed topic: " + listen_info->topic);
-    main_loop->RemoveWatch(it->second->GetHandle());
-    subscribeTable.erase(it);
-    delete listen_info;
+    // Messages to the ID that arrive later are dropped.
+    if (topic_data->cb_list.empty())
+        subscribeTable.erase(topic_data->id);
 
     UpdateDiscoveryMsg();
 
@@ -254,7 +822,14 @@ void Module::SendReply(AittMsg *msg, const void *data, const int datalen, AittQo
 // Discovery Message (flexbuffers)
 // map {
 //   "host": "192.168.1.11",
-//   "$topic": {port, cb_list_size, key, iv}
+//   "port": 12345,               // the listener of the module, with a topic subscribed
+//   "key": blob, "iv": blob,     // with secure
+//   "aead": true,                // with secure
+//   "chunks": true,              // large payloads are taken in chunks
+//   "topics": map {
+//     "$topic": [id, cb_list_size],
+//     ...
+//   }
 // }
 void Module::DiscoveryMessageCallback(const std::string &clientId, const std::string &status,
       const void *msg, const int szmsg)
@@ -265,11 +840,8 @@ void Module::DiscoveryMessageCallback(const std::string &clientId, const std::st
             clientTable.erase(clientId);
         }
 
-        {
-            std::lock_guard<std::mutex> autoLock(publishTableLock);
-            for (auto it = publishTable.begin(); it != publishTable.end(); ++it)
-                it->second.erase(clientId);
-        }
+        std::lock_guard<std::mutex> autoLock(publishTableLock);
+        RemovePeers(clientId, std::set<std::string>());
         return;
     }
 
@@ -285,39 +857,69 @@ void Module::DiscoveryMessageCallback(const std::string &clientId, const std::st
             clientIt->second = host;
     }
 
-    auto topics = map.Keys();
-    for (size_t idx = 0; idx < topics.size(); ++idx) {
-        std::string topic = topics[idx].AsString().c_str();
+    TCP::ConnectInfo info;
+    info.port = map["port"].AsUInt16();
+    // Peers without it take a payload in one frame.
+    bool chunked = map["chunks"].AsBool();
+    if (secure && info.port) {
+        info.secure = true;
+        // Peers without it send AES-CBC frames.
+        info.aead = map["aead"].AsBool();
+        auto key_blob = map["key"].AsBlob();
+        if (key_blob.size() == sizeof(info.key))
+            memcpy(info.key, key_blob.data(), key_blob.size());
+        else
+            ERR("Invalid key blob(%zu) != %zu", key_blob.size(), sizeof(info.key));
 
-        if (!topic.compare("host"))
-            continue;
+        auto iv_blob = map["iv"].AsBlob();
+        if (iv_blob.size() == sizeof(info.iv))
+            memcpy(info.iv, iv_blob.data(), iv_blob.size());
+        else
+            ERR("Invalid iv blob(%zu) != %zu", iv_blob.size(), sizeof(info.iv));
+    }
 
-        TCP::ConnectInfo info;
-        auto connectInfo = map[topic].AsVector();
-        size_t vec_size = connectInfo.size();
-        info.port = connectInfo[TCP::CONN_INFO_PORT].AsUInt16();
-        info.num_of_cb = connectInfo[TCP::CONN_INFO_NUM_OF_CB].AsUInt16();
-        if (secure) {
-            if (vec_size != TCP::CONN_INFO_MAX) {
-                ERR("Unknown Message");
-                return;
+    std::lock_guard<std::mutex> autoLock(publishTableLock);
+    std::set<std::string> announced;
+    if (info.port) {
+        UpdatePeer(clientId, info, chunked);
+
+        auto topics = map["topics"].AsMap();
+        auto keys = topics.Keys();
+        for (size_t idx = 0; idx < keys.size(); ++idx) {
+            std::string topic = keys[idx].AsString().c_str();
+            auto topic_info = topics[topic].AsVector();
+            if (topic_info.size() < 2) {
+                ERR("Unknown Message(%s)", topic.c_str());
+                continue;
             }
-            info.secure = true;
-            auto key_blob = connectInfo[TCP::CONN_INFO_KEY].AsBlob();
-            if (key_blob.size() == sizeof(info.key))
-                memcpy(info.key, key_blob.data(), key_blob.size());
-            else
-                ERR("Invalid key blob(%zu) != %zu", key_blob.size(), sizeof(info.key));
-
-            auto iv_blob = connectInfo[TCP::CONN_INFO_IV].AsBlob();
-            if (iv_blob.size() == sizeof(info.iv))
-                memcpy(info.iv, iv_blob.data(), iv_blob.size());
-            else
-                ERR("Invalid iv blob(%zu) != %zu", iv_blob.size(), sizeof(info.iv));
+            UpdatePublishTable(topic, clientId, topic_info[0].AsUInt32(),
+                  topic_info[1].AsInt32());
+            announced.insert(topic);
         }
-        {
-            std::lock_guard<std::mutex> autoLock(publishTableLock);
-            UpdatePublishTable(topic, clientId, info);
+    }
+
+    // Topics not announced anymore are unsubscribed.
+    RemovePeers(clientId, announced);
+    SendHeldReplies();
+}
+
+// Replies to the reply topics discovered now. publishTableLock must be held, so it doesn't wait
+// for room in the send queues.
+void Module::SendHeldReplies(void)
+{
+    auto replies = held_replies.Take([this](const std::string &topic) {
+        return LookupDestinations(topic, false)->empty() == false;
+    });
+    for (auto &reply : replies) {
+        std::shared_ptr<const std::vector<uint8_t>> payload =
+              std::make_shared<const std::vector<uint8_t>>(std::move(reply.payload));
+        // Keep the destinations, they aren't cached.
+        Destinations destinations = LookupDestinations(reply.msg.GetResponseTopic(), false);
+        for (auto &destination : *destinations) {
+            const PortInfo &peer = destination.peer;
+            SendMessagePtr message = PackMessage(reply.msg, destination, payload, reply.qos, true);
+            if (peer->queue.Push(std::move(message), false))
+                ScheduleFlush(peer);
         }
     }
 }
@@ -327,23 +929,24 @@ void Module::UpdateDiscoveryMsg()
     flexbuffers::Builder fbb;
     fbb.Map([this, &fbb]() {
         fbb.String("host", ip);
+        if (server == nullptr || subscribeTable.empty())
+            return;
 
-        for (auto it = subscribeTable.begin(); it != subscribeTable.end(); ++it) {
-            if (it->second) {
-                fbb.Vector(it->first->topic.c_str(), [&]() {
-                    fbb.UInt(it->second->GetPort());
-                    fbb.UInt(it->first->cb_list.size());
-                    if (secure) {
-                        fbb.Blob(it->second->GetCryptoKey(), AITT_TCP_ENCRYPTOR_KEY_LEN);
-                        fbb.Blob(it->second->GetCryptoIv(), AITT_TCP_ENCRYPTOR_IV_LEN);
-                    }
+        fbb.UInt("port", server->GetPort());
+        fbb.Bool("chunks", true);
+        if (secure) {
+            fbb.Blob("key", server->GetCryptoKey(), AITT_TCP_ENCRYPTOR_KEY_LEN);
+            fbb.Blob("iv", server->GetCryptoIv(), AITT_TCP_ENCRYPTOR_IV_LEN);
+            fbb.Bool("aead", true);
+        }
+        fbb.Map("topics", [this, &fbb]() {
+            for (auto it = subscribeTable.begin(); it != subscribeTable.end(); ++it) {
+                fbb.Vector(it->second->topic.c_str(), [&]() {
+                    fbb.UInt(it->second->id);
+                    fbb.UInt(it->second->cb_list.size());
                 });
-            } else {
-                // this is an error case
-                TCP::ConnectInfo info;
-                fbb.Vector(it->first->topic.c_str(), [&]() { fbb.UInt(it->second->GetPort()); });
             }
-        }
+        });
     });
     fbb.Finish();
 
@@ -356,89 +959,292 @@ int Module::ReceiveData(MainLoopIface::Event result, int handle,
 {
     TCPData *tcp_data = dynamic_cast<TCPData *>(user_data);
     RETV_IF(tcp_data == nullptr, AITT_LOOP_EVENT_REMOVE);
-    TCPServerData *parent_info = tcp_data->parent;
-    RETV_IF(parent_info == nullptr, AITT_LOOP_EVENT_REMOVE);
-    Module *impl = parent_info->impl;
+    Module *impl = tcp_data->impl;
     RETV_IF(impl == nullptr, AITT_LOOP_EVENT_REMOVE);
+    Reactor *reactor = tcp_data->reactor;
 
     if (result == MainLoopIface::Event::HANGUP) {
         ERR("The main loop hung up. Disconnect the client.");
-        return impl->HandleClientDisconnect(handle);
+        return impl->HandleClientDisconnect(reactor, handle);
     }
 
-    int32_t szmsg = 0;
-    char *msg = nullptr;
-    AittMsg msg_info;
+    // Every complete message that has arrived is delivered at once.
+    std::vector<RecvMessage> messages;
+    int ret = tcp_data->client->RecvFrames(
+          [&](void *frame, int32_t frame_size) {
+              impl->HandleFrame(tcp_data, frame, frame_size, messages);
+          });
 
-    impl->GetMsgInfo(msg_info, tcp_data);
-    if (msg_info.GetTopic().empty()) {
-        ERR("A topic is empty.");
-        return AITT_LOOP_EVENT_CONTINUE;
+    using Delivery = std::pair<AittMsg, std::vector<Subscribe_CB_Info>>;
+    std::vector<Delivery> deliveries;
+    if (messages.empty() == false) {
+        std::lock_guard<std::mutex> autoLock(impl->subscribeTableLock);
+        for (auto &message : messages) {
+            Delivery delivery(message.msg, std::vector<Subscribe_CB_Info>());
+            for (auto id : message.ids) {
+                // The topic may be unsubscribed after the peer sent it.
+                auto topicIt = impl->subscribeTable.find(id);
+                if (topicIt == impl->subscribeTable.end())
+                    continue;
+
+                TopicData *topic_data = topicIt->second.get();
+                if (delivery.first.GetTopic().empty())
+                    delivery.first.SetTopic(topic_data->topic);
+                std::transform(topic_data->cb_list.begin(), topic_data->cb_list.end(),
+                      std::back_inserter(delivery.second),
+                      [](std::unique_ptr<Subscribe_CB_Info> const &it) { return *it; });
+            }
+            if (delivery.second.empty() == false)
+                deliveries.push_back(std::move(delivery));
+        }
     }
 
-    szmsg = tcp_data->client->RecvSizedData((void **)&msg);
-    if (-ENOTCONN == szmsg) {
-        ERR("Got a disconnection message(%d)", szmsg);
-        return impl->HandleClientDisconnect(handle);
-    } else if (szmsg < 0) {
-        ERR("Failed to receive data(%d)", szmsg);
-        return AITT_LOOP_EVENT_CONTINUE;
+    for (auto &delivery : deliveries) {
+        AittMsg &msg_info = delivery.first;
+        const AittMsgBuffer &payload = msg_info.GetPayload();
+        for (auto const &it : delivery.second)
+            it.first(&msg_info, payload.GetData(), payload.GetSize(), it.second);
     }
 
-    std::vector<Subscribe_CB_Info> cb_list;
-    {
-        std::lock_guard<std::mutex> autoLock(impl->subscribeTableLock);
-        std::transform(parent_info->cb_list.begin(), parent_info->cb_list.end(),
-              std::back_inserter(cb_list),
-              [](std::unique_ptr<Subscribe_CB_Info> const &it) { return *it; });
+    for (auto &message : messages) {
+        if (message.assembly)
+            impl->ReleaseChunkBuffer(reactor, std::move(message.assembly));
     }
-    for (auto const &it : cb_list)
-        it.first(&msg_info, msg, szmsg, it.second);
-    free(msg);
 
-    return AITT_LOOP_EVENT_CONTINUE;
+    // The messages are acknowledged once their callbacks return, so the peer sends them again
+    // if the connection is lost while they are handled.
+    if (ret < 0) {
+        ERR("Got a disconnection message(%d)", ret);
+        impl->HandleClientDisconnect(reactor, handle);
+    } else if (tcp_data->acked < tcp_data->received
+               || tcp_data->granted + AITT_TCP_CHUNK_CREDIT / 2 <= tcp_data->taken) {
+        impl->SendAck(tcp_data);
+    }
+
+    return (ret < 0) ? AITT_LOOP_EVENT_REMOVE : AITT_LOOP_EVENT_CONTINUE;
 }
 
-int Module::HandleClientDisconnect(int handle)
+void Module::HandleFrame(TCPData *tcp_data, void *frame, int32_t frame_size,
+      std::vector<RecvMessage> &messages)
 {
-    TCPData *tcp_data = dynamic_cast<TCPData *>(main_loop->RemoveWatch(handle));
-    if (tcp_data == nullptr) {
-        ERR("No watch data");
-        return AITT_LOOP_EVENT_REMOVE;
+    if (tcp_data->has_header == false) {
+        if (frame == nullptr) {
+            ERR("Unknown topic");
+            return;
+        }
+        tcp_data->header = AittMsg();
+        tcp_data->ids.clear();
+        size_t chunked_size = 0;
+        UnpackMsgInfo(tcp_data->header, tcp_data->ids, tcp_data->reliable, chunked_size, frame,
+              frame_size);
+        tcp_data->has_header = true;
+        free(frame);
+
+        if (AITT_MESSAGE_MAX < chunked_size) {
+            ERR("Invalid Size(%zu)", chunked_size);
+            chunked_size = 0;
+        }
+        tcp_data->chunk_left = chunked_size;
+        tcp_data->chunk_seq = 0;
+        // A request is answered once, so it's delivered whole.
+        bool stream = stream_chunks && tcp_data->header.GetResponseTopic().empty();
+        if (chunked_size && stream == false)
+            tcp_data->assembly = AcquireChunkBuffer(tcp_data->reactor, chunked_size);
+        return;
     }
-    auto it = std::find(tcp_data->parent->client_list.begin(), tcp_data->parent->client_list.end(),
-          handle);
-    tcp_data->parent->client_list.erase(it);
 
-    delete tcp_data;
-    return AITT_LOOP_EVENT_REMOVE;
+    if (tcp_data->chunk_left) {
+        HandleChunk(tcp_data, frame, frame_size, messages);
+        return;
+    }
+
+    tcp_data->has_header = false;
+    // It's acknowledged even if the topic is unsubscribed.
+    if (tcp_data->reliable)
+        tcp_data->received++;
+
+    // A heartbeat of the peer
+    if (tcp_data->ids.empty()) {
+        free(frame);
+        return;
+    }
+
+    messages.emplace_back();
+    RecvMessage &message = messages.back();
+    message.msg = tcp_data->header;
+    message.msg.SetPayload(AittMsgBuffer::Adopt(frame, frame_size));
+    message.ids.swap(tcp_data->ids);
 }
 
-void Module::GetMsgInfo(AittMsg &msg, Module::TCPData *tcp_data)
+// A chunk is copied into the buffer of the payload, or delivered by itself with streaming.
+// Either way, only a chunk is received at once.
+void Module::HandleChunk(TCPData *tcp_data, void *frame, int32_t frame_size,
+      std::vector<RecvMessage> &messages)
 {
-    std::lock_guard<std::mutex> autoLock(subscribeTableLock);
-    int32_t info_length = 0;
-    void *msg_info = nullptr;
-    info_length = tcp_data->client->RecvSizedData(&msg_info);
-    if (-ENOTCONN == info_length) {
-        ERR("Got a disconnection message.");
-        HandleClientDisconnect(tcp_data->client->GetHandle());
-        return;
+    size_t size = std::min(static_cast<size_t>(frame_size), tcp_data->chunk_left);
+    if (size < static_cast<size_t>(frame_size))
+        ERR("Invalid Chunk(%d) > %zu", frame_size, tcp_data->chunk_left);
+
+    tcp_data->taken++;
+    tcp_data->chunk_seq++;
+    tcp_data->chunk_left -= size;
+    bool last = (tcp_data->chunk_left == 0);
+    if (last) {
+        tcp_data->has_header = false;
+        if (tcp_data->reliable)
+            tcp_data->received++;
     }
-    if (nullptr == msg_info) {
-        ERR("Unknown topic");
+
+    if (tcp_data->assembly) {
+        std::vector<uint8_t> &assembly = *tcp_data->assembly;
+        memcpy(assembly.data() + assembly.size() - tcp_data->chunk_left - size, frame, size);
+        free(frame);
+        if (last == false)
+            return;
+
+        messages.emplace_back();
+        RecvMessage &message = messages.back();
+        message.msg = tcp_data->header;
+        message.msg.SetPayload(AittMsgBuffer::Wrap(assembly.data(), assembly.size()));
+        message.ids.swap(tcp_data->ids);
+        message.assembly = std::move(tcp_data->assembly);
         return;
     }
 
-    UnpackMsgInfo(msg, msg_info, info_length);
+    messages.emplace_back();
+    RecvMessage &message = messages.back();
+    message.msg = tcp_data->header;
+    message.msg.SetChunk(tcp_data->chunk_seq);
+    message.msg.SetLastChunk(last);
+    message.msg.SetPayload(AittMsgBuffer::Adopt(frame, size));
+    if (last)
+        message.ids.swap(tcp_data->ids);
+    else
+        message.ids = tcp_data->ids;
+}
+
+// The smallest buffer kept that fits, or the largest one grown
+Module::ChunkBuffer Module::AcquireChunkBuffer(Reactor *reactor, size_t size)
+{
+    std::vector<ChunkBuffer> &chunk_pool = reactor->chunk_pool;
+    ChunkBuffer buffer;
+    auto fit = chunk_pool.end();
+    for (auto it = chunk_pool.begin(); it != chunk_pool.end(); ++it) {
+        if (fit == chunk_pool.end())
+            fit = it;
+        else if ((*it)->capacity() < size)
+            fit = ((*fit)->capacity() < (*it)->capacity()) ? it : fit;
+        else if ((*fit)->capacity() < size || (*it)->capacity() < (*fit)->capacity())
+            fit = it;
+    }
+
+    if (fit != chunk_pool.end()) {
+        buffer = std::move(*fit);
+        chunk_pool.erase(fit);
+    } else {
+        buffer = ChunkBuffer(new std::vector<uint8_t>);
+    }
+    buffer->resize(size);
+    return buffer;
+}
+
+void Module::ReleaseChunkBuffer(Reactor *reactor, ChunkBuffer buffer)
+{
+    if (reactor->chunk_pool.size() < AITT_TCP_CHUNK_POOL)
+        reactor->chunk_pool.push_back(std::move(buffer));
+}
+
+// The number of messages with AITT_QOS_AT_LEAST_ONCE received on the connection is sent with
+// the number of chunks taken. A new one is sent after the last one has been sent completely.
+void Module::SendAck(TCPData *tcp_data)
+{
+    while (true) {
+        if (tcp_data->ack.GetLength() == 0) {
+            if (tcp_data->acked == tcp_data->received && tcp_data->granted == tcp_data->taken)
+                break;
+
+            flexbuffers::Builder fbb;
+            fbb.Map([&]() {
+                fbb.UInt("ack", tcp_data->received);
+                fbb.UInt("taken", tcp_data->taken);
+            });
+            fbb.Finish();
+            tcp_data->ack_data = fbb.GetBuffer();
+            tcp_data->client->AddSizedData(tcp_data->ack_data.data(), tcp_data->ack_data.size(),
+                  tcp_data->ack);
+            tcp_data->ack_offset = 0;
+            tcp_data->acked = tcp_data->received;
+            tcp_data->granted = tcp_data->taken;
+        }
+
+        std::vector<struct iovec> iov;
+        tcp_data->ack.GetSegments(tcp_data->ack_offset, iov);
+        ssize_t ret = tcp_data->client->TrySend(iov.data(), iov.size());
+        if (ret < 0) {
+            // ReceiveData() gets the disconnection.
+            ERR("Sending an acknowledgement Fail(%zd)", ret);
+            return;
+        }
+        if (ret == 0) {
+            if (tcp_data->ack_watching == false) {
+                tcp_data->ack_watching = true;
+                tcp_data->reactor->loop->AddWriteWatch(
+                      tcp_data->client->GetHandle(),
+                      [this, tcp_data](MainLoopIface::Event result, int fd,
+                            MainLoopIface::MainLoopData *data) {
+                          if (result == MainLoopIface::Event::OKAY)
+                              SendAck(tcp_data);
+                          else
+                              tcp_data->ack_watching = false;
+                          return tcp_data->ack_watching ? AITT_LOOP_EVENT_CONTINUE
+                                                        : AITT_LOOP_EVENT_REMOVE;
+                      },
+                      nullptr);
+            }
+            return;
+        }
 
-    free(msg_info);
+        tcp_data->ack_offset += ret;
+        if (tcp_data->ack.GetLength() <= tcp_data->ack_offset)
+            tcp_data->ack = TCP::Frames();
+    }
+
+    if (tcp_data->ack_watching) {
+        tcp_data->reactor->loop->RemoveWriteWatch(tcp_data->client->GetHandle());
+        tcp_data->ack_watching = false;
+    }
 }
 
-void Module::UnpackMsgInfo(AittMsg &msg, const void *data, const size_t datalen)
+int Module::HandleClientDisconnect(Reactor *reactor, int handle)
+{
+    TCPData *tcp_data = dynamic_cast<TCPData *>(reactor->loop->RemoveWatch(handle));
+    if (tcp_data == nullptr) {
+        ERR("No watch data");
+        return AITT_LOOP_EVENT_REMOVE;
+    }
+    if (tcp_data->ack_watching)
+        reactor->loop->RemoveWriteWatch(handle);
+    {
+        std::lock_guard<std::mutex> autoLock(reactor->connections_lock);
+        reactor->connections.erase(tcp_data);
+    }
+    reactor->load--;
+
+    delete tcp_data;
+    return AITT_LOOP_EVENT_REMOVE;
+}
+
+void Module::UnpackMsgInfo(AittMsg &msg, std::vector<uint32_t> &ids, bool &reliable,
+      size_t &chunked_size, const void *data, const size_t datalen)
 {
     auto map = flexbuffers::GetRoot(static_cast<const uint8_t *>(data), datalen).AsMap();
 
+    reliable = (map["qos"].IsUInt() && map["qos"].AsUInt64() != AITT_QOS_AT_MOST_ONCE);
+    if (map["size"].IsUInt())
+        chunked_size = map["size"].AsUInt64();
+    auto id_vector = map["ids"].AsTypedVector();
+    for (size_t idx = 0; idx < id_vector.size(); ++idx)
+        ids.push_back(id_vector[idx].AsUInt32());
     if (map["topic"].IsString())
         msg.SetTopic(map["topic"].AsString().str());
     if (map["reply_topic"].IsString())
@@ -462,12 +1268,7 @@ int Module::AcceptConnection(MainLoopIface::Event result, int handle,
     std::unique_ptr<TCP> client;
     {
         std::lock_guard<std::mutex> autoLock(impl->subscribeTableLock);
-
-        auto clientIt = impl->subscribeTable.find(listen_info);
-        if (clientIt == impl->subscribeTable.end())
-            return AITT_LOOP_EVENT_REMOVE;
-
-        client = clientIt->second->AcceptPeer();
+        client = impl->server->AcceptPeer();
     }
 
     if (client == nullptr) {
@@ -476,38 +1277,148 @@ int Module::AcceptConnection(MainLoopIface::Event result, int handle,
     }
 
     int client_handle = client->GetHandle();
-    listen_info->client_list.push_back(client_handle);
 
+    Reactor *reactor = impl->ChooseReactor();
     TCPData *tcp_data = new TCPData;
-    tcp_data->parent = listen_info;
+    tcp_data->impl = impl;
+    tcp_data->reactor = reactor;
     tcp_data->client = std::move(client);
+    {
+        std::lock_guard<std::mutex> autoLock(reactor->connections_lock);
+        reactor->connections.insert(tcp_data);
+    }
+    reactor->load++;
 
-    impl->main_loop->AddWatch(client_handle, ReceiveData, tcp_data);
+    reactor->loop->AddWatch(client_handle, ReceiveData, tcp_data);
     return AITT_LOOP_EVENT_CONTINUE;
 }
 
+// A new port or key means the peer has restarted, so the connection is made again.
+// publishTableLock must be held.
+void Module::UpdatePeer(const std::string &clientId, const TCP::ConnectInfo &info, bool chunked)
+{
+    auto peerIt = peerTable.find(clientId);
+    if (peerIt != peerTable.end()) {
+        const TCP::ConnectInfo &old_info = peerIt->second->info;
+        if (old_info.port == info.port && old_info.aead == info.aead
+              && peerIt->second->chunked == chunked
+              && memcmp(old_info.key, info.key, sizeof(info.key)) == 0
+              && memcmp(old_info.iv, info.iv, sizeof(info.iv)) == 0)
+            return;
+
+        ClosePeer(peerIt->second);
+        peerIt->second = NewPeer(clientId, info, chunked);
+    } else {
+        peerIt = peerTable
+                       .insert(PeerMap::value_type(clientId, NewPeer(clientId, info, chunked)))
+                       .first;
+    }
+    if (clientId != local_id)
+        PrewarmPeer(peerIt->second);
+
+    for (auto &entry : publishTable) {
+        auto hostIt = entry.second.find(clientId);
+        if (hostIt != entry.second.end())
+            hostIt->second.peer = peerIt->second;
+    }
+    destinationCache.clear();
+    destinationLru.clear();
+}
+
+// The peer of the client must be updated before. publishTableLock must be held.
 void Module::UpdatePublishTable(const std::string &topic, const std::string &clientId,
-      const TCP::ConnectInfo &info)
+      uint32_t id, int num_of_cb)
 {
-    auto topicIt = publishTable.find(topic);
-    if (topicIt == publishTable.end()) {
-        HostMap hostMap;
-        hostMap.insert(HostMap::value_type(clientId, std::make_pair(info, nullptr)));
-        publishTable.insert(PublishMap::value_type(topic, std::move(hostMap)));
+    auto peerIt = peerTable.find(clientId);
+    if (peerIt == peerTable.end()) {
+        ERR("Unknown client(%s)", clientId.c_str());
         return;
     }
 
-    auto hostIt = topicIt->second.find(clientId);
-    if (hostIt == topicIt->second.end()) {
-        topicIt->second.insert(HostMap::value_type(clientId, std::make_pair(info, nullptr)));
-    } else {
-        PortInfo &port_info = hostIt->second;
-        if (port_info.first.port == info.port) {
-            port_info.first.num_of_cb = info.num_of_cb;
-        } else {
-            port_info = std::make_pair(info, nullptr);
+    HostMap &hostMap = publishTable[topic];
+    auto hostIt = hostMap.find(clientId);
+    if (hostIt == hostMap.end()) {
+        hostMap.insert(HostMap::value_type(clientId, RemoteTopic{peerIt->second, id, num_of_cb}));
+        InvalidateDestinations(topic);
+        return;
+    }
+
+    RemoteTopic &remote = hostIt->second;
+    remote.num_of_cb = num_of_cb;
+    if (remote.id != id) {
+        remote.id = id;
+        InvalidateDestinations(topic);
+    }
+}
+
+// Remove the topics of the client except for the topics kept, and its peer with none of them.
+// publishTableLock must be held.
+void Module::RemovePeers(const std::string &clientId, const std::set<std::string> &kept)
+{
+    for (auto it = publishTable.begin(); it != publishTable.end();) {
+        auto hostIt = it->second.find(clientId);
+        if (hostIt == it->second.end() || kept.count(it->first)) {
+            ++it;
+            continue;
         }
+
+        it->second.erase(hostIt);
+        InvalidateDestinations(it->first);
+        if (it->second.empty())
+            it = publishTable.erase(it);
+        else
+            ++it;
     }
+
+    if (kept.empty() == false)
+        return;
+
+    auto peerIt = peerTable.find(clientId);
+    if (peerIt != peerTable.end()) {
+        ClosePeer(peerIt->second);
+        peerTable.erase(peerIt);
+    }
+}
+
+Module::PeerData::PeerData(const std::string &id, const TCP::ConnectInfo &connect_info,
+      bool in_chunks, size_t queue_size, AittSendOverflow overflow)
+      : clientId(id),
+        info(connect_info),
+        chunked(in_chunks),
+        queue(queue_size, overflow),
+        flush_scheduled(false),
+        closed(false),
+        sent_offset(0),
+        watching(false),
+        retry_delay(0),
+        retry_timer(0),
+        heartbeat_timer(0),
+        active(false),
+        misses(0),
+        replayed(0),
+        acked(0),
+        chunk_pos(0),
+        chunking_queued(false),
+        chunks_sent(0),
+        chunks_taken(0)
+{
+}
+
+Module::PeerData::~PeerData(void)
+{
+    aitt::SendQueue<SendMessagePtr>::Stats stats = queue.GetStats();
+    INFO("Peer(%s:%u) enqueued(%" PRIu64 ") sent(%" PRIu64 ") dropped(%" PRIu64
+         ") blocked(%" PRIu64 ") depth(%zu)",
+          clientId.c_str(), info.port, stats.enqueued, stats.sent, stats.dropped, stats.blocked,
+          stats.depth);
+}
+
+// Messages popped from the queue and not sent yet
+size_t Module::PeerData::InFlight(void) const
+{
+    size_t count = std::count_if(sending.begin(), sending.end(),
+          [](const OutMessage &out) { return out.queued; });
+    return (chunking && chunking_queued) ? count + 1 : count;
 }
 
 int Module::CountSubscriber(const std::string &topic)
@@ -519,8 +1430,7 @@ int Module::CountSubscriber(const std::string &topic)
     for (auto topicIt = publishTable.begin(); topicIt != publishTable.end(); ++topicIt) {
         if (discovery.CompareTopic(topicIt->first, topic)) {
             for (auto hostIt = topicIt->second.begin(); hostIt != topicIt->second.end(); ++hostIt) {
-                TCP::ConnectInfo info = hostIt->second.first;
-                count += info.num_of_cb;
+                count += hostIt->second.num_of_cb;
             }
         }
     }
@@ -528,4 +1438,15 @@ int Module::CountSubscriber(const std::string &topic)
     return count;
 }
 
+std::map<std::string, AittPeerStats> Module::GetPeerStats(void)
+{
+    std::map<std::string, AittPeerStats> stats;
+
+    std::lock_guard<std::mutex> auto_lock(publishTableLock);
+    for (auto &peer : peerTable)
+        stats[peer.first] = peer.second->queue.GetPeerStats();
+
+    return stats;
+}
+
 }  // namespace AittTCPNamespace
@@ -19,29 +19,76 @@
 #include <MainLoopIface.h>
 #include <flatbuffers/flexbuffers.h>
 
+#include <atomic>
+#include <deque>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "HeldReplies.h"
+#include "SendQueue.h"
 #include "TCPServer.h"
 
 using AittTransport = aitt::AittTransport;
 using MainLoopIface = aitt::MainLoopIface;
 using AittDiscovery = aitt::AittDiscovery;
 
+// Topics whose destinations are kept at most
+#define AITT_TCP_DESTINATION_CACHE_MAX 1024
+
+// Messages of a peer sent with one system call at most.
+// A message has 4 segments at most, so it keeps iovcnt under IOV_MAX(1024).
+#define AITT_TCP_SEND_BATCH 64
+
+// Delay of connecting to a peer again after a failure(ms), doubled up to the max.
+// Messages published in the backoff wait in the queue for the retry, so publishers with
+// AITT_SEND_OVERFLOW_BLOCK may wait for it on a full queue.
+#define AITT_TCP_CONNECT_BACKOFF_MIN 100
+#define AITT_TCP_CONNECT_BACKOFF_MAX 10000
+
+// An idle connection sends a heartbeat every interval(ms), and a peer that takes nothing
+// for the intervals is dropped.
+#define AITT_TCP_HEARTBEAT_INTERVAL 2000
+#define AITT_TCP_HEARTBEAT_MISSES 3
+
+// Messages with AITT_QOS_AT_LEAST_ONCE sent to a peer and not acknowledged yet at most
+#define AITT_TCP_RETRANSMIT_MAX 256
+
+// A payload larger than a chunk is sent in chunks to the peers that take them, so no frame of it
+// is encrypted or received at once.
+#define AITT_TCP_CHUNK_SIZE (64 * 1024)
+// Chunks sent to a peer and not taken yet at most. The peer grants more as it takes them.
+#define AITT_TCP_CHUNK_CREDIT 16
+// Buffers of reassembled payloads kept for the next large messages
+#define AITT_TCP_CHUNK_POOL 2
+
+// Receive threads at most, with one for each CPU
+#define AITT_TCP_RECEIVE_THREADS_MAX 64
+
 #define MODULE_NAMESPACE AittTCPNamespace
 namespace AittTCPNamespace {
 
+// A module listens on a port for all its topics, and a publisher has a connection to each peer.
+// The main loop accepts connections and sends messages. The connections accepted are received
+// on the main loop too, or spread over the receive threads.
+// The header of a message carries the IDs of the topics of the peer it's sent to.
+// A large payload follows it in chunks, as many as the peer grants.
 class Module : public AittTransport {
   public:
-    explicit Module(AittProtocol type, AittDiscovery &manager, const std::string &ip);
+    explicit Module(AittProtocol type, AittDiscovery &manager, const std::string &ip,
+          const AittOption &option = AittOption());
     virtual ~Module(void);
 
     void Publish(const std::string &topic, const void *data, const int datalen,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false) override;
+    void PublishBatch(const AittBatchMessage *messages, int count,
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false) override;
 
     void *Subscribe(const std::string &topic, const SubscribeCallback &cb, void *cbdata = nullptr,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE) override;
@@ -50,29 +97,151 @@ class Module : public AittTransport {
           AittQoS qos, bool retain, const std::string &reply_topic, const std::string &correlation);
     void SendReply(AittMsg *msg, const void *data, const int datalen, AittQoS qos, bool retain);
     int CountSubscriber(const std::string &topic);
+    std::map<std::string, AittPeerStats> GetPeerStats(void) override;
 
   private:
     using Subscribe_CB_Info = std::pair<SubscribeCallback, void *>;
+    using ChunkBuffer = std::unique_ptr<std::vector<uint8_t>>;
+
+    // A topic subscribed, known to the peers by its ID
+    struct TopicData {
+        uint32_t id;
+        std::string topic;
+        std::vector<std::unique_ptr<Subscribe_CB_Info>> cb_list;
+    };
 
     struct TCPServerData : public MainLoopIface::MainLoopData {
         Module *impl;
-        std::vector<std::unique_ptr<Subscribe_CB_Info>> cb_list;
-        std::string topic;
-        std::vector<int> client_list;
+    };
+
+    struct TCPData;
+    // A loop receiving from the connections given to it, the main loop or one on its own thread
+    struct Reactor {
+        Reactor() : loop(nullptr), load(0) {}
+
+        MainLoopIface *loop;
+        std::unique_ptr<MainLoopIface> own_loop;  // nullptr on the main loop
+        std::thread thread;
+        std::set<TCPData *> connections;  // guarded by connections_lock
+        std::mutex connections_lock;
+        std::atomic_int load;                 // connections
+        std::vector<ChunkBuffer> chunk_pool;  // used only on the loop
     };
 
     struct TCPData : public MainLoopIface::MainLoopData {
-        TCPServerData *parent;
+        TCPData()
+              : impl(nullptr),
+                reactor(nullptr),
+                has_header(false),
+                reliable(false),
+                chunk_left(0),
+                chunk_seq(0),
+                taken(0),
+                granted(0),
+                received(0),
+                acked(0),
+                ack_offset(0),
+                ack_watching(false)
+        {
+        }
+
+        Module *impl;
+        Reactor *reactor;
+        std::unique_ptr<TCP> client;
+        // A message comes in two frames, the header(flexbuffers) and the payload.
+        AittMsg header;
+        std::vector<uint32_t> ids;
+        bool has_header;
+        bool reliable;  // the header is of a message with AITT_QOS_AT_LEAST_ONCE
+
+        // The payload of the header in chunks
+        size_t chunk_left;     // bytes left to receive
+        int chunk_seq;         // number of the last chunk received
+        ChunkBuffer assembly;  // from the chunk pool, without streaming
+        uint64_t taken;        // chunks received on the connection
+        uint64_t granted;      // chunks taken in the last acknowledgement
+
+        // Acknowledgement of the messages with AITT_QOS_AT_LEAST_ONCE
+        uint64_t received;
+        uint64_t acked;
+        std::vector<uint8_t> ack_data;
+        TCP::Frames ack;  // being sent
+        size_t ack_offset;
+        bool ack_watching;
+    };
+
+    // A message received with the IDs of the topics it goes to
+    struct RecvMessage {
+        AittMsg msg;
+        std::vector<uint32_t> ids;
+        ChunkBuffer assembly;  // lent to the payload while delivered
+    };
+
+    // The payload is packed once and shared by the send queues of all peers.
+    // The header has the topic IDs of each peer.
+    struct SendMessage {
+        std::vector<uint8_t> header;
+        std::shared_ptr<const std::vector<uint8_t>> payload;
+        bool reliable;  // kept until the peer acknowledges it
+        bool chunked;   // the payload is sent in chunks
+    };
+    using SendMessagePtr = std::shared_ptr<const SendMessage>;
+
+    // Frames of a message point to its data, so it's kept until they are sent.
+    struct OutMessage {
+        OutMessage() : queued(false) {}
+
+        SendMessagePtr message;
+        TCP::Frames frames;
+        bool queued;  // counted by the queue when it's sent, not a heartbeat nor acknowledged
+    };
+
+    // Connection to another module, shared by all the topics it subscribes.
+    // Publishers only push messages to the queue, the loop thread connects and sends them.
+    // It's connected when discovered, and messages are dropped while it waits to reconnect.
+    struct PeerData {
+        PeerData(const std::string &id, const TCP::ConnectInfo &info, bool chunked,
+              size_t queue_size, AittSendOverflow overflow);
+        ~PeerData(void);
+        size_t InFlight(void) const;
+
+        const std::string clientId;
+        const TCP::ConnectInfo info;
+        const bool chunked;  // It takes large payloads in chunks.
+        aitt::SendQueue<SendMessagePtr> queue;
+        std::atomic_bool flush_scheduled;
+        std::atomic_bool closed;
+
+        // Below are used only on the loop thread
         std::unique_ptr<TCP> client;
+        std::deque<OutMessage> sending;  // popped from the queue to be sent together
+        size_t sent_offset;              // bytes of the first message already sent
+        bool watching;  // waiting for the socket to be writable
+        int retry_delay;           // backoff after the last failure(ms), 0 with a connection
+        unsigned int retry_timer;  // waiting to connect again
+        unsigned int heartbeat_timer;
+        bool active;  // sent since the last heartbeat interval
+        int misses;   // heartbeat intervals without sending
+        // Retransmit buffer of the messages with AITT_QOS_AT_LEAST_ONCE not acknowledged
+        std::deque<SendMessagePtr> unacked;
+        size_t replayed;  // messages of unacked sent on the connection
+        uint64_t acked;   // messages acknowledged on the connection
+        // The message whose payload is being sent in chunks, as the peer grants them
+        SendMessagePtr chunking;
+        size_t chunk_pos;       // bytes of the payload framed
+        bool chunking_queued;   // counted by the queue when the last chunk is sent
+        uint64_t chunks_sent;   // on the connection
+        uint64_t chunks_taken;  // by the peer
     };
+    using PortInfo = std::shared_ptr<PeerData>;
 
     // SubscribeTable
     // map {
-    //    "/customTopic/mytopic": $serverHandle,
+    //    $topicId: $topicData(topic, callbacks),
     //    ...
     // }
-    using SubscribeMap = std::map<TCPServerData *, std::unique_ptr<TCP::Server>>;
-    using SubscribeHandles = std::map<Subscribe_CB_Info *, TCPServerData *>;
+    using SubscribeMap = std::map<uint32_t /* topic id */, std::unique_ptr<TopicData>>;
+    using SubscribeHandles = std::map<Subscribe_CB_Info *, TopicData *>;
 
     // ClientTable
     // map {
@@ -82,34 +251,105 @@ class Module : public AittTransport {
     // }
     using ClientMap = std::map<std::string /* id */, std::string /* host */>;
 
+    // PeerTable
+    // map {
+    //   $clientId: $peerData(port, send queue, ...)  // one connection for each client
+    //   ...
+    // }
+    using PeerMap = std::map<std::string /* clientId */, PortInfo>;
+
+    // A topic subscribed by a peer
+    struct RemoteTopic {
+        PortInfo peer;
+        uint32_t id;
+        int num_of_cb;
+    };
+
     // PublishTable
     // map {
     //    "/customTopic/faceRecog": map {
-    //       $clientId: pair { 11234: $clientHandle } //one topic has one port for each client.
+    //       $clientId: $remoteTopic(peerData, topic id, number of callbacks),
     //       ...
     //       },
     //    },
     // }
-    using PortInfo = std::pair<TCP::ConnectInfo /* port */, std::unique_ptr<TCP>>;
-    using HostMap = std::map<std::string /* clientId */, PortInfo>;
+    using HostMap = std::map<std::string /* clientId */, RemoteTopic>;
     using PublishMap = std::map<std::string /* topic */, HostMap>;
 
+    // A peer of a topic with the IDs of its topic filters matched
+    struct Destination {
+        PortInfo peer;
+        std::vector<uint32_t> ids;
+        bool exact;  // The only topic filter is the topic, so the topic isn't sent.
+    };
+
+    // DestinationCache
+    // map {
+    //    "/customTopic/faceRecog/1": [$destination, ...],  // peers of every matched topic filter
+    //    ...
+    // }
+    // It's filled on the first publish to a topic, and the topics matched with a topic filter
+    // are dropped when the peers of the filter change. The topic published least recently is
+    // dropped when it's full.
+    using Destinations = std::shared_ptr<const std::vector<Destination>>;
+    struct CachedDestinations {
+        Destinations destinations;
+        std::list<std::string>::iterator lru;  // position in destinationLru
+    };
+    using DestinationCache = std::unordered_map<std::string /* topic */, CachedDestinations>;
+
     static int AcceptConnection(MainLoopIface::Event result, int handle,
           MainLoopIface::MainLoopData *watchData);
     void PublishFull(const AittMsg &msg, const void *data, const int datalen,
           AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false, bool is_reply = false);
+    Destinations LookupDestinations(const std::string &topic, bool cache = true);
+    void InvalidateDestinations(const std::string &filter);
+    std::shared_ptr<const std::vector<uint8_t>> CopyPayload(const void *data, const int datalen);
+    SendMessagePtr PackMessage(const AittMsg &msg, const Destination &destination,
+          const std::shared_ptr<const std::vector<uint8_t>> &payload, AittQoS qos,
+          bool is_reply = false);
     void DiscoveryMessageCallback(const std::string &clientId, const std::string &status,
           const void *msg, const int szmsg);
+    void SendHeldReplies(void);
     void UpdateDiscoveryMsg();
     static int ReceiveData(MainLoopIface::Event result, int handle,
           MainLoopIface::MainLoopData *watchData);
-    int HandleClientDisconnect(int handle);
-    void GetMsgInfo(AittMsg &msg, TCPData *connect_info);
+    int HandleClientDisconnect(Reactor *reactor, int handle);
+    void HandleFrame(TCPData *tcp_data, void *frame, int32_t frame_size,
+          std::vector<RecvMessage> &messages);
+    void HandleChunk(TCPData *tcp_data, void *frame, int32_t frame_size,
+          std::vector<RecvMessage> &messages);
+    void SendAck(TCPData *tcp_data);
+    ChunkBuffer AcquireChunkBuffer(Reactor *reactor, size_t size);
+    void ReleaseChunkBuffer(Reactor *reactor, ChunkBuffer buffer);
     void ThreadMain(void);
-    void UpdatePublishTable(const std::string &topic, const std::string &host,
-          const TCP::ConnectInfo &info);
-    void PackMsgInfo(flexbuffers::Builder &fbb, const AittMsg &msg, bool is_reply = false);
-    void UnpackMsgInfo(AittMsg &msg, const void *data, const size_t datalen);
+    void ReactorMain(Reactor *reactor, int cpu);
+    Reactor *ChooseReactor(void);
+    void UpdatePeer(const std::string &clientId, const TCP::ConnectInfo &info, bool chunked);
+    void UpdatePublishTable(const std::string &topic, const std::string &clientId, uint32_t id,
+          int num_of_cb);
+    void RemovePeers(const std::string &clientId, const std::set<std::string> &kept);
+    PortInfo NewPeer(const std::string &clientId, const TCP::ConnectInfo &info, bool chunked);
+    void ClosePeer(const PortInfo &peer);
+    void ScheduleFlush(const PortInfo &peer);
+    void FlushPeer(const PortInfo &peer);
+    void PrewarmPeer(const PortInfo &peer);
+    bool ConnectPeer(const PortInfo &peer);
+    void RetryPeer(const PortInfo &peer);
+    void DisconnectPeer(PeerData &peer);
+    void WatchPeer(const PortInfo &peer);
+    void AddMessage(PeerData &peer, const SendMessagePtr &message, bool queued);
+    bool AddChunk(PeerData &peer);
+    int ReceiveAck(const PortInfo &peer, MainLoopIface::Event result);
+    void DropMessages(PeerData &peer);
+    void FailPeer(const PortInfo &peer);
+    int CheckHeartbeat(const PortInfo &peer);
+    SendMessagePtr PackHeartbeat(void);
+    void PackMsgInfo(flexbuffers::Builder &fbb, const AittMsg &msg,
+          const Destination &destination, bool reliable, size_t chunked_size,
+          bool is_reply = false);
+    void UnpackMsgInfo(AittMsg &msg, std::vector<uint32_t> &ids, bool &reliable,
+          size_t &chunked_size, const void *data, const size_t datalen);
 
     const char *const NAME[2] = {"TCP", "SECURE_TCP"};
     std::unique_ptr<MainLoopIface> main_loop;
@@ -117,14 +357,29 @@ class Module : public AittTransport {
     int discovery_cb;
 
     PublishMap publishTable;
+    PeerMap peerTable;                      // guarded by publishTableLock
+    DestinationCache destinationCache;      // guarded by publishTableLock
+    std::list<std::string> destinationLru;  // guarded by publishTableLock, latest first
+    aitt::HeldReplies held_replies;         // guarded by publishTableLock
     std::mutex publishTableLock;
+    std::unique_ptr<TCP::Server> server;  // listening from the first subscription
+    TCPServerData server_data;
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    size_t next_reactor;  // used only on the loop thread
     SubscribeMap subscribeTable;
     SubscribeHandles subscribe_handles;
+    uint32_t next_topic_id;
     std::mutex subscribeTableLock;
     ClientMap clientTable;
     std::mutex clientTableLock;
     std::string ip;
     bool secure;
+    size_t send_queue_size;
+    AittSendOverflow send_overflow;
+    // Own subscribers get messages in the process with the local delivery, so they are skipped.
+    std::string local_id;
+    bool stream_chunks;
+    const SendMessagePtr heartbeat;
 };
 
 }  // namespace AittTCPNamespace
@@ -17,22 +17,36 @@
 
 #include <AittTypes.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdlib>
 #include <cstring>
+#include <random>
 #include <stdexcept>
 
 #include "aitt_internal.h"
 
 namespace AittTCPNamespace {
 
-TCP::TCP(const std::string &host, const ConnectInfo &connect_info)
-      : handle_(-1), addrlen_(0), addr_(nullptr), secure(false)
+TCP::TCP(const std::string &host, const ConnectInfo &connect_info, bool nonblocking)
+      : handle_(-1),
+        addrlen_(0),
+        addr_(nullptr),
+        secure(false),
+        aead(false),
+        nonce_(),
+        nonce_count_(0),
+        recv_len_(0),
+        frame_size_(-1),
+        frame_(nullptr),
+        frame_received_(0)
 {
     int ret = 0;
 
@@ -64,8 +78,16 @@ TCP::TCP(const std::string &host, const ConnectInfo &connect_info)
         inet_addr->sin_port = htons(connect_info.port);
         inet_addr->sin_family = AF_INET;
 
+        if (nonblocking) {
+            ret = fcntl(handle_, F_SETFL, fcntl(handle_, F_GETFL) | O_NONBLOCK);
+            if (ret < 0) {
+                ERR("fcntl(O_NONBLOCK) Fail");
+                break;
+            }
+        }
+
         ret = connect(handle_, addr_, addrlen_);
-        if (ret < 0) {
+        if (ret < 0 && (nonblocking == false || errno != EINPROGRESS)) {
             ERR("connect() Fail(%s, %d)", host.c_str(), connect_info.port);
             break;
         }
@@ -84,13 +106,24 @@ TCP::TCP(const std::string &host, const ConnectInfo &connect_info)
 }
 
 TCP::TCP(int handle, sockaddr *addr, socklen_t szAddr, const ConnectInfo &connect_info)
-      : handle_(handle), addrlen_(szAddr), addr_(addr), secure(false)
+      : handle_(handle),
+        addrlen_(szAddr),
+        addr_(addr),
+        secure(false),
+        aead(false),
+        nonce_(),
+        nonce_count_(0),
+        recv_len_(0),
+        frame_size_(-1),
+        frame_(nullptr),
+        frame_received_(0)
 {
     SetupOptions(connect_info);
 }
 
 TCP::~TCP(void)
 {
+    free(frame_);
     if (handle_ < 0)
         return;
 
@@ -108,12 +141,50 @@ void TCP::SetupOptions(const ConnectInfo &connect_info)
         ERR_CODE(errno, "delay option setting failed");
     }
 
+    // A peer gone silently is detected by the kernel, so the connection fails instead of
+    // waiting forever.
+    int idle = AITT_TCP_KEEPALIVE_IDLE;
+    int interval = AITT_TCP_KEEPALIVE_INTERVAL;
+    int count = AITT_TCP_KEEPALIVE_COUNT;
+    if (setsockopt(handle_, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on)) < 0
+          || setsockopt(handle_, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle)) < 0
+          || setsockopt(handle_, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval)) < 0
+          || setsockopt(handle_, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count)) < 0) {
+        ERR_CODE(errno, "keepalive option setting failed");
+    }
+
+#ifdef TCP_USER_TIMEOUT
+    unsigned int user_timeout = AITT_TCP_USER_TIMEOUT;
+    ret = setsockopt(handle_, IPPROTO_TCP, TCP_USER_TIMEOUT, &user_timeout, sizeof(user_timeout));
+    if (ret < 0) {
+        ERR_CODE(errno, "user timeout option setting failed");
+    }
+#endif
+
     if (connect_info.secure) {
         secure = true;
+        aead = connect_info.aead;
         crypto.Init(connect_info.key, connect_info.iv);
     }
 }
 
+// Every connection to a server shares its key, so the salt is chosen randomly.
+// A new salt is chosen when the counter wraps around.
+void TCP::NextNonce(unsigned char *nonce)
+{
+    if (nonce_count_ == 0) {
+        std::random_device random;
+        for (size_t i = 0; i < sizeof(nonce_) - sizeof(nonce_count_); i += sizeof(unsigned int)) {
+            unsigned int value = random();
+            memcpy(nonce_ + i, &value, sizeof(value));
+        }
+    }
+
+    nonce_count_++;
+    memcpy(nonce_ + sizeof(nonce_) - sizeof(nonce_count_), &nonce_count_, sizeof(nonce_count_));
+    memcpy(nonce, nonce_, sizeof(nonce_));
+}
+
 int32_t TCP::Send(const void *data, int32_t data_size)
 {
     int32_t sent = 0;
@@ -129,14 +200,109 @@ int32_t TCP::Send(const void *data, int32_t data_size)
     return sent;
 }
 
+ssize_t TCP::TrySend(const struct iovec *iov, int iovcnt)
+{
+    struct msghdr msg = {};
+    msg.msg_iov = const_cast<struct iovec *>(iov);
+    msg.msg_iovlen = iovcnt;
+
+    while (true) {
+        ssize_t ret = sendmsg(handle_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (0 <= ret)
+            return ret;
+
+        int err = errno;
+        if (err == EINTR)
+            continue;
+        if (err == EAGAIN || err == EWOULDBLOCK)
+            return 0;
+        ERR_CODE(err, "sendmsg(%d) Fail", handle_);
+        return -err;
+    }
+}
+
+void TCP::AddSizedData(const void *data, int32_t data_size, Frames &frames)
+{
+    RET_IF(data_size < 0);
+
+    // distinguish between connection problems and zero-size messages
+    int32_t fixed_data_size = data_size ? data_size : INT32_MAX;
+    std::vector<unsigned char> &buffer = frames.buffer;
+    size_t pos = buffer.size();
+
+    if (aead) {
+        // The size and the data are encrypted in one pass right into the buffer.
+        buffer.resize(pos + AITT_TCP_AEAD_HEAD_LEN + data_size + AITT_TCP_ENCRYPTOR_TAG_LEN);
+        unsigned char *frame = buffer.data() + pos;
+        NextNonce(frame);
+        int ret = crypto.Seal(frame, reinterpret_cast<unsigned char *>(&data_size),
+              sizeof(data_size), static_cast<const unsigned char *>(data), data_size,
+              frame + AITT_TCP_ENCRYPTOR_NONCE_LEN, frame + AITT_TCP_AEAD_HEAD_LEN + data_size);
+        if (ret < 0) {
+            ERR("Seal() Fail(%d)", ret);
+            buffer.resize(pos);
+            return;
+        }
+        frames.AddOwned(pos, buffer.size() - pos);
+        return;
+    }
+
+    if (secure == false) {
+        // Small data is copied to be sent in the same segment with the length prefix.
+        bool copy = (data_size <= AITT_TCP_FRAME_COPY_MAX);
+        buffer.resize(pos + sizeof(fixed_data_size) + (copy ? data_size : 0));
+        memcpy(buffer.data() + pos, &fixed_data_size, sizeof(fixed_data_size));
+        if (copy && data_size)
+            memcpy(buffer.data() + pos + sizeof(fixed_data_size), data, data_size);
+        frames.AddOwned(pos, buffer.size() - pos);
+        if (copy == false) {
+            frames.segments.push_back(Frames::Segment{data, 0, static_cast<size_t>(data_size)});
+            frames.length += data_size;
+        }
+        return;
+    }
+
+    int32_t size_len = crypto.GetCryptogramSize(sizeof(int32_t));
+    buffer.resize(pos + size_len + (data_size ? crypto.GetCryptogramSize(data_size) : 0));
+    unsigned char *size_buf = buffer.data() + pos;
+    if (data_size) {
+        int32_t data_len = crypto.Encrypt(static_cast<const unsigned char *>(data), data_size,
+              size_buf + size_len);
+        crypto.Encrypt((unsigned char *)&data_len, sizeof(data_len), size_buf);
+        buffer.resize(pos + size_len + data_len);
+    } else {
+        crypto.Encrypt((unsigned char *)&fixed_data_size, sizeof(fixed_data_size), size_buf);
+    }
+    frames.AddOwned(pos, buffer.size() - pos);
+}
+
 void TCP::SendSizedData(const void *data, int32_t data_size)
 {
     RET_IF(data_size < 0);
+    if (0 == data_size)
+        INFO("Send a zero-size message.");
 
-    if (secure)
-        return SendSizedDataSecure(data, data_size);
-    else
-        return SendSizedDataNormal(data, data_size);
+    Frames frames;
+    AddSizedData(data, data_size, frames);
+
+    std::vector<struct iovec> iov;
+    size_t sent = 0;
+    while (sent < frames.GetLength()) {
+        iov.clear();
+        frames.GetSegments(sent, iov);
+
+        struct msghdr msg = {};
+        msg.msg_iov = iov.data();
+        msg.msg_iovlen = iov.size();
+        ssize_t ret = sendmsg(handle_, &msg, 0);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            ERR("sendmsg(%d, %zu) Fail(%d)", handle_, frames.GetLength(), errno);
+            throw std::runtime_error("send() Fail");
+        }
+        sent += ret;
+    }
 }
 
 int32_t TCP::Recv(void *data, int32_t data_size)
@@ -161,12 +327,214 @@ int32_t TCP::Recv(void *data, int32_t data_size)
 
 int32_t TCP::RecvSizedData(void **data)
 {
-    if (secure)
+    if (aead)
+        return RecvSizedDataAead(data);
+    else if (secure)
         return RecvSizedDataSecure(data);
     else
         return RecvSizedDataNormal(data);
 }
 
+int TCP::RecvFrames(const FrameCallback &cb)
+{
+    size_t budget = AITT_TCP_RECV_BUDGET;
+
+    while (budget > 0) {
+        unsigned char *dest;
+        size_t room;
+        if (frame_) {
+            dest = frame_ + frame_received_;
+            room = frame_size_ - frame_received_;
+        } else {
+            if (recv_buf_.size() - recv_len_ < AITT_TCP_RECV_CHUNK)
+                recv_buf_.resize(recv_len_ + AITT_TCP_RECV_CHUNK);
+            dest = recv_buf_.data() + recv_len_;
+            room = recv_buf_.size() - recv_len_;
+        }
+
+        ssize_t ret = recv(handle_, dest, room, MSG_DONTWAIT);
+        if (ret < 0) {
+            int err = errno;
+            if (err == EINTR)
+                continue;
+            if (err == EAGAIN || err == EWOULDBLOCK)
+                break;
+            ERR_CODE(err, "recv(%d) Fail", handle_);
+            return -err;
+        }
+        if (ret == 0) {
+            ERR("disconnected");
+            return -ENOTCONN;
+        }
+        budget -= std::min(budget, static_cast<size_t>(ret));
+
+        if (frame_) {
+            frame_received_ += ret;
+            if (frame_received_ < frame_size_)
+                continue;
+
+            unsigned char *frame = frame_;
+            frame_ = nullptr;
+            int result = DeliverFrame(frame, frame_size_, true, cb);
+            frame_size_ = -1;
+            if (result < 0)
+                return result;
+        } else {
+            recv_len_ += ret;
+            int result = ParseFrames(cb);
+            if (result < 0)
+                return result;
+        }
+
+        // Nothing more to read
+        if (static_cast<size_t>(ret) < room)
+            break;
+    }
+
+    return 0;
+}
+
+int TCP::ParseFrames(const FrameCallback &cb)
+{
+    size_t size_len = secure ? crypto.GetCryptogramSize(sizeof(int32_t)) : sizeof(int32_t);
+    if (aead)
+        size_len = AITT_TCP_AEAD_HEAD_LEN;
+    size_t pos = 0;
+    int result = 0;
+
+    while (result == 0) {
+        size_t avail = recv_len_ - pos;
+        if (frame_size_ < 0) {
+            if (avail < size_len)
+                break;
+
+            int32_t frame_size = 0;
+            if (aead) {
+                // The head is kept to authenticate the frame with its data.
+                memcpy(frame_head_, recv_buf_.data() + pos, size_len);
+                if (crypto.OpenHead(frame_head_, frame_head_ + AITT_TCP_ENCRYPTOR_NONCE_LEN,
+                          sizeof(frame_size), reinterpret_cast<unsigned char *>(&frame_size))
+                      < 0) {
+                    result = -EPROTO;
+                    break;
+                }
+            } else if (secure) {
+                unsigned char plain_size_buf[AITT_TCP_ENCRYPTOR_BLOCK_SIZE * 2];
+                crypto.Decrypt(recv_buf_.data() + pos, size_len, plain_size_buf);
+                memcpy(&frame_size, plain_size_buf, sizeof(frame_size));
+            } else {
+                memcpy(&frame_size, recv_buf_.data() + pos, sizeof(frame_size));
+            }
+            pos += size_len;
+
+            if (aead == false && frame_size == INT32_MAX) {
+                cb(nullptr, 0);
+                continue;
+            }
+            if (frame_size < 0 || AITT_MESSAGE_MAX < frame_size) {
+                ERR("Invalid Size(%d)", frame_size);
+                result = -EPROTO;
+                break;
+            }
+            frame_size_ = frame_size + (aead ? AITT_TCP_ENCRYPTOR_TAG_LEN : 0);
+        } else if (static_cast<size_t>(frame_size_) <= avail) {
+            result = DeliverFrame(recv_buf_.data() + pos, frame_size_, false, cb);
+            pos += frame_size_;
+            frame_size_ = -1;
+        } else {
+            // Receive the rest of a large frame directly into its own buffer.
+            if (AITT_TCP_RECV_CHUNK < frame_size_) {
+                frame_ = static_cast<unsigned char *>(malloc(frame_size_));
+                if (frame_ == nullptr) {
+                    ERR("malloc(%d) Fail", frame_size_);
+                    result = -ENOMEM;
+                    break;
+                }
+                memcpy(frame_, recv_buf_.data() + pos, avail);
+                frame_received_ = avail;
+                pos += avail;
+            }
+            break;
+        }
+    }
+
+    recv_len_ -= pos;
+    if (pos && recv_len_)
+        memmove(recv_buf_.data(), recv_buf_.data() + pos, recv_len_);
+    return result;
+}
+
+// If owned is true, frame was allocated by malloc() and it's consumed here.
+int TCP::DeliverFrame(unsigned char *frame, int32_t frame_size, bool owned,
+      const FrameCallback &cb)
+{
+    if (aead)
+        return DeliverAeadFrame(frame, frame_size, owned, cb);
+
+    if (secure) {
+        unsigned char *data = static_cast<unsigned char *>(malloc(frame_size));
+        int32_t result = data ? crypto.Decrypt(frame, frame_size, data) : -ENOMEM;
+        if (owned)
+            free(frame);
+        if (result < 0) {
+            ERR("Decrypt() Fail(%d)", result);
+            free(data);
+            return -EPROTO;
+        }
+        cb(data, result);
+        return 0;
+    }
+
+    if (owned) {
+        cb(frame, frame_size);
+        return 0;
+    }
+
+    void *data = nullptr;
+    if (frame_size) {
+        data = malloc(frame_size);
+        if (data == nullptr) {
+            ERR("malloc(%d) Fail", frame_size);
+            return -ENOMEM;
+        }
+        memcpy(data, frame, frame_size);
+    }
+    cb(data, frame_size);
+    return 0;
+}
+
+// An owned frame is decrypted in place and passed to the callback without copying.
+int TCP::DeliverAeadFrame(unsigned char *frame, int32_t frame_size, bool owned,
+      const FrameCallback &cb)
+{
+    int32_t data_size = frame_size - AITT_TCP_ENCRYPTOR_TAG_LEN;
+    unsigned char *data = owned ? frame : nullptr;
+    if (owned == false && data_size) {
+        data = static_cast<unsigned char *>(malloc(data_size));
+        if (data == nullptr) {
+            ERR("malloc(%d) Fail", data_size);
+            return -ENOMEM;
+        }
+    }
+
+    int32_t size;
+    int result = crypto.Open(frame_head_, frame_head_ + AITT_TCP_ENCRYPTOR_NONCE_LEN,
+          sizeof(size), frame, data_size, frame + data_size,
+          reinterpret_cast<unsigned char *>(&size), data);
+    if (result < 0) {
+        ERR("Open() Fail(%d)", result);
+        free(data);
+        return -EPROTO;
+    }
+
+    if (data_size == 0) {
+        free(data);
+        data = nullptr;
+    }
+    cb(data, data_size);
+    return 0;
+}
+
 int32_t TCP::HandleZeroMsg(void **data)
 {
     // distinguish between connection problems and zero-size messages
@@ -205,20 +573,6 @@ unsigned short TCP::GetPort(void)
     return ntohs(addr.sin_port);
 }
 
-void TCP::SendSizedDataNormal(const void *data, int32_t data_size)
-{
-    int32_t fixed_data_size = data_size;
-    if (0 == data_size) {
-        // distinguish between connection problems and zero-size messages
-        INFO("Send a zero-size message.");
-        fixed_data_size = INT32_MAX;
-    }
-
-    int32_t size_len = sizeof(fixed_data_size);
-    Send(static_cast<const void *>(&fixed_data_size), size_len);
-    Send(data, data_size);
-}
-
 int32_t TCP::RecvSizedDataNormal(void **data)
 {
     int32_t result;
@@ -234,52 +588,26 @@ int32_t TCP::RecvSizedDataNormal(void **data)
     if (data_len == INT32_MAX)
         return HandleZeroMsg(data);
 
-    if (AITT_MESSAGE_MAX < data_len) {
+    if (data_len < 0 || AITT_MESSAGE_MAX < data_len) {
         ERR("Invalid Size(%d)", data_len);
         return -1;
     }
     void *data_buf = malloc(data_len);
-    Recv(data_buf, data_len);
-    if (data_len < 0) {
-        ERR("Recv() Fail(%d)", data_len);
+    if (data_buf == nullptr) {
+        ERR("malloc(%d) Fail", data_len);
+        return -1;
+    }
+    result = Recv(data_buf, data_len);
+    if (result < 0) {
+        ERR("Recv() Fail(%d)", result);
         free(data_buf);
-    } else {
-        *data = data_buf;
+        return result;
     }
 
+    *data = data_buf;
     return data_len;
 }
 
-void TCP::SendSizedDataSecure(const void *data, int32_t data_size)
-{
-    int32_t fixed_data_size = data_size;
-    if (0 == data_size) {
-        // distinguish between connection problems and zero-size messages
-        INFO("Send a zero-size message.");
-        fixed_data_size = INT32_MAX;
-    }
-
-    int32_t size_len;
-    unsigned char *size_buf =
-          static_cast<unsigned char *>(malloc(crypto.GetCryptogramSize(sizeof(int32_t))));
-
-    if (data_size) {
-        unsigned char *data_buf =
-              static_cast<unsigned char *>(malloc(crypto.GetCryptogramSize(data_size)));
-        int32_t data_len =
-              crypto.Encrypt(static_cast<const unsigned char *>(data), data_size, data_buf);
-        size_len = crypto.Encrypt((unsigned char *)&data_len, sizeof(data_len), size_buf);
-        Send(size_buf, size_len);
-        Send(data_buf, data_len);
-        free(data_buf);
-    } else {
-        size_len =
-              crypto.Encrypt((unsigned char *)&fixed_data_size, sizeof(fixed_data_size), size_buf);
-        Send(size_buf, size_len);
-    }
-    free(size_buf);
-}
-
 int32_t TCP::RecvSizedDataSecure(void **data)
 {
     int32_t result;
@@ -320,7 +648,92 @@ int32_t TCP::RecvSizedDataSecure(void **data)
     return result;
 }
 
-TCP::ConnectInfo::ConnectInfo() : port(0), num_of_cb(0), secure(false), key(), iv()
+int32_t TCP::RecvSizedDataAead(void **data)
+{
+    int32_t result = Recv(frame_head_, sizeof(frame_head_));
+    if (result < 0) {
+        ERR("Recv() Fail(%d)", result);
+        return result;
+    }
+
+    int32_t data_len = 0;
+    result = crypto.OpenHead(frame_head_, frame_head_ + AITT_TCP_ENCRYPTOR_NONCE_LEN,
+          sizeof(data_len), reinterpret_cast<unsigned char *>(&data_len));
+    if (result < 0 || data_len < 0 || AITT_MESSAGE_MAX < data_len) {
+        ERR("Invalid Size(%d)", data_len);
+        return -1;
+    }
+
+    int32_t frame_len = data_len + AITT_TCP_ENCRYPTOR_TAG_LEN;
+    unsigned char *frame_buf = static_cast<unsigned char *>(malloc(frame_len));
+    if (frame_buf == nullptr) {
+        ERR("malloc(%d) Fail", frame_len);
+        return -1;
+    }
+
+    result = Recv(frame_buf, frame_len);
+    if (0 <= result) {
+        int32_t size;
+        result = crypto.Open(frame_head_, frame_head_ + AITT_TCP_ENCRYPTOR_NONCE_LEN,
+              sizeof(size), frame_buf, data_len, frame_buf + data_len,
+              reinterpret_cast<unsigned char *>(&size), frame_buf);
+    }
+    if (result < 0) {
+        ERR("Recv() or Open() Fail(%d)", result);
+        free(frame_buf);
+        return result;
+    }
+
+    if (data_len == 0) {
+        free(frame_buf);
+        return HandleZeroMsg(data);
+    }
+    *data = frame_buf;
+    return data_len;
+}
+
+TCP::Frames::Frames() : length(0)
+{
+}
+
+size_t TCP::Frames::GetLength(void) const
+{
+    return length;
+}
+
+void TCP::Frames::GetSegments(size_t offset, std::vector<struct iovec> &iov) const
+{
+    for (const auto &segment : segments) {
+        if (segment.size <= offset) {
+            offset -= segment.size;
+            continue;
+        }
+
+        const unsigned char *data = buffer.data() + segment.pos;
+        if (segment.data)
+            data = static_cast<const unsigned char *>(segment.data);
+        struct iovec vec;
+        vec.iov_base = const_cast<unsigned char *>(data + offset);
+        vec.iov_len = segment.size - offset;
+        iov.push_back(vec);
+        offset = 0;
+    }
+}
+
+// Adjacent segments in the buffer are merged.
+void TCP::Frames::AddOwned(size_t pos, size_t size)
+{
+    length += size;
+    if (segments.empty() == false && segments.back().data == nullptr
+          && segments.back().pos + segments.back().size == pos) {
+        segments.back().size += size;
+        return;
+    }
+    segments.push_back(Segment{nullptr, pos, size});
+}
+
+TCP::ConnectInfo::ConnectInfo()
+      : port(0), secure(false), aead(false), key(), iv()
 {
 }
 
@@ -17,8 +17,11 @@
 
 #include <stdint.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
+#include <functional>
 #include <string>
+#include <vector>
 
 #include "AESEncryptorMbedTLS.h"
 #include "AESEncryptorOpenSSL.h"
@@ -27,6 +30,20 @@
 #define SOCK_CLOEXEC 0
 #endif
 
+#define AITT_TCP_RECV_CHUNK 4096
+// Bytes read for a connection at once, not to starve the others on the same loop
+#define AITT_TCP_RECV_BUDGET (1024 * 1024)
+// Data up to this size is copied into Frames instead of having its own segment.
+#define AITT_TCP_FRAME_COPY_MAX 256
+// The nonce and the encrypted size in front of an AEAD frame
+#define AITT_TCP_AEAD_HEAD_LEN (AITT_TCP_ENCRYPTOR_NONCE_LEN + sizeof(int32_t))
+// Keepalive probes of an idle connection(seconds, count)
+#define AITT_TCP_KEEPALIVE_IDLE 5
+#define AITT_TCP_KEEPALIVE_INTERVAL 1
+#define AITT_TCP_KEEPALIVE_COUNT 3
+// A connection is closed when the data sent isn't acknowledged for this time(ms).
+#define AITT_TCP_USER_TIMEOUT 8000
+
 namespace AittTCPNamespace {
 class TCP {
   public:
@@ -35,25 +52,54 @@ class TCP {
         ConnectInfo();
 
         unsigned short port;
-        int num_of_cb;
         bool secure;
+        bool aead;  // AES-GCM frames instead of AES-CBC, with secure
         unsigned char key[AITT_TCP_ENCRYPTOR_KEY_LEN];
         unsigned char iv[AITT_TCP_ENCRYPTOR_IV_LEN];
     };
 
-    enum ConnectInfoMember {
-        CONN_INFO_PORT,
-        CONN_INFO_NUM_OF_CB,
-        CONN_INFO_KEY,
-        CONN_INFO_IV,
-        CONN_INFO_MAX
+    // The data is allocated by malloc() and the callback takes it. It's nullptr for zero-size.
+    using FrameCallback = std::function<void(void *data, int32_t data_size)>;
+
+    // Sized frames to be sent with a single system call.
+    // Plain data isn't copied and has to be kept until the frames are sent.
+    // Length prefixes and encrypted frames are kept in the Frames.
+    class Frames {
+      public:
+        Frames();
+
+        size_t GetLength(void) const;
+        // Append segments of the frames after the offset bytes to iov.
+        void GetSegments(size_t offset, std::vector<struct iovec> &iov) const;
+
+      private:
+        friend class TCP;
+        struct Segment {
+            const void *data;  // nullptr if it's in buffer
+            size_t pos;        // position in buffer
+            size_t size;
+        };
+
+        void AddOwned(size_t pos, size_t size);
+
+        std::vector<unsigned char> buffer;
+        std::vector<Segment> segments;
+        size_t length;
     };
 
-    TCP(const std::string &host, const ConnectInfo &ConnectInfo);
+    // With nonblocking, connect() doesn't wait for the connection and sending doesn't block.
+    TCP(const std::string &host, const ConnectInfo &ConnectInfo, bool nonblocking = false);
     virtual ~TCP(void);
 
     void SendSizedData(const void *data, int32_t data_size);
+    // Add a sized frame to frames as SendSizedData() sends it.
+    void AddSizedData(const void *data, int32_t data_size, Frames &frames);
+    // It returns the bytes sent without blocking, 0 if the socket isn't writable yet or -errno.
+    ssize_t TrySend(const struct iovec *iov, int iovcnt);
     int RecvSizedData(void **data);
+    // Read what has arrived without blocking and call the callback for every complete frame.
+    // A partial frame is kept until the next call. It returns -ENOTCONN when disconnected.
+    int RecvFrames(const FrameCallback &cb);
     int GetHandle(void);
     unsigned short GetPort(void);
     void GetPeerInfo(std::string &host, unsigned short &port);
@@ -66,15 +112,33 @@ class TCP {
     TCP(int handle, sockaddr *addr, socklen_t addrlen, const ConnectInfo &connect_info);
     void SetupOptions(const ConnectInfo &connect_info);
     int HandleZeroMsg(void **data);
-    void SendSizedDataNormal(const void *data, int32_t data_size);
     int RecvSizedDataNormal(void **data);
-    void SendSizedDataSecure(const void *data, int32_t data_size);
     int RecvSizedDataSecure(void **data);
+    int RecvSizedDataAead(void **data);
+    void NextNonce(unsigned char *nonce);
+    int ParseFrames(const FrameCallback &cb);
+    int DeliverFrame(unsigned char *frame, int32_t frame_size, bool owned,
+          const FrameCallback &cb);
+    int DeliverAeadFrame(unsigned char *frame, int32_t frame_size, bool owned,
+          const FrameCallback &cb);
 
     int handle_;
     socklen_t addrlen_;
     sockaddr *addr_;
     bool secure;
+    // AEAD frame: nonce | encrypted (size | data) | tag
+    // The nonce is a random salt of the connection followed by a counter.
+    bool aead;
+    unsigned char nonce_[AITT_TCP_ENCRYPTOR_NONCE_LEN];
+    uint32_t nonce_count_;
+
+    // Receive state of RecvFrames()
+    std::vector<unsigned char> recv_buf_;
+    size_t recv_len_;
+    int32_t frame_size_;  // -1 while waiting for the size of the next frame
+    unsigned char *frame_;  // a large frame is received here directly, not through recv_buf_
+    int32_t frame_received_;
+    unsigned char frame_head_[AITT_TCP_AEAD_HEAD_LEN];
 #ifdef WITH_MBEDTLS
     AESEncryptorMbedTLS crypto;
 #else
@@ -119,6 +119,7 @@ std::unique_ptr<TCP> TCP::Server::AcceptPeer(void)
     ConnectInfo info;
     if (secure) {
         info.secure = true;
+        info.aead = true;
         memcpy(info.key, key, sizeof(key));
         memcpy(info.iv, iv, sizeof(iv));
     }
@@ -33,6 +33,9 @@ class AESEncryptorTest : public testing::Test {
     unsigned char TEST_CIPHER_IV[AITT_TCP_ENCRYPTOR_IV_LEN] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae,
           0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
 
+    unsigned char TEST_NONCE[AITT_TCP_ENCRYPTOR_NONCE_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+          0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c};
+
     const std::string TEST_MESSAGE = "TCP encryptions.";
 
 #ifdef WITH_MBEDTLS
@@ -79,3 +82,40 @@ TEST_F(AESEncryptorTest, Decryped_N_Anytime)
         ASSERT_STREQ(e.what(), strerror(EINVAL));
     }
 }
+
+TEST_F(AESEncryptorTest, SealOpen_P_Anytime)
+{
+    int32_t size = TEST_MESSAGE.size();
+    unsigned char ciphertext[sizeof(size) + TEST_MESSAGE.size()];
+    unsigned char tag[AITT_TCP_ENCRYPTOR_TAG_LEN];
+    int len = crypto.Seal(TEST_NONCE, reinterpret_cast<unsigned char *>(&size), sizeof(size),
+          reinterpret_cast<const unsigned char *>(TEST_MESSAGE.c_str()), size, ciphertext, tag);
+    ASSERT_EQ(len, static_cast<int>(sizeof(ciphertext)));
+
+    int32_t plain_size = 0;
+    len = crypto.OpenHead(TEST_NONCE, ciphertext, sizeof(plain_size),
+          reinterpret_cast<unsigned char *>(&plain_size));
+    ASSERT_EQ(len, static_cast<int>(sizeof(plain_size)));
+    ASSERT_EQ(plain_size, size);
+
+    // The body is decrypted in place.
+    len = crypto.Open(TEST_NONCE, ciphertext, sizeof(plain_size), ciphertext + sizeof(size), size,
+          tag, reinterpret_cast<unsigned char *>(&plain_size), ciphertext + sizeof(size));
+    ASSERT_EQ(len, size);
+    EXPECT_EQ(std::string(reinterpret_cast<char *>(ciphertext) + sizeof(size), size), TEST_MESSAGE);
+}
+
+TEST_F(AESEncryptorTest, Open_N_Anytime)
+{
+    int32_t size = TEST_MESSAGE.size();
+    unsigned char ciphertext[sizeof(size) + TEST_MESSAGE.size()];
+    unsigned char tag[AITT_TCP_ENCRYPTOR_TAG_LEN];
+    crypto.Seal(TEST_NONCE, reinterpret_cast<unsigned char *>(&size), sizeof(size),
+          reinterpret_cast<const unsigned char *>(TEST_MESSAGE.c_str()), size, ciphertext, tag);
+
+    ciphertext[sizeof(size)] ^= 1;
+    unsigned char plaintext[TEST_MESSAGE.size()];
+    int len = crypto.Open(TEST_NONCE, ciphertext, sizeof(size), ciphertext + sizeof(size), size,
+          tag, reinterpret_cast<unsigned char *>(&size), plaintext);
+    EXPECT_EQ(len, -1);
+}
@@ -94,3 +94,39 @@ TEST_F(AESCompatibilityTest, opensslEncrypt_mbedtlsDecrypt_Anytime)
         ASSERT_EQ(0, memcmp(plaintext.data(), decrypted, decrypted_len));
     }
 }
+
+TEST_F(AESCompatibilityTest, opensslSeal_mbedtlsOpen_Anytime)
+{
+    unsigned char nonce[AITT_TCP_ENCRYPTOR_NONCE_LEN] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+          0x08, 0x09, 0x0a, 0x0b, 0x0c};
+    unsigned char tag[AITT_TCP_ENCRYPTOR_TAG_LEN];
+    opensslcryptor.Init(TEST_CIPHER_KEY, TEST_CIPHER_IV);
+    mbedtlscryptor.Init(TEST_CIPHER_KEY, TEST_CIPHER_IV);
+
+    plaintext.resize(100);
+    std::independent_bits_engine<std::default_random_engine, CHAR_BIT, unsigned char> random_engine;
+    std::generate(begin(plaintext), end(plaintext), std::ref(random_engine));
+
+    for (int i = 0; i < static_cast<int>(plaintext.size()); i++) {
+        int32_t size = i;
+        int32_t decrypted_size = 0;
+        opensslcryptor.Seal(nonce, reinterpret_cast<unsigned char *>(&size), sizeof(size),
+              plaintext.data(), i, ciphertext, tag);
+        int decrypted_len = mbedtlscryptor.Open(nonce, ciphertext, sizeof(size),
+              ciphertext + sizeof(size), i, tag, reinterpret_cast<unsigned char *>(&decrypted_size),
+              decrypted);
+
+        ASSERT_EQ(i, decrypted_len);
+        ASSERT_EQ(size, decrypted_size);
+        ASSERT_EQ(0, memcmp(plaintext.data(), decrypted, decrypted_len));
+
+        mbedtlscryptor.Seal(nonce, reinterpret_cast<unsigned char *>(&size), sizeof(size),
+              plaintext.data(), i, ciphertext, tag);
+        decrypted_len = opensslcryptor.Open(nonce, ciphertext, sizeof(size),
+              ciphertext + sizeof(size), i, tag, reinterpret_cast<unsigned char *>(&decrypted_size),
+              decrypted);
+
+        ASSERT_EQ(i, decrypted_len);
+        ASSERT_EQ(0, memcmp(plaintext.data(), decrypted, decrypted_len));
+    }
+}
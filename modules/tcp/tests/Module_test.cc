@@ -0,0 +1,252 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../Module.h"
+
+#include <flatbuffers/flexbuffers.h>
+#include <gtest/gtest.h>
+#include <poll.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../TCPServer.h"
+#include "AittDiscovery.h"
+#include "MQ.h"
+#include "aitt_internal.h"
+
+#define TEST_HOST "127.0.0.1"
+#define TEST_PEER "module_test_peer"
+#define TEST_TOPIC "test/module"
+#define TEST_MSG "This is aitt tcp module test message"
+#define TEST_ACCEPT_TIMEOUT 1000
+// Messages more than the socket buffers, so the module writes them partially
+#define TEST_PARTIAL_COUNT 64
+#define TEST_PARTIAL_SIZE (256 * 1024)
+
+using namespace AittTCPNamespace;
+
+// Discovery messages are delivered by the test instead of a broker.
+class DiscoveryMQ : public aitt::MQ {
+  public:
+    DiscoveryMQ() : user_data(nullptr) {}
+
+    void SetConnectionCallback(const MQConnectionCallback &cb) override { connection_cb = cb; }
+    void Connect(const std::string &host, int port, const std::string &username,
+          const std::string &password) override
+    {
+        if (connection_cb)
+            connection_cb(AITT_CONNECTED);
+    }
+    void SetWillInfo(const std::string &topic, const void *msg, int szmsg, int qos,
+          bool retain) override
+    {
+    }
+    void Disconnect(void) override {}
+    void Publish(const std::string &topic, const void *data, const int datalen, int qos,
+          bool retain) override
+    {
+    }
+    void PublishWithReply(const std::string &topic, const void *data, const int datalen, int qos,
+          bool retain, const std::string &reply_topic, const std::string &correlation) override
+    {
+    }
+    void SendReply(AittMsg *msg, const void *data, const int datalen, int qos,
+          bool retain) override
+    {
+    }
+    void *Subscribe(const std::string &topic, const SubscribeCallback &cb, void *data,
+          int qos) override
+    {
+        discovery_cb = cb;
+        user_data = data;
+        return this;
+    }
+    void *Unsubscribe(void *handle) override
+    {
+        discovery_cb = nullptr;
+        return user_data;
+    }
+    bool CompareTopic(const std::string &left, const std::string &right) override
+    {
+        return left == right;
+    }
+
+    MQConnectionCallback connection_cb;
+    SubscribeCallback discovery_cb;
+    void *user_data;
+};
+
+class TCPModuleTest : public testing::Test {
+  protected:
+    void SetUp() override
+    {
+        discovery = std::unique_ptr<aitt::AittDiscovery>(new aitt::AittDiscovery("module_test"));
+        mq = new DiscoveryMQ();
+        discovery->SetMQ(std::unique_ptr<aitt::MQ>(mq));
+        discovery->Start(TEST_HOST, 0, "", "");
+        module = std::unique_ptr<Module>(new Module(AITT_TYPE_TCP, *discovery, TEST_HOST));
+    }
+
+    void TearDown() override
+    {
+        module.reset();
+        discovery.reset();
+    }
+
+    // The peer subscribes TEST_TOPIC at the port.
+    void Announce(unsigned short port)
+    {
+        flexbuffers::Builder tcp;
+        tcp.Map([&]() {
+            tcp.String("host", TEST_HOST);
+            tcp.UInt("port", port);
+            tcp.Map("topics", [&]() {
+                tcp.Vector(TEST_TOPIC, [&]() {
+                    tcp.UInt(1);
+                    tcp.UInt(1);
+                });
+            });
+        });
+        tcp.Finish();
+
+        flexbuffers::Builder fbb;
+        fbb.Map([&]() {
+            fbb.String("status", aitt::AittDiscovery::JOIN_NETWORK);
+            fbb.Key("TCP");
+            fbb.Blob(tcp.GetBuffer().data(), tcp.GetBuffer().size());
+        });
+        fbb.Finish();
+
+        AittMsg msg;
+        msg.SetTopic(DISCOVERY_TOPIC_BASE + TEST_PEER);
+        ASSERT_TRUE(mq->discovery_cb != nullptr);
+        mq->discovery_cb(&msg, fbb.GetBuffer().data(), fbb.GetBuffer().size(), mq->user_data);
+    }
+
+    static std::unique_ptr<TCP> Accept(TCP::Server &server, int timeout_ms)
+    {
+        struct pollfd fds = {server.GetHandle(), POLLIN, 0};
+        if (poll(&fds, 1, timeout_ms) <= 0)
+            return nullptr;
+        return server.AcceptPeer();
+    }
+
+    // It returns true when a frame of the data arrives in the time.
+    static bool WaitFrame(TCP &peer, const std::string &data, int timeout_ms)
+    {
+        bool found = false;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (found == false && std::chrono::steady_clock::now() < deadline) {
+            struct pollfd fds = {peer.GetHandle(), POLLIN, 0};
+            if (poll(&fds, 1, 10) <= 0)
+                continue;
+            int ret = peer.RecvFrames([&](void *frame, int32_t frame_size) {
+                if (frame && std::string(static_cast<char *>(frame), frame_size) == data)
+                    found = true;
+                free(frame);
+            });
+            if (ret < 0)
+                break;
+        }
+        return found;
+    }
+
+    std::unique_ptr<aitt::AittDiscovery> discovery;
+    DiscoveryMQ *mq;
+    std::unique_ptr<Module> module;
+};
+
+TEST_F(TCPModuleTest, Prewarm_P_Anytime)
+{
+    unsigned short port = 0;
+    TCP::Server server(TEST_HOST, port);
+
+    // The peer is connected on the discovery, before any message is published.
+    Announce(port);
+    std::unique_ptr<TCP> peer = Accept(server, TEST_ACCEPT_TIMEOUT);
+    ASSERT_NE(peer, nullptr);
+
+    module->Publish(TEST_TOPIC, TEST_MSG, sizeof(TEST_MSG) - 1);
+    EXPECT_TRUE(WaitFrame(*peer, TEST_MSG, TEST_ACCEPT_TIMEOUT));
+}
+
+TEST_F(TCPModuleTest, ConnectBackoff_P_Anytime)
+{
+    unsigned short port = 0;
+    std::unique_ptr<TCP::Server> server(new TCP::Server(TEST_HOST, port));
+    server.reset();
+
+    // Connecting is refused at once, then again after MIN and after MIN * 2.
+    auto start = std::chrono::steady_clock::now();
+    Announce(port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(AITT_TCP_CONNECT_BACKOFF_MIN * 4));
+    server = std::unique_ptr<TCP::Server>(new TCP::Server(TEST_HOST, port));
+
+    // A message published in the backoff waits for the retry after MIN * 4.
+    std::this_thread::sleep_for(std::chrono::milliseconds(AITT_TCP_CONNECT_BACKOFF_MIN / 2));
+    module->Publish(TEST_TOPIC, TEST_MSG, sizeof(TEST_MSG) - 1);
+
+    std::unique_ptr<TCP> peer = Accept(*server, AITT_TCP_CONNECT_BACKOFF_MIN * 10);
+    ASSERT_NE(peer, nullptr);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start);
+    EXPECT_GE(elapsed.count(), AITT_TCP_CONNECT_BACKOFF_MIN * 6);
+    EXPECT_LT(elapsed.count(), AITT_TCP_CONNECT_BACKOFF_MIN * 15);
+
+    EXPECT_TRUE(WaitFrame(*peer, TEST_MSG, TEST_ACCEPT_TIMEOUT));
+}
+
+TEST_F(TCPModuleTest, PartialSend_P_Anytime)
+{
+    unsigned short port = 0;
+    TCP::Server server(TEST_HOST, port);
+    Announce(port);
+    std::unique_ptr<TCP> peer = Accept(server, TEST_ACCEPT_TIMEOUT);
+    ASSERT_NE(peer, nullptr);
+
+    std::vector<std::string> payloads;
+    for (int i = 0; i < TEST_PARTIAL_COUNT; i++) {
+        payloads.push_back(std::string(TEST_PARTIAL_SIZE, 'a' + i % 26));
+        module->Publish(TEST_TOPIC, payloads.back().data(), payloads.back().size());
+    }
+
+    // Nothing is read yet, so the socket is full in the middle of a message.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_LT(module->GetPeerStats()[TEST_PEER].sent, TEST_PARTIAL_COUNT + 0ULL);
+
+    // The rest is sent from the offset written, when the socket is writable again.
+    std::vector<std::string> received;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (received.size() < payloads.size() && std::chrono::steady_clock::now() < deadline) {
+        struct pollfd fds = {peer->GetHandle(), POLLIN, 0};
+        if (poll(&fds, 1, 10) <= 0)
+            continue;
+        int ret = peer->RecvFrames([&](void *frame, int32_t frame_size) {
+            if (frame_size == TEST_PARTIAL_SIZE)
+                received.push_back(std::string(static_cast<char *>(frame), frame_size));
+            free(frame);
+        });
+        ASSERT_LE(0, ret);
+    }
+
+    ASSERT_EQ(received.size(), payloads.size());
+    for (size_t i = 0; i < payloads.size(); i++)
+        EXPECT_EQ(received[i], payloads[i]) << "message " << i;
+}
@@ -14,13 +14,18 @@
  * limitations under the License.
  */
 #include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 
+#include <atomic>
 #include <condition_variable>
 #include <cstring>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "../TCPServer.h"
 
@@ -31,6 +36,9 @@
 #define TEST_BUFFER_SIZE 256
 #define TEST_BUFFER_HELLO "Hello World"
 #define TEST_BUFFER_BYE "Good Bye"
+#define TEST_LARGE_FRAME_SIZE (AITT_TCP_RECV_CHUNK * 10 + 1)
+// Larger than the socket buffers, so it's sent partially
+#define TEST_BATCH_FRAME_SIZE (16 * 1024 * 1024)
 
 using namespace AittTCPNamespace;
 
@@ -39,6 +47,7 @@ class TCPTest : public testing::Test {
     void SetUp() override
     {
         ready = false;
+        secure = false;
         serverPort = TEST_SERVER_PORT;
         customTest = [](void) {};
 
@@ -47,6 +56,12 @@ class TCPTest : public testing::Test {
             ready_cv.wait(lk, [this] { return ready; });
             TCP::ConnectInfo info;
             info.port = serverPort;
+            if (secure) {
+                info.secure = true;
+                info.aead = true;
+                memcpy(info.key, tcp->GetCryptoKey(), sizeof(info.key));
+                memcpy(info.iv, tcp->GetCryptoIv(), sizeof(info.iv));
+            }
             client = std::unique_ptr<TCP>(new TCP(TEST_SERVER_ADDRESS, info));
 
             customTest();
@@ -55,7 +70,8 @@ class TCPTest : public testing::Test {
 
     void RunServer(void)
     {
-        tcp = std::unique_ptr<TCP::Server>(new TCP::Server(TEST_SERVER_ADDRESS, serverPort));
+        tcp = std::unique_ptr<TCP::Server>(
+              new TCP::Server(TEST_SERVER_ADDRESS, serverPort, secure));
         {
             std::lock_guard<std::mutex> lk(m);
             ready = true;
@@ -71,6 +87,7 @@ class TCPTest : public testing::Test {
     std::mutex m;
     std::condition_variable ready_cv;
     bool ready;
+    bool secure;
     unsigned short serverPort;
     std::thread clientThread;
     std::unique_ptr<TCP::Server> tcp;
@@ -121,6 +138,26 @@ TEST_F(TCPTest, Get_P_Anytime)
     ASSERT_GT(port, 0);
 }
 
+TEST_F(TCPTest, KeepAlive_P_Anytime)
+{
+    RunServer();
+
+    int handle = peer->GetHandle();
+    int value = 0;
+    socklen_t len = sizeof(value);
+    ASSERT_EQ(getsockopt(handle, SOL_SOCKET, SO_KEEPALIVE, &value, &len), 0);
+    EXPECT_NE(value, 0);
+
+    len = sizeof(value);
+    ASSERT_EQ(getsockopt(handle, IPPROTO_TCP, TCP_KEEPIDLE, &value, &len), 0);
+    EXPECT_EQ(value, AITT_TCP_KEEPALIVE_IDLE);
+
+    unsigned int timeout = 0;
+    len = sizeof(timeout);
+    ASSERT_EQ(getsockopt(handle, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout, &len), 0);
+    EXPECT_EQ(timeout, static_cast<unsigned int>(AITT_TCP_USER_TIMEOUT));
+}
+
 TEST_F(TCPTest, SendRecv_P_Anytime)
 {
     char helloBuffer[TEST_BUFFER_SIZE];
@@ -145,3 +182,166 @@ TEST_F(TCPTest, SendRecv_P_Anytime)
     ASSERT_STREQ(helloBuffer, TEST_BUFFER_HELLO);
     ASSERT_STREQ(byeBuffer, TEST_BUFFER_BYE);
 }
+
+TEST_F(TCPTest, RecvFrames_P_Anytime)
+{
+    std::vector<char> large(TEST_LARGE_FRAME_SIZE, 'a');
+
+    customTest = [this, &large](void) mutable -> void {
+        client->SendSizedData(TEST_BUFFER_HELLO, sizeof(TEST_BUFFER_HELLO));
+        client->SendSizedData(nullptr, 0);
+        client->SendSizedData(large.data(), large.size());
+
+        // A frame split in the middle of its size
+        int32_t szData = sizeof(TEST_BUFFER_BYE);
+        client->Send(&szData, 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        client->Send(reinterpret_cast<char *>(&szData) + 2, sizeof(szData) - 2);
+        client->Send(TEST_BUFFER_BYE, szData);
+
+        client.reset();
+    };
+
+    RunServer();
+
+    std::vector<std::string> frames;
+    int ret = 0;
+    while (ret == 0) {
+        pollfd fds = {peer->GetHandle(), POLLIN, 0};
+        ASSERT_EQ(poll(&fds, 1, 1000), 1);
+
+        ret = peer->RecvFrames([&](void *data, int32_t data_size) {
+            frames.push_back(data ? std::string(static_cast<char *>(data), data_size) : "");
+            free(data);
+        });
+    }
+
+    EXPECT_EQ(ret, -ENOTCONN);
+    ASSERT_EQ(frames.size(), 4U);
+    EXPECT_STREQ(frames[0].c_str(), TEST_BUFFER_HELLO);
+    EXPECT_TRUE(frames[1].empty());
+    EXPECT_EQ(frames[2], std::string(large.data(), large.size()));
+    EXPECT_STREQ(frames[3].c_str(), TEST_BUFFER_BYE);
+}
+
+TEST_F(TCPTest, RecvFrames_Secure_P_Anytime)
+{
+    std::vector<char> large(TEST_LARGE_FRAME_SIZE, 'a');
+
+    customTest = [this, &large](void) mutable -> void {
+        client->SendSizedData(TEST_BUFFER_HELLO, sizeof(TEST_BUFFER_HELLO));
+        client->SendSizedData(nullptr, 0);
+        client->SendSizedData(large.data(), large.size());
+        client->SendSizedData(TEST_BUFFER_BYE, sizeof(TEST_BUFFER_BYE));
+
+        client.reset();
+    };
+
+    secure = true;
+    RunServer();
+
+    std::vector<std::string> frames;
+    int ret = 0;
+    while (ret == 0) {
+        pollfd fds = {peer->GetHandle(), POLLIN, 0};
+        ASSERT_EQ(poll(&fds, 1, 1000), 1);
+
+        ret = peer->RecvFrames([&](void *data, int32_t data_size) {
+            frames.push_back(data ? std::string(static_cast<char *>(data), data_size) : "");
+            free(data);
+        });
+    }
+
+    EXPECT_EQ(ret, -ENOTCONN);
+    ASSERT_EQ(frames.size(), 4U);
+    EXPECT_STREQ(frames[0].c_str(), TEST_BUFFER_HELLO);
+    EXPECT_TRUE(frames[1].empty());
+    EXPECT_EQ(frames[2], std::string(large.data(), large.size()));
+    EXPECT_STREQ(frames[3].c_str(), TEST_BUFFER_BYE);
+}
+
+TEST_F(TCPTest, TrySend_Frames_P_Anytime)
+{
+    std::vector<char> large(TEST_BATCH_FRAME_SIZE, 'b');
+    std::atomic<size_t> first_iovcnt(0);
+    std::atomic<int> partial(0);
+
+    customTest = [&](void) mutable -> void {
+        // Frames of several messages go with one system call, as the module sends its queue.
+        TCP::Frames frames[3];
+        client->AddSizedData(TEST_BUFFER_HELLO, sizeof(TEST_BUFFER_HELLO), frames[0]);
+        client->AddSizedData(nullptr, 0, frames[1]);
+        client->AddSizedData(large.data(), large.size(), frames[2]);
+        size_t total = 0;
+        for (const auto &frame : frames)
+            total += frame.GetLength();
+
+        // A partial write is resumed from the offset of the bytes sent.
+        size_t sent = 0;
+        std::vector<struct iovec> iov;
+        while (sent < total) {
+            iov.clear();
+            size_t offset = sent;
+            for (const auto &frame : frames) {
+                if (frame.GetLength() <= offset) {
+                    offset -= frame.GetLength();
+                    continue;
+                }
+                frame.GetSegments(offset, iov);
+                offset = 0;
+            }
+            if (first_iovcnt == 0)
+                first_iovcnt = iov.size();
+
+            ssize_t ret = client->TrySend(iov.data(), iov.size());
+            ASSERT_LE(0, ret);
+            if (ret == 0) {
+                pollfd fds = {client->GetHandle(), POLLOUT, 0};
+                ASSERT_EQ(poll(&fds, 1, 1000), 1);
+                continue;
+            }
+            sent += ret;
+            if (sent < total)
+                partial++;
+        }
+
+        client.reset();
+    };
+
+    RunServer();
+
+    std::vector<std::string> frames;
+    int ret = 0;
+    while (ret == 0) {
+        pollfd fds = {peer->GetHandle(), POLLIN, 0};
+        ASSERT_EQ(poll(&fds, 1, 1000), 1);
+
+        ret = peer->RecvFrames([&](void *data, int32_t data_size) {
+            frames.push_back(data ? std::string(static_cast<char *>(data), data_size) : "");
+            free(data);
+        });
+    }
+    EXPECT_GE(first_iovcnt, 3U);
+    EXPECT_GT(partial, 0);
+    EXPECT_EQ(ret, -ENOTCONN);
+    ASSERT_EQ(frames.size(), 3U);
+    EXPECT_STREQ(frames[0].c_str(), TEST_BUFFER_HELLO);
+    EXPECT_TRUE(frames[1].empty());
+    EXPECT_EQ(frames[2], std::string(large.data(), large.size()));
+}
+
+TEST_F(TCPTest, RecvSizedData_Secure_P_Anytime)
+{
+    customTest = [this](void) mutable -> void {
+        client->SendSizedData(TEST_BUFFER_HELLO, sizeof(TEST_BUFFER_HELLO));
+    };
+
+    secure = true;
+    RunServer();
+
+    void *data = nullptr;
+    int32_t data_size = peer->RecvSizedData(&data);
+    ASSERT_EQ(data_size, static_cast<int32_t>(sizeof(TEST_BUFFER_HELLO)));
+    EXPECT_STREQ(static_cast<char *>(data), TEST_BUFFER_HELLO);
+    free(data);
+}
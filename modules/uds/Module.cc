@@ -0,0 +1,567 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "Module.h"
+
+#include <flatbuffers/flexbuffers.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "MainLoopHandler.h"
+#include "aitt_internal.h"
+
+namespace AittUDSNamespace {
+
+Module::Module(AittProtocol type, AittDiscovery &manager, const std::string &my_ip,
+      const AittOption &option)
+      : AittTransport(type, manager),
+        main_loop(aitt::MainLoopHandler::new_loop(aitt::MainLoopHandler::Backend::EPOLL)),
+        // Abstract socket names are shared in the network namespace of the same kernel.
+        host_id(aitt::HostTransport::GetHostId("net")),
+        can_block(option.GetSendOverflowPolicy() == AITT_SEND_OVERFLOW_BLOCK),
+        send_queue_size(option.GetSendQueueSize()),
+        send_overflow(option.GetSendOverflowPolicy()),
+        local_id(option.GetLocalDelivery() ? manager.GetId() : std::string()),
+        recv_buffer(AITT_UDS_INLINE_MAX)
+{
+    server_data.impl = this;
+    aittThread = std::thread(&Module::ThreadMain, this);
+
+    discovery_cb = discovery.AddDiscoveryCB(NAME,
+          std::bind(&Module::DiscoveryMessageCallback, this, std::placeholders::_1,
+                std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    DBG("Discovery Callback : %p, %d", this, discovery_cb);
+}
+
+Module::~Module(void)
+{
+    try {
+        discovery.RemoveDiscoveryCB(discovery_cb);
+    } catch (std::exception &e) {
+        ERR("RemoveDiscoveryCB() Fail(%s)", e.what());
+    }
+
+    // Wake up the publishers waiting for room in the queues of peers.
+    {
+        std::lock_guard<std::mutex> autoLock(peerTableLock);
+        peerTable.ForEach(
+              [](const std::string &clientId, const PeerPtr &peer) { peer->queue.Close(); });
+    }
+
+    while (main_loop->Quit() == false) {
+        // wait when called before the thread has completely created.
+        usleep(1000);
+    }
+
+    if (aittThread.joinable())
+        aittThread.join();
+
+    for (auto uds_data : connections)
+        delete uds_data;
+}
+
+void Module::ThreadMain(void)
+{
+    pthread_setname_np(pthread_self(), "UDSLoop");
+    main_loop->Run();
+}
+
+void Module::PublishFull(const AittMsg &msg, const void *data, const int datalen, bool is_reply)
+{
+    RET_IF(datalen < 0);
+
+    std::vector<PeerPtr> peers;
+    {
+        std::lock_guard<std::mutex> autoLock(peerTableLock);
+        FindPeers(is_reply ? msg.GetResponseTopic() : msg.GetTopic(), peers);
+        if (peers.empty() && is_reply)
+            held_replies.Hold(msg, data, datalen, AITT_QOS_AT_MOST_ONCE);
+    }
+
+    // The loop thread(e.g. SendReply() in a callback) can't wait for itself to send.
+    bool block = can_block && (std::this_thread::get_id() != aittThread.get_id());
+    SendPeers(peers, msg, data, datalen, is_reply, block);
+}
+
+// Peers subscribing the topic. peerTableLock must be held.
+void Module::FindPeers(const std::string &topic, std::vector<PeerPtr> &peers)
+{
+    peerTable.Match(topic, local_id, peers);
+}
+
+// A packet is queued for every peer, and the loop thread sends it.
+// block waits for room in the queues with AITT_SEND_OVERFLOW_BLOCK.
+void Module::SendPeers(const std::vector<PeerPtr> &peers, const AittMsg &msg, const void *data,
+      const int datalen, bool is_reply, bool block)
+{
+    if (peers.empty())
+        return;
+
+    flexbuffers::Builder fbb;
+    aitt::HostTransport::PackMsgInfo(fbb, msg, is_reply);
+    const std::vector<uint8_t> &header = fbb.GetBuffer();
+    uint32_t header_size = header.size();
+    if (AITT_UDS_INLINE_MAX < sizeof(header_size) + header_size) {
+        ERR("Too long header(%u)", header_size);
+        return;
+    }
+
+    Packet packet;
+    size_t inline_size = datalen;
+    if (AITT_UDS_INLINE_MAX < sizeof(header_size) + header_size + datalen) {
+        // The payload is copied once into the blob, and every peer gets the descriptor.
+        int blob = aitt::HostTransport::NewBlob(data, datalen);
+        if (blob < 0)
+            return;
+        packet.blob = std::make_shared<Blob>(blob);
+        inline_size = 0;
+    }
+
+    auto buffer = std::make_shared<std::vector<uint8_t>>();
+    buffer->reserve(sizeof(header_size) + header_size + inline_size);
+    const uint8_t *size_bytes = reinterpret_cast<const uint8_t *>(&header_size);
+    buffer->insert(buffer->end(), size_bytes, size_bytes + sizeof(header_size));
+    buffer->insert(buffer->end(), header.begin(), header.end());
+    const uint8_t *payload = static_cast<const uint8_t *>(data);
+    if (inline_size)
+        buffer->insert(buffer->end(), payload, payload + inline_size);
+    packet.data = buffer;
+
+    for (auto &peer : peers) {
+        Packet copy = packet;
+        if (peer->queue.Push(std::move(copy), block))
+            ScheduleFlush(peer);
+    }
+}
+
+// The peer is disconnected on the loop thread.
+void Module::ClosePeer(const PeerPtr &peer)
+{
+    peer->closed = true;
+    peer->queue.Close();
+    ScheduleFlush(peer);
+}
+
+void Module::ScheduleFlush(const PeerPtr &peer)
+{
+    if (peer->flush_scheduled.exchange(true))
+        return;
+
+    main_loop->AddIdle(
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              peer->flush_scheduled = false;
+              FlushPeer(peer);
+              return AITT_LOOP_EVENT_REMOVE;
+          },
+          nullptr);
+}
+
+// Send queued packets until the connection is full. It runs on the loop thread.
+void Module::FlushPeer(const PeerPtr &peer)
+{
+    if (peer->closed) {
+        peer->queue.Clear(peer->pending.data ? 1 : 0);
+        peer->pending = Packet();
+        DisconnectPeer(*peer);
+        return;
+    }
+
+    while (true) {
+        if (peer->pending.data == nullptr && peer->queue.Pop(peer->pending) == false)
+            break;
+
+        if (peer->client == nullptr) {
+            try {
+                peer->client = std::unique_ptr<UDS>(new UDS(peer->name));
+            } catch (std::exception &e) {
+                ERR("Connecting to %s Fail(%s)", peer->name.c_str(), e.what());
+                peer->queue.Clear(1);
+                peer->pending = Packet();
+                return;
+            }
+        }
+
+        struct iovec iov = {const_cast<uint8_t *>(peer->pending.data->data()),
+              peer->pending.data->size()};
+        int ret = peer->client->Send(&iov, 1,
+              peer->pending.blob ? peer->pending.blob->fd : -1, false);
+        if (ret == -EAGAIN) {
+            WatchPeer(peer);
+            return;
+        }
+
+        peer->pending = Packet();
+        if (ret < 0) {
+            ERR("Sending to %s Fail(%d)", peer->name.c_str(), ret);
+            peer->queue.Dropped();
+            DisconnectPeer(*peer);
+            continue;
+        }
+        peer->queue.Sent();
+    }
+
+    if (peer->watching) {
+        main_loop->RemoveWriteWatch(peer->client->GetHandle());
+        peer->watching = false;
+    }
+}
+
+// Packets are sent again when the connection is writable.
+void Module::WatchPeer(const PeerPtr &peer)
+{
+    if (peer->watching)
+        return;
+
+    peer->watching = true;
+    main_loop->AddWriteWatch(
+          peer->client->GetHandle(),
+          [this, peer](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) {
+              if (result != MainLoopIface::Event::OKAY) {
+                  ERR("The connection to %s is broken", peer->name.c_str());
+                  peer->queue.Dropped();
+                  peer->pending = Packet();
+                  DisconnectPeer(*peer);
+                  return AITT_LOOP_EVENT_REMOVE;
+              }
+
+              FlushPeer(peer);
+              return peer->watching ? AITT_LOOP_EVENT_CONTINUE : AITT_LOOP_EVENT_REMOVE;
+          },
+          nullptr);
+}
+
+void Module::DisconnectPeer(PeerData &peer)
+{
+    if (peer.watching)
+        main_loop->RemoveWriteWatch(peer.client->GetHandle());
+    peer.watching = false;
+    peer.client.reset();
+}
+
+void Module::Publish(const std::string &topic, const void *data, const int datalen, AittQoS qos,
+      bool retain)
+{
+    AittMsg msg;
+    msg.SetTopic(topic);
+    PublishFull(msg, data, datalen);
+}
+
+void *Module::Subscribe(const std::string &topic, const AittTransport::SubscribeCallback &cb,
+      void *cbdata, AittQoS qos)
+{
+    std::unique_ptr<Subscribe_CB_Info> cb_info(new Subscribe_CB_Info(cb, cbdata));
+    Subscribe_CB_Info *info_ptr = cb_info.get();
+
+    std::lock_guard<std::mutex> autoLock(subscribeTableLock);
+    if (server == nullptr) {
+        server = std::unique_ptr<UDS::Server>(new UDS::Server());
+        main_loop->AddWatch(server->GetHandle(), AcceptConnection, &server_data);
+    }
+
+    subscribeTable[topic].push_back(std::move(cb_info));
+    subscribe_handles.insert(SubscribeHandles::value_type(info_ptr, topic));
+
+    UpdateDiscoveryMsg();
+
+    return info_ptr;
+}
+
+void *Module::Unsubscribe(void *handlePtr)
+{
+    std::lock_guard<std::mutex> autoLock(subscribeTableLock);
+
+    auto handle_it = subscribe_handles.find(static_cast<Subscribe_CB_Info *>(handlePtr));
+    if (handle_it == subscribe_handles.end()) {
+        ERR("Unknown handle(%p)", handlePtr);
+        return nullptr;
+    }
+
+    void *cbdata = handle_it->first->second;
+    auto it = subscribeTable.find(handle_it->second);
+    subscribe_handles.erase(handle_it);
+    if (it == subscribeTable.end())
+        throw std::runtime_error("Invalid Callback Info");
+
+    auto cb_it = std::find_if(it->second.begin(), it->second.end(),
+          [&](const std::unique_ptr<Subscribe_CB_Info> &cb_info) {
+              return cb_info.get() == handlePtr;
+          });
+    if (cb_it == it->second.end())
+        throw std::runtime_error("Invalid Callback Info");
+    it->second.erase(cb_it);
+    if (it->second.empty())
+        subscribeTable.erase(it);
+
+    UpdateDiscoveryMsg();
+
+    return cbdata;
+}
+
+void Module::PublishWithReply(const std::string &topic, const void *data, const int datalen,
+      AittQoS qos, bool retain, const std::string &reply_topic, const std::string &correlation)
+{
+    AittMsg msg;
+    msg.SetTopic(topic);
+    msg.SetResponseTopic(reply_topic);
+    msg.SetCorrelation(correlation);
+    PublishFull(msg, data, datalen);
+}
+
+void Module::SendReply(AittMsg *msg, const void *data, const int datalen, AittQoS qos, bool retain)
+{
+    if (msg == nullptr) {
+        ERR("Invalid message(msg is nullptr)");
+        throw std::runtime_error("Invalid message");
+    }
+
+    PublishFull(*msg, data, datalen, true);
+}
+
+// Discovery Message (flexbuffers)
+// map {
+//   "host": "$boot_id/$net_namespace",
+//   "name": "aitt-uds-$pid-$random",
+//   "topics": {"$topic": cb_list_size, ...}
+// }
+void Module::DiscoveryMessageCallback(const std::string &clientId, const std::string &status,
+      const void *msg, const int szmsg)
+{
+    if (!status.compare(AittDiscovery::WILL_LEAVE_NETWORK)) {
+        std::lock_guard<std::mutex> autoLock(peerTableLock);
+        PeerPtr peer = peerTable.Remove(clientId);
+        if (peer)
+            ClosePeer(peer);
+        return;
+    }
+
+    auto map = flexbuffers::GetRoot(static_cast<const uint8_t *>(msg), szmsg).AsMap();
+    // Peers on other hosts are reached by other transports.
+    if (map["host"].AsString().str() != host_id)
+        return;
+
+    std::string name = map["name"].AsString().str();
+    if (name.empty()) {
+        ERR("Unknown Message");
+        return;
+    }
+
+    PeerTable::Topics topics;
+    auto topic_map = map["topics"].AsMap();
+    auto keys = topic_map.Keys();
+    for (size_t idx = 0; idx < keys.size(); ++idx) {
+        std::string topic = keys[idx].AsString().str();
+        topics[topic] = topic_map[topic].AsUInt32();
+    }
+
+    std::lock_guard<std::mutex> autoLock(peerTableLock);
+    PeerPtr peer = peerTable.Find(clientId);
+    if (peer == nullptr || peer->name != name) {
+        if (peer)
+            ClosePeer(peer);
+        peer = std::make_shared<PeerData>(name, send_queue_size, send_overflow);
+    }
+    peerTable.Update(clientId, peer, topics);
+    SendHeldReplies();
+}
+
+// Replies to the reply topics discovered now. peerTableLock must be held, so it doesn't wait
+// for room in the queues.
+void Module::SendHeldReplies(void)
+{
+    std::vector<PeerPtr> peers;
+    auto replies = held_replies.Take([&](const std::string &topic) {
+        peers.clear();
+        FindPeers(topic, peers);
+        return peers.empty() == false;
+    });
+    for (auto &reply : replies) {
+        peers.clear();
+        FindPeers(reply.msg.GetResponseTopic(), peers);
+        SendPeers(peers, reply.msg, reply.payload.data(), reply.payload.size(), true, false);
+    }
+}
+
+void Module::UpdateDiscoveryMsg(void)
+{
+    flexbuffers::Builder fbb;
+    fbb.Map([this, &fbb]() {
+        fbb.String("host", host_id);
+        fbb.String("name", server->GetName());
+        fbb.Map("topics", [&]() {
+            for (auto it = subscribeTable.begin(); it != subscribeTable.end(); ++it)
+                fbb.UInt(it->first.c_str(), it->second.size());
+        });
+    });
+    fbb.Finish();
+
+    auto buf = fbb.GetBuffer();
+    discovery.UpdateDiscoveryMsg(NAME, buf.data(), buf.size());
+}
+
+int Module::AcceptConnection(MainLoopIface::Event result, int handle,
+      MainLoopIface::MainLoopData *user_data)
+{
+    UDSServerData *server_data = dynamic_cast<UDSServerData *>(user_data);
+    RETV_IF(server_data == nullptr, AITT_LOOP_EVENT_REMOVE);
+    Module *impl = server_data->impl;
+    RETV_IF(impl == nullptr, AITT_LOOP_EVENT_REMOVE);
+
+    std::unique_ptr<UDS> client = impl->server->AcceptPeer();
+    if (client == nullptr) {
+        ERR("Unable to accept a peer");
+        return AITT_LOOP_EVENT_CONTINUE;
+    }
+
+    int client_handle = client->GetHandle();
+    UDSData *uds_data = new UDSData;
+    uds_data->impl = impl;
+    uds_data->client = std::move(client);
+    impl->connections.insert(uds_data);
+    impl->main_loop->AddWatch(client_handle, ReceiveData, uds_data);
+
+    return AITT_LOOP_EVENT_CONTINUE;
+}
+
+int Module::ReceiveData(MainLoopIface::Event result, int handle,
+      MainLoopIface::MainLoopData *user_data)
+{
+    UDSData *uds_data = dynamic_cast<UDSData *>(user_data);
+    RETV_IF(uds_data == nullptr, AITT_LOOP_EVENT_REMOVE);
+    Module *impl = uds_data->impl;
+    RETV_IF(impl == nullptr, AITT_LOOP_EVENT_REMOVE);
+
+    if (result == MainLoopIface::Event::HANGUP) {
+        ERR("The main loop hung up. Disconnect the client.");
+        return impl->HandleClientDisconnect(uds_data);
+    }
+
+    for (int i = 0; i < AITT_UDS_RECV_BUDGET; i++) {
+        int fd = -1;
+        ssize_t size =
+              uds_data->client->Recv(impl->recv_buffer.data(), impl->recv_buffer.size(), fd);
+        if (size == -EAGAIN)
+            break;
+        if (size == -EMSGSIZE)
+            continue;
+        if (size < 0)
+            return impl->HandleClientDisconnect(uds_data);
+
+        impl->HandlePacket(impl->recv_buffer.data(), size, fd);
+    }
+
+    return AITT_LOOP_EVENT_CONTINUE;
+}
+
+// The payload is delivered in the receive buffer or the mapped blob,
+// it's released after the callbacks return.
+void Module::HandlePacket(const uint8_t *packet, size_t size, int fd)
+{
+    uint32_t header_size = 0;
+    if (size < sizeof(header_size)
+          || (memcpy(&header_size, packet, sizeof(header_size)),
+                size - sizeof(header_size) < header_size)) {
+        ERR("Invalid packet(%zu)", size);
+        if (0 <= fd)
+            close(fd);
+        return;
+    }
+
+    AittMsg msg;
+    aitt::HostTransport::UnpackMsgInfo(msg, packet + sizeof(header_size), header_size);
+    if (msg.GetTopic().empty()) {
+        ERR("A topic is empty.");
+        if (0 <= fd)
+            close(fd);
+        return;
+    }
+
+    const void *payload = packet + sizeof(header_size) + header_size;
+    size_t payload_size = size - sizeof(header_size) - header_size;
+    void *blob = nullptr;
+    if (0 <= fd) {
+        blob = aitt::HostTransport::MapBlob(fd, payload_size);
+        close(fd);
+        if (blob == nullptr)
+            return;
+        payload = blob;
+    }
+    if (payload_size == 0)
+        payload = nullptr;
+    msg.SetPayload(AittMsgBuffer::Wrap(payload, payload_size));
+
+    std::vector<Subscribe_CB_Info> cb_list;
+    {
+        std::lock_guard<std::mutex> autoLock(subscribeTableLock);
+        for (auto it = subscribeTable.begin(); it != subscribeTable.end(); ++it) {
+            if (!discovery.CompareTopic(it->first, msg.GetTopic()))
+                continue;
+            for (auto &cb_info : it->second)
+                cb_list.push_back(*cb_info);
+        }
+    }
+
+    for (auto const &it : cb_list)
+        it.first(&msg, payload, payload_size, it.second);
+
+    if (blob)
+        munmap(blob, payload_size);
+}
+
+int Module::HandleClientDisconnect(UDSData *uds_data)
+{
+    main_loop->RemoveWatch(uds_data->client->GetHandle());
+    connections.erase(uds_data);
+    delete uds_data;
+    return AITT_LOOP_EVENT_REMOVE;
+}
+
+int Module::CountSubscriber(const std::string &topic)
+{
+    std::lock_guard<std::mutex> autoLock(peerTableLock);
+    return peerTable.Count(topic);
+}
+
+std::map<std::string, AittPeerStats> Module::GetPeerStats(void)
+{
+    std::map<std::string, AittPeerStats> stats;
+
+    std::lock_guard<std::mutex> autoLock(peerTableLock);
+    peerTable.ForEach([&stats](const std::string &clientId, const PeerPtr &peer) {
+        stats[clientId] = peer->queue.GetPeerStats();
+    });
+    return stats;
+}
+
+Module::Blob::~Blob(void)
+{
+    close(fd);
+}
+
+Module::PeerData::PeerData(const std::string &peer_name, size_t queue_size,
+      AittSendOverflow overflow)
+      : name(peer_name),
+        queue(queue_size, overflow),
+        flush_scheduled(false),
+        closed(false),
+        watching(false)
+{
+}
+
+}  // namespace AittUDSNamespace
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <AittTransport.h>
+#include <MainLoopIface.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HeldReplies.h"
+#include "HostTransport.h"
+#include "SendQueue.h"
+#include "UDSServer.h"
+
+using AittTransport = aitt::AittTransport;
+using MainLoopIface = aitt::MainLoopIface;
+using AittDiscovery = aitt::AittDiscovery;
+
+#define MODULE_NAMESPACE AittUDSNamespace
+namespace AittUDSNamespace {
+
+// Peers on the same host get messages through unix domain sockets.
+// A packet is (header size | header(flexbuffers) | payload), and a big payload is passed
+// in a sealed memfd instead. Publishers queue packets for each peer,
+// and the loop thread sends them without blocking.
+class Module : public AittTransport {
+  public:
+    explicit Module(AittProtocol type, AittDiscovery &manager, const std::string &ip,
+          const AittOption &option = AittOption());
+    virtual ~Module(void);
+
+    void Publish(const std::string &topic, const void *data, const int datalen,
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE, bool retain = false) override;
+
+    void *Subscribe(const std::string &topic, const SubscribeCallback &cb, void *cbdata = nullptr,
+          AittQoS qos = AITT_QOS_AT_MOST_ONCE) override;
+    void *Unsubscribe(void *handle) override;
+    void PublishWithReply(const std::string &topic, const void *data, const int datalen,
+          AittQoS qos, bool retain, const std::string &reply_topic, const std::string &correlation);
+    void SendReply(AittMsg *msg, const void *data, const int datalen, AittQoS qos, bool retain);
+    int CountSubscriber(const std::string &topic);
+    std::map<std::string, AittPeerStats> GetPeerStats(void) override;
+
+  private:
+    using Subscribe_CB_Info = std::pair<SubscribeCallback, void *>;
+
+    // SubscribeTable
+    // map {
+    //    "/customTopic/mytopic": [$callback, ...],
+    //    ...
+    // }
+    using SubscribeMap =
+          std::map<std::string /* topic */, std::vector<std::unique_ptr<Subscribe_CB_Info>>>;
+    using SubscribeHandles = std::map<Subscribe_CB_Info *, std::string /* topic */>;
+
+    struct UDSServerData : public MainLoopIface::MainLoopData {
+        Module *impl;
+    };
+
+    struct UDSData : public MainLoopIface::MainLoopData {
+        Module *impl;
+        std::unique_ptr<UDS> client;
+    };
+
+    // A sealed memfd of a payload, closed when every peer has sent it
+    struct Blob {
+        explicit Blob(int blob_fd) : fd(blob_fd) {}
+        ~Blob(void);
+
+        const int fd;
+    };
+
+    struct Packet {
+        // (header size | header | payload) shared by the peers, without the payload of a blob
+        std::shared_ptr<const std::vector<uint8_t>> data;
+        std::shared_ptr<Blob> blob;
+    };
+
+    // Connection to a subscriber process on the same host
+    struct PeerData {
+        PeerData(const std::string &peer_name, size_t queue_size, AittSendOverflow overflow);
+
+        const std::string name;
+        aitt::SendQueue<Packet> queue;
+        std::atomic_bool flush_scheduled;
+        std::atomic_bool closed;
+
+        // Below are used only on the loop thread
+        std::unique_ptr<UDS> client;  // connected at the first message to the peer
+        Packet pending;               // popped and not sent yet as the connection was full
+        bool watching;                // waiting for the connection to be writable
+    };
+    using PeerTable = aitt::HostPeerTable<PeerData>;
+    using PeerPtr = PeerTable::PeerPtr;
+
+    void PublishFull(const AittMsg &msg, const void *data, const int datalen,
+          bool is_reply = false);
+    void FindPeers(const std::string &topic, std::vector<PeerPtr> &peers);
+    void SendPeers(const std::vector<PeerPtr> &peers, const AittMsg &msg, const void *data,
+          const int datalen, bool is_reply, bool block);
+    void ClosePeer(const PeerPtr &peer);
+    void ScheduleFlush(const PeerPtr &peer);
+    void FlushPeer(const PeerPtr &peer);
+    void WatchPeer(const PeerPtr &peer);
+    void DisconnectPeer(PeerData &peer);
+    void DiscoveryMessageCallback(const std::string &clientId, const std::string &status,
+          const void *msg, const int szmsg);
+    void SendHeldReplies(void);
+    void UpdateDiscoveryMsg(void);
+    static int AcceptConnection(MainLoopIface::Event result, int handle,
+          MainLoopIface::MainLoopData *watchData);
+    static int ReceiveData(MainLoopIface::Event result, int handle,
+          MainLoopIface::MainLoopData *watchData);
+    int HandleClientDisconnect(UDSData *uds_data);
+    void HandlePacket(const uint8_t *packet, size_t size, int fd);
+    void ThreadMain(void);
+
+    const char *const NAME = "UDS";
+    std::unique_ptr<MainLoopIface> main_loop;
+    std::thread aittThread;
+    int discovery_cb;
+    const std::string host_id;
+    const bool can_block;
+    const size_t send_queue_size;
+    const AittSendOverflow send_overflow;
+    // Own subscribers get messages in the process with the local delivery, so they are skipped.
+    const std::string local_id;
+
+    std::unique_ptr<UDS::Server> server;  // listening from the first subscription
+    UDSServerData server_data;
+    std::set<UDSData *> connections;      // used only on the loop thread
+    std::vector<uint8_t> recv_buffer;
+    SubscribeMap subscribeTable;
+    SubscribeHandles subscribe_handles;
+    std::mutex subscribeTableLock;
+
+    PeerTable peerTable;
+    aitt::HeldReplies held_replies;  // guarded by peerTableLock
+    std::mutex peerTableLock;
+};
+
+}  // namespace AittUDSNamespace
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "UDS.h"
+
+#include <stddef.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "aitt_internal.h"
+
+
+namespace AittUDSNamespace {
+
+UDS::UDS(const std::string &name) : handle_(-1)
+{
+    struct sockaddr_un addr;
+    if (sizeof(addr.sun_path) <= name.size()) {
+        ERR("Too long name(%s)", name.c_str());
+        throw std::runtime_error("Too long name: " + name);
+    }
+
+    handle_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (handle_ < 0) {
+        ERR("socket() Fail(%d)", errno);
+        throw std::runtime_error("socket() Fail");
+    }
+
+    // The abstract name starts with a null byte.
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path + 1, name.data(), name.size());
+    socklen_t addrlen = offsetof(struct sockaddr_un, sun_path) + 1 + name.size();
+    if (connect(handle_, reinterpret_cast<struct sockaddr *>(&addr), addrlen) < 0) {
+        ERR("connect(%s) Fail(%d)", name.c_str(), errno);
+        close(handle_);
+        throw std::runtime_error("connect() Fail: " + name);
+    }
+}
+
+UDS::UDS(int handle) : handle_(handle)
+{
+}
+
+UDS::~UDS(void)
+{
+    if (0 <= handle_)
+        close(handle_);
+}
+
+int UDS::GetHandle(void)
+{
+    return handle_;
+}
+
+int UDS::Send(const struct iovec *iov, int iovcnt, int fd, bool block)
+{
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = const_cast<struct iovec *>(iov);
+    msg.msg_iovlen = iovcnt;
+
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    if (0 <= fd) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    int flags = MSG_NOSIGNAL | (block ? 0 : MSG_DONTWAIT);
+    ssize_t ret;
+    do {
+        ret = sendmsg(handle_, &msg, flags);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0)
+        return -errno;
+    return 0;
+}
+
+ssize_t UDS::Recv(void *buffer, size_t size, int &fd)
+{
+    fd = -1;
+
+    struct iovec iov = {buffer, size};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ssize_t ret;
+    do {
+        ret = recvmsg(handle_, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    } while (ret < 0 && errno == EINTR);
+
+    if (ret < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return -EAGAIN;
+        ERR("recvmsg(%d) Fail(%d)", handle_, errno);
+        return -ENOTCONN;
+    }
+    if (ret == 0) {
+        ERR("disconnected");
+        return -ENOTCONN;
+    }
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+              && CMSG_LEN(sizeof(int)) <= cmsg->cmsg_len) {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+            break;
+        }
+    }
+
+    if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        ERR("Truncated packet(%zd, flags:0x%x)", ret, msg.msg_flags);
+        if (0 <= fd)
+            close(fd);
+        fd = -1;
+        return -EMSGSIZE;
+    }
+
+    return ret;
+}
+
+}  // namespace AittUDSNamespace
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <string>
+
+// Packets up to this size are sent as they are, bigger payloads are passed in a memfd.
+#define AITT_UDS_INLINE_MAX (64 * 1024)
+// Packets read for a connection at once, not to starve the others on the same loop
+#define AITT_UDS_RECV_BUDGET 16
+
+namespace AittUDSNamespace {
+
+// A SOCK_SEQPACKET connection of the abstract unix domain socket
+class UDS {
+  public:
+    class Server;
+
+    // Connect to the server of the name
+    explicit UDS(const std::string &name);
+    virtual ~UDS(void);
+
+    // Send a packet of the segments with the fd, if it's not negative.
+    // It returns 0, -EAGAIN if it would block without block, or -errno.
+    int Send(const struct iovec *iov, int iovcnt, int fd, bool block);
+    // Receive a packet without blocking. fd is the received descriptor, or -1.
+    // It returns the size of the packet, -EAGAIN if nothing has arrived,
+    // -EMSGSIZE if a bigger packet was dropped, or -ENOTCONN.
+    ssize_t Recv(void *buffer, size_t size, int &fd);
+    int GetHandle(void);
+
+  private:
+    explicit UDS(int handle);
+
+    int handle_;
+};
+
+}  // namespace AittUDSNamespace
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "UDSServer.h"
+
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+#include "aitt_internal.h"
+
+#define BACKLOG 10  // Accept only 10 simultaneously connections by default
+
+namespace AittUDSNamespace {
+
+UDS::Server::Server(void) : handle(-1)
+{
+    std::random_device rd;
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "%08x%08x", rd(), rd());
+    name = "aitt-uds-" + std::to_string(getpid()) + "-" + suffix;
+
+    handle = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (handle < 0) {
+        ERR("socket() Fail(%d)", errno);
+        throw std::runtime_error("socket() Fail");
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path + 1, name.data(), name.size());
+    socklen_t addrlen = offsetof(struct sockaddr_un, sun_path) + 1 + name.size();
+    if (bind(handle, reinterpret_cast<struct sockaddr *>(&addr), addrlen) < 0
+          || listen(handle, BACKLOG) < 0) {
+        ERR("Listening on %s Fail(%d)", name.c_str(), errno);
+        close(handle);
+        throw std::runtime_error("listen() Fail: " + name);
+    }
+}
+
+UDS::Server::~Server(void)
+{
+    if (0 <= handle)
+        close(handle);
+}
+
+std::unique_ptr<UDS> UDS::Server::AcceptPeer(void)
+{
+    int peer = accept4(handle, nullptr, nullptr, SOCK_CLOEXEC);
+    if (peer < 0) {
+        ERR("accept4() Fail(%d)", errno);
+        return nullptr;
+    }
+
+    return std::unique_ptr<UDS>(new UDS(peer));
+}
+
+int UDS::Server::GetHandle(void)
+{
+    return handle;
+}
+
+const std::string &UDS::Server::GetName(void)
+{
+    return name;
+}
+
+}  // namespace AittUDSNamespace
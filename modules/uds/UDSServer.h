@@ -0,0 +1,41 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "UDS.h"
+
+namespace AittUDSNamespace {
+
+class UDS::Server {
+  public:
+    // It listens on a new abstract name.
+    Server(void);
+    virtual ~Server(void);
+
+    std::unique_ptr<UDS> AcceptPeer(void);
+
+    int GetHandle(void);
+    const std::string &GetName(void);
+
+  private:
+    int handle;
+    std::string name;
+};
+
+}  // namespace AittUDSNamespace
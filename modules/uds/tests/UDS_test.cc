@@ -0,0 +1,154 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "../UDS.h"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../UDSServer.h"
+#include "HostTransport.h"
+
+#define TEST_WAIT_MS 1000
+
+using namespace AittUDSNamespace;
+
+class UDSTest : public testing::Test {
+  protected:
+    void SetUp() override
+    {
+        server = std::unique_ptr<UDS::Server>(new UDS::Server());
+        client = std::unique_ptr<UDS>(new UDS(server->GetName()));
+
+        struct pollfd pfd = {server->GetHandle(), POLLIN, 0};
+        ASSERT_EQ(poll(&pfd, 1, TEST_WAIT_MS), 1);
+        peer = server->AcceptPeer();
+        ASSERT_NE(peer, nullptr);
+    }
+
+    int Send(const std::string &data, int fd = -1, bool block = false)
+    {
+        struct iovec iov = {const_cast<char *>(data.data()), data.size()};
+        return client->Send(&iov, 1, fd, block);
+    }
+
+    ssize_t Recv(std::string &data, int &fd)
+    {
+        struct pollfd pfd = {peer->GetHandle(), POLLIN, 0};
+        if (poll(&pfd, 1, TEST_WAIT_MS) != 1)
+            return -ETIMEDOUT;
+
+        std::vector<char> buffer(AITT_UDS_INLINE_MAX);
+        ssize_t ret = peer->Recv(buffer.data(), buffer.size(), fd);
+        if (0 <= ret)
+            data.assign(buffer.data(), ret);
+        return ret;
+    }
+
+    std::unique_ptr<UDS::Server> server;
+    std::unique_ptr<UDS> client;
+    std::unique_ptr<UDS> peer;
+};
+
+TEST_F(UDSTest, SendRecv_P_Anytime)
+{
+    struct iovec iov[2] = {{const_cast<char *>("head"), 4}, {const_cast<char *>("body"), 4}};
+    EXPECT_EQ(client->Send(iov, 2, -1, false), 0);
+    EXPECT_EQ(Send("second"), 0);
+
+    std::string data;
+    int fd;
+    EXPECT_EQ(Recv(data, fd), 8);
+    EXPECT_EQ(data, "headbody");
+    EXPECT_EQ(fd, -1);
+
+    // Packet boundaries are kept.
+    EXPECT_EQ(Recv(data, fd), 6);
+    EXPECT_EQ(data, "second");
+
+    std::vector<char> buffer(16);
+    EXPECT_EQ(peer->Recv(buffer.data(), buffer.size(), fd), -EAGAIN);
+}
+
+TEST_F(UDSTest, Blob_P_Anytime)
+{
+    std::string payload(AITT_UDS_INLINE_MAX * 4, 'x');
+    payload[payload.size() - 1] = 'y';
+    int blob = aitt::HostTransport::NewBlob(payload.data(), payload.size());
+    ASSERT_LE(0, blob);
+
+    EXPECT_EQ(Send("header", blob), 0);
+    close(blob);
+
+    std::string data;
+    int fd;
+    EXPECT_EQ(Recv(data, fd), 6);
+    EXPECT_EQ(data, "header");
+    ASSERT_LE(0, fd);
+
+    size_t size = 0;
+    void *addr = aitt::HostTransport::MapBlob(fd, size);
+    close(fd);
+    ASSERT_NE(addr, nullptr);
+    EXPECT_EQ(size, payload.size());
+    EXPECT_EQ(memcmp(addr, payload.data(), size), 0);
+    munmap(addr, size);
+}
+
+TEST_F(UDSTest, Blob_Unsealed_N_Anytime)
+{
+    int unsealed = memfd_create("unsealed", MFD_CLOEXEC);
+    ASSERT_LE(0, unsealed);
+    ASSERT_EQ(ftruncate(unsealed, 4096), 0);
+
+    size_t size = 0;
+    EXPECT_EQ(aitt::HostTransport::MapBlob(unsealed, size), nullptr);
+    close(unsealed);
+}
+
+TEST_F(UDSTest, Send_Full_N_Anytime)
+{
+    std::string data(1024, 'a');
+    int ret;
+    int count = 0;
+    while ((ret = Send(data)) == 0)
+        count++;
+
+    EXPECT_EQ(ret, -EAGAIN);
+    EXPECT_LT(0, count);
+}
+
+TEST_F(UDSTest, Disconnect_N_Anytime)
+{
+    client.reset();
+
+    std::string data;
+    int fd;
+    EXPECT_EQ(Recv(data, fd), -ENOTCONN);
+}
+
+TEST(UDSConnect, Unknown_Name_N_Anytime)
+{
+    EXPECT_THROW(UDS("aitt-uds-unknown"), std::runtime_error);
+}
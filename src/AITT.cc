@@ -101,6 +101,37 @@ void AITT::Publish(const std::string &topic, const void *data, const int datalen
     return pImpl->Publish(topic, data, datalen, protocols, qos, retain);
 }
 
+void AITT::PublishAsync(const std::string &topic, const void *data, const int datalen,
+      AittQoS qos, bool retain, const PublishCallback &cb, void *user_data)
+{
+    if (datalen < 0 || AITT_PAYLOAD_MAX < datalen) {
+        ERR("Invalid Size(%d)", datalen);
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    return pImpl->PublishAsync(topic, data, datalen, qos, retain, cb, user_data);
+}
+
+void AITT::PublishBatch(const AittBatchMessage *messages, int count, AittProtocol protocols,
+      AittQoS qos, bool retain)
+{
+    if (count < 0 || (messages == nullptr && count != 0)) {
+        ERR("Invalid Batch(%p, %d)", messages, count);
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (messages[i].topic == nullptr || messages[i].datalen < 0
+              || AITT_PAYLOAD_MAX < messages[i].datalen
+              || (messages[i].data == nullptr && messages[i].datalen != 0)) {
+            ERR("Invalid Message(%d)", i);
+            throw AittException(AittException::INVALID_ARG);
+        }
+    }
+
+    return pImpl->PublishBatch(messages, count, protocols, qos, retain);
+}
+
 void AITT::PublishWithReply(const std::string &topic, const void *data, const int datalen,
       AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb, void *cbdata,
       const std::string &correlation)
@@ -138,6 +169,11 @@ void *AITT::Unsubscribe(AittSubscribeID handle)
     return pImpl->Unsubscribe(handle);
 }
 
+void AITT::SetRemotePolicy(const std::string &topic, AittRemotePolicy policy)
+{
+    pImpl->SetRemotePolicy(topic, policy);
+}
+
 void AITT::SendReply(AittMsg *msg, const void *data, int datalen, bool end)
 {
     if (datalen < 0 || AITT_PAYLOAD_MAX < datalen) {
@@ -164,4 +200,14 @@ int AITT::CountSubscriber(const std::string &topic, AittProtocol protocols)
     return pImpl->CountSubscriber(topic, protocols);
 }
 
+AittPublishStats AITT::GetPublishStats(void)
+{
+    return pImpl->GetPublishStats();
+}
+
+std::map<std::string, AittPeerStats> AITT::GetPeerStats(AittProtocol protocol)
+{
+    return pImpl->GetPeerStats(protocol);
+}
+
 }  // namespace aitt
@@ -17,6 +17,8 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <chrono>
+#include <cstdlib>
 #include <cstring>
 #include <functional>
 #include <memory>
@@ -29,13 +31,19 @@
 
 namespace aitt {
 
+thread_local const AITT::Impl *AITT::Impl::receiving_impl = nullptr;
+thread_local AittProtocol AITT::Impl::receiving_protocol = AITT_TYPE_UNKNOWN;
+
 AITT::Impl::Impl(AITT &parent, const std::string &id, const std::string &my_ip,
       const AittOption &option)
       : public_api(parent),
         discovery(id),
         main_loop(MainLoopHandler::new_loop()),
-        modules(my_ip, discovery),
+        delivery_queue(main_loop.get(), &Impl::DetachedCB),
+        modules(my_ip, discovery, option),
         mq_discovery_handler(discovery, id),
+        local_delivery(option.GetLocalDelivery()),
+        local_order(0),
         id_(id),
         mqtt_broker_port_(0),
         reply_id(0)
@@ -46,9 +54,16 @@ AITT::Impl::Impl(AITT &parent, const std::string &id, const std::string &my_ip,
         discovery_option.SetCleanSession(false);
         discovery.SetMQ(modules.NewCustomMQ(id + 'd', option));
     } else {
-        mq = std::unique_ptr<MQ>(new MosquittoMQ(id, option.GetCleanSession()));
+        mq = std::unique_ptr<MQ>(new MosquittoMQ(id, option.GetCleanSession(),
+              option.GetLocalDelivery(), option.GetMaxInflight(), option.GetInflightBlocking()));
         discovery.SetMQ(std::unique_ptr<MQ>(new MosquittoMQ(id + 'd', false)));
     }
+    // With a single worker, callbacks keep running on the AITTWorkerLoop thread.
+    if (option.GetWorkerThreads() > 1) {
+        executor = std::unique_ptr<MQExecutor>(new MQExecutor(option.GetWorkerThreads(),
+              option.GetWorkStealing(), &Impl::DetachedCB));
+    }
+    reply_dispatch = NewDispatcher();
     aittThread = std::thread(&AITT::Impl::ThreadMain, this);
 }
 
@@ -69,6 +84,9 @@ AITT::Impl::~Impl(void)
     if (aittThread.joinable())
         aittThread.join();
 
+    if (executor)
+        executor->Stop();
+
     discovery.SetMQ(nullptr);
     mq = nullptr;
 }
@@ -127,6 +145,7 @@ void AITT::Impl::Connect(const std::string &host, int port, const std::string &u
 void AITT::Impl::Disconnect(void)
 {
     UnsubscribeAll();
+    ClearReplies();
     modules.DestroyStreamAll();
 
     mqtt_broker_ip_.clear();
@@ -150,6 +169,8 @@ void AITT::Impl::UnsubscribeAll()
             break;
         case AITT_TYPE_TCP:
         case AITT_TYPE_TCP_SECURE:
+        case AITT_TYPE_SHM:
+        case AITT_TYPE_UDS:
             modules.Get(subscribe_info->first).Unsubscribe(subscribe_info->second);
             break;
 
@@ -161,6 +182,10 @@ void AITT::Impl::UnsubscribeAll()
         delete subscribe_info;
     }
     subscribed_list.clear();
+
+    std::lock_guard<std::mutex> local_lock(local_subscribers_mutex_);
+    local_subscribers.Clear();
+    local_subscriber_handles.clear();
 }
 
 void AITT::Impl::Publish(const std::string &topic, const void *data, const int datalen,
@@ -170,11 +195,17 @@ void AITT::Impl::Publish(const std::string &topic, const void *data, const int d
         ERR("Not connected");
         throw AittException(AittException::INVALID_STATE);
     }
-    if ((protocols & ~(AITT_TYPE_MQTT | AITT_TYPE_TCP | AITT_TYPE_TCP_SECURE)) != 0) {
+    if ((protocols
+                & ~(AITT_TYPE_MQTT | AITT_TYPE_TCP | AITT_TYPE_TCP_SECURE | AITT_TYPE_SHM
+                      | AITT_TYPE_UDS))
+          != 0) {
         ERR("Unknown Protocol(%d)", protocols);
         throw AittException(AittException::INVALID_ARG);
     }
 
+    if (DeliverLocal(topic, data, datalen, protocols) == false)
+        return;
+
     if ((protocols & AITT_TYPE_MQTT) == AITT_TYPE_MQTT)
         mq->Publish(topic, data, datalen, qos, retain);
 
@@ -183,6 +214,92 @@ void AITT::Impl::Publish(const std::string &topic, const void *data, const int d
 
     if ((protocols & AITT_TYPE_TCP_SECURE) == AITT_TYPE_TCP_SECURE)
         modules.Get(AITT_TYPE_TCP_SECURE).Publish(topic, data, datalen, qos, retain);
+
+    if ((protocols & AITT_TYPE_SHM) == AITT_TYPE_SHM)
+        modules.Get(AITT_TYPE_SHM).Publish(topic, data, datalen, qos, retain);
+
+    if ((protocols & AITT_TYPE_UDS) == AITT_TYPE_UDS)
+        modules.Get(AITT_TYPE_UDS).Publish(topic, data, datalen, qos, retain);
+}
+
+void AITT::Impl::PublishAsync(const std::string &topic, const void *data, const int datalen,
+      AittQoS qos, bool retain, const PublishCallback &cb, void *user_data)
+{
+    if (discovery.IsRunning() == false) {
+        ERR("Not connected");
+        throw AittException(AittException::INVALID_STATE);
+    }
+
+    // Completions come on the MQ thread, and the callback is called on the AITT thread.
+    MQ::PublishCallback completion;
+    if (cb) {
+        completion = [this, cb, user_data](int result) {
+            auto idler_cb = std::bind(&Impl::PublishCB, this, cb, user_data, result,
+                  std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+            main_loop->AddIdle(idler_cb, nullptr);
+        };
+    }
+
+    if (DeliverLocal(topic, data, datalen, AITT_TYPE_MQTT) == false) {
+        if (completion)
+            completion(AITT_ERROR_NONE);
+        return;
+    }
+
+    mq->PublishAsync(topic, data, datalen, qos, retain, completion);
+}
+
+void AITT::Impl::PublishBatch(const AittBatchMessage *messages, int count,
+      AittProtocol protocols, AittQoS qos, bool retain)
+{
+    if (discovery.IsRunning() == false) {
+        ERR("Not connected");
+        throw AittException(AittException::INVALID_STATE);
+    }
+    if ((protocols
+                & ~(AITT_TYPE_MQTT | AITT_TYPE_TCP | AITT_TYPE_TCP_SECURE | AITT_TYPE_SHM
+                      | AITT_TYPE_UDS))
+          != 0) {
+        ERR("Unknown Protocol(%d)", protocols);
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    // Messages delivered only to the local subscribers are left out.
+    std::vector<AittBatchMessage> remote;
+    if (local_delivery) {
+        remote.reserve(count);
+        for (int i = 0; i < count; i++) {
+            if (DeliverLocal(messages[i].topic, messages[i].data, messages[i].datalen, protocols))
+                remote.push_back(messages[i]);
+        }
+        messages = remote.data();
+        count = remote.size();
+    }
+    if (count == 0)
+        return;
+
+    if ((protocols & AITT_TYPE_MQTT) == AITT_TYPE_MQTT)
+        mq->PublishBatch(messages, count, qos, retain);
+
+    if ((protocols & AITT_TYPE_TCP) == AITT_TYPE_TCP)
+        modules.Get(AITT_TYPE_TCP).PublishBatch(messages, count, qos, retain);
+
+    if ((protocols & AITT_TYPE_TCP_SECURE) == AITT_TYPE_TCP_SECURE)
+        modules.Get(AITT_TYPE_TCP_SECURE).PublishBatch(messages, count, qos, retain);
+
+    if ((protocols & AITT_TYPE_SHM) == AITT_TYPE_SHM)
+        modules.Get(AITT_TYPE_SHM).PublishBatch(messages, count, qos, retain);
+
+    if ((protocols & AITT_TYPE_UDS) == AITT_TYPE_UDS)
+        modules.Get(AITT_TYPE_UDS).PublishBatch(messages, count, qos, retain);
+}
+
+int AITT::Impl::PublishCB(PublishCallback cb, void *user_data, int result,
+      MainLoopIface::Event event, int fd, MainLoopIface::MainLoopData *loop_data)
+{
+    cb(result, user_data);
+
+    return AITT_LOOP_EVENT_REMOVE;
 }
 
 AittSubscribeID AITT::Impl::Subscribe(const std::string &topic, const AITT::SubscribeCallback &cb,
@@ -192,13 +309,17 @@ AittSubscribeID AITT::Impl::Subscribe(const std::string &topic, const AITT::Subs
     info->first = protocol;
 
     void *subscribe_handle;
+    MQDispatcher dispatch;
     switch (protocol) {
     case AITT_TYPE_MQTT:
-        subscribe_handle = SubscribeMQ(info, main_loop.get(), topic, cb, user_data, qos);
+        dispatch = NewDispatcher();
+        subscribe_handle = SubscribeMQ(info, dispatch, topic, cb, user_data, qos);
         break;
     case AITT_TYPE_TCP:
     case AITT_TYPE_TCP_SECURE:
-        subscribe_handle = SubscribeTCP(info, topic, cb, user_data, qos);
+    case AITT_TYPE_SHM:
+    case AITT_TYPE_UDS:
+        subscribe_handle = SubscribeTransport(info, topic, cb, user_data, qos);
         break;
     default:
         ERR("Unknown AittProtocol(%d)", protocol);
@@ -211,28 +332,48 @@ AittSubscribeID AITT::Impl::Subscribe(const std::string &topic, const AITT::Subs
         subscribed_list.push_back(info);
     }
 
+    // Local deliveries of a transport subscription are called back on the worker as MQTT ones.
+    if (local_delivery)
+        AddLocalSubscriber(info, topic, cb, user_data, dispatch ? dispatch : NewDispatcher());
+
     INFO("Subscribe topic(%s) : %p", topic.c_str(), info);
     return reinterpret_cast<AittSubscribeID>(info);
 }
 
-AittSubscribeID AITT::Impl::SubscribeMQ(SubscribeInfo *handle, MainLoopIface *loop_handle,
+AITT::Impl::MQDispatcher AITT::Impl::NewDispatcher(void)
+{
+    if (executor == nullptr) {
+        MQDeliveryQueue *queue = &delivery_queue;
+        return [queue](MQDelivery &&delivery) { queue->Push(std::move(delivery)); };
+    }
+
+    // Messages of a subscription are kept in order by its own strand.
+    MQExecutor *pool = executor.get();
+    std::shared_ptr<MQExecutor::Strand> strand = pool->NewStrand();
+    return [pool, strand](MQDelivery &&delivery) { pool->Post(strand, std::move(delivery)); };
+}
+
+AittSubscribeID AITT::Impl::SubscribeMQ(SubscribeInfo *handle, const MQDispatcher &dispatch,
       const std::string &topic, const SubscribeCallback &cb, void *user_data, AittQoS qos)
 {
-    RETV_IF(nullptr == loop_handle, nullptr);
+    RETV_IF(nullptr == dispatch, nullptr);
+
+    // The callback is shared by every delivery instead of being copied for each message.
+    std::shared_ptr<const SubscribeCallback> shared_cb =
+          std::make_shared<const SubscribeCallback>(cb);
 
     AittSubscribeID subscribe_handle = mq->Subscribe(
           topic,
-          [this, handle, loop_handle, cb](AittMsg *msg, const void *data, const int datalen,
+          [handle, dispatch, shared_cb](AittMsg *msg, const void *data, const int datalen,
                 void *mq_user_data) {
-              void *delivery = malloc(datalen);
-              if (delivery)
-                  memcpy(delivery, data, datalen);
+              // The payload is shared with the other subscriptions of the same message.
+              if (msg->GetPayload().Retain() == false) {
+                  ERR("Retain(%d) Fail", datalen);
+                  return;
+              }
 
               msg->SetID(handle);
-              auto idler_cb =
-                    std::bind(&Impl::DetachedCB, this, cb, *msg, delivery, datalen, mq_user_data,
-                          std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
-              loop_handle->AddIdle(idler_cb, nullptr);
+              dispatch(MQDelivery{shared_cb, *msg, mq_user_data});
           },
           user_data, qos);
 
@@ -241,15 +382,12 @@ AittSubscribeID AITT::Impl::SubscribeMQ(SubscribeInfo *handle, MainLoopIface *lo
     return subscribe_handle;
 }
 
-int AITT::Impl::DetachedCB(SubscribeCallback cb, AittMsg msg, void *data, const int datalen,
-      void *user_data, MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *loop_data)
+void AITT::Impl::DetachedCB(MQDelivery &delivery)
 {
-    RETV_IF(cb == nullptr, AITT_LOOP_EVENT_REMOVE);
+    RET_IF(delivery.cb == nullptr || *delivery.cb == nullptr);
 
-    cb(&msg, data, datalen, user_data);
-
-    free(data);
-    return AITT_LOOP_EVENT_REMOVE;
+    const AittMsgBuffer &payload = delivery.msg.GetPayload();
+    (*delivery.cb)(&delivery.msg, payload.GetData(), payload.GetSize(), delivery.user_data);
 }
 
 void *AITT::Impl::Unsubscribe(AittSubscribeID subscribe_id)
@@ -274,6 +412,8 @@ void *AITT::Impl::Unsubscribe(AittSubscribeID subscribe_id)
         break;
     case AITT_TYPE_TCP:
     case AITT_TYPE_TCP_SECURE:
+    case AITT_TYPE_SHM:
+    case AITT_TYPE_UDS:
         user_data = modules.Get(found_info->first).Unsubscribe(found_info->second);
         break;
 
@@ -283,115 +423,359 @@ void *AITT::Impl::Unsubscribe(AittSubscribeID subscribe_id)
     }
 
     subscribed_list.erase(it);
+    RemoveLocalSubscriber(info);
     delete info;
 
     return user_data;
 }
 
+void AITT::Impl::SetRemotePolicy(const std::string &topic, AittRemotePolicy policy)
+{
+    if (topic.find("+") != std::string::npos || topic.find("#") != std::string::npos) {
+        ERR("Not Support Wildcard in SetRemotePolicy");
+        throw AittException(AittException::INVALID_ARG);
+    }
+    if (policy < AITT_REMOTE_ALWAYS || AITT_REMOTE_UNLESS_LOCAL < policy) {
+        ERR("Unknown AittRemotePolicy(%d)", policy);
+        throw AittException(AittException::INVALID_ARG);
+    }
+
+    std::lock_guard<std::mutex> lock(local_subscribers_mutex_);
+    if (policy == AITT_REMOTE_ALWAYS)
+        remote_policies.erase(topic);
+    else
+        remote_policies[topic] = policy;
+}
+
+void AITT::Impl::AddLocalSubscriber(SubscribeInfo *info, const std::string &topic,
+      const SubscribeCallback &cb, void *user_data, const MQDispatcher &dispatch)
+{
+    std::lock_guard<std::mutex> lock(local_subscribers_mutex_);
+    LocalSubscriberPtr subscriber = std::make_shared<const LocalSubscriber>(
+          LocalSubscriber{topic, info->first, info, std::make_shared<const SubscribeCallback>(cb),
+                user_data, dispatch, local_order++});
+    local_subscribers.Insert(topic, subscriber);
+    local_subscriber_handles[info] = subscriber;
+}
+
+void AITT::Impl::RemoveLocalSubscriber(SubscribeInfo *info)
+{
+    std::lock_guard<std::mutex> lock(local_subscribers_mutex_);
+    auto it = local_subscriber_handles.find(info);
+    if (it == local_subscriber_handles.end())
+        return;
+
+    local_subscribers.Remove(it->second->topic, it->second);
+    local_subscriber_handles.erase(it);
+}
+
+// It delivers a message to the subscribers of the same AITT without serializing it,
+// and tells whether the message still goes through the transports.
+bool AITT::Impl::DeliverLocal(const std::string &topic, const void *data, const int datalen,
+      AittProtocol protocols, const std::string &reply_topic, const std::string &correlation)
+{
+    if (local_delivery == false)
+        return true;
+
+    std::vector<LocalSubscriberPtr> matched;
+    AittRemotePolicy policy = AITT_REMOTE_ALWAYS;
+    {
+        std::lock_guard<std::mutex> lock(local_subscribers_mutex_);
+        local_subscribers.Match(topic, [&matched, protocols](const LocalSubscriberPtr &subscriber) {
+            if (subscriber->protocol & protocols)
+                matched.push_back(subscriber);
+        });
+
+        auto it = remote_policies.find(topic);
+        if (it != remote_policies.end())
+            policy = it->second;
+    }
+
+    if (matched.empty() == false) {
+        std::sort(matched.begin(), matched.end(),
+              [](const LocalSubscriberPtr &left, const LocalSubscriberPtr &right) {
+                  return left->order < right->order;
+              });
+
+        AittMsg msg;
+        msg.SetTopic(topic);
+        if (reply_topic.empty() == false) {
+            msg.SetResponseTopic(reply_topic);
+            msg.SetCorrelation(correlation);
+        }
+        // Every subscriber shares one copy of the payload.
+        msg.SetPayload(AittMsgBuffer::Wrap(data, datalen));
+        if (msg.GetPayload().Retain() == false) {
+            ERR("Retain(%d) Fail", datalen);
+            return true;
+        }
+
+        for (const auto &subscriber : matched) {
+            AittMsg delivery_msg = msg;
+            delivery_msg.SetID(subscriber->info);
+            delivery_msg.SetProtocol(subscriber->protocol);
+            subscriber->dispatch(MQDelivery{subscriber->cb, delivery_msg, subscriber->user_data});
+        }
+    }
+
+    switch (policy) {
+    case AITT_REMOTE_NEVER:
+        return false;
+    case AITT_REMOTE_UNLESS_LOCAL:
+        return matched.empty();
+    default:
+        return true;
+    }
+}
+
 // It's not supported with multiple protocols like subscribe.
 void AITT::Impl::PublishWithReply(const std::string &topic, const void *data, const int datalen,
       AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb, void *user_data,
       const std::string &correlation)
 {
-    std::string replyTopic = topic + RESPONSE_POSTFIX + std::to_string(reply_id++);
-
-    auto id = Subscribe(
-          replyTopic,
-          [this, cb](AittMsg *sub_msg, const void *sub_data, const int sub_datalen,
-                void *sub_cbdata) {
-              if (sub_msg->IsEndSequence()) {
-                  try {
-                      Unsubscribe(sub_msg->GetID());
-                  } catch (AittException &e) {
-                      ERR("Unsubscribe() Fail(%s)", e.what());
-                  }
-              }
-              cb(sub_msg, sub_data, sub_datalen, sub_cbdata);
-          },
-          user_data, protocol, qos);
-
-    switch (protocol) {
-    case AITT_TYPE_MQTT:
-        mq->PublishWithReply(topic, data, datalen, qos, retain, replyTopic, correlation);
-        break;
-    case AITT_TYPE_TCP:
-    case AITT_TYPE_TCP_SECURE:
-        modules.Get(protocol).PublishWithReply(topic, data, datalen, qos, retain, replyTopic,
-              correlation);
-        break;
-    default:
-        ERR("Unknown AittProtocol(%d)", protocol);
-        Unsubscribe(id);
-        throw AittException(AittException::INVALID_ARG);
+    ReplyHandler handler;
+    if (protocol == AITT_TYPE_MQTT) {
+        // Callbacks of MQTT replies run on the worker like the ones of subscriptions.
+        MQDispatcher dispatch = reply_dispatch;
+        std::shared_ptr<const SubscribeCallback> shared_cb =
+              std::make_shared<const SubscribeCallback>(cb);
+        handler = [dispatch, shared_cb, user_data](AittMsg *msg, const void *reply_data,
+                        const int reply_datalen) {
+            dispatch(MQDelivery{shared_cb, *msg, user_data});
+        };
+    } else {
+        handler = [cb, user_data](AittMsg *msg, const void *reply_data,
+                        const int reply_datalen) {
+            cb(msg, reply_data, reply_datalen, user_data);
+        };
     }
+
+    unsigned int id = AddReplyHandler(protocol, handler);
+    PublishRequest(topic, data, datalen, protocol, qos, retain, id, correlation);
 }
 
 int AITT::Impl::PublishWithReplySync(const std::string &topic, const void *data, const int datalen,
       AittProtocol protocol, AittQoS qos, bool retain, const SubscribeCallback &cb, void *user_data,
       const std::string &correlation, int timeout_ms)
 {
-    if (protocol != AITT_TYPE_MQTT)
-        return -1;  // not yet support
-
-    std::string replyTopic = topic + RESPONSE_POSTFIX + std::to_string(reply_id++);
-    MainLoopIface *sync_loop = MainLoopHandler::new_loop();
-    SubscribeInfo *info = new SubscribeInfo();
-    void *subscribe_handle;
-    unsigned int timeout_id = 0;
-    bool is_timeout = false;
+    // Transport replies come on the thread receiving the messages of the protocol, so a callback
+    // of the protocol would wait for itself.
+    if (receiving_impl == this && receiving_protocol == protocol) {
+        ERR("PublishWithReplySync(%d) on the thread receiving its replies", protocol);
+        return AITT_ERROR_NOT_SUPPORTED;
+    }
 
-    info->first = protocol;
+    uint64_t ticket;
+    SyncWaiterPtr waiter = AcquireWaiter(ticket);
 
-    subscribe_handle = SubscribeMQ(
-          info, sync_loop, replyTopic,
-          [&](AittMsg *sub_msg, const void *sub_data, const int sub_datalen, void *sub_cbdata) {
-              if (sub_msg->IsEndSequence()) {
-                  try {
-                      Unsubscribe(sub_msg->GetID());
-                  } catch (AittException &e) {
-                      ERR("Unsubscribe() Fail(%s)", e.what());
-                  }
-                  sync_loop->Quit();
-              } else {
-                  if (timeout_id) {
-                      sync_loop->RemoveTimeout(timeout_id);
-                      HandleTimeout(timeout_ms, timeout_id, sync_loop, is_timeout);
+    unsigned int id;
+    try {
+        id = AddReplyHandler(protocol,
+              [waiter, ticket](AittMsg *msg, const void *reply_data, const int reply_datalen) {
+                  if (msg->GetPayload().Retain() == false) {
+                      ERR("Retain(%d) Fail", reply_datalen);
+                      return;
                   }
-              }
-              cb(sub_msg, sub_data, sub_datalen, sub_cbdata);
+
+                  std::lock_guard<std::mutex> lock(waiter->lock);
+                  if (waiter->ticket != ticket)
+                      return;
+                  waiter->replies.push_back(*msg);
+                  waiter->cond.notify_one();
+              });
+        PublishRequest(topic, data, datalen, protocol, qos, false, id, correlation);
+    } catch (...) {
+        ReleaseWaiter(waiter);
+        throw;
+    }
+
+    // The timeout restarts whenever a reply comes before the end of the sequence.
+    int ret = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    auto has_reply = [&waiter]() { return waiter->replies.empty() == false; };
+    std::unique_lock<std::mutex> lock(waiter->lock);
+    while (true) {
+        if (timeout_ms <= 0) {
+            waiter->cond.wait(lock, has_reply);
+        } else if (waiter->cond.wait_until(lock, deadline, has_reply) == false) {
+            ERR("PublishWithReplySync() timeout(%d)", timeout_ms);
+            ret = AITT_ERROR_TIMED_OUT;
+            break;
+        }
+
+        AittMsg reply = std::move(waiter->replies.front());
+        waiter->replies.pop_front();
+        lock.unlock();
+
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        const AittMsgBuffer &payload = reply.GetPayload();
+        cb(&reply, payload.GetData(), payload.GetSize(), user_data);
+        if (reply.IsEndSequence() && reply.IsLastChunk())
+            break;
+
+        lock.lock();
+    }
+    if (lock.owns_lock())
+        lock.unlock();
+
+    RemoveReplyHandler(id);
+    ReleaseWaiter(waiter);
+    return ret;
+}
+
+void AITT::Impl::PublishRequest(const std::string &topic, const void *data, const int datalen,
+      AittProtocol protocol, AittQoS qos, bool retain, unsigned int id,
+      const std::string &correlation)
+{
+    try {
+        std::string reply_topic = ReplyTopic(id);
+        switch (protocol) {
+        case AITT_TYPE_MQTT:
+            if (DeliverLocal(topic, data, datalen, protocol, reply_topic, correlation))
+                mq->PublishWithReply(topic, data, datalen, qos, retain, reply_topic, correlation);
+            break;
+        case AITT_TYPE_TCP:
+        case AITT_TYPE_TCP_SECURE:
+        case AITT_TYPE_SHM:
+        case AITT_TYPE_UDS:
+            if (DeliverLocal(topic, data, datalen, protocol, reply_topic, correlation)) {
+                modules.Get(protocol).PublishWithReply(topic, data, datalen, qos, retain,
+                      reply_topic, correlation);
+            }
+            break;
+        default:
+            ERR("Unknown AittProtocol(%d)", protocol);
+            throw AittException(AittException::INVALID_ARG);
+        }
+    } catch (...) {
+        RemoveReplyHandler(id);
+        throw;
+    }
+}
+
+AittSubscribeID AITT::Impl::SubscribeReply(AittProtocol protocol)
+{
+    std::string topic = REPLY_TOPIC_BASE + id_ + "/+";
+    // Replies keep the QoS of SendReply(), the subscription doesn't downgrade them.
+    // Transport replies come on the module thread, so PublishWithReplySync() refuses to wait
+    // on it.
+    if (protocol != AITT_TYPE_MQTT) {
+        // Responders hold the replies until they discover the subscription.
+        return Subscribe(
+              topic,
+              [this](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                  DispatchReply(msg, data, datalen);
+              },
+              nullptr, protocol, AITT_QOS_EXACTLY_ONCE);
+    }
+
+    // MQTT replies are routed on the MQ thread, because the worker may be waiting for them
+    // in PublishWithReplySync() called by a callback.
+    SubscribeInfo *info = new SubscribeInfo(protocol, nullptr);
+    info->second = SubscribeMQ(
+          info,
+          [this](MQDelivery &&delivery) {
+              const AittMsgBuffer &payload = delivery.msg.GetPayload();
+              DispatchReply(&delivery.msg, payload.GetData(), payload.GetSize());
           },
-          user_data, qos);
-    info->second = subscribe_handle;
+          topic, nullptr, nullptr, AITT_QOS_EXACTLY_ONCE);
     {
         std::unique_lock<std::mutex> lock(subscribed_list_mutex_);
         subscribed_list.push_back(info);
     }
 
-    mq->PublishWithReply(topic, data, datalen, qos, false, replyTopic, correlation);
-    if (timeout_ms)
-        HandleTimeout(timeout_ms, timeout_id, sync_loop, is_timeout);
+    return reinterpret_cast<AittSubscribeID>(info);
+}
 
-    sync_loop->Run();
-    delete sync_loop;
+unsigned int AITT::Impl::AddReplyHandler(AittProtocol protocol, const ReplyHandler &handler)
+{
+    {
+        std::lock_guard<std::mutex> lock(reply_subscriptions_mutex_);
+        if (reply_subscriptions.find(protocol) == reply_subscriptions.end())
+            reply_subscriptions[protocol] = SubscribeReply(protocol);
+    }
 
-    if (is_timeout)
-        return AITT_ERROR_TIMED_OUT;
-    return 0;
+    std::lock_guard<std::mutex> lock(reply_handlers_mutex_);
+    unsigned int id = reply_id++;
+    reply_handlers[id] = std::make_shared<const ReplyHandler>(handler);
+    return id;
 }
 
-void AITT::Impl::HandleTimeout(int timeout_ms, unsigned int &timeout_id, MainLoopIface *sync_loop,
-      bool &is_timeout)
+void AITT::Impl::RemoveReplyHandler(unsigned int id)
 {
-    timeout_id = sync_loop->AddTimeout(
-          timeout_ms,
-          [&, sync_loop, timeout_ms](MainLoopIface::Event result, int fd,
-                MainLoopIface::MainLoopData *data) -> int {
-              ERR("PublishWithReplySync() timeout(%d)", timeout_ms);
-              sync_loop->Quit();
-              is_timeout = true;
-              return AITT_LOOP_EVENT_REMOVE;
-          },
-          nullptr);
+    std::lock_guard<std::mutex> lock(reply_handlers_mutex_);
+    reply_handlers.erase(id);
+}
+
+std::string AITT::Impl::ReplyTopic(unsigned int id) const
+{
+    return REPLY_TOPIC_BASE + id_ + "/" + std::to_string(id);
+}
+
+void AITT::Impl::DispatchReply(AittMsg *msg, const void *data, const int datalen)
+{
+    const std::string &topic = msg->GetTopic();
+    unsigned int id = strtoul(topic.c_str() + topic.rfind('/') + 1, nullptr, 10);
+
+    std::shared_ptr<const ReplyHandler> handler;
+    {
+        std::lock_guard<std::mutex> lock(reply_handlers_mutex_);
+        auto it = reply_handlers.find(id);
+        if (it == reply_handlers.end()) {
+            DBG("No request for the reply(%s)", topic.c_str());
+            return;
+        }
+        handler = it->second;
+        // A streamed reply ends with its last chunk.
+        if (msg->IsEndSequence() && msg->IsLastChunk())
+            reply_handlers.erase(it);
+    }
+
+    // The reply subscription is shared, so it's not for the callback to unsubscribe.
+    msg->SetID(nullptr);
+    (*handler)(msg, data, datalen);
+}
+
+// The reply subscriptions are removed by UnsubscribeAll().
+void AITT::Impl::ClearReplies(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(reply_subscriptions_mutex_);
+        reply_subscriptions.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(reply_handlers_mutex_);
+    reply_handlers.clear();
+}
+
+AITT::Impl::SyncWaiterPtr AITT::Impl::AcquireWaiter(uint64_t &ticket)
+{
+    SyncWaiterPtr waiter;
+    {
+        std::lock_guard<std::mutex> lock(sync_waiters_mutex_);
+        if (sync_waiters.empty() == false) {
+            waiter = sync_waiters.back();
+            sync_waiters.pop_back();
+        }
+    }
+    if (waiter == nullptr)
+        waiter = std::make_shared<SyncWaiter>();
+
+    std::lock_guard<std::mutex> lock(waiter->lock);
+    ticket = waiter->ticket;
+    return waiter;
+}
+
+void AITT::Impl::ReleaseWaiter(const SyncWaiterPtr &waiter)
+{
+    {
+        std::lock_guard<std::mutex> lock(waiter->lock);
+        waiter->ticket++;
+        waiter->replies.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(sync_waiters_mutex_);
+    sync_waiters.push_back(waiter);
 }
 
 void AITT::Impl::SendReply(AittMsg *msg, const void *data, const int datalen, bool end)
@@ -402,12 +786,23 @@ void AITT::Impl::SendReply(AittMsg *msg, const void *data, const int datalen, bo
         msg->IncreaseSequence();
     msg->SetEndSequence(end);
 
+    // Replies to the requests of the same AITT don't leave the process.
+    if (local_delivery) {
+        std::string own_replies = REPLY_TOPIC_BASE + id_ + "/";
+        if (msg->GetResponseTopic().compare(0, own_replies.size(), own_replies) == 0) {
+            SendLocalReply(*msg, data, datalen);
+            return;
+        }
+    }
+
     switch (msg->GetProtocol()) {
     case AITT_TYPE_MQTT:
         mq->SendReply(msg, data, datalen, AITT_QOS_AT_MOST_ONCE, false);
         break;
     case AITT_TYPE_TCP:
     case AITT_TYPE_TCP_SECURE:
+    case AITT_TYPE_SHM:
+    case AITT_TYPE_UDS:
         modules.Get(msg->GetProtocol()).SendReply(msg, data, datalen, AITT_QOS_AT_MOST_ONCE, false);
         break;
     default:
@@ -416,18 +811,49 @@ void AITT::Impl::SendReply(AittMsg *msg, const void *data, const int datalen, bo
     }
 }
 
-void *AITT::Impl::SubscribeTCP(SubscribeInfo *handle, const std::string &topic,
+void AITT::Impl::SendLocalReply(const AittMsg &request, const void *data, const int datalen)
+{
+    AittMsg reply;
+    reply.SetTopic(request.GetResponseTopic());
+    reply.SetCorrelation(request.GetCorrelation());
+    reply.SetSequence(request.GetSequence());
+    reply.SetEndSequence(request.IsEndSequence());
+    reply.SetProtocol(request.GetProtocol());
+    // The requester may keep the reply after SendReply() returns.
+    reply.SetPayload(AittMsgBuffer::Wrap(data, datalen));
+    if (reply.GetPayload().Retain() == false) {
+        ERR("Retain(%d) Fail", datalen);
+        return;
+    }
+
+    const AittMsgBuffer &payload = reply.GetPayload();
+    DispatchReply(&reply, payload.GetData(), payload.GetSize());
+}
+
+void *AITT::Impl::SubscribeTransport(SubscribeInfo *handle, const std::string &topic,
       const SubscribeCallback &cb, void *user_data, AittQoS qos)
 {
     auto protocol = handle->first;
     return modules.Get(protocol).Subscribe(
           topic,
-          [handle, cb, protocol](AittMsg *msg, const void *data, const int datalen,
+          [this, handle, cb, protocol](AittMsg *msg, const void *data, const int datalen,
                 void *userdata) {
               msg->SetID(handle);
               msg->SetProtocol(protocol);
 
-              return cb(msg, data, datalen, userdata);
+              const Impl *impl = receiving_impl;
+              AittProtocol impl_protocol = receiving_protocol;
+              receiving_impl = this;
+              receiving_protocol = protocol;
+              try {
+                  cb(msg, data, datalen, userdata);
+              } catch (...) {
+                  receiving_impl = impl;
+                  receiving_protocol = impl_protocol;
+                  throw;
+              }
+              receiving_impl = impl;
+              receiving_protocol = impl_protocol;
           },
           user_data, qos);
 }
@@ -463,7 +889,23 @@ int AITT::Impl::CountSubscriber(const std::string &topic, AittProtocol protocols
     if (protocols & AITT_TYPE_TCP_SECURE)
         total += modules.Get(AITT_TYPE_TCP_SECURE).CountSubscriber(topic);
 
+    if (protocols & AITT_TYPE_SHM)
+        total += modules.Get(AITT_TYPE_SHM).CountSubscriber(topic);
+
+    if (protocols & AITT_TYPE_UDS)
+        total += modules.Get(AITT_TYPE_UDS).CountSubscriber(topic);
+
     return total;
 }
 
+AittPublishStats AITT::Impl::GetPublishStats(void)
+{
+    return mq->GetPublishStats();
+}
+
+std::map<std::string, AittPeerStats> AITT::Impl::GetPeerStats(AittProtocol protocol)
+{
+    return modules.Get(protocol).GetPeerStats();
+}
+
 }  // namespace aitt
@@ -15,20 +15,28 @@
  */
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "AITT.h"
 #include "AittDiscovery.h"
 #include "AittStream.h"
+#include "DeliveryQueue.h"
 #include "MQ.h"
 #include "MQDiscoveryHandler.h"
 #include "MainLoopIface.h"
 #include "ModuleManager.h"
+#include "SubscriberExecutor.h"
+#include "TopicTrie.h"
 
 namespace aitt {
 class AITT::Impl {
@@ -46,6 +54,10 @@ class AITT::Impl {
 
     void Publish(const std::string &topic, const void *data, const int datalen,
           AittProtocol protocols, AittQoS qos, bool retain);
+    void PublishAsync(const std::string &topic, const void *data, const int datalen, AittQoS qos,
+          bool retain, const PublishCallback &cb, void *user_data);
+    void PublishBatch(const AittBatchMessage *messages, int count, AittProtocol protocols,
+          AittQoS qos, bool retain);
     void PublishWithReply(const std::string &topic, const void *data, const int datalen,
           AittProtocol protocol, AittQoS qos, bool retain, const AITT::SubscribeCallback &cb,
           void *cbdata, const std::string &correlation);
@@ -56,6 +68,7 @@ class AITT::Impl {
     AittSubscribeID Subscribe(const std::string &topic, const AITT::SubscribeCallback &cb,
           void *cbdata, AittProtocol protocols, AittQoS qos);
     void *Unsubscribe(AittSubscribeID handle);
+    void SetRemotePolicy(const std::string &topic, AittRemotePolicy policy);
 
     void SendReply(AittMsg *msg, const void *data, const int datalen, bool end);
 
@@ -64,28 +77,88 @@ class AITT::Impl {
     void DestroyStream(AittStream *aitt_stream);
 
     int CountSubscriber(const std::string &topic, AittProtocol protocols);
+    AittPublishStats GetPublishStats(void);
+    std::map<std::string, AittPeerStats> GetPeerStats(AittProtocol protocol);
 
   private:
     using SubscribeInfo = std::pair<AittProtocol, void *>;
+    struct MQDelivery {
+        std::shared_ptr<const SubscribeCallback> cb;
+        AittMsg msg;
+        void *user_data;
+    };
+    using MQDeliveryQueue = DeliveryQueue<MQDelivery>;
+    using MQExecutor = SubscriberExecutor<MQDelivery>;
+    using MQDispatcher = std::function<void(MQDelivery &&delivery)>;
+    // It routes a reply to its request on the thread delivering the reply.
+    using ReplyHandler = std::function<void(AittMsg *msg, const void *data, const int datalen)>;
+
+    // PublishWithReplySync() blocks on a waiter and calls back on its own thread.
+    // Waiters are reused, and the ticket keeps late replies of a former request out.
+    struct SyncWaiter {
+        SyncWaiter(void) : ticket(0) {}
+
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<AittMsg> replies;
+        uint64_t ticket;
+    };
+    using SyncWaiterPtr = std::shared_ptr<SyncWaiter>;
+
+    // A subscription reached by the publishers of the same AITT with the local delivery
+    struct LocalSubscriber {
+        std::string topic;
+        AittProtocol protocol;
+        SubscribeInfo *info;
+        std::shared_ptr<const SubscribeCallback> cb;
+        void *user_data;
+        MQDispatcher dispatch;
+        uint64_t order;  // callbacks of a message are invoked in the order of subscription
+    };
+    using LocalSubscriberPtr = std::shared_ptr<const LocalSubscriber>;
 
     int ConnectionCB(ConnectionCallback cb, void *user_data, int status,
           MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *loop_data);
-    AittSubscribeID SubscribeMQ(SubscribeInfo *info, MainLoopIface *loop_handle,
+    int PublishCB(PublishCallback cb, void *user_data, int result, MainLoopIface::Event event,
+          int fd, MainLoopIface::MainLoopData *loop_data);
+    MQDispatcher NewDispatcher(void);
+    AittSubscribeID SubscribeMQ(SubscribeInfo *info, const MQDispatcher &dispatch,
           const std::string &topic, const SubscribeCallback &cb, void *cbdata, AittQoS qos);
-    int DetachedCB(SubscribeCallback cb, AittMsg mq_msg, void *data, const int datalen,
-          void *cbdata, MainLoopIface::Event result, int fd,
-          MainLoopIface::MainLoopData *loop_data);
-    void *SubscribeTCP(SubscribeInfo *, const std::string &topic, const SubscribeCallback &cb,
-          void *cbdata, AittQoS qos);
-
-    void HandleTimeout(int timeout_ms, unsigned int &timeout_id, MainLoopIface *sync_loop,
-          bool &is_timeout);
+    static void DetachedCB(MQDelivery &delivery);
+    void *SubscribeTransport(SubscribeInfo *, const std::string &topic,
+          const SubscribeCallback &cb, void *cbdata, AittQoS qos);
+
+    void AddLocalSubscriber(SubscribeInfo *info, const std::string &topic,
+          const SubscribeCallback &cb, void *user_data, const MQDispatcher &dispatch);
+    void RemoveLocalSubscriber(SubscribeInfo *info);
+    bool DeliverLocal(const std::string &topic, const void *data, const int datalen,
+          AittProtocol protocols, const std::string &reply_topic = std::string(),
+          const std::string &correlation = std::string());
+    void SendLocalReply(const AittMsg &request, const void *data, const int datalen);
+    void PublishRequest(const std::string &topic, const void *data, const int datalen,
+          AittProtocol protocol, AittQoS qos, bool retain, unsigned int id,
+          const std::string &correlation);
+    AittSubscribeID SubscribeReply(AittProtocol protocol);
+    unsigned int AddReplyHandler(AittProtocol protocol, const ReplyHandler &handler);
+    void RemoveReplyHandler(unsigned int id);
+    std::string ReplyTopic(unsigned int id) const;
+    void DispatchReply(AittMsg *msg, const void *data, const int datalen);
+    void ClearReplies(void);
+    SyncWaiterPtr AcquireWaiter(uint64_t &ticket);
+    void ReleaseWaiter(const SyncWaiterPtr &waiter);
     void UnsubscribeAll();
     void ThreadMain(void);
 
+    // The transport subscription being called back on the thread. The thread receives the
+    // replies of the protocol too, so it can't wait for them.
+    static thread_local const Impl *receiving_impl;
+    static thread_local AittProtocol receiving_protocol;
+
     AITT &public_api;
     AittDiscovery discovery;
     std::unique_ptr<MainLoopIface> main_loop;
+    MQDeliveryQueue delivery_queue;
+    std::unique_ptr<MQExecutor> executor;
     std::thread aittThread;
     ModuleManager modules;
     MQDiscoveryHandler mq_discovery_handler;
@@ -94,10 +167,28 @@ class AITT::Impl {
     std::vector<SubscribeInfo *> subscribed_list;
     std::mutex subscribed_list_mutex_;
 
+    // Requests of a protocol share a reply subscription, and its topic level after the client id
+    // tells which request a reply belongs to.
+    std::map<AittProtocol, AittSubscribeID> reply_subscriptions;
+    std::mutex reply_subscriptions_mutex_;
+    std::unordered_map<unsigned int, std::shared_ptr<const ReplyHandler>> reply_handlers;
+    std::mutex reply_handlers_mutex_;
+    MQDispatcher reply_dispatch;
+    std::vector<SyncWaiterPtr> sync_waiters;
+    std::mutex sync_waiters_mutex_;
+
+    // Messages to the own subscribers skip the transports, with the local delivery.
+    bool local_delivery;
+    TopicTrie<LocalSubscriberPtr> local_subscribers;
+    std::unordered_map<SubscribeInfo *, LocalSubscriberPtr> local_subscriber_handles;
+    std::unordered_map<std::string, AittRemotePolicy> remote_policies;
+    uint64_t local_order;
+    std::mutex local_subscribers_mutex_;
+
     std::string id_;
     std::string mqtt_broker_ip_;
     int mqtt_broker_port_;
-    unsigned short reply_id;
+    unsigned int reply_id;
 
 #ifdef ANDROID
     friend class AittDiscoveryHelper;
@@ -72,7 +72,7 @@ void MQDiscoveryHandler::DiscoveryMessageCallback(const std::string &id, const s
 
     if (!status.compare(AittDiscovery::WILL_LEAVE_NETWORK)) {
         std::lock_guard<std::mutex> auto_lock(remote_subscribe_table_lock);
-        remote_subscribe_table.erase(id);
+        RemoveRemoteTopics(id);
 
         return;
     }
@@ -86,6 +86,9 @@ void MQDiscoveryHandler::DiscoveryMessageCallback(const std::string &id, const s
 
     {
         std::lock_guard<std::mutex> auto_lock(remote_subscribe_table_lock);
+        RemoveRemoteTopics(id);
+        for (const auto &topic : topics)
+            remote_subscribe_trie.Insert(topic, id);
         remote_subscribe_table[id] = topics;
     }
 }
@@ -99,6 +102,7 @@ void MQDiscoveryHandler::Subscribe(AittSubscribeID handle, const std::string &to
     if (result == false) {
         throw AittException(AittException::ALREADY);
     }
+    my_subscribe_trie.Insert(topic, handle);
 
     UpdateDiscoveryMsg();
 }
@@ -108,9 +112,12 @@ void MQDiscoveryHandler::Unsubscribe(AittSubscribeID handle)
     std::lock_guard<std::mutex> auto_lock(my_subscribe_table_lock);
 
     DBG("Unsubscribe : %p", handle);
-    if (my_subscribe_table.erase(handle) == 0) {
+    auto it = my_subscribe_table.find(handle);
+    if (it == my_subscribe_table.end()) {
         throw AittException(AittException::NO_DATA_ERR);
     }
+    my_subscribe_trie.Remove(it->second, handle);
+    my_subscribe_table.erase(it);
 
     UpdateDiscoveryMsg();
 }
@@ -120,21 +127,23 @@ int MQDiscoveryHandler::CountSubscriber(const std::string &topic)
     int count = 0;
 
     std::lock_guard<std::mutex> my_auto_lock(my_subscribe_table_lock);
-    for (const auto &subscribe_handle : my_subscribe_table) {
-        if (discovery_.CompareTopic(subscribe_handle.second, topic)) {
-            count++;
-        }
-    }
+    count += my_subscribe_trie.Count(topic);
 
     std::lock_guard<std::mutex> remote_auto_lock(remote_subscribe_table_lock);
-    for (const auto &remote : remote_subscribe_table) {
-        for (const auto &remote_topic : remote.second) {
-            if (discovery_.CompareTopic(remote_topic, topic)) {
-                count++;
-            }
-        }
-    }
+    count += remote_subscribe_trie.Count(topic);
+
     return count;
 }
 
+void MQDiscoveryHandler::RemoveRemoteTopics(const std::string &id)
+{
+    auto it = remote_subscribe_table.find(id);
+    if (it == remote_subscribe_table.end())
+        return;
+
+    for (const auto &topic : it->second)
+        remote_subscribe_trie.Remove(topic, id);
+    remote_subscribe_table.erase(it);
+}
+
 }  // namespace aitt
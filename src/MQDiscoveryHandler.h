@@ -24,6 +24,7 @@
 
 #include "AITT.h"
 #include "AittDiscovery.h"
+#include "TopicTrie.h"
 
 namespace aitt {
 class MQDiscoveryHandler {
@@ -44,14 +45,18 @@ class MQDiscoveryHandler {
     void DiscoveryMessageCallback(const std::string &id, const std::string &status, const void *msg,
           const int szmsg);
     void UpdateDiscoveryMsg(void);
+    // It must be called with remote_subscribe_table_lock.
+    void RemoveRemoteTopics(const std::string &id);
 
     AittDiscovery &discovery_;
     int discovery_cb;
     std::string id_;
 
     MySubscribeTable my_subscribe_table;
+    TopicTrie<AittSubscribeID> my_subscribe_trie;
     std::mutex my_subscribe_table_lock;
     RemoteSubscribeTable remote_subscribe_table;
+    TopicTrie<std::string> remote_subscribe_trie;  // values are IDs of remote clients
     std::mutex remote_subscribe_table_lock;
 };
 }  // namespace aitt
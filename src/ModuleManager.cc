@@ -27,12 +27,13 @@
 
 namespace aitt {
 
-ModuleManager::ModuleManager(const std::string &my_ip, AittDiscovery &d)
+ModuleManager::ModuleManager(const std::string &my_ip, AittDiscovery &d,
+      const AittOption &option)
       : ip(my_ip), discovery(d), custom_mqtt_handle(nullptr, nullptr), null_transport(discovery, ip)
 {
     for (int i = TYPE_TCP; i < TYPE_TRANSPORT_MAX; ++i) {
         transport_handles.push_back(ModuleHandle(nullptr, nullptr));
-        LoadTransport(static_cast<TransportType>(i));
+        LoadTransport(static_cast<TransportType>(i), option);
     }
 
     for (int i = AITT_STREAM_TYPE_WEBRTC; i < AITT_STREAM_TYPE_MAX; ++i) {
@@ -57,6 +58,10 @@ ModuleManager::TransportType ModuleManager::Convert(AittProtocol type)
         return TYPE_TCP;
     case AITT_TYPE_TCP_SECURE:
         return TYPE_TCP_SECURE;
+    case AITT_TYPE_SHM:
+        return TYPE_SHM;
+    case AITT_TYPE_UDS:
+        return TYPE_UDS;
 
     case AITT_TYPE_MQTT:
     default:
@@ -72,6 +77,10 @@ const char *ModuleManager::GetTransportFileName(TransportType type)
     case TYPE_TCP:
     case TYPE_TCP_SECURE:
         return "libaitt-transport-tcp.so";
+    case TYPE_SHM:
+        return "libaitt-transport-shm.so";
+    case TYPE_UDS:
+        return "libaitt-transport-uds.so";
     default:
         ERR("Unknown Type(%d)", type);
         break;
@@ -119,7 +128,7 @@ ModuleManager::ModuleHandle ModuleManager::OpenTransport(TransportType type)
     return handle;
 }
 
-void ModuleManager::LoadTransport(TransportType type)
+void ModuleManager::LoadTransport(TransportType type, const AittOption &option)
 {
     try {
         transport_handles[type] = OpenTransport(type);
@@ -137,7 +146,7 @@ void ModuleManager::LoadTransport(TransportType type)
 
     AittProtocol protocol = static_cast<AittProtocol>(0x1 << (type + 1));
     transports[type] = std::unique_ptr<AittTransport>(
-          static_cast<AittTransport *>(get_instance_fn(protocol, discovery, ip.c_str())));
+          static_cast<AittTransport *>(get_instance_fn(protocol, discovery, ip.c_str(), option)));
     if (transports[type] == nullptr) {
         ERR("get_instance_fn(%d) Fail", protocol);
     }
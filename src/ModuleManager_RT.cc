@@ -25,13 +25,14 @@
 
 namespace aitt {
 
-ModuleManager::ModuleManager(const std::string &my_ip, AittDiscovery &d)
+ModuleManager::ModuleManager(const std::string &my_ip, AittDiscovery &d,
+      const AittOption &option)
       : ip(my_ip), discovery(d), null_transport(discovery, ip)
 {
     transports[TYPE_TCP] = std::unique_ptr<AittTransport>(static_cast<AittTransport *>(
-          new AittTCPNamespace::Module(AITT_TYPE_TCP, discovery, my_ip)));
+          new AittTCPNamespace::Module(AITT_TYPE_TCP, discovery, my_ip, option)));
     transports[TYPE_TCP_SECURE] = std::unique_ptr<AittTransport>(static_cast<AittTransport *>(
-          new AittTCPNamespace::Module(AITT_TYPE_TCP_SECURE, discovery, my_ip)));
+          new AittTCPNamespace::Module(AITT_TYPE_TCP_SECURE, discovery, my_ip, option)));
 }
 
 AittTransport &ModuleManager::Get(AittProtocol protocol)
@@ -51,6 +52,10 @@ ModuleManager::TransportType ModuleManager::Convert(AittProtocol type)
         return TYPE_TCP;
     case AITT_TYPE_TCP_SECURE:
         return TYPE_TCP_SECURE;
+    case AITT_TYPE_SHM:
+        return TYPE_SHM;
+    case AITT_TYPE_UDS:
+        return TYPE_UDS;
 
     case AITT_TYPE_MQTT:
     default:
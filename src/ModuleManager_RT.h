@@ -29,7 +29,8 @@ namespace aitt {
 
 class ModuleManager {
   public:
-    explicit ModuleManager(const std::string &my_ip, AittDiscovery &d);
+    explicit ModuleManager(const std::string &my_ip, AittDiscovery &d,
+          const AittOption &option = AittOption());
     virtual ~ModuleManager() = default;
 
     AittTransport &Get(AittProtocol type);
@@ -45,6 +46,8 @@ class ModuleManager {
     enum TransportType {
         TYPE_TCP,         //(0x1 << 1)
         TYPE_TCP_SECURE,  //(0x1 << 2)
+        TYPE_SHM,         //(0x1 << 3)
+        TYPE_UDS,         //(0x1 << 4)
         TYPE_TRANSPORT_MAX,
     };
 
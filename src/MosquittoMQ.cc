@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <cstdlib>
 #include <stdexcept>
 #include <thread>
 
@@ -32,13 +33,20 @@ namespace aitt {
 
 const std::string MosquittoMQ::REPLY_SEQUENCE_NUM_KEY = "sequenceNum";
 const std::string MosquittoMQ::REPLY_IS_END_SEQUENCE_KEY = "isEndSequence";
+thread_local bool MosquittoMQ::on_loop_thread = false;
 
-MosquittoMQ::MosquittoMQ(const std::string &id, bool clean_session)
+MosquittoMQ::MosquittoMQ(const std::string &id, bool clean_session, bool no_local,
+      int max_inflight, bool inflight_block)
       : handle(nullptr),
         keep_alive(60),
+        subscribe_options(no_local ? MQTT_SUB_OPT_NO_LOCAL : 0),
+        subscribe_order(0),
         subscribers_iterating(false),
-        subscriber_iterator_updated(false),
-        connect_cb(nullptr)
+        connect_cb(nullptr),
+        max_inflight(max_inflight),
+        inflight_block(inflight_block),
+        reserving(0),
+        publish_stats()
 {
     do {
         int ret = mosquitto_lib_init();
@@ -62,6 +70,7 @@ MosquittoMQ::MosquittoMQ(const std::string &id, bool clean_session)
         mosquitto_message_v5_callback_set(handle, MessageCallback);
         mosquitto_connect_v5_callback_set(handle, ConnectCallback);
         mosquitto_disconnect_v5_callback_set(handle, DisconnectCallback);
+        mosquitto_publish_v5_callback_set(handle, PublishedCallback);
 
         return;
     } while (0);
@@ -78,7 +87,10 @@ MosquittoMQ::~MosquittoMQ(void)
 
     callback_lock.lock();
     connect_cb = nullptr;
-    subscribers.clear();
+    subscribers.Clear();
+    for (auto data : subscribe_handles)
+        delete data;
+    subscribe_handles.clear();
     callback_lock.unlock();
 
     mosquitto_destroy(handle);
@@ -99,6 +111,7 @@ void MosquittoMQ::ConnectCallback(struct mosquitto *mosq, void *obj, int rc, int
 {
     RET_IF(obj == nullptr);
     MosquittoMQ *mq = static_cast<MosquittoMQ *>(obj);
+    on_loop_thread = true;
 
     INFO("Connected : rc(%d), flag(%d)", rc, flag);
 
@@ -112,8 +125,10 @@ void MosquittoMQ::DisconnectCallback(struct mosquitto *mosq, void *obj, int rc,
 {
     RET_IF(obj == nullptr);
     MosquittoMQ *mq = static_cast<MosquittoMQ *>(obj);
+    on_loop_thread = true;
 
     INFO("Disconnected : rc(%d)", rc);
+    mq->FailInflightQoS0();
 
     std::lock_guard<std::recursive_mutex> lock_from_here(mq->callback_lock);
     if (mq->connect_cb)
@@ -176,104 +191,307 @@ void MosquittoMQ::MessageCallback(mosquitto *handle, void *obj, const mosquitto_
 {
     RET_IF(obj == nullptr);
     MosquittoMQ *mq = static_cast<MosquittoMQ *>(obj);
+    on_loop_thread = true;
 
     mq->MessageCB(msg, props);
 }
 
-void MosquittoMQ::MessageCB(const mosquitto_message *msg, const mosquitto_property *props)
+void MosquittoMQ::PublishedCallback(struct mosquitto *mosq, void *obj, int mid, int reason_code,
+      const mosquitto_property *props)
 {
-    std::lock_guard<std::recursive_mutex> auto_lock(callback_lock);
-    subscribers_iterating = true;
-    subscriber_iterator = subscribers.begin();
-    while (subscriber_iterator != subscribers.end()) {
-        auto subscribe_data = *(subscriber_iterator);
-        if (nullptr == subscribe_data) {
-            ERR("Invalid subscribe data");
-            ++subscriber_iterator;
-            continue;
+    RET_IF(obj == nullptr);
+    MosquittoMQ *mq = static_cast<MosquittoMQ *>(obj);
+    on_loop_thread = true;
+
+    int result = AITT_ERROR_NONE;
+    if (reason_code == MQTT_RC_NOT_AUTHORIZED) {
+        result = AITT_ERROR_PERMISSION_DENIED;
+    } else if (reason_code >= 0x80) {  // Reason codes of failures
+        ERR("Publish(mid:%d) Fail(reason:%d)", mid, reason_code);
+        result = AITT_ERROR_SYSTEM;
+    }
+    mq->CompleteInflight(mid, result);
+}
+
+// Only the messages counted by the window or waited for by a callback are tracked, so the others
+// don't take inflight_lock. It returns false for a message not tracked.
+bool MosquittoMQ::ReserveInflight(bool has_cb)
+{
+    if (max_inflight == 0 && has_cb == false)
+        return false;
+
+    std::unique_lock<std::mutex> lock(inflight_lock);
+    while (max_inflight && max_inflight <= publish_stats.inflight) {
+        if (inflight_block == false) {
+            publish_stats.overflowed++;
+            ERR("Too many in-flight messages(%d)", publish_stats.inflight);
+            throw AittException(AittException::RESOURCE_BUSY_ERR);
         }
+        // Completions come on the loop thread, so it can't wait for them.
+        if (on_loop_thread)
+            break;
+        inflight_cond.wait(lock);
+    }
+
+    publish_stats.inflight++;
+    if (publish_stats.peak_inflight < publish_stats.inflight)
+        publish_stats.peak_inflight = publish_stats.inflight;
+    reserving++;
+    return true;
+}
+
+void MosquittoMQ::CancelInflight(void)
+{
+    std::lock_guard<std::mutex> lock(inflight_lock);
+    publish_stats.inflight--;
+    EndReserving();
+    inflight_cond.notify_one();
+}
+
+// Completions of the messages not tracked are dropped when no publisher is tracking a message.
+// inflight_lock must be held.
+void MosquittoMQ::EndReserving(void)
+{
+    if (--reserving == 0)
+        early_completions.clear();
+}
 
-        if (CompareTopic(subscribe_data->topic.c_str(), msg->topic))
-            InvokeCallback(*subscriber_iterator, msg, props);
+void MosquittoMQ::TrackInflight(int mid, int qos, const PublishCallback &cb)
+{
+    int result;
+    {
+        std::lock_guard<std::mutex> lock(inflight_lock);
+        auto early = early_completions.find(mid);
+        if (early == early_completions.end()) {
+            InflightData &data = inflight[mid];
+            data.cb = cb;
+            data.qos = qos;
+            EndReserving();
+            return;
+        }
 
-        if (!subscriber_iterator_updated)
-            ++subscriber_iterator;
+        result = early->second;
+        early_completions.erase(early);
+        EndReserving();
+        publish_stats.inflight--;
+        if (result == AITT_ERROR_NONE)
+            publish_stats.completed++;
         else
-            subscriber_iterator_updated = false;
+            publish_stats.failed++;
+        inflight_cond.notify_one();
     }
-    subscribers_iterating = false;
-    subscribers.insert(subscribers.end(), new_subscribers.begin(), new_subscribers.end());
-    new_subscribers.clear();
+
+    if (cb)
+        cb(result);
 }
 
-void MosquittoMQ::InvokeCallback(SubscribeData *subscriber, const mosquitto_message *msg,
-      const mosquitto_property *props)
+void MosquittoMQ::CompleteInflight(int mid, int result)
 {
-    RET_IF(nullptr == subscriber);
+    PublishCallback cb;
+    {
+        std::lock_guard<std::mutex> lock(inflight_lock);
+        auto it = inflight.find(mid);
+        if (it == inflight.end()) {
+            // It may be of a message being tracked, or of a message not tracked.
+            if (reserving)
+                early_completions[mid] = result;
+            return;
+        }
+
+        cb = std::move(it->second.cb);
+        inflight.erase(it);
+        publish_stats.inflight--;
+        if (result == AITT_ERROR_NONE)
+            publish_stats.completed++;
+        else
+            publish_stats.failed++;
+        inflight_cond.notify_one();
+    }
+
+    if (cb)
+        cb(result);
+}
 
+// Messages of QoS 0 queued at a disconnection are dropped, others are sent again after
+// reconnecting.
+void MosquittoMQ::FailInflightQoS0(void)
+{
+    std::vector<PublishCallback> failed;
+    {
+        std::lock_guard<std::mutex> lock(inflight_lock);
+        for (auto it = inflight.begin(); it != inflight.end();) {
+            if (it->second.qos != AITT_QOS_AT_MOST_ONCE) {
+                ++it;
+                continue;
+            }
+            failed.push_back(std::move(it->second.cb));
+            it = inflight.erase(it);
+            publish_stats.inflight--;
+            publish_stats.failed++;
+        }
+        inflight_cond.notify_all();
+    }
+
+    for (auto &cb : failed) {
+        if (cb)
+            cb(AITT_ERROR_NOT_READY);
+    }
+}
+
+AittPublishStats MosquittoMQ::GetPublishStats(void)
+{
+    std::lock_guard<std::mutex> lock(inflight_lock);
+    return publish_stats;
+}
+
+void MosquittoMQ::MessageCB(const mosquitto_message *msg, const mosquitto_property *props)
+{
+    // The payload is owned by mosquitto. It's copied only when a subscriber retains it.
+    AittMsgBuffer payload = AittMsgBuffer::Wrap(msg->payload, msg->payloadlen);
+
+    std::lock_guard<std::recursive_mutex> auto_lock(callback_lock);
+    std::vector<SubscribeData *> matched;
+    subscribers.Match(msg->topic,
+          [&matched](SubscribeData *const &data) { matched.push_back(data); });
+    std::sort(matched.begin(), matched.end(),
+          [](const SubscribeData *a, const SubscribeData *b) { return a->order < b->order; });
+
+    // The header is parsed once, at the first subscriber, and shared by all of them.
     AittMsg mq_msg;
-    mq_msg.SetTopic(msg->topic);
-    if (props) {
-        const mosquitto_property *prop;
-
-        char *response_topic = nullptr;
-        prop = mosquitto_property_read_string(props, MQTT_PROP_RESPONSE_TOPIC, &response_topic,
-              false);
-        if (prop) {
-            mq_msg.SetResponseTopic(response_topic);
-            free(response_topic);
+    bool parsed = false;
+
+    // Subscriptions added by the callbacks don't get this message.
+    // Removed ones are deleted after the iteration.
+    subscribers_iterating = true;
+    for (auto subscribe_data : matched) {
+        if (subscribe_data->unsubscribed)
+            continue;
+        if (parsed == false) {
+            ParseMessage(msg, props, payload, mq_msg);
+            parsed = true;
         }
+        InvokeCallback(subscribe_data, mq_msg);
+    }
+    subscribers_iterating = false;
+
+    for (auto subscribe_data : removed_subscribers)
+        delete subscribe_data;
+    removed_subscribers.clear();
+}
+
+void MosquittoMQ::ParseMessage(const mosquitto_message *msg, const mosquitto_property *props,
+      const AittMsgBuffer &payload, AittMsg &mq_msg)
+{
+    mq_msg.SetTopic(msg->topic);
+    mq_msg.SetPayload(payload);
+    if (props == nullptr)
+        return;
 
-        void *correlation = nullptr;
-        uint16_t correlation_size = 0;
-        prop = mosquitto_property_read_binary(props, MQTT_PROP_CORRELATION_DATA, &correlation,
-              &correlation_size, false);
-        if (prop == nullptr || correlation == nullptr)
-            ERR("No Correlation Data");
+    const mosquitto_property *prop;
+
+    char *response_topic = nullptr;
+    prop = mosquitto_property_read_string(props, MQTT_PROP_RESPONSE_TOPIC, &response_topic,
+          false);
+    if (prop) {
+        mq_msg.SetResponseTopic(response_topic);
+        free(response_topic);
+    }
 
+    void *correlation = nullptr;
+    uint16_t correlation_size = 0;
+    prop = mosquitto_property_read_binary(props, MQTT_PROP_CORRELATION_DATA, &correlation,
+          &correlation_size, false);
+    if (prop && correlation) {
         mq_msg.SetCorrelation(std::string((char *)correlation, correlation_size));
-        if (correlation)
-            free(correlation);
-
-        char *name = nullptr;
-        char *value = nullptr;
-        prop = mosquitto_property_read_string_pair(props, MQTT_PROP_USER_PROPERTY, &name, &value,
-              false);
-        while (prop) {
-            if (REPLY_SEQUENCE_NUM_KEY == name) {
-                mq_msg.SetSequence(std::stoi(value));
-            } else if (REPLY_IS_END_SEQUENCE_KEY == name) {
-                mq_msg.SetEndSequence(std::stoi(value) == 1);
-            } else {
-                ERR("Unsupported property(%s, %s)", name, value);
-            }
-            free(name);
-            free(value);
+        free(correlation);
+    }
 
-            prop = mosquitto_property_read_string_pair(prop, MQTT_PROP_USER_PROPERTY, &name, &value,
-                  true);
+    char *name = nullptr;
+    char *value = nullptr;
+    prop = mosquitto_property_read_string_pair(props, MQTT_PROP_USER_PROPERTY, &name, &value,
+          false);
+    while (prop) {
+        if (REPLY_SEQUENCE_NUM_KEY == name) {
+            mq_msg.SetSequence(strtol(value, nullptr, 10));
+        } else if (REPLY_IS_END_SEQUENCE_KEY == name) {
+            mq_msg.SetEndSequence(strtol(value, nullptr, 10) == 1);
+        } else {
+            ERR("Unsupported property(%s, %s)", name, value);
         }
+        free(name);
+        free(value);
+
+        prop = mosquitto_property_read_string_pair(prop, MQTT_PROP_USER_PROPERTY, &name, &value,
+              true);
     }
+}
+
+void MosquittoMQ::InvokeCallback(SubscribeData *subscriber, const AittMsg &mq_msg)
+{
+    RET_IF(nullptr == subscriber);
 
-    subscriber->cb(&mq_msg, msg->payload, msg->payloadlen, subscriber->user_data);
+    // Each subscriber gets its own view sharing the parsed header.
+    AittMsg sub_msg = mq_msg;
+    const AittMsgBuffer &payload = sub_msg.GetPayload();
+    subscriber->cb(&sub_msg, payload.GetData(), payload.GetSize(), subscriber->user_data);
 }
 
 void MosquittoMQ::Publish(const std::string &topic, const void *data, const int datalen, int qos,
       bool retain)
 {
+    PublishMessage(topic.c_str(), data, datalen, qos, retain, nullptr, nullptr);
+}
+
+void MosquittoMQ::PublishAsync(const std::string &topic, const void *data, const int datalen,
+      int qos, bool retain, const PublishCallback &cb)
+{
+    PublishMessage(topic.c_str(), data, datalen, qos, retain, nullptr, cb);
+}
+
+// libmosquitto queues a message at a time, so the batch saves the checks of the callers only.
+void MosquittoMQ::PublishBatch(const AittBatchMessage *messages, int count, int qos, bool retain)
+{
+    for (int i = 0; i < count; i++) {
+        PublishMessage(messages[i].topic, messages[i].data, messages[i].datalen, qos, retain,
+              nullptr, nullptr);
+    }
+}
+
+// With props, it's published with the MQTT 5 properties, which are freed in any case.
+void MosquittoMQ::PublishMessage(const char *topic, const void *data, const int datalen, int qos,
+      bool retain, mosquitto_property **props, const PublishCallback &cb)
+{
+    bool tracked;
+    try {
+        tracked = ReserveInflight(cb != nullptr);
+    } catch (...) {
+        if (props)
+            mosquitto_property_free_all(props);
+        throw;
+    }
+
     int mid = -1;
-    int ret = mosquitto_publish(handle, &mid, topic.c_str(), datalen, data, qos, retain);
+    int ret;
+    if (props) {
+        ret = mosquitto_publish_v5(handle, &mid, topic, datalen, data, qos, retain, *props);
+        mosquitto_property_free_all(props);
+    } else {
+        ret = mosquitto_publish(handle, &mid, topic, datalen, data, qos, retain);
+    }
     if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_publish(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
+        if (tracked)
+            CancelInflight();
+        ERR("mosquitto_publish(%s) Fail(%s)", topic, mosquitto_strerror(ret));
         throw AittException(AittException::MQTT_ERR);
     }
+    if (tracked)
+        TrackInflight(mid, qos, cb);
 }
 
 void MosquittoMQ::PublishWithReply(const std::string &topic, const void *data, const int datalen,
       int qos, bool retain, const std::string &reply_topic, const std::string &correlation)
 {
     int ret;
-    int mid = -1;
     mosquitto_property *props = nullptr;
 
     ret = mosquitto_property_add_string(&props, MQTT_PROP_RESPONSE_TOPIC, reply_topic.c_str());
@@ -286,14 +504,11 @@ void MosquittoMQ::PublishWithReply(const std::string &topic, const void *data, c
           correlation.size());
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_property_add_binary(correlation) Fail(%s)", mosquitto_strerror(ret));
+        mosquitto_property_free_all(&props);
         throw AittException(AittException::MQTT_ERR);
     }
-    ret = mosquitto_publish_v5(handle, &mid, topic.c_str(), datalen, data, qos, retain, props);
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_publish_v5(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
-        throw AittException(AittException::MQTT_ERR);
-    }
-    mosquitto_property_free_all(&props);
+
+    PublishMessage(topic.c_str(), data, datalen, qos, retain, &props, nullptr);
 }
 
 void MosquittoMQ::SendReply(AittMsg *msg, const void *data, const int datalen, int qos, bool retain)
@@ -301,7 +516,6 @@ void MosquittoMQ::SendReply(AittMsg *msg, const void *data, const int datalen, i
     RET_IF(msg == nullptr);
 
     int ret;
-    int mId = -1;
     mosquitto_property *props = nullptr;
 
     ret = mosquitto_property_add_binary(&props, MQTT_PROP_CORRELATION_DATA,
@@ -315,6 +529,7 @@ void MosquittoMQ::SendReply(AittMsg *msg, const void *data, const int datalen, i
           REPLY_SEQUENCE_NUM_KEY.c_str(), std::to_string(msg->GetSequence()).c_str());
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_property_add_string_pair(squenceNum) Fail(%s)", mosquitto_strerror(ret));
+        mosquitto_property_free_all(&props);
         throw AittException(AittException::MQTT_ERR);
     }
 
@@ -322,35 +537,27 @@ void MosquittoMQ::SendReply(AittMsg *msg, const void *data, const int datalen, i
           REPLY_IS_END_SEQUENCE_KEY.c_str(), std::to_string(msg->IsEndSequence()).c_str());
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_property_add_string_pair(IsEndSequence) Fail(%s)", mosquitto_strerror(ret));
+        mosquitto_property_free_all(&props);
         throw AittException(AittException::MQTT_ERR);
     }
 
-    ret = mosquitto_publish_v5(handle, &mId, msg->GetResponseTopic().c_str(), datalen, data, qos,
-          retain, props);
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_publish_v5(%s) Fail(%s)", msg->GetResponseTopic().c_str(),
-              mosquitto_strerror(ret));
-        throw AittException(AittException::MQTT_ERR);
-    }
-    mosquitto_property_free_all(&props);
+    PublishMessage(msg->GetResponseTopic().c_str(), data, datalen, qos, retain, &props, nullptr);
 }
 
 void *MosquittoMQ::Subscribe(const std::string &topic, const SubscribeCallback &cb, void *user_data,
       int qos)
 {
     int mid = -1;
-    int ret = mosquitto_subscribe(handle, &mid, topic.c_str(), qos);
+    int ret = mosquitto_subscribe_v5(handle, &mid, topic.c_str(), qos, subscribe_options, nullptr);
     if (ret != MOSQ_ERR_SUCCESS) {
         ERR("mosquitto_subscribe(%s) Fail(%s)", topic.c_str(), mosquitto_strerror(ret));
         throw AittException(AittException::MQTT_ERR);
     }
 
     std::lock_guard<std::recursive_mutex> lock_from_here(callback_lock);
-    SubscribeData *data = new SubscribeData(topic, cb, user_data);
-    if (subscribers_iterating)
-        new_subscribers.push_back(data);
-    else
-        subscribers.push_back(data);
+    SubscribeData *data = new SubscribeData(topic, cb, user_data, subscribe_order++);
+    subscribers.Insert(topic, data);
+    subscribe_handles.insert(data);
 
     return static_cast<void *>(data);
 }
@@ -360,26 +567,23 @@ void *MosquittoMQ::Unsubscribe(void *sub_handle)
     RETV_IF(nullptr == sub_handle, nullptr);
 
     std::lock_guard<std::recursive_mutex> auto_lock(callback_lock);
-    auto it = std::find(subscribers.begin(), subscribers.end(),
-          static_cast<SubscribeData *>(sub_handle));
-
-    if (it == subscribers.end()) {
+    SubscribeData *data = static_cast<SubscribeData *>(sub_handle);
+    auto it = subscribe_handles.find(data);
+    if (it == subscribe_handles.end()) {
         ERR("No Subscription(%p)", sub_handle);
         throw AittException(AittException::NO_DATA_ERR);
     }
-
-    SubscribeData *data = static_cast<SubscribeData *>(sub_handle);
-
-    if (subscriber_iterator == it) {
-        subscriber_iterator = subscribers.erase(it);
-        subscriber_iterator_updated = true;
-    } else {
-        subscribers.erase(it);
-    }
+    subscribe_handles.erase(it);
+    subscribers.Remove(data->topic, data);
 
     void *user_data = data->user_data;
     std::string topic = data->topic;
-    delete data;
+    if (subscribers_iterating) {
+        data->unsubscribed = true;
+        removed_subscribers.push_back(data);
+    } else {
+        delete data;
+    }
 
     int mid = -1;
     int ret = mosquitto_unsubscribe(handle, &mid, topic.c_str());
@@ -393,19 +597,12 @@ void *MosquittoMQ::Unsubscribe(void *sub_handle)
 
 bool MosquittoMQ::CompareTopic(const std::string &left, const std::string &right)
 {
-    bool result = false;
-    int ret = mosquitto_topic_matches_sub(left.c_str(), right.c_str(), &result);
-    if (ret != MOSQ_ERR_SUCCESS) {
-        ERR("mosquitto_topic_matches_sub(%s, %s) Fail(%s)", left.c_str(), right.c_str(),
-              mosquitto_strerror(ret));
-        return false;
-    }
-    return result;
+    return TopicFilter::Matches(left, right);
 }
 
 MosquittoMQ::SubscribeData::SubscribeData(const std::string &in_topic,
-      const SubscribeCallback &in_cb, void *in_user_data)
-      : topic(in_topic), cb(in_cb), user_data(in_user_data)
+      const SubscribeCallback &in_cb, void *in_user_data, uint64_t in_order)
+      : topic(in_topic), cb(in_cb), user_data(in_user_data), order(in_order), unsubscribed(false)
 {
 }
 
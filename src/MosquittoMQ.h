@@ -17,13 +17,18 @@
 
 #include <mosquitto.h>
 
+#include <condition_variable>
+#include <cstdint>
 #include <functional>
 #include <mutex>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "AittMsg.h"
 #include "MQ.h"
+#include "TopicTrie.h"
 
 #define MQTT_LOCALHOST "127.0.0.1"
 #define MQTT_PORT 1883
@@ -32,7 +37,11 @@ namespace aitt {
 
 class MosquittoMQ : public MQ {
   public:
-    explicit MosquittoMQ(const std::string &id, bool clean_session = false);
+    // With no_local, the broker doesn't send back messages published by itself.
+    // Publishers wait for room, or fail without inflight_block, when max_inflight messages are
+    // waiting for their completions. 0 is unlimited.
+    explicit MosquittoMQ(const std::string &id, bool clean_session = false,
+          bool no_local = false, int max_inflight = 0, bool inflight_block = true);
     virtual ~MosquittoMQ(void);
 
     void SetConnectionCallback(const MQConnectionCallback &cb);
@@ -42,6 +51,10 @@ class MosquittoMQ : public MQ {
     void Disconnect(void);
     void Publish(const std::string &topic, const void *data, const int datalen, int qos = 0,
           bool retain = false);
+    void PublishAsync(const std::string &topic, const void *data, const int datalen, int qos,
+          bool retain, const PublishCallback &cb);
+    void PublishBatch(const AittBatchMessage *messages, int count, int qos = 0,
+          bool retain = false);
     void PublishWithReply(const std::string &topic, const void *data, const int datalen, int qos,
           bool retain, const std::string &reply_topic, const std::string &correlation);
     void SendReply(AittMsg *msg, const void *data, const int datalen, int qos, bool retain);
@@ -49,37 +62,71 @@ class MosquittoMQ : public MQ {
           void *user_data = nullptr, int qos = 0);
     void *Unsubscribe(void *handle);
     bool CompareTopic(const std::string &left, const std::string &right);
+    AittPublishStats GetPublishStats(void);
 
   private:
     struct SubscribeData {
-        SubscribeData(const std::string &topic, const SubscribeCallback &cb, void *user_data);
+        SubscribeData(const std::string &topic, const SubscribeCallback &cb, void *user_data,
+              uint64_t order);
         std::string topic;
         SubscribeCallback cb;
         void *user_data;
+        uint64_t order;  // callbacks of a message are invoked in the order of subscription
+        bool unsubscribed;
+    };
+
+    struct InflightData {
+        PublishCallback cb;
+        int qos;
     };
 
     static void ConnectCallback(struct mosquitto *mosq, void *obj, int rc, int flag,
           const mosquitto_property *props);
     static void DisconnectCallback(struct mosquitto *mosq, void *obj, int rc,
           const mosquitto_property *props);
+    static void PublishedCallback(struct mosquitto *mosq, void *obj, int mid, int reason_code,
+          const mosquitto_property *props);
+    void PublishMessage(const char *topic, const void *data, const int datalen, int qos,
+          bool retain, mosquitto_property **props, const PublishCallback &cb);
+    bool ReserveInflight(bool has_cb);
+    void CancelInflight(void);
+    void EndReserving(void);
+    void TrackInflight(int mid, int qos, const PublishCallback &cb);
+    void CompleteInflight(int mid, int result);
+    void FailInflightQoS0(void);
     static void MessageCallback(mosquitto *, void *, const mosquitto_message *,
           const mosquitto_property *);
     void MessageCB(const mosquitto_message *msg, const mosquitto_property *props);
-    void InvokeCallback(SubscribeData *subscriber, const mosquitto_message *msg,
-          const mosquitto_property *props);
+    void ParseMessage(const mosquitto_message *msg, const mosquitto_property *props,
+          const AittMsgBuffer &payload, AittMsg &mq_msg);
+    void InvokeCallback(SubscribeData *subscriber, const AittMsg &mq_msg);
 
     static const std::string REPLY_SEQUENCE_NUM_KEY;
     static const std::string REPLY_IS_END_SEQUENCE_KEY;
 
     mosquitto *handle;
     const int keep_alive;
-    std::vector<SubscribeData *> subscribers;
+    const int subscribe_options;
+    TopicTrie<SubscribeData *> subscribers;
+    std::set<SubscribeData *> subscribe_handles;
+    uint64_t subscribe_order;
     bool subscribers_iterating;
-    std::vector<SubscribeData *> new_subscribers;
-    std::vector<SubscribeData *>::iterator subscriber_iterator;
-    bool subscriber_iterator_updated;
+    std::vector<SubscribeData *> removed_subscribers;
     std::recursive_mutex callback_lock;
     MQConnectionCallback connect_cb;
+
+    // Messages published and not completed yet. A completion may come before its message is
+    // tracked, then it's kept in early_completions until the publisher tracks the message.
+    // Without max_inflight, only the messages with a callback are tracked.
+    std::unordered_map<int /* mid */, InflightData> inflight;
+    std::unordered_map<int /* mid */, int /* result */> early_completions;
+    const int max_inflight;
+    const bool inflight_block;
+    int reserving;  // publishers between ReserveInflight() and TrackInflight()
+    AittPublishStats publish_stats;
+    std::mutex inflight_lock;
+    std::condition_variable inflight_cond;
+    static thread_local bool on_loop_thread;
 };
 
 }  // namespace aitt
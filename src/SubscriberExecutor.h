@@ -0,0 +1,224 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <pthread.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define AITT_EXECUTOR_BATCH 32
+
+namespace aitt {
+
+// Runs subscription callbacks on a pool of worker threads.
+// Items of a Strand (one per subscription) are handled one by one in FIFO order,
+// while different strands run in parallel. A strand is in at most one ready queue at a time,
+// so a worker with an empty ready queue can steal strands from the others
+// without breaking the order.
+template <typename T>
+class SubscriberExecutor {
+  public:
+    using Handler = std::function<void(T &item)>;
+
+    class Strand {
+      public:
+        explicit Strand(size_t home) : home_(home), scheduled_(false) {}
+
+      private:
+        friend class SubscriberExecutor;
+
+        const size_t home_;
+        std::mutex lock_;
+        std::deque<T> items_;
+        bool scheduled_;
+    };
+
+    SubscriberExecutor(int num_threads, bool work_stealing, const Handler &handler)
+          : handler_(handler), work_stealing_(work_stealing), stop_(false), next_home_(0),
+            next_poke_(0)
+    {
+        if (num_threads < 1)
+            num_threads = 1;
+
+        for (int i = 0; i < num_threads; i++)
+            workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+        for (int i = 0; i < num_threads; i++)
+            workers_[i]->thread = std::thread(&SubscriberExecutor::WorkerMain, this, i);
+    }
+
+    ~SubscriberExecutor(void) { Stop(); }
+
+    // Items posted after it are dropped.
+    void Stop(void)
+    {
+        if (stop_.exchange(true))
+            return;
+
+        for (auto &worker : workers_) {
+            std::lock_guard<std::mutex> lock(worker->lock);
+            worker->cond.notify_one();
+        }
+        for (auto &worker : workers_) {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+    }
+
+    std::shared_ptr<Strand> NewStrand(void)
+    {
+        return std::make_shared<Strand>(next_home_++ % workers_.size());
+    }
+
+    void Post(const std::shared_ptr<Strand> &strand, T &&item)
+    {
+        if (stop_.load())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(strand->lock_);
+            strand->items_.push_back(std::move(item));
+            if (strand->scheduled_)
+                return;
+            strand->scheduled_ = true;
+        }
+        Schedule(strand, strand->home_);
+    }
+
+    size_t GetThreadCount(void) const { return workers_.size(); }
+
+  private:
+    struct Worker {
+        Worker() : busy(false), poked(false) {}
+
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<std::shared_ptr<Strand>> ready;
+        bool busy;
+        bool poked;
+        std::thread thread;
+    };
+
+    void Schedule(const std::shared_ptr<Strand> &strand, size_t idx)
+    {
+        bool busy;
+        {
+            std::lock_guard<std::mutex> lock(workers_[idx]->lock);
+            workers_[idx]->ready.push_back(strand);
+            busy = workers_[idx]->busy;
+            workers_[idx]->cond.notify_one();
+        }
+
+        // The owner is running another strand. Let an idle worker steal it.
+        if (work_stealing_ && busy && workers_.size() > 1) {
+            size_t thief = (idx + 1 + next_poke_++ % (workers_.size() - 1)) % workers_.size();
+            std::lock_guard<std::mutex> lock(workers_[thief]->lock);
+            workers_[thief]->poked = true;
+            workers_[thief]->cond.notify_one();
+        }
+    }
+
+    std::shared_ptr<Strand> PopReady(size_t idx)
+    {
+        std::lock_guard<std::mutex> lock(workers_[idx]->lock);
+        if (workers_[idx]->ready.empty())
+            return nullptr;
+
+        std::shared_ptr<Strand> strand = std::move(workers_[idx]->ready.front());
+        workers_[idx]->ready.pop_front();
+        return strand;
+    }
+
+    std::shared_ptr<Strand> Steal(size_t idx)
+    {
+        for (size_t i = 1; i < workers_.size(); i++) {
+            Worker &victim = *workers_[(idx + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.lock);
+            if (victim.ready.empty())
+                continue;
+
+            std::shared_ptr<Strand> strand = std::move(victim.ready.back());
+            victim.ready.pop_back();
+            return strand;
+        }
+        return nullptr;
+    }
+
+    void SetBusy(size_t idx, bool busy)
+    {
+        std::lock_guard<std::mutex> lock(workers_[idx]->lock);
+        workers_[idx]->busy = busy;
+    }
+
+    // It returns after handling AITT_EXECUTOR_BATCH items to be fair to the other strands.
+    void RunStrand(const std::shared_ptr<Strand> &strand, size_t idx)
+    {
+        for (int i = 0; i < AITT_EXECUTOR_BATCH; i++) {
+            T item;
+            {
+                std::lock_guard<std::mutex> lock(strand->lock_);
+                if (strand->items_.empty()) {
+                    strand->scheduled_ = false;
+                    return;
+                }
+                item = std::move(strand->items_.front());
+                strand->items_.pop_front();
+            }
+            handler_(item);
+        }
+        Schedule(strand, idx);
+    }
+
+    void WorkerMain(size_t idx)
+    {
+        pthread_setname_np(pthread_self(), "AITTSubscriber");
+        Worker &self = *workers_[idx];
+
+        while (stop_.load() == false) {
+            std::shared_ptr<Strand> strand = PopReady(idx);
+            if (strand == nullptr && work_stealing_)
+                strand = Steal(idx);
+
+            if (strand) {
+                SetBusy(idx, true);
+                RunStrand(strand, idx);
+                SetBusy(idx, false);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(self.lock);
+            self.cond.wait(lock,
+                  [&] { return stop_.load() || self.ready.empty() == false || self.poked; });
+            self.poked = false;
+        }
+    }
+
+    Handler handler_;
+    const bool work_stealing_;
+    std::atomic_bool stop_;
+    std::atomic<size_t> next_home_;
+    std::atomic<size_t> next_poke_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+}  // namespace aitt
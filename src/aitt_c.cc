@@ -18,6 +18,8 @@
 #include <arpa/inet.h>
 #include <stdlib.h>
 
+#include <string>
+
 #include "AITT.h"
 #include "aitt_internal.h"
 
@@ -34,6 +36,7 @@ struct aitt_option {
     aitt_option() : my_ip(nullptr) {}
     const char *my_ip;
     AittOption option;
+    std::string number;  // an integer option returned as a string
 };
 
 API aitt_h aitt_new(const char *id, aitt_option_h option)
@@ -113,6 +116,22 @@ static int _to_boolean(const char *value, bool &dest)
     return AITT_ERROR_NONE;
 }
 
+static const char *const send_overflow_names[] = {"block", "drop_oldest", "drop_newest"};
+
+static int _to_send_overflow(const char *value, AittSendOverflow &dest)
+{
+    RETV_IF(value == nullptr, AITT_ERROR_INVALID_PARAMETER);
+
+    for (int i = AITT_SEND_OVERFLOW_BLOCK; i <= AITT_SEND_OVERFLOW_DROP_NEWEST; i++) {
+        if (STR_EQ == strcasecmp(value, send_overflow_names[i])) {
+            dest = static_cast<AittSendOverflow>(i);
+            return AITT_ERROR_NONE;
+        }
+    }
+    ERR("Unknown value(%s)", value);
+    return AITT_ERROR_INVALID_PARAMETER;
+}
+
 API int aitt_option_set(aitt_option_h handle, aitt_option_e option, const char *value)
 {
     RETV_IF(handle == nullptr, AITT_ERROR_INVALID_PARAMETER);
@@ -148,6 +167,54 @@ API int aitt_option_set(aitt_option_h handle, aitt_option_e option, const char *
     case AITT_OPT_CUSTOM_RW_FILE:
         return handle->option.SetCustomRWFile(value);
 
+    case AITT_OPT_WORKER_THREADS:
+        RETV_IF(value == nullptr, AITT_ERROR_INVALID_PARAMETER);
+        return handle->option.SetWorkerThreads(atoi(value));
+
+    case AITT_OPT_WORK_STEALING:
+        ret = _to_boolean(value, bool_val);
+        if (ret == AITT_ERROR_NONE)
+            handle->option.SetWorkStealing(bool_val);
+        return ret;
+
+    case AITT_OPT_SEND_QUEUE_SIZE:
+        RETV_IF(value == nullptr, AITT_ERROR_INVALID_PARAMETER);
+        return handle->option.SetSendQueueSize(atoi(value));
+
+    case AITT_OPT_SEND_OVERFLOW: {
+        AittSendOverflow policy = AITT_SEND_OVERFLOW_BLOCK;
+        ret = _to_send_overflow(value, policy);
+        if (ret == AITT_ERROR_NONE)
+            ret = handle->option.SetSendOverflowPolicy(policy);
+        return ret;
+    }
+
+    case AITT_OPT_LOCAL_DELIVERY:
+        ret = _to_boolean(value, bool_val);
+        if (ret == AITT_ERROR_NONE)
+            handle->option.SetLocalDelivery(bool_val);
+        return ret;
+
+    case AITT_OPT_MAX_INFLIGHT:
+        RETV_IF(value == nullptr, AITT_ERROR_INVALID_PARAMETER);
+        return handle->option.SetMaxInflight(atoi(value));
+
+    case AITT_OPT_STREAM_CHUNKS:
+        ret = _to_boolean(value, bool_val);
+        if (ret == AITT_ERROR_NONE)
+            handle->option.SetStreamChunks(bool_val);
+        return ret;
+
+    case AITT_OPT_RECEIVE_THREADS:
+        RETV_IF(value == nullptr, AITT_ERROR_INVALID_PARAMETER);
+        return handle->option.SetReceiveThreads(atoi(value));
+
+    case AITT_OPT_INFLIGHT_BLOCKING:
+        ret = _to_boolean(value, bool_val);
+        if (ret == AITT_ERROR_NONE)
+            handle->option.SetInflightBlocking(bool_val);
+        return ret;
+
     default:
         ERR("Unknown option(%d)", option);
         return AITT_ERROR_INVALID_PARAMETER;
@@ -175,6 +242,28 @@ API const char *aitt_option_get(aitt_option_h handle, aitt_option_e option)
         return handle->option.GetRootCA();
     case AITT_OPT_CUSTOM_RW_FILE:
         return handle->option.GetCustomRWFile();
+    case AITT_OPT_WORKER_THREADS:
+        handle->number = std::to_string(handle->option.GetWorkerThreads());
+        return handle->number.c_str();
+    case AITT_OPT_WORK_STEALING:
+        return (handle->option.GetWorkStealing()) ? "true" : "false";
+    case AITT_OPT_SEND_QUEUE_SIZE:
+        handle->number = std::to_string(handle->option.GetSendQueueSize());
+        return handle->number.c_str();
+    case AITT_OPT_SEND_OVERFLOW:
+        return send_overflow_names[handle->option.GetSendOverflowPolicy()];
+    case AITT_OPT_LOCAL_DELIVERY:
+        return (handle->option.GetLocalDelivery()) ? "true" : "false";
+    case AITT_OPT_MAX_INFLIGHT:
+        handle->number = std::to_string(handle->option.GetMaxInflight());
+        return handle->number.c_str();
+    case AITT_OPT_STREAM_CHUNKS:
+        return (handle->option.GetStreamChunks()) ? "true" : "false";
+    case AITT_OPT_RECEIVE_THREADS:
+        handle->number = std::to_string(handle->option.GetReceiveThreads());
+        return handle->number.c_str();
+    case AITT_OPT_INFLIGHT_BLOCKING:
+        return (handle->option.GetInflightBlocking()) ? "true" : "false";
     default:
         ERR("Unknown option(%d)", option);
     }
@@ -294,6 +383,25 @@ API int aitt_publish_full(aitt_h handle, const char *topic, const void *msg, con
     return AITT_ERROR_NONE;
 }
 
+API int aitt_publish_batch(aitt_h handle, const aitt_batch_msg_s *msgs, int count, int protocols,
+      aitt_qos_e qos)
+{
+    RETV_IF(handle == nullptr, AITT_ERROR_INVALID_PARAMETER);
+    RETV_IF(handle->aitt == nullptr, AITT_ERROR_INVALID_PARAMETER);
+    RETV_IF(handle->connected == false, AITT_ERROR_NOT_READY);
+    RETV_IF(msgs == nullptr, AITT_ERROR_INVALID_PARAMETER);
+    RETV_IF(count <= 0, AITT_ERROR_INVALID_PARAMETER);
+
+    try {
+        handle->aitt->PublishBatch(msgs, count, static_cast<AittProtocol>(protocols), qos);
+    } catch (std::exception &e) {
+        ERR("PublishBatch(count:%d) Fail(%s)", count, e.what());
+        return AITT_ERROR_SYSTEM;
+    }
+
+    return AITT_ERROR_NONE;
+}
+
 API int aitt_publish_with_reply(aitt_h handle, const char *topic, const void *msg,
       const int msg_len, aitt_protocol_e protocols, aitt_qos_e qos, const char *correlation,
       aitt_sub_fn cb, void *user_data)
@@ -374,6 +482,21 @@ API int aitt_unsubscribe(aitt_h handle, aitt_sub_h sub_handle)
     return AITT_ERROR_NONE;
 }
 
+API int aitt_set_remote_policy(aitt_h handle, const char *topic, aitt_remote_policy_e policy)
+{
+    RETV_IF(handle == nullptr, AITT_ERROR_INVALID_PARAMETER);
+    RETV_IF(handle->aitt == nullptr, AITT_ERROR_INVALID_PARAMETER);
+    RETV_IF(topic == nullptr, AITT_ERROR_INVALID_PARAMETER);
+
+    try {
+        handle->aitt->SetRemotePolicy(topic, policy);
+    } catch (std::exception &e) {
+        ERR("SetRemotePolicy(%s, %d) Fail(%s)", topic, policy, e.what());
+        return AITT_ERROR_INVALID_PARAMETER;
+    }
+    return AITT_ERROR_NONE;
+}
+
 API const char *aitt_msg_get_topic(aitt_msg_h handle)
 {
     RETV_IF(handle == nullptr, nullptr);
@@ -0,0 +1,391 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "AITT.h"
+#include "AittTests.h"
+#include "aitt_internal.h"
+
+// Over the inline size of UDS(64 KB), but inline in the ring of SHM
+#define TEST_HOST_MEDIUM_SIZE (100 * 1024)
+// Over the inline size of SHM(1 MB)
+#define TEST_HOST_BIG_SIZE (2 * 1024 * 1024)
+// Over the ring of SHM(16 MB)
+#define TEST_HOST_HUGE_SIZE (20 * 1024 * 1024)
+
+using AITT = aitt::AITT;
+
+// Transports to the peers on the same host(SHM and UDS)
+class AittHostTest : public testing::Test, public AittTests {
+  protected:
+    void SetUp() override { Init(); }
+    void TearDown() override { Deinit(); }
+
+    void WaitReady(void)
+    {
+        auto timeout = mainLoop->AddTimeout(
+              CHECK_INTERVAL,
+              [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+                  return ReadyCheck(static_cast<AittTests *>(this));
+              },
+              nullptr);
+        IterateEventLoop();
+        mainLoop->RemoveTimeout(timeout);
+    }
+
+    void PublishSubscribeTemplate(AittProtocol protocol)
+    {
+        try {
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            std::atomic<int> cnt(0);
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) -> void {
+                      AittHostTest *test = static_cast<AittHostTest *>(cbdata);
+                      std::string receivedMsg(static_cast<const char *>(msg), szmsg);
+                      EXPECT_EQ(handle->GetTopic(), testTopic);
+                      if (++cnt == 1) {
+                          EXPECT_STREQ(receivedMsg.c_str(), TEST_MSG);
+                      } else {
+                          EXPECT_EQ(szmsg, 0);
+                          test->ToggleReady();
+                      }
+                  },
+                  static_cast<void *>(this), protocol);
+
+            // Wait a few seconds until the AITT client gets a server list (discover devices)
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            publisher.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG), protocol);
+            publisher.Publish(testTopic, nullptr, 0, protocol);
+            WaitReady();
+
+            ASSERT_TRUE(ready);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void WildcardsTopicTemplate(AittProtocol protocol, bool single_level)
+    {
+        try {
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            std::string sub_topic = testTopic + (single_level ? "/+" : "/#");
+            std::atomic<int> cnt(0);
+            subscriber.Subscribe(
+                  sub_topic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) -> void {
+                      AittHostTest *test = static_cast<AittHostTest *>(cbdata);
+                      INFO("Got Message(Topic:%s, size:%d)", handle->GetTopic().c_str(), szmsg);
+                      if (++cnt == 3)
+                          test->ToggleReady();
+                  },
+                  static_cast<void *>(this), protocol);
+
+            while (publisher.CountSubscriber(testTopic + "/value1", protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            publisher.Publish(testTopic + "/value1", TEST_MSG, sizeof(TEST_MSG), protocol);
+            if (single_level) {
+                publisher.Publish(testTopic + "/value2", TEST_MSG, sizeof(TEST_MSG), protocol);
+                publisher.Publish(testTopic + "/value3", TEST_MSG, sizeof(TEST_MSG), protocol);
+            } else {
+                publisher.Publish(testTopic + "/step1/value1", TEST_MSG, sizeof(TEST_MSG),
+                      protocol);
+                publisher.Publish(testTopic + "/step2/value1", TEST_MSG, sizeof(TEST_MSG),
+                      protocol);
+            }
+            WaitReady();
+
+            ASSERT_TRUE(ready);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void SubscribeSameTopicTwiceTemplate(AittProtocol protocol)
+    {
+        try {
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) -> void {
+                      AittHostTest *test = static_cast<AittHostTest *>(cbdata);
+                      test->ToggleReady();
+                  },
+                  static_cast<void *>(this), protocol);
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) -> void {
+                      AittHostTest *test = static_cast<AittHostTest *>(cbdata);
+                      test->ToggleReady2();
+                  },
+                  static_cast<void *>(this), protocol);
+
+            // A message goes once to the peer, which calls both callbacks.
+            while (publisher.CountSubscriber(testTopic, protocol) != 2) {
+                usleep(SLEEP_10MS);
+            }
+
+            publisher.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG), protocol);
+
+            auto timeout = mainLoop->AddTimeout(
+                  CHECK_INTERVAL,
+                  [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+                        -> int { return ReadyAllCheck(static_cast<AittTests *>(this)); },
+                  nullptr);
+            IterateEventLoop();
+            mainLoop->RemoveTimeout(timeout);
+
+            ASSERT_TRUE(ready);
+            ASSERT_TRUE(ready2);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void RequestResponseTemplate(AittProtocol protocol)
+    {
+        const std::string correlation = "correlation";
+        const std::string reply = "reply message";
+
+        try {
+            AITT requester(clientId + ".req", LOCAL_IP, AittOption(true, false));
+            AITT responder(clientId + ".res", LOCAL_IP, AittOption(true, false));
+            requester.Connect();
+            responder.Connect();
+
+            responder.Subscribe(
+                  testTopic,
+                  [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                      EXPECT_EQ(msg->GetCorrelation(), correlation);
+                      EXPECT_FALSE(msg->GetResponseTopic().empty());
+                      responder.SendReply(msg, reply.c_str(), reply.size());
+                  },
+                  nullptr, protocol);
+
+            while (requester.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            bool reply_ok = false;
+            int ret = requester.PublishWithReplySync(testTopic, TEST_MSG, sizeof(TEST_MSG),
+                  protocol, AITT_QOS_AT_MOST_ONCE, false,
+                  [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                      EXPECT_EQ(msg->GetCorrelation(), correlation);
+                      EXPECT_EQ(std::string(static_cast<const char *>(data), datalen), reply);
+                      EXPECT_TRUE(msg->IsEndSequence());
+                      reply_ok = true;
+                  },
+                  nullptr, correlation, 1000);
+
+            EXPECT_EQ(ret, 0);
+            EXPECT_TRUE(reply_ok);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    // Payloads go by the ring or the socket inline, or by a blob over the limits.
+    void PublishLargeTemplate(AittProtocol protocol)
+    {
+        std::independent_bits_engine<std::default_random_engine, CHAR_BIT, unsigned char>
+              random_engine;
+        std::vector<unsigned char> data(TEST_HOST_HUGE_SIZE);
+        std::generate(data.begin(), data.end(), std::ref(random_engine));
+        const std::vector<int> sizes = {TEST_HOST_MEDIUM_SIZE, TEST_HOST_BIG_SIZE,
+              TEST_HOST_HUGE_SIZE};
+
+        try {
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            std::atomic<size_t> cnt(0);
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) -> void {
+                      AittHostTest *test = static_cast<AittHostTest *>(cbdata);
+                      size_t i = cnt++;
+                      ASSERT_LT(i, sizes.size());
+                      ASSERT_EQ(szmsg, sizes[i]);
+                      EXPECT_EQ(memcmp(msg, data.data(), szmsg), 0);
+                      if (i + 1 == sizes.size())
+                          test->ToggleReady();
+                  },
+                  static_cast<void *>(this), protocol);
+
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            for (int size : sizes) {
+                DBG("Publish(%s) : size(%d)", testTopic.c_str(), size);
+                publisher.Publish(testTopic, data.data(), size, protocol);
+            }
+            WaitReady();
+
+            ASSERT_TRUE(ready);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    // UDS counts the messages of its send queues, SHM writes to the rings without them.
+    void PeerStatsTemplate(AittProtocol protocol, bool queued)
+    {
+        try {
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            const int count = 10;
+            std::atomic<int> cnt(0);
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) { ++cnt; },
+                  nullptr, protocol);
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            for (int i = 0; i < count; i++)
+                publisher.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG), protocol);
+
+            const std::string peer_id = clientId + ".sub";
+            std::map<std::string, AittPeerStats> stats;
+            for (int i = 0; i < 500; i++) {
+                stats = publisher.GetPeerStats(protocol);
+                auto it = stats.find(peer_id);
+                if (cnt == count && (queued == false || (it != stats.end()
+                                                          && it->second.sent == count + 0ULL)))
+                    break;
+                usleep(SLEEP_10MS);
+            }
+            EXPECT_EQ(cnt, count);
+            if (queued == false) {
+                EXPECT_TRUE(stats.empty());
+                return;
+            }
+
+            ASSERT_EQ(stats.count(peer_id), 1U);
+            const AittPeerStats &peer = stats[peer_id];
+            EXPECT_EQ(peer.enqueued, count + 0ULL);
+            EXPECT_EQ(peer.sent, count + 0ULL);
+            EXPECT_EQ(peer.dropped, 0ULL);
+            EXPECT_EQ(peer.depth, 0);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+};
+
+TEST_F(AittHostTest, SHM_PublishSubscribe_P_Anytime)
+{
+    PublishSubscribeTemplate(AITT_TYPE_SHM);
+}
+
+TEST_F(AittHostTest, SHM_Wildcard_single_P_Anytime)
+{
+    WildcardsTopicTemplate(AITT_TYPE_SHM, true);
+}
+
+TEST_F(AittHostTest, SHM_Wildcard_multi_P_Anytime)
+{
+    WildcardsTopicTemplate(AITT_TYPE_SHM, false);
+}
+
+TEST_F(AittHostTest, SHM_Subscribe_Same_Topic_twice_P_Anytime)
+{
+    SubscribeSameTopicTwiceTemplate(AITT_TYPE_SHM);
+}
+
+TEST_F(AittHostTest, SHM_RequestResponse_P_Anytime)
+{
+    RequestResponseTemplate(AITT_TYPE_SHM);
+}
+
+TEST_F(AittHostTest, SHM_Publish_Large_P_Anytime)
+{
+    PublishLargeTemplate(AITT_TYPE_SHM);
+}
+
+TEST_F(AittHostTest, SHM_Peer_Stats_N_Anytime)
+{
+    PeerStatsTemplate(AITT_TYPE_SHM, false);
+}
+
+TEST_F(AittHostTest, UDS_PublishSubscribe_P_Anytime)
+{
+    PublishSubscribeTemplate(AITT_TYPE_UDS);
+}
+
+TEST_F(AittHostTest, UDS_Wildcard_single_P_Anytime)
+{
+    WildcardsTopicTemplate(AITT_TYPE_UDS, true);
+}
+
+TEST_F(AittHostTest, UDS_Wildcard_multi_P_Anytime)
+{
+    WildcardsTopicTemplate(AITT_TYPE_UDS, false);
+}
+
+TEST_F(AittHostTest, UDS_Subscribe_Same_Topic_twice_P_Anytime)
+{
+    SubscribeSameTopicTwiceTemplate(AITT_TYPE_UDS);
+}
+
+TEST_F(AittHostTest, UDS_RequestResponse_P_Anytime)
+{
+    RequestResponseTemplate(AITT_TYPE_UDS);
+}
+
+TEST_F(AittHostTest, UDS_Publish_Large_P_Anytime)
+{
+    PublishLargeTemplate(AITT_TYPE_UDS);
+}
+
+TEST_F(AittHostTest, UDS_Peer_Stats_P_Anytime)
+{
+    PeerStatsTemplate(AITT_TYPE_UDS, true);
+}
@@ -16,8 +16,14 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <atomic>
 #include <climits>
+#include <map>
+#include <mutex>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "AITT.h"
 #include "AittTests.h"
@@ -323,6 +329,427 @@ class AittTcpTest : public testing::Test, public AittTests {
             FAIL() << "Unexpected exception: " << e.what();
         }
     }
+
+    void PublishBatchTemplate(AittProtocol protocol)
+    {
+        try {
+            ready = false;
+            AITT aitt(clientId, LOCAL_IP);
+
+            const std::string topic1 = testTopic + "/1";
+            const std::string topic2 = testTopic + "/2";
+            std::vector<std::string> received;
+            aitt.SetConnectionCallback([&](AITT &handle, int status, void *user_data) {
+                if (status != AITT_CONNECTED)
+                    return;
+
+                auto cb = [&](AittMsg *handle, const void *msg, const int szmsg,
+                                void *cbdata) -> void {
+                    AittTcpTest *test = static_cast<AittTcpTest *>(cbdata);
+                    received.push_back(handle->GetTopic() + ":"
+                                       + std::string(static_cast<const char *>(msg), szmsg));
+                    if (received.size() == 4)
+                        test->ToggleReady();
+                };
+                aitt.Subscribe(topic1, cb, static_cast<void *>(this), protocol);
+                aitt.Subscribe(topic2, cb, static_cast<void *>(this), protocol);
+
+                // Wait a few seconds to the AITT client gets server list (discover devices)
+                while (aitt.CountSubscriber(topic1, protocol) == 0
+                       || aitt.CountSubscriber(topic2, protocol) == 0) {
+                    usleep(SLEEP_10MS);
+                }
+
+                AittBatchMessage messages[] = {
+                      {topic1.c_str(), "a", 1},
+                      {topic2.c_str(), "b", 1},
+                      {topic1.c_str(), "c", 1},
+                      {topic2.c_str(), "d", 1},
+                };
+                aitt.PublishBatch(messages, 4, protocol);
+            });
+            aitt.Connect();
+
+            mainLoop->AddTimeout(
+                  CHECK_INTERVAL,
+                  [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+                        -> int { return ReadyCheck(static_cast<AittTests *>(this)); },
+                  nullptr);
+
+            IterateEventLoop();
+            ASSERT_TRUE(ready);
+
+            // Messages of a topic keep their order.
+            std::vector<std::string> first, second;
+            for (const auto &message : received) {
+                if (message.compare(0, topic1.size(), topic1) == 0)
+                    first.push_back(message);
+                else
+                    second.push_back(message);
+            }
+            EXPECT_EQ(first, std::vector<std::string>({topic1 + ":a", topic1 + ":c"}));
+            EXPECT_EQ(second, std::vector<std::string>({topic2 + ":b", topic2 + ":d"}));
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void SharedListenerTemplate(AittProtocol protocol)
+    {
+        try {
+            ready = false;
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            // Both topics are sent to the same listener with one message.
+            std::atomic<int> cnt(0);
+            auto cb = [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) {
+                EXPECT_STREQ(handle->GetTopic().c_str(), "test/value1");
+                EXPECT_EQ(szmsg, static_cast<int>(sizeof(TEST_MSG)));
+                if (++cnt == 2)
+                    static_cast<AittTcpTest *>(cbdata)->ToggleReady();
+            };
+            subscriber.Subscribe("test/+", cb, this, protocol);
+            subscriber.Subscribe("test/value1", cb, this, protocol);
+            while (publisher.CountSubscriber("test/value1", protocol) != 2) {
+                usleep(SLEEP_10MS);
+            }
+            publisher.Publish("test/value1", TEST_MSG, sizeof(TEST_MSG), protocol);
+
+            mainLoop->AddTimeout(
+                  CHECK_INTERVAL,
+                  [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+                        -> int { return ReadyCheck(static_cast<AittTests *>(this)); },
+                  nullptr);
+
+            IterateEventLoop();
+            ASSERT_TRUE(ready);
+            EXPECT_EQ(cnt, 2);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void DestinationChangeTemplate(AittProtocol protocol)
+    {
+        try {
+            ready = false;
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            // Nobody subscribes the topic yet.
+            publisher.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG), protocol);
+
+            std::atomic<int> cnt(0);
+            auto cb = [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) {
+                if (++cnt == 2)
+                    static_cast<AittTcpTest *>(cbdata)->ToggleReady();
+            };
+            AittSubscribeID handle = subscriber.Subscribe(testTopic, cb, this, protocol);
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+            publisher.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG), protocol);
+            while (cnt == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            // The topic gets another ID after it's subscribed again.
+            subscriber.Unsubscribe(handle);
+            while (publisher.CountSubscriber(testTopic, protocol) != 0) {
+                usleep(SLEEP_10MS);
+            }
+            subscriber.Subscribe(testTopic, cb, this, protocol);
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+            publisher.Publish(testTopic, TEST_MSG2, sizeof(TEST_MSG2), protocol);
+
+            mainLoop->AddTimeout(
+                  CHECK_INTERVAL,
+                  [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+                        -> int { return ReadyCheck(static_cast<AittTests *>(this)); },
+                  nullptr);
+
+            IterateEventLoop();
+            ASSERT_TRUE(ready);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void LargePayloadTemplate(AittProtocol protocol, bool stream)
+    {
+        try {
+            ready = false;
+            AittOption option;
+            option.SetStreamChunks(stream);
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP, option);
+            publisher.Connect();
+            subscriber.Connect();
+
+            // Larger than many chunks, and not a multiple of them
+            std::vector<char> payload(3 * 1024 * 1024 + 123);
+            for (size_t i = 0; i < payload.size(); i++)
+                payload[i] = static_cast<char>(i % 251);
+
+            std::vector<char> assembly;
+            int messages = 0;
+            int chunks = 0;
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) {
+                      const char *data = static_cast<const char *>(msg);
+                      assembly.insert(assembly.end(), data, data + szmsg);
+                      chunks++;
+                      EXPECT_EQ(handle->GetChunk(), stream ? chunks : 0);
+                      EXPECT_EQ(handle->GetSequence(), 0);
+                      EXPECT_TRUE(handle->IsEndSequence());
+                      if (handle->IsLastChunk() == false)
+                          return;
+
+                      EXPECT_TRUE(assembly == payload);
+                      EXPECT_EQ(stream, 1 < chunks);
+                      assembly.clear();
+                      chunks = 0;
+                      if (++messages == 2)
+                          static_cast<AittTcpTest *>(cbdata)->ToggleReady();
+                  },
+                  this, protocol);
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+            publisher.Publish(testTopic, payload.data(), payload.size(), protocol);
+            publisher.Publish(testTopic, payload.data(), payload.size(), protocol,
+                  AITT_QOS_AT_LEAST_ONCE);
+
+            mainLoop->AddTimeout(
+                  CHECK_INTERVAL,
+                  [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+                        -> int { return ReadyCheck(static_cast<AittTests *>(this)); },
+                  nullptr);
+
+            IterateEventLoop();
+            ASSERT_TRUE(ready);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    // Requests are reassembled, and replies are streamed without ending their sequence early.
+    void LargeReplyStreamTemplate(AittProtocol protocol)
+    {
+        try {
+            AittOption option;
+            option.SetStreamChunks(true);
+            AITT aitt(clientId, LOCAL_IP, option);
+            aitt.Connect();
+
+            std::vector<char> payload(1024 * 1024 + 123);
+            for (size_t i = 0; i < payload.size(); i++)
+                payload[i] = static_cast<char>(i % 251);
+
+            int requests = 0;
+            aitt.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) {
+                      requests++;
+                      EXPECT_EQ(handle->GetChunk(), 0);
+                      EXPECT_EQ(static_cast<size_t>(szmsg), payload.size());
+                      aitt.SendReply(handle, payload.data(), payload.size(), false);
+                      aitt.SendReply(handle, payload.data(), payload.size(), true);
+                  },
+                  nullptr, protocol);
+            while (aitt.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            std::vector<char> assembly;
+            int replies = 0;
+            int chunks = 0;
+            int ret = aitt.PublishWithReplySync(testTopic, payload.data(), payload.size(),
+                  protocol, AITT_QOS_AT_MOST_ONCE, false,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) {
+                      const char *data = static_cast<const char *>(msg);
+                      assembly.insert(assembly.end(), data, data + szmsg);
+                      chunks++;
+                      EXPECT_EQ(handle->GetChunk(), chunks);
+                      EXPECT_EQ(handle->GetSequence(), replies + 1);
+                      if (handle->IsLastChunk() == false)
+                          return;
+
+                      EXPECT_TRUE(assembly == payload);
+                      EXPECT_EQ(handle->IsEndSequence(), replies == 1);
+                      assembly.clear();
+                      chunks = 0;
+                      replies++;
+                  },
+                  nullptr, "", 5000);
+
+            EXPECT_EQ(ret, 0);
+            EXPECT_EQ(requests, 1);
+            EXPECT_EQ(replies, 2);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void ReceiveThreadsTemplate(AittProtocol protocol, int threads)
+    {
+        try {
+            ready = false;
+            AittOption option;
+            option.SetReceiveThreads(threads);
+            AITT subscriber(clientId + ".sub", LOCAL_IP, option);
+            subscriber.Connect();
+
+            const int publishers = 4;
+            const int count = 200;
+            std::mutex lock;
+            std::vector<int> next(publishers, 0);
+            std::atomic<int> received(0);
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) {
+                      int value = std::stoi(std::string(static_cast<const char *>(msg), szmsg));
+                      {
+                          // Messages of a publisher keep their order.
+                          std::lock_guard<std::mutex> auto_lock(lock);
+                          EXPECT_EQ(value % count, next[value / count]++);
+                      }
+                      if (++received == publishers * count)
+                          static_cast<AittTcpTest *>(cbdata)->ToggleReady();
+                  },
+                  this, protocol);
+
+            std::vector<std::unique_ptr<AITT>> handles;
+            for (int i = 0; i < publishers; i++) {
+                handles.emplace_back(new AITT(clientId + ".pub" + std::to_string(i), LOCAL_IP));
+                handles.back()->Connect();
+            }
+            std::vector<std::thread> senders;
+            for (int i = 0; i < publishers; i++) {
+                AITT *publisher = handles[i].get();
+                senders.emplace_back([&, publisher, i]() {
+                    while (publisher->CountSubscriber(testTopic, protocol) == 0) {
+                        usleep(SLEEP_10MS);
+                    }
+                    for (int j = 0; j < count; j++) {
+                        std::string msg = std::to_string(i * count + j);
+                        publisher->Publish(testTopic, msg.c_str(), msg.size(), protocol);
+                    }
+                });
+            }
+            for (auto &sender : senders)
+                sender.join();
+
+            mainLoop->AddTimeout(
+                  CHECK_INTERVAL,
+                  [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+                        -> int { return ReadyCheck(static_cast<AittTests *>(this)); },
+                  nullptr);
+
+            IterateEventLoop();
+            ASSERT_TRUE(ready);
+            EXPECT_EQ(next, std::vector<int>(publishers, count));
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void AtLeastOnceTemplate(AittProtocol protocol)
+    {
+        try {
+            ready = false;
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            // More messages than the retransmit buffer holds
+            const int count = 1000;
+            std::vector<int> received;
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) {
+                      received.push_back(std::stoi(std::string(static_cast<const char *>(msg),
+                            szmsg)));
+                      if (received.size() == count)
+                          static_cast<AittTcpTest *>(cbdata)->ToggleReady();
+                  },
+                  this, protocol);
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+            for (int i = 0; i < count; i++) {
+                std::string msg = std::to_string(i);
+                publisher.Publish(testTopic, msg.c_str(), msg.size(), protocol,
+                      AITT_QOS_AT_LEAST_ONCE);
+            }
+
+            mainLoop->AddTimeout(
+                  CHECK_INTERVAL,
+                  [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data)
+                        -> int { return ReadyCheck(static_cast<AittTests *>(this)); },
+                  nullptr);
+
+            IterateEventLoop();
+            ASSERT_TRUE(ready);
+            for (int i = 0; i < count; i++)
+                ASSERT_EQ(received[i], i);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
+
+    void PeerStatsTemplate(AittProtocol protocol)
+    {
+        try {
+            AITT publisher(clientId + ".pub", LOCAL_IP);
+            AITT subscriber(clientId + ".sub", LOCAL_IP);
+            publisher.Connect();
+            subscriber.Connect();
+
+            const int count = 10;
+            std::atomic<int> cnt(0);
+            subscriber.Subscribe(
+                  testTopic,
+                  [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) { ++cnt; },
+                  nullptr, protocol);
+            while (publisher.CountSubscriber(testTopic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            for (int i = 0; i < count; i++)
+                publisher.Publish(testTopic, TEST_MSG, sizeof(TEST_MSG), protocol);
+
+            // The queue counts a message sent after writing it.
+            const std::string peer_id = clientId + ".sub";
+            std::map<std::string, AittPeerStats> stats;
+            for (int i = 0; i < 500; i++) {
+                stats = publisher.GetPeerStats(protocol);
+                auto it = stats.find(peer_id);
+                if (cnt == count && it != stats.end() && it->second.sent == count + 0ULL)
+                    break;
+                usleep(SLEEP_10MS);
+            }
+            ASSERT_EQ(stats.size(), 1U);
+            ASSERT_EQ(stats.count(peer_id), 1U);
+            const AittPeerStats &peer = stats[peer_id];
+            EXPECT_EQ(peer.enqueued, count + 0ULL);
+            EXPECT_EQ(peer.sent, count + 0ULL);
+            EXPECT_EQ(peer.dropped, 0ULL);
+            EXPECT_EQ(peer.depth, 0);
+            EXPECT_EQ(cnt, count);
+        } catch (std::exception &e) {
+            FAIL() << "Unexpected exception: " << e.what();
+        }
+    }
 };
 
 TEST_F(AittTcpTest, TCP_Wildcard_single_Anytime)
@@ -361,6 +788,61 @@ TEST_F(AittTcpTest, Publish_Disconnect_P_Anytime)
     PublishDisconnectTemplate(AITT_TYPE_TCP_SECURE);
 }
 
+TEST_F(AittTcpTest, PublishBatch_P_Anytime)
+{
+    PublishBatchTemplate(AITT_TYPE_TCP);
+    PublishBatchTemplate(AITT_TYPE_TCP_SECURE);
+}
+
+TEST_F(AittTcpTest, Destination_Change_P_Anytime)
+{
+    DestinationChangeTemplate(AITT_TYPE_TCP);
+    DestinationChangeTemplate(AITT_TYPE_TCP_SECURE);
+}
+
+TEST_F(AittTcpTest, Shared_Listener_P_Anytime)
+{
+    SharedListenerTemplate(AITT_TYPE_TCP);
+    SharedListenerTemplate(AITT_TYPE_TCP_SECURE);
+}
+
+TEST_F(AittTcpTest, Large_Payload_P_Anytime)
+{
+    LargePayloadTemplate(AITT_TYPE_TCP, false);
+    LargePayloadTemplate(AITT_TYPE_TCP_SECURE, false);
+}
+
+TEST_F(AittTcpTest, Large_Payload_Stream_P_Anytime)
+{
+    LargePayloadTemplate(AITT_TYPE_TCP, true);
+    LargePayloadTemplate(AITT_TYPE_TCP_SECURE, true);
+}
+
+TEST_F(AittTcpTest, Large_Reply_Stream_P_Anytime)
+{
+    LargeReplyStreamTemplate(AITT_TYPE_TCP);
+    LargeReplyStreamTemplate(AITT_TYPE_TCP_SECURE);
+}
+
+TEST_F(AittTcpTest, Receive_Threads_P_Anytime)
+{
+    ReceiveThreadsTemplate(AITT_TYPE_TCP, 4);
+    ReceiveThreadsTemplate(AITT_TYPE_TCP_SECURE, 4);
+    ReceiveThreadsTemplate(AITT_TYPE_TCP, 0);
+}
+
+TEST_F(AittTcpTest, Publish_At_Least_Once_P_Anytime)
+{
+    AtLeastOnceTemplate(AITT_TYPE_TCP);
+    AtLeastOnceTemplate(AITT_TYPE_TCP_SECURE);
+}
+
+TEST_F(AittTcpTest, Peer_Stats_P_Anytime)
+{
+    PeerStatsTemplate(AITT_TYPE_TCP);
+    PeerStatsTemplate(AITT_TYPE_TCP_SECURE);
+}
+
 TEST_F(AittTcpTest, SECURE_TCP_various_msg_Anytime)
 {
     std::independent_bits_engine<std::default_random_engine, CHAR_BIT, unsigned char> random_engine;
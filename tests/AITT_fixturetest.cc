@@ -349,6 +349,71 @@ TEST_F(AITTTest, PublishSubscribe_Multiple_Protocols_P_Anytime)
     }
 }
 
+TEST_F(AITTTest, PublishSubscribe_Local_Delivery_P_Anytime)
+{
+    try {
+        AittOption option(true, false);
+        option.SetLocalDelivery(true);
+        AITT aitt(clientId, LOCAL_IP, option);
+        aitt.Connect();
+
+        int tcp_count = 0;
+        int mqtt_count = 0;
+        aitt.Subscribe(
+              testTopic,
+              [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) -> void {
+                  AITTTest *test = static_cast<AITTTest *>(cbdata);
+                  EXPECT_EQ(std::string(static_cast<const char *>(msg), szmsg), TEST_MSG);
+                  tcp_count++;
+                  test->ToggleReady();
+              },
+              static_cast<void *>(this), AITT_TYPE_TCP);
+
+        aitt.Subscribe(
+              testTopic,
+              [&](AittMsg *handle, const void *msg, const int szmsg, void *cbdata) -> void {
+                  AITTTest *test = static_cast<AITTTest *>(cbdata);
+                  EXPECT_EQ(std::string(static_cast<const char *>(msg), szmsg), TEST_MSG);
+                  mqtt_count++;
+                  test->ToggleReady2();
+              },
+              static_cast<void *>(this), AITT_TYPE_MQTT);
+
+        // Subscribers of the same AITT get it without the discovery and the transports.
+        aitt.SetRemotePolicy(testTopic, AITT_REMOTE_NEVER);
+        aitt.Publish(testTopic, TEST_MSG, strlen(TEST_MSG),
+              (AittProtocol)(AITT_TYPE_MQTT | AITT_TYPE_TCP));
+
+        mainLoop->AddTimeout(
+              CHECK_INTERVAL,
+              [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+                  return ReadyAllCheck(static_cast<AittTests *>(this));
+              },
+              nullptr);
+
+        IterateEventLoop();
+
+        ASSERT_TRUE(ready);
+        ASSERT_TRUE(ready2);
+        EXPECT_EQ(tcp_count, 1);
+        EXPECT_EQ(mqtt_count, 1);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
+TEST_F(AITTTest, SetRemotePolicy_Wildcard_N_Anytime)
+{
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        EXPECT_THROW(aitt.SetRemotePolicy("test/+", AITT_REMOTE_NEVER), aitt::AittException);
+        EXPECT_THROW(aitt.SetRemotePolicy(testTopic, static_cast<AittRemotePolicy>(10)),
+              aitt::AittException);
+    } catch (std::exception &e) {
+        FAIL() << "Unexpected exception: " << e.what();
+    }
+}
+
 TEST_F(AITTTest, CountSubscriber_P_Anytime)
 {
     try {
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "AittMsgBuffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "AittMsg.h"
+
+#define TEST_PAYLOAD "This is aitt test payload"
+
+TEST(AittMsgBuffer, Empty_P_Anytime)
+{
+    AittMsgBuffer buffer;
+
+    EXPECT_EQ(buffer.GetData(), nullptr);
+    EXPECT_EQ(buffer.GetSize(), 0);
+    EXPECT_TRUE(buffer.IsRetained());
+    EXPECT_TRUE(buffer.Retain());
+}
+
+TEST(AittMsgBuffer, Wrap_P_Anytime)
+{
+    char payload[] = TEST_PAYLOAD;
+    AittMsgBuffer buffer = AittMsgBuffer::Wrap(payload, sizeof(payload));
+
+    EXPECT_EQ(buffer.GetData(), payload);
+    EXPECT_EQ(buffer.GetSize(), static_cast<int>(sizeof(payload)));
+    EXPECT_FALSE(buffer.IsRetained());
+}
+
+TEST(AittMsgBuffer, Retain_P_Anytime)
+{
+    char payload[] = TEST_PAYLOAD;
+    AittMsgBuffer buffer = AittMsgBuffer::Wrap(payload, sizeof(payload));
+    AittMsgBuffer shared = buffer;
+
+    EXPECT_TRUE(buffer.Retain());
+    EXPECT_TRUE(buffer.IsRetained());
+    EXPECT_NE(buffer.GetData(), payload);
+
+    // Every copy of the buffer shares the retained memory.
+    const void *retained = buffer.GetData();
+    EXPECT_TRUE(shared.IsRetained());
+    EXPECT_EQ(shared.GetData(), retained);
+    EXPECT_TRUE(shared.Retain());
+    EXPECT_EQ(shared.GetData(), retained);
+
+    memset(payload, 0, sizeof(payload));
+    EXPECT_STREQ(static_cast<const char *>(shared.GetData()), TEST_PAYLOAD);
+}
+
+TEST(AittMsgBuffer, Retain_Threads_P_Anytime)
+{
+    char payload[] = TEST_PAYLOAD;
+    AittMsgBuffer buffer = AittMsgBuffer::Wrap(payload, sizeof(payload));
+
+    std::vector<const void *> retained(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < retained.size(); i++) {
+        AittMsgBuffer shared = buffer;
+        threads.emplace_back([shared, &retained, i]() {
+            EXPECT_TRUE(shared.Retain());
+            retained[i] = shared.GetData();
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    // Every thread ends up with the one copy kept.
+    for (auto data : retained)
+        EXPECT_EQ(data, buffer.GetData());
+    EXPECT_NE(buffer.GetData(), payload);
+    EXPECT_STREQ(static_cast<const char *>(buffer.GetData()), TEST_PAYLOAD);
+}
+
+TEST(AittMsgBuffer, Retain_Zero_Size_P_Anytime)
+{
+    char payload[] = TEST_PAYLOAD;
+    AittMsgBuffer buffer = AittMsgBuffer::Wrap(payload, 0);
+
+    EXPECT_TRUE(buffer.Retain());
+    EXPECT_EQ(buffer.GetData(), nullptr);
+    EXPECT_EQ(buffer.GetSize(), 0);
+}
+
+TEST(AittMsgBuffer, Adopt_P_Anytime)
+{
+    void *payload = malloc(sizeof(TEST_PAYLOAD));
+    ASSERT_NE(payload, nullptr);
+    memcpy(payload, TEST_PAYLOAD, sizeof(TEST_PAYLOAD));
+
+    AittMsgBuffer buffer = AittMsgBuffer::Adopt(payload, sizeof(TEST_PAYLOAD));
+    EXPECT_TRUE(buffer.IsRetained());
+    EXPECT_TRUE(buffer.Retain());
+    EXPECT_EQ(buffer.GetData(), payload);
+}
+
+TEST(AittMsgBuffer, Keep_After_Msg_P_Anytime)
+{
+    AittMsgBuffer kept;
+    {
+        char payload[] = TEST_PAYLOAD;
+        AittMsg msg;
+        msg.SetPayload(AittMsgBuffer::Wrap(payload, sizeof(payload)));
+        ASSERT_TRUE(msg.GetPayload().Retain());
+        kept = msg.GetPayload();
+    }
+
+    EXPECT_EQ(kept.GetSize(), static_cast<int>(sizeof(TEST_PAYLOAD)));
+    EXPECT_STREQ(static_cast<const char *>(kept.GetData()), TEST_PAYLOAD);
+}
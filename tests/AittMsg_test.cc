@@ -0,0 +1,67 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "AittMsg.h"
+
+#include <gtest/gtest.h>
+
+#define TEST_TOPIC "test/topic"
+#define TEST_REPLY_TOPIC "test/topic_AittRe_1"
+#define TEST_CORRELATION "correlation"
+
+TEST(AittMsg, Default_P_Anytime)
+{
+    AittMsg msg;
+
+    EXPECT_STREQ(msg.GetTopic().c_str(), "");
+    EXPECT_STREQ(msg.GetCorrelation().c_str(), "");
+    EXPECT_STREQ(msg.GetResponseTopic().c_str(), "");
+    EXPECT_EQ(msg.GetSequence(), 0);
+    EXPECT_TRUE(msg.IsEndSequence());
+}
+
+TEST(AittMsg, Shared_Header_P_Anytime)
+{
+    AittMsg msg;
+    msg.SetTopic(TEST_TOPIC);
+    msg.SetResponseTopic(TEST_REPLY_TOPIC);
+    msg.SetCorrelation(TEST_CORRELATION);
+
+    AittMsg view = msg;
+    EXPECT_EQ(&view.GetTopic(), &msg.GetTopic());
+    EXPECT_STREQ(view.GetResponseTopic().c_str(), TEST_REPLY_TOPIC);
+    EXPECT_STREQ(view.GetCorrelation().c_str(), TEST_CORRELATION);
+}
+
+TEST(AittMsg, Copy_On_Write_P_Anytime)
+{
+    AittMsg msg;
+    msg.SetTopic(TEST_TOPIC);
+    msg.SetSequence(1);
+    msg.SetEndSequence(false);
+
+    AittMsg view = msg;
+    view.IncreaseSequence();
+    view.SetEndSequence(true);
+    view.SetID(&view);
+
+    EXPECT_EQ(view.GetSequence(), 2);
+    EXPECT_TRUE(view.IsEndSequence());
+    EXPECT_STREQ(view.GetTopic().c_str(), TEST_TOPIC);
+
+    EXPECT_EQ(msg.GetSequence(), 1);
+    EXPECT_FALSE(msg.IsEndSequence());
+    EXPECT_EQ(msg.GetID(), nullptr);
+}
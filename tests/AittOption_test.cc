@@ -76,3 +76,109 @@ TEST(Option, CustomBroker_SetCustomRWFile_N_Anytime)
     option.SetCustomRWFile("");
     EXPECT_STRNE(option.GetCustomRWFile(), "");
 }
+
+TEST(Option, SetWorkerThreads_P_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.GetWorkerThreads(), 1);
+    EXPECT_EQ(option.SetWorkerThreads(4), AITT_ERROR_NONE);
+    EXPECT_EQ(option.GetWorkerThreads(), 4);
+
+    EXPECT_FALSE(option.GetWorkStealing());
+    option.SetWorkStealing(true);
+    EXPECT_TRUE(option.GetWorkStealing());
+}
+
+TEST(Option, SetWorkerThreads_N_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.SetWorkerThreads(0), AITT_ERROR_INVALID_PARAMETER);
+    EXPECT_EQ(option.GetWorkerThreads(), 1);
+}
+
+TEST(Option, SetSendQueue_P_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.GetSendQueueSize(), 256);
+    EXPECT_EQ(option.SetSendQueueSize(16), AITT_ERROR_NONE);
+    EXPECT_EQ(option.GetSendQueueSize(), 16);
+
+    EXPECT_EQ(option.GetSendOverflowPolicy(), AITT_SEND_OVERFLOW_BLOCK);
+    EXPECT_EQ(option.SetSendOverflowPolicy(AITT_SEND_OVERFLOW_DROP_OLDEST), AITT_ERROR_NONE);
+    EXPECT_EQ(option.GetSendOverflowPolicy(), AITT_SEND_OVERFLOW_DROP_OLDEST);
+}
+
+TEST(Option, SetSendQueue_N_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.SetSendQueueSize(0), AITT_ERROR_INVALID_PARAMETER);
+    EXPECT_EQ(option.GetSendQueueSize(), 256);
+    EXPECT_EQ(option.SetSendOverflowPolicy(static_cast<AittSendOverflow>(10)),
+          AITT_ERROR_INVALID_PARAMETER);
+    EXPECT_EQ(option.GetSendOverflowPolicy(), AITT_SEND_OVERFLOW_BLOCK);
+}
+
+TEST(Option, SetMaxInflight_P_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.GetMaxInflight(), 0);
+    EXPECT_EQ(option.SetMaxInflight(64), AITT_ERROR_NONE);
+    EXPECT_EQ(option.GetMaxInflight(), 64);
+
+    // It doesn't follow the policy of the TCP send queue.
+    EXPECT_TRUE(option.GetInflightBlocking());
+    EXPECT_EQ(option.SetSendOverflowPolicy(AITT_SEND_OVERFLOW_DROP_NEWEST), AITT_ERROR_NONE);
+    EXPECT_TRUE(option.GetInflightBlocking());
+    option.SetInflightBlocking(false);
+    EXPECT_FALSE(option.GetInflightBlocking());
+}
+
+TEST(Option, SetMaxInflight_N_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.SetMaxInflight(-1), AITT_ERROR_INVALID_PARAMETER);
+    EXPECT_EQ(option.GetMaxInflight(), 0);
+}
+
+TEST(Option, SetLocalDelivery_P_Anytime)
+{
+    AittOption option;
+
+    EXPECT_FALSE(option.GetLocalDelivery());
+    option.SetLocalDelivery(true);
+    EXPECT_TRUE(option.GetLocalDelivery());
+}
+
+TEST(Option, SetStreamChunks_P_Anytime)
+{
+    AittOption option;
+
+    EXPECT_FALSE(option.GetStreamChunks());
+    option.SetStreamChunks(true);
+    EXPECT_TRUE(option.GetStreamChunks());
+}
+
+TEST(Option, SetReceiveThreads_P_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.GetReceiveThreads(), 1);
+    EXPECT_EQ(option.SetReceiveThreads(4), AITT_ERROR_NONE);
+    EXPECT_EQ(option.GetReceiveThreads(), 4);
+    EXPECT_EQ(option.SetReceiveThreads(0), AITT_ERROR_NONE);
+    EXPECT_EQ(option.GetReceiveThreads(), 0);
+}
+
+TEST(Option, SetReceiveThreads_N_Anytime)
+{
+    AittOption option;
+
+    EXPECT_EQ(option.SetReceiveThreads(-1), AITT_ERROR_INVALID_PARAMETER);
+    EXPECT_EQ(option.GetReceiveThreads(), 1);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "DeliveryQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "MainLoopHandler.h"
+#include "aitt_internal.h"
+
+#define PRODUCER_NUM 4
+#define ITEM_NUM 10000
+
+using aitt::DeliveryQueue;
+using aitt::MainLoopIface;
+
+// It keeps idle callbacks to run them by hand.
+class IdleRecorder : public MainLoopIface {
+  public:
+    void Run() override {}
+    bool Quit() override { return true; }
+    void AddIdle(const mainLoopCB &cb, MainLoopData *user_data) override
+    {
+        idles.push_back(cb);
+    }
+    void AddWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override {}
+    MainLoopData *RemoveWatch(int fd) override { return nullptr; }
+    void AddWriteWatch(int fd, const mainLoopCB &cb, MainLoopData *user_data) override {}
+    MainLoopData *RemoveWriteWatch(int fd) override { return nullptr; }
+    unsigned int AddTimeout(int interval, const mainLoopCB &cb, MainLoopData *user_data) override
+    {
+        return 0;
+    }
+    void RemoveTimeout(unsigned int id) override {}
+
+    void RunIdles(void)
+    {
+        std::vector<mainLoopCB> pending;
+        pending.swap(idles);
+        for (auto &cb : pending)
+            EXPECT_EQ(cb(Event::OKAY, -1, nullptr), AITT_LOOP_EVENT_REMOVE);
+    }
+
+    std::vector<mainLoopCB> idles;
+};
+
+TEST(DeliveryQueue, One_Wakeup_Per_Batch_P_Anytime)
+{
+    IdleRecorder loop;
+    std::vector<int> delivered;
+    DeliveryQueue<int> queue(&loop, [&](int &item) { delivered.push_back(item); });
+
+    for (int i = 0; i < 10; i++)
+        queue.Push(int(i));
+    EXPECT_EQ(loop.idles.size(), 1U);
+
+    loop.RunIdles();
+    ASSERT_EQ(delivered.size(), 10U);
+    for (int i = 0; i < 10; i++)
+        EXPECT_EQ(delivered[i], i);
+
+    queue.Push(10);
+    EXPECT_EQ(loop.idles.size(), 1U);
+    loop.RunIdles();
+    EXPECT_EQ(delivered.size(), 11U);
+}
+
+TEST(DeliveryQueue, Overflow_Keeps_Order_P_Anytime)
+{
+    IdleRecorder loop;
+    std::vector<int> delivered;
+    DeliveryQueue<int> queue(&loop, [&](int &item) { delivered.push_back(item); }, 4);
+
+    for (int i = 0; i < 100; i++)
+        queue.Push(int(i));
+    EXPECT_EQ(loop.idles.size(), 1U);
+
+    loop.RunIdles();
+    ASSERT_EQ(delivered.size(), 100U);
+    for (int i = 0; i < 100; i++)
+        EXPECT_EQ(delivered[i], i);
+}
+
+TEST(DeliveryQueue, Multi_Producer_P_Anytime)
+{
+    std::unique_ptr<MainLoopIface> loop(aitt::MainLoopHandler::new_loop());
+    std::vector<int> last(PRODUCER_NUM, -1);
+    int count = 0;
+    bool in_order = true;
+
+    DeliveryQueue<std::pair<int, int>> queue(
+          loop.get(),
+          [&](std::pair<int, int> &item) {
+              if (item.second != last[item.first] + 1)
+                  in_order = false;
+              last[item.first] = item.second;
+              if (++count == PRODUCER_NUM * ITEM_NUM)
+                  loop->Quit();
+          },
+          64);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCER_NUM; p++) {
+        producers.push_back(std::thread([&queue, p]() {
+            for (int i = 0; i < ITEM_NUM; i++)
+                queue.Push(std::make_pair(p, i));
+        }));
+    }
+
+    loop->Run();
+    for (auto &producer : producers)
+        producer.join();
+
+    EXPECT_EQ(count, PRODUCER_NUM * ITEM_NUM);
+    EXPECT_TRUE(in_order);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HostTransport.h"
+
+struct TestPeer {
+    explicit TestPeer(const std::string &peer_name) : name(peer_name) {}
+    std::string name;
+};
+
+using PeerTable = aitt::HostPeerTable<TestPeer>;
+
+TEST(HostPeerTable, Match_P_Anytime)
+{
+    PeerTable table;
+    auto peer_a = std::make_shared<TestPeer>("a");
+    auto peer_b = std::make_shared<TestPeer>("b");
+    table.Update("a", peer_a, {{"test/+", 1}, {"test/#", 2}});
+    table.Update("b", peer_b, {{"test/topic", 3}});
+
+    std::vector<PeerTable::PeerPtr> peers;
+    table.Match("test/topic", "", peers);
+    // A peer is matched once with several filters.
+    ASSERT_EQ(peers.size(), 2U);
+    EXPECT_EQ(peers[0], peer_a);
+    EXPECT_EQ(peers[1], peer_b);
+    EXPECT_EQ(table.Count("test/topic"), 6);
+
+    peers.clear();
+    table.Match("test/topic", "a", peers);
+    ASSERT_EQ(peers.size(), 1U);
+    EXPECT_EQ(peers[0], peer_b);
+
+    peers.clear();
+    table.Match("other", "", peers);
+    EXPECT_TRUE(peers.empty());
+}
+
+TEST(HostPeerTable, Update_P_Anytime)
+{
+    PeerTable table;
+    auto peer = std::make_shared<TestPeer>("a");
+    table.Update("a", peer, {{"test/one", 1}});
+    table.Update("a", peer, {{"test/two", 1}});
+
+    EXPECT_EQ(table.Find("a"), peer);
+    EXPECT_EQ(table.Count("test/one"), 0);
+    EXPECT_EQ(table.Count("test/two"), 1);
+
+    EXPECT_EQ(table.Remove("a"), peer);
+    EXPECT_EQ(table.Find("a"), nullptr);
+    EXPECT_EQ(table.Count("test/two"), 0);
+}
+
+TEST(HostPeerTable, Remove_N_Anytime)
+{
+    PeerTable table;
+    EXPECT_EQ(table.Remove("unknown"), nullptr);
+    EXPECT_EQ(table.Find("unknown"), nullptr);
+}
@@ -28,6 +28,7 @@
 
 #define SLEEP_10MS 10000
 #define MAINLOOP_MESSAGE "1"
+using aitt::MainLoopHandler;
 using aitt::MainLoopIface;
 
 class MainLoopTest : public testing::Test {
@@ -253,6 +254,27 @@ TEST(MainLoop_Test, Quit_Without_RemoveTimeout_Anytime)
     EXPECT_TRUE(ret);
 }
 
+TEST(MainLoop_Test, Run_After_Quit_In_Timeout_P_Anytime)
+{
+    int count = 0;
+    std::unique_ptr<MainLoopIface> handler(aitt::MainLoopHandler::new_loop());
+
+    // The loop runs again after it quits in a callback.
+    for (int iter = 0; iter < 2; iter++) {
+        handler->AddTimeout(
+              1,
+              [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+                  count++;
+                  handler->Quit();
+                  return AITT_LOOP_EVENT_REMOVE;
+              },
+              nullptr);
+
+        handler->Run();
+        EXPECT_EQ(count, iter + 1);
+    }
+}
+
 TEST_F(MainLoopTest, AddWatch_Normal_P_Anytime)
 {
     bool ret = false;
@@ -366,11 +388,187 @@ TEST_F(MainLoopTest, Watch_Event_CB_Return_P_Anytime)
                           MainLoopIface::MainLoopData *data) -> int {
                         static int count = 0;
                         EXPECT_EQ(result, MainLoopIface::Event::OKAY);
-                        return CheckCount(handler.get(), count);
+                        return MainLoopTest::CheckCount(handler.get(), count);
+                    },
+                    nullptr);
+              return AITT_LOOP_EVENT_REMOVE;
+          },
+          nullptr);
+    handler->Run();
+}
+
+TEST(MainLoop_Test, AddWriteWatch_P_Anytime)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::unique_ptr<MainLoopIface> handler(aitt::MainLoopHandler::new_loop());
+    int count = 0;
+
+    handler->AddWriteWatch(
+          fds[0],
+          [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+              EXPECT_EQ(fd, fds[0]);
+              EXPECT_EQ(result, MainLoopIface::Event::OKAY);
+              EXPECT_EQ(write(fd, MAINLOOP_MESSAGE, 1), 1);
+              return MainLoopTest::CheckCount(handler.get(), count);
+          },
+          nullptr);
+    handler->Run();
+
+    char buf[3] = {0};
+    EXPECT_EQ(read(fds[1], buf, 2), 2);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(MainLoop_Test, RemoveWriteWatch_N_Anytime)
+{
+    std::unique_ptr<MainLoopIface> handler(aitt::MainLoopHandler::new_loop());
+    EXPECT_EQ(handler->RemoveWriteWatch(777), nullptr);
+}
+
+static MainLoopIface *NewEpollLoop(void)
+{
+    return MainLoopHandler::new_loop(MainLoopHandler::Backend::EPOLL);
+}
+
+TEST(MainLoop_Test, Epoll_Quit_N_Anytime)
+{
+    std::unique_ptr<MainLoopIface> handler(NewEpollLoop());
+    EXPECT_EQ(handler->Quit(), false);
+}
+
+TEST(MainLoop_Test, Epoll_AddIdle_P_Anytime)
+{
+    std::unique_ptr<MainLoopIface> handler(NewEpollLoop());
+    MainLoopIface::MainLoopData test_data;
+    int count = 0;
+
+    handler->AddIdle(
+          [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+              EXPECT_EQ(data, &test_data);
+              EXPECT_EQ(result, MainLoopIface::Event::OKAY);
+              return MainLoopTest::CheckCount(handler.get(), count);
+          },
+          &test_data);
+
+    handler->Run();
+    EXPECT_EQ(count, 1);
+}
+
+TEST(MainLoop_Test, Epoll_AddIdle_From_Thread_P_Anytime)
+{
+    std::unique_ptr<MainLoopIface> handler(NewEpollLoop());
+    bool ret = false;
+
+    std::thread thread([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        handler->AddIdle(
+              [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+                  ret = true;
+                  handler->Quit();
+                  return AITT_LOOP_EVENT_REMOVE;
+              },
+              nullptr);
+    });
+
+    handler->Run();
+    thread.join();
+    EXPECT_TRUE(ret);
+}
+
+TEST(MainLoop_Test, Epoll_Timeout_CB_Return_P_Anytime)
+{
+    std::unique_ptr<MainLoopIface> handler(NewEpollLoop());
+    struct timespec ts_start, ts_end;
+    int interval = 10;
+    int count = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts_start);
+    unsigned int id = handler->AddTimeout(
+          interval,
+          [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+              clock_gettime(CLOCK_MONOTONIC, &ts_end);
+              double diff = 1000.0 * ts_end.tv_sec + 1e-6 * ts_end.tv_nsec
+                            - (1000.0 * ts_start.tv_sec + 1e-6 * ts_start.tv_nsec);
+              EXPECT_GE(diff, interval * (count + 1));
+              return MainLoopTest::CheckCount(handler.get(), count);
+          },
+          nullptr);
+    EXPECT_NE(id, 0U);
+    EXPECT_EQ(handler->AddTimeout(0, nullptr, nullptr), 0U);
+
+    handler->Run();
+    EXPECT_EQ(count, 1);
+}
+
+TEST_F(MainLoopTest, Epoll_HANGUP_N_Anytime)
+{
+    std::unique_ptr<MainLoopIface> handler(NewEpollLoop());
+    MainLoopIface::MainLoopData test_data;
+    bool ret = false;
+
+    handler->AddWatch(
+          server_fd,
+          [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+              EXPECT_EQ(data, &test_data);
+              int client_fd = accept(server_fd, 0, 0);
+              EXPECT_NE(client_fd, -1);
+              handler->AddWatch(
+                    client_fd,
+                    [&](MainLoopIface::Event result, int fd,
+                          MainLoopIface::MainLoopData *data) -> int {
+                        if (result == MainLoopIface::Event::OKAY) {
+                            ReadAndCheck(fd);
+                            return AITT_LOOP_EVENT_CONTINUE;
+                        }
+
+                        EXPECT_EQ(result, MainLoopIface::Event::HANGUP);
+                        handler->Quit();
+                        close(fd);
+                        ret = true;
+                        return AITT_LOOP_EVENT_REMOVE;
                     },
                     nullptr);
               return AITT_LOOP_EVENT_REMOVE;
           },
+          &test_data);
+
+    handler->Run();
+    EXPECT_TRUE(ret);
+    EXPECT_EQ(handler->RemoveWatch(server_fd), nullptr);
+}
+
+TEST(MainLoop_Test, Epoll_Read_Write_Watch_P_Anytime)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::unique_ptr<MainLoopIface> handler(NewEpollLoop());
+    MainLoopIface::MainLoopData test_data;
+    int written = 0;
+
+    // Both watches of the same fd
+    handler->AddWatch(
+          fds[0],
+          [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+              ADD_FAILURE() << "Nothing to read";
+              return AITT_LOOP_EVENT_REMOVE;
+          },
+          &test_data);
+    handler->AddWriteWatch(
+          fds[0],
+          [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+              EXPECT_EQ(fd, fds[0]);
+              EXPECT_EQ(write(fd, MAINLOOP_MESSAGE, 1), 1);
+              return MainLoopTest::CheckCount(handler.get(), written);
+          },
           nullptr);
     handler->Run();
+
+    char buf[3] = {0};
+    EXPECT_EQ(read(fds[1], buf, 2), 2);
+    EXPECT_EQ(handler->RemoveWriteWatch(fds[0]), nullptr);
+    EXPECT_EQ(handler->RemoveWatch(fds[0]), &test_data);
+    close(fds[0]);
+    close(fds[1]);
 }
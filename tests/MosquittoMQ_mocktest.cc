@@ -21,6 +21,8 @@
 
 #include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "AittException.h"
 #include "AittTypes.h"
@@ -300,8 +302,8 @@ TEST_F(MQMockTest, Subscribe_P_Anytime)
     EXPECT_CALL(mqttMock, mosquitto_loop_start(TEST_HANDLE)).WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(mqttMock, mosquitto_connect(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
-    EXPECT_CALL(mqttMock, mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
-                                AITT_QOS_AT_MOST_ONCE))
+    EXPECT_CALL(mqttMock, mosquitto_subscribe_v5(TEST_HANDLE, testing::_,
+                                testing::StrEq(TEST_TOPIC), AITT_QOS_AT_MOST_ONCE, 0, nullptr))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(mqttMock, mosquitto_destroy(TEST_HANDLE)).Times(1);
     EXPECT_CALL(mqttMock, mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
@@ -323,8 +325,8 @@ TEST_F(MQMockTest, Subscribe_N_Anytime)
     EXPECT_CALL(mqttMock, mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(mqttMock, mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
           .WillOnce(Return(TEST_HANDLE));
-    EXPECT_CALL(mqttMock, mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
-                                AITT_QOS_AT_MOST_ONCE))
+    EXPECT_CALL(mqttMock, mosquitto_subscribe_v5(TEST_HANDLE, testing::_,
+                                testing::StrEq(TEST_TOPIC), AITT_QOS_AT_MOST_ONCE, 0, nullptr))
           .WillOnce(Return(MOSQ_ERR_INVAL));
 
     EXPECT_THROW(
@@ -349,7 +351,8 @@ TEST_F(MQMockTest, Unsubscribe_P_Anytime)
     EXPECT_CALL(mqttMock, mosquitto_connect(TEST_HANDLE, testing::StrEq(TEST_HOST), TEST_PORT, 60))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(mqttMock,
-          mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0))
+          mosquitto_subscribe_v5(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0, 0,
+                nullptr))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(mqttMock,
           mosquitto_unsubscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC)))
@@ -377,7 +380,8 @@ TEST_F(MQMockTest, Unsubscribe_N_Anytime)
           .WillOnce(Return(TEST_HANDLE));
     EXPECT_CALL(mqttMock, mosquitto_message_v5_callback_set(TEST_HANDLE, testing::_)).Times(1);
     EXPECT_CALL(mqttMock,
-          mosquitto_subscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0))
+          mosquitto_subscribe_v5(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC), 0, 0,
+                nullptr))
           .WillOnce(Return(MOSQ_ERR_SUCCESS));
     EXPECT_CALL(mqttMock,
           mosquitto_unsubscribe(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC)))
@@ -445,3 +449,201 @@ TEST_F(MQMockTest, PublishWithReply_N_Anytime)
           },
           aitt::AittException);
 }
+
+class MQPublishAsyncTest : public MQMockTest {
+  protected:
+    using PublishedCB = void (*)(struct mosquitto *, void *, int, int, const mosquitto_property *);
+
+    void SetUp() override
+    {
+        EXPECT_CALL(mqttMock, mosquitto_lib_init()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+        EXPECT_CALL(mqttMock, mosquitto_new(testing::StrEq(TEST_CLIENT_ID), true, testing::_))
+              .WillOnce(testing::DoAll(testing::SaveArg<2>(&mq_obj), Return(TEST_HANDLE)));
+        EXPECT_CALL(mqttMock, mosquitto_publish_v5_callback_set(TEST_HANDLE, testing::_))
+              .WillOnce(testing::SaveArg<1>(&published_cb));
+        EXPECT_CALL(mqttMock, mosquitto_destroy(TEST_HANDLE)).Times(1);
+        EXPECT_CALL(mqttMock, mosquitto_lib_cleanup()).WillOnce(Return(MOSQ_ERR_SUCCESS));
+    }
+
+    void ExpectPublish(int mid)
+    {
+        EXPECT_CALL(mqttMock, mosquitto_publish(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
+                                    sizeof(TEST_PAYLOAD), TEST_PAYLOAD, AITT_QOS_AT_LEAST_ONCE,
+                                    false))
+              .WillOnce(testing::DoAll(testing::SetArgPointee<1>(mid), Return(MOSQ_ERR_SUCCESS)))
+              .RetiresOnSaturation();
+    }
+
+    void *mq_obj = nullptr;
+    PublishedCB published_cb = nullptr;
+};
+
+TEST_F(MQPublishAsyncTest, PublishAsync_P_Anytime)
+{
+    aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+    ASSERT_NE(published_cb, nullptr);
+
+    std::vector<int> results;
+    ExpectPublish(7);
+    mq.PublishAsync(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE, false,
+          [&](int result) { results.push_back(result); });
+    EXPECT_TRUE(results.empty());
+    EXPECT_EQ(mq.GetPublishStats().inflight, 1);
+
+    // PUBACK
+    published_cb(TEST_HANDLE, mq_obj, 7, MQTT_RC_SUCCESS, nullptr);
+    EXPECT_EQ(results, std::vector<int>({AITT_ERROR_NONE}));
+
+    AittPublishStats stats = mq.GetPublishStats();
+    EXPECT_EQ(stats.inflight, 0);
+    EXPECT_EQ(stats.peak_inflight, 1);
+    EXPECT_EQ(stats.completed, 1ULL);
+    EXPECT_EQ(stats.failed, 0ULL);
+}
+
+TEST_F(MQPublishAsyncTest, PublishAsync_Early_Completion_P_Anytime)
+{
+    aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+    ASSERT_NE(published_cb, nullptr);
+
+    // The loop thread may complete a message before mosquitto_publish() returns.
+    EXPECT_CALL(mqttMock, mosquitto_publish(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
+                                sizeof(TEST_PAYLOAD), TEST_PAYLOAD, AITT_QOS_AT_LEAST_ONCE, false))
+          .WillOnce(testing::Invoke([&](struct mosquitto *mosq, int *mid, const char *topic,
+                                          int payloadlen, const void *payload, int qos,
+                                          bool retain) {
+              *mid = 3;
+              published_cb(TEST_HANDLE, mq_obj, 3, MQTT_RC_NOT_AUTHORIZED, nullptr);
+              return MOSQ_ERR_SUCCESS;
+          }));
+
+    int result = AITT_ERROR_NONE;
+    mq.PublishAsync(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE, false,
+          [&](int ret) { result = ret; });
+    EXPECT_EQ(result, AITT_ERROR_PERMISSION_DENIED);
+
+    AittPublishStats stats = mq.GetPublishStats();
+    EXPECT_EQ(stats.inflight, 0);
+    EXPECT_EQ(stats.failed, 1ULL);
+}
+
+TEST_F(MQPublishAsyncTest, PublishAsync_Inflight_Full_N_Anytime)
+{
+    aitt::MosquittoMQ mq(TEST_CLIENT_ID, true, false, 1, false);
+
+    ExpectPublish(1);
+    mq.PublishAsync(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE, false,
+          nullptr);
+    EXPECT_THROW(mq.PublishAsync(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD),
+                       AITT_QOS_AT_LEAST_ONCE, false, nullptr),
+          aitt::AittException);
+
+    AittPublishStats stats = mq.GetPublishStats();
+    EXPECT_EQ(stats.inflight, 1);
+    EXPECT_EQ(stats.overflowed, 1ULL);
+
+    published_cb(TEST_HANDLE, mq_obj, 1, MQTT_RC_SUCCESS, nullptr);
+    ExpectPublish(2);
+    EXPECT_NO_THROW(mq.PublishAsync(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD),
+          AITT_QOS_AT_LEAST_ONCE, false, nullptr));
+}
+
+TEST_F(MQPublishAsyncTest, PublishAsync_Inflight_Block_P_Anytime)
+{
+    aitt::MosquittoMQ mq(TEST_CLIENT_ID, true, false, 1, true);
+
+    ExpectPublish(1);
+    mq.PublishAsync(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE, false,
+          nullptr);
+
+    std::mutex lock;
+    std::condition_variable cond;
+    bool published = false;
+    ExpectPublish(2);
+    std::thread publisher([&]() {
+        mq.Publish(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE);
+        std::lock_guard<std::mutex> guard(lock);
+        published = true;
+        cond.notify_one();
+    });
+
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        EXPECT_FALSE(cond.wait_for(guard, std::chrono::milliseconds(100),
+              [&]() { return published; }));
+    }
+
+    published_cb(TEST_HANDLE, mq_obj, 1, MQTT_RC_SUCCESS, nullptr);
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        EXPECT_TRUE(
+              cond.wait_for(guard, std::chrono::seconds(1), [&]() { return published; }));
+    }
+    publisher.join();
+    EXPECT_EQ(mq.GetPublishStats().peak_inflight, 1);
+}
+
+TEST_F(MQPublishAsyncTest, Publish_Untracked_P_Anytime)
+{
+    aitt::MosquittoMQ mq(TEST_CLIENT_ID, true);
+
+    // Without the window and a callback, the message isn't tracked.
+    ExpectPublish(5);
+    mq.Publish(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE);
+    EXPECT_EQ(mq.GetPublishStats().inflight, 0);
+    published_cb(TEST_HANDLE, mq_obj, 5, MQTT_RC_SUCCESS, nullptr);
+
+    // Its completion doesn't complete a later message of the same mid.
+    std::vector<int> results;
+    ExpectPublish(5);
+    mq.PublishAsync(TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD), AITT_QOS_AT_LEAST_ONCE, false,
+          [&](int result) { results.push_back(result); });
+    EXPECT_TRUE(results.empty());
+    published_cb(TEST_HANDLE, mq_obj, 5, MQTT_RC_SUCCESS, nullptr);
+    EXPECT_EQ(results, std::vector<int>({AITT_ERROR_NONE}));
+
+    AittPublishStats stats = mq.GetPublishStats();
+    EXPECT_EQ(stats.inflight, 0);
+    EXPECT_EQ(stats.completed, 1ULL);
+}
+
+TEST_F(MQPublishAsyncTest, PublishBatch_P_Anytime)
+{
+    aitt::MosquittoMQ mq(TEST_CLIENT_ID, true, false, 8);
+
+    AittBatchMessage messages[3];
+    for (int i = 0; i < 3; i++)
+        messages[i] = AittBatchMessage{TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD)};
+
+    testing::InSequence seq;
+    ExpectPublish(1);
+    ExpectPublish(2);
+    ExpectPublish(3);
+    mq.PublishBatch(messages, 3, AITT_QOS_AT_LEAST_ONCE);
+    EXPECT_EQ(mq.GetPublishStats().inflight, 3);
+
+    for (int mid = 1; mid <= 3; mid++)
+        published_cb(TEST_HANDLE, mq_obj, mid, MQTT_RC_SUCCESS, nullptr);
+
+    AittPublishStats stats = mq.GetPublishStats();
+    EXPECT_EQ(stats.inflight, 0);
+    EXPECT_EQ(stats.completed, 3ULL);
+}
+
+TEST_F(MQPublishAsyncTest, PublishBatch_N_Anytime)
+{
+    aitt::MosquittoMQ mq(TEST_CLIENT_ID, true, false, 8);
+
+    AittBatchMessage messages[3];
+    for (int i = 0; i < 3; i++)
+        messages[i] = AittBatchMessage{TEST_TOPIC, TEST_PAYLOAD, sizeof(TEST_PAYLOAD)};
+
+    // It stops at the message failed.
+    testing::InSequence seq;
+    ExpectPublish(1);
+    EXPECT_CALL(mqttMock, mosquitto_publish(TEST_HANDLE, testing::_, testing::StrEq(TEST_TOPIC),
+                                sizeof(TEST_PAYLOAD), TEST_PAYLOAD, AITT_QOS_AT_LEAST_ONCE, false))
+          .WillOnce(Return(MOSQ_ERR_NO_CONN));
+    EXPECT_THROW(mq.PublishBatch(messages, 3, AITT_QOS_AT_LEAST_ONCE), aitt::AittException);
+    EXPECT_EQ(mq.GetPublishStats().inflight, 1);
+}
@@ -39,8 +39,9 @@ CMOCK_MOCK_FUNCTION8(MosquittoMock, mosquitto_publish_v5,
       int(struct mosquitto *mosq, int *mid, const char *topic, int payloadlen, const void *payload,
             int qos, bool retain, const mosquitto_property *properties));
 
-CMOCK_MOCK_FUNCTION4(MosquittoMock, mosquitto_subscribe,
-      int(struct mosquitto *mosq, int *mid, const char *sub, int qos));
+CMOCK_MOCK_FUNCTION6(MosquittoMock, mosquitto_subscribe_v5,
+      int(struct mosquitto *mosq, int *mid, const char *sub, int qos, int options,
+            const mosquitto_property *properties));
 CMOCK_MOCK_FUNCTION3(MosquittoMock, mosquitto_unsubscribe,
       int(struct mosquitto *mosq, int *mid, const char *sub));
 CMOCK_MOCK_FUNCTION1(MosquittoMock, mosquitto_loop_start, int(struct mosquitto *mosq));
@@ -55,6 +56,9 @@ CMOCK_MOCK_FUNCTION2(MosquittoMock, mosquitto_connect_v5_callback_set,
 CMOCK_MOCK_FUNCTION2(MosquittoMock, mosquitto_disconnect_v5_callback_set,
       void(struct mosquitto *mosq,
             void (*on_disconnect)(struct mosquitto *, void *, int, const mosquitto_property *)));
+CMOCK_MOCK_FUNCTION2(MosquittoMock, mosquitto_publish_v5_callback_set,
+      void(struct mosquitto *mosq,
+            void (*on_publish)(struct mosquitto *, void *, int, int, const mosquitto_property *)));
 
 CMOCK_MOCK_FUNCTION3(MosquittoMock, mosquitto_property_add_string,
       int(mosquitto_property **proplist, int identifier, const char *value));
@@ -42,8 +42,9 @@ class MosquittoMock : public CMockMocker<MosquittoMock> {
           int(struct mosquitto *mosq, int *mid, const char *topic, int payloadlen,
                 const void *payload, int qos, bool retain, const mosquitto_property *properties));
 
-    MOCK_METHOD4(mosquitto_subscribe,
-          int(struct mosquitto *mosq, int *mid, const char *sub, int qos));
+    MOCK_METHOD6(mosquitto_subscribe_v5,
+          int(struct mosquitto *mosq, int *mid, const char *sub, int qos, int options,
+                const mosquitto_property *properties));
     MOCK_METHOD3(mosquitto_unsubscribe, int(struct mosquitto *mosq, int *mid, const char *sub));
     MOCK_METHOD1(mosquitto_loop_start, int(struct mosquitto *mosq));
     MOCK_METHOD2(mosquitto_loop_stop, int(struct mosquitto *mosq, bool force));
@@ -57,6 +58,9 @@ class MosquittoMock : public CMockMocker<MosquittoMock> {
     MOCK_METHOD2(mosquitto_disconnect_v5_callback_set,
           void(struct mosquitto *mosq, void (*on_disconnect)(struct mosquitto *, void *, int,
                                              const mosquitto_property *)));
+    MOCK_METHOD2(mosquitto_publish_v5_callback_set,
+          void(struct mosquitto *mosq, void (*on_publish)(struct mosquitto *, void *, int, int,
+                                             const mosquitto_property *)));
     MOCK_METHOD3(mosquitto_property_add_string,
           int(mosquitto_property **proplist, int identifier, const char *value));
     MOCK_METHOD4(mosquitto_property_add_binary,
@@ -15,7 +15,9 @@
  */
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
 
 #include "AITT.h"
 #include "AittTests.h"
@@ -344,6 +346,56 @@ TEST_F(AITTRRTest, RequestResponse_2times_Anytime)
     }
 }
 
+TEST_F(AITTRRTest, RequestResponse_Concurrent_P_Anytime)
+{
+    const int request_count = 20;
+    int reply_count = 0;
+    std::mutex reply_lock;
+
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        aitt.Subscribe(rr_topic.c_str(),
+              [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                  // Each request is answered with its own correlation.
+                  aitt.SendReply(msg, msg->GetCorrelation().c_str(),
+                        msg->GetCorrelation().size());
+              });
+
+        for (int i = 0; i < request_count; i++) {
+            std::string request_correlation = std::to_string(i);
+            aitt.PublishWithReply(
+                  rr_topic.c_str(), message.c_str(), message.size(), AITT_TYPE_MQTT,
+                  AITT_QOS_AT_MOST_ONCE, false,
+                  [&, request_correlation](AittMsg *msg, const void *data, const int datalen,
+                        void *cbdata) {
+                      std::string received_data((const char *)data, datalen);
+                      EXPECT_EQ(msg->GetCorrelation(), request_correlation);
+                      EXPECT_EQ(received_data, request_correlation);
+
+                      std::lock_guard<std::mutex> lock(reply_lock);
+                      if (++reply_count == request_count)
+                          ToggleReady();
+                  },
+                  nullptr, request_correlation);
+        }
+
+        mainLoop->AddTimeout(
+              CHECK_INTERVAL,
+              [&](MainLoopIface::Event result, int fd, MainLoopIface::MainLoopData *data) -> int {
+                  return ReadyCheck(static_cast<AittTests *>(this));
+              },
+              nullptr);
+        IterateEventLoop();
+
+        aitt.Disconnect();
+        EXPECT_EQ(reply_count, request_count);
+    } catch (std::exception &e) {
+        FAIL() << e.what();
+    }
+}
+
 TEST_F(AITTRRTest, RequestResponse_sync_P_Anytime)
 {
     bool sub_ok, reply1_ok;
@@ -356,8 +408,8 @@ TEST_F(AITTRRTest, RequestResponse_sync_P_Anytime)
         aitt.Subscribe(rr_topic.c_str(),
               [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
                   CheckSubscribe(msg, data, datalen);
-                  aitt.SendReply(msg, reply.c_str(), reply.size());
                   sub_ok = true;
+                  aitt.SendReply(msg, reply.c_str(), reply.size());
               });
 
         aitt.PublishWithReplySync(rr_topic.c_str(), message.c_str(), message.size(), AITT_TYPE_MQTT,
@@ -374,6 +426,104 @@ TEST_F(AITTRRTest, RequestResponse_sync_P_Anytime)
     }
 }
 
+TEST_F(AITTRRTest, RequestResponse_sync_TCP_P_Anytime)
+{
+    std::vector<AittProtocol> protocols = {AITT_TYPE_TCP, AITT_TYPE_TCP_SECURE};
+
+    for (AittProtocol &protocol : protocols) {
+        bool sub_ok, reply_ok;
+        sub_ok = reply_ok = false;
+
+        try {
+            AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+            aitt.Connect();
+
+            aitt.Subscribe(
+                  rr_topic,
+                  [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                      CheckSubscribe(msg, data, datalen);
+                      sub_ok = true;
+                      aitt.SendReply(msg, reply.c_str(), reply.size());
+                  },
+                  nullptr, protocol);
+
+            // Wait a few seconds until the AITT client gets a server list (discover devices)
+            while (aitt.CountSubscriber(rr_topic, protocol) == 0) {
+                usleep(SLEEP_10MS);
+            }
+
+            int ret = aitt.PublishWithReplySync(rr_topic, message.c_str(), message.size(),
+                  protocol, AITT_QOS_AT_MOST_ONCE, false,
+                  std::bind(&AITTRRTest::CheckReplyCallback, GetHandle(), false, &reply_ok,
+                        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+                        std::placeholders::_4),
+                  nullptr, correlation, 1000);
+
+            EXPECT_EQ(ret, 0);
+            EXPECT_TRUE(sub_ok);
+            EXPECT_TRUE(reply_ok);
+        } catch (std::exception &e) {
+            FAIL() << e.what();
+        }
+    }
+}
+
+TEST_F(AITTRRTest, RequestResponse_sync_in_TCP_callback_N_Anytime)
+{
+    try {
+        AITT aitt(clientId, LOCAL_IP, AittOption(true, false));
+        aitt.Connect();
+
+        aitt.Subscribe(
+              rr_topic,
+              [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                  CheckSubscribe(msg, data, datalen);
+                  aitt.SendReply(msg, reply.c_str(), reply.size());
+              },
+              nullptr, AITT_TYPE_TCP_SECURE);
+
+        int tcp_ret = AITT_ERROR_UNKNOWN;
+        int secure_ret = AITT_ERROR_UNKNOWN;
+        bool reply_ok = false;
+        std::atomic_bool done(false);
+        aitt.Subscribe(
+              testTopic,
+              [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                  // The replies of TCP would come on this thread.
+                  tcp_ret = aitt.PublishWithReplySync(rr_topic, message.c_str(),
+                        message.size(), AITT_TYPE_TCP, AITT_QOS_AT_MOST_ONCE, false,
+                        [&](AittMsg *msg, const void *data, const int datalen, void *cbdata) {
+                            FAIL() << "Should not be called";
+                        },
+                        nullptr, correlation, 1000);
+                  secure_ret = aitt.PublishWithReplySync(rr_topic, message.c_str(),
+                        message.size(), AITT_TYPE_TCP_SECURE, AITT_QOS_AT_MOST_ONCE, false,
+                        std::bind(&AITTRRTest::CheckReplyCallback, GetHandle(), false,
+                              &reply_ok, std::placeholders::_1, std::placeholders::_2,
+                              std::placeholders::_3, std::placeholders::_4),
+                        nullptr, correlation, 1000);
+                  done = true;
+              },
+              nullptr, AITT_TYPE_TCP);
+
+        while (aitt.CountSubscriber(rr_topic, AITT_TYPE_TCP_SECURE) == 0
+               || aitt.CountSubscriber(testTopic, AITT_TYPE_TCP) == 0) {
+            usleep(SLEEP_10MS);
+        }
+
+        aitt.Publish(testTopic, message.c_str(), message.size(), AITT_TYPE_TCP);
+        for (int i = 0; i < 300 && done == false; i++)
+            usleep(SLEEP_10MS);
+
+        ASSERT_TRUE(done);
+        EXPECT_EQ(tcp_ret, AITT_ERROR_NOT_SUPPORTED);
+        EXPECT_EQ(secure_ret, 0);
+        EXPECT_TRUE(reply_ok);
+    } catch (std::exception &e) {
+        FAIL() << e.what();
+    }
+}
+
 TEST_F(AITTRRTest, RequestResponse_sync_async_P_Anytime)
 {
     try {
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "SendQueue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define TEST_QUEUE_SIZE 4
+
+using aitt::SendQueue;
+
+TEST(SendQueue, DropNewest_P_Anytime)
+{
+    SendQueue<int> queue(TEST_QUEUE_SIZE, AITT_SEND_OVERFLOW_DROP_NEWEST);
+
+    for (int i = 0; i < TEST_QUEUE_SIZE; i++)
+        EXPECT_TRUE(queue.Push(int(i)));
+    EXPECT_FALSE(queue.Push(TEST_QUEUE_SIZE));
+
+    int item;
+    for (int i = 0; i < TEST_QUEUE_SIZE; i++) {
+        ASSERT_TRUE(queue.Pop(item));
+        EXPECT_EQ(item, i);
+        queue.Sent();
+    }
+    EXPECT_FALSE(queue.Pop(item));
+
+    SendQueue<int>::Stats stats = queue.GetStats();
+    EXPECT_EQ(stats.enqueued, TEST_QUEUE_SIZE);
+    EXPECT_EQ(stats.sent, TEST_QUEUE_SIZE);
+    EXPECT_EQ(stats.dropped, 1U);
+    EXPECT_EQ(stats.depth, 0U);
+}
+
+TEST(SendQueue, DropOldest_P_Anytime)
+{
+    SendQueue<int> queue(TEST_QUEUE_SIZE, AITT_SEND_OVERFLOW_DROP_OLDEST);
+
+    for (int i = 0; i < TEST_QUEUE_SIZE + 2; i++)
+        EXPECT_TRUE(queue.Push(int(i)));
+
+    int item;
+    for (int i = 2; i < TEST_QUEUE_SIZE + 2; i++) {
+        ASSERT_TRUE(queue.Pop(item));
+        EXPECT_EQ(item, i);
+    }
+
+    SendQueue<int>::Stats stats = queue.GetStats();
+    EXPECT_EQ(stats.enqueued, TEST_QUEUE_SIZE + 2U);
+    EXPECT_EQ(stats.dropped, 2U);
+}
+
+TEST(SendQueue, Block_P_Anytime)
+{
+    SendQueue<int> queue(1, AITT_SEND_OVERFLOW_BLOCK);
+    std::atomic_bool pushed(false);
+
+    EXPECT_TRUE(queue.Push(0));
+    std::thread publisher([&]() {
+        EXPECT_TRUE(queue.Push(1));
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(pushed);
+
+    int item;
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 0);
+    publisher.join();
+    EXPECT_TRUE(pushed);
+
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 1);
+    EXPECT_EQ(queue.GetStats().blocked, 1U);
+}
+
+TEST(SendQueue, Block_Without_Wait_P_Anytime)
+{
+    SendQueue<int> queue(1, AITT_SEND_OVERFLOW_BLOCK);
+
+    EXPECT_TRUE(queue.Push(0));
+    EXPECT_TRUE(queue.Push(1, false));
+    EXPECT_EQ(queue.GetStats().depth, 2U);
+}
+
+TEST(SendQueue, Close_N_Anytime)
+{
+    SendQueue<int> queue(1, AITT_SEND_OVERFLOW_BLOCK);
+
+    EXPECT_TRUE(queue.Push(0));
+    std::thread publisher([&]() { EXPECT_FALSE(queue.Push(1)); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    queue.Close();
+    publisher.join();
+
+    EXPECT_FALSE(queue.Push(2));
+    queue.Clear(1);
+
+    SendQueue<int>::Stats stats = queue.GetStats();
+    EXPECT_EQ(stats.enqueued, 1U);
+    EXPECT_EQ(stats.dropped, 4U);
+    EXPECT_EQ(stats.depth, 0U);
+}
+
+TEST(SendQueue, Clear_Keep_P_Anytime)
+{
+    SendQueue<int> queue(TEST_QUEUE_SIZE, AITT_SEND_OVERFLOW_DROP_NEWEST);
+
+    for (int i = 0; i < TEST_QUEUE_SIZE; i++)
+        EXPECT_TRUE(queue.Push(int(i)));
+    queue.Clear(1, [](const int &item) { return item % 2 == 1; });
+
+    int item;
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 1);
+    ASSERT_TRUE(queue.Pop(item));
+    EXPECT_EQ(item, 3);
+    EXPECT_FALSE(queue.Pop(item));
+
+    SendQueue<int>::Stats stats = queue.GetStats();
+    EXPECT_EQ(stats.dropped, 3U);
+}
+
+TEST(SendQueue, SentDropped_P_Anytime)
+{
+    SendQueue<int> queue(TEST_QUEUE_SIZE, AITT_SEND_OVERFLOW_DROP_NEWEST);
+
+    EXPECT_TRUE(queue.Push(1));
+    EXPECT_TRUE(queue.Push(2));
+    int item;
+    ASSERT_TRUE(queue.Pop(item));
+    queue.Sent();
+    ASSERT_TRUE(queue.Pop(item));
+    queue.Dropped();
+
+    SendQueue<int>::Stats stats = queue.GetStats();
+    EXPECT_EQ(stats.enqueued, 2U);
+    EXPECT_EQ(stats.sent, 1U);
+    EXPECT_EQ(stats.dropped, 1U);
+    EXPECT_EQ(stats.depth, 0U);
+}
+
+TEST(SendQueue, PeerStats_P_Anytime)
+{
+    SendQueue<int> queue(TEST_QUEUE_SIZE, AITT_SEND_OVERFLOW_DROP_NEWEST);
+
+    for (int i = 0; i < TEST_QUEUE_SIZE + 1; i++)
+        queue.Push(int(i));
+    int item;
+    ASSERT_TRUE(queue.Pop(item));
+    queue.Sent();
+
+    AittPeerStats stats = queue.GetPeerStats();
+    EXPECT_EQ(stats.enqueued, TEST_QUEUE_SIZE + 0ULL);
+    EXPECT_EQ(stats.sent, 1ULL);
+    EXPECT_EQ(stats.dropped, 1ULL);
+    EXPECT_EQ(stats.blocked, 0ULL);
+    EXPECT_EQ(stats.depth, TEST_QUEUE_SIZE - 1);
+}
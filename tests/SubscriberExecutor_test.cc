@@ -0,0 +1,130 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "SubscriberExecutor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <vector>
+
+#define STRAND_NUM 8
+#define ITEM_NUM 1000
+
+using aitt::SubscriberExecutor;
+
+// first: index of the strand, second: sequence in the strand
+using Item = std::pair<int, int>;
+using Executor = SubscriberExecutor<Item>;
+
+TEST(SubscriberExecutor, Strand_Order_P_Anytime)
+{
+    std::mutex lock;
+    std::vector<int> last(STRAND_NUM, -1);
+    std::atomic_int count(0);
+    std::atomic_bool in_order(true);
+    std::promise<void> done;
+
+    Executor executor(4, true, [&](Item &item) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (item.second != last[item.first] + 1)
+                in_order = false;
+            last[item.first] = item.second;
+        }
+        if (++count == STRAND_NUM * ITEM_NUM)
+            done.set_value();
+    });
+
+    std::vector<std::shared_ptr<Executor::Strand>> strands;
+    for (int i = 0; i < STRAND_NUM; i++)
+        strands.push_back(executor.NewStrand());
+
+    for (int seq = 0; seq < ITEM_NUM; seq++) {
+        for (int i = 0; i < STRAND_NUM; i++)
+            executor.Post(strands[i], Item(i, seq));
+    }
+
+    ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(10)), std::future_status::ready);
+    EXPECT_TRUE(in_order);
+}
+
+TEST(SubscriberExecutor, Slow_Strand_P_Anytime)
+{
+    std::promise<void> fast_done;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+
+    Executor executor(2, false, [&](Item &item) {
+        if (item.first == 0)
+            released.wait();
+        else
+            fast_done.set_value();
+    });
+
+    auto slow = executor.NewStrand();
+    auto fast = executor.NewStrand();
+    executor.Post(slow, Item(0, 0));
+    executor.Post(fast, Item(1, 0));
+
+    // The blocked strand doesn't delay the other one.
+    EXPECT_EQ(fast_done.get_future().wait_for(std::chrono::seconds(5)),
+          std::future_status::ready);
+    release.set_value();
+}
+
+TEST(SubscriberExecutor, Work_Stealing_P_Anytime)
+{
+    std::promise<void> fast_done;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::promise<void> slow_started;
+
+    Executor executor(2, true, [&](Item &item) {
+        if (item.first == 0) {
+            slow_started.set_value();
+            released.wait();
+        } else {
+            fast_done.set_value();
+        }
+    });
+
+    // Both strands have the same worker, the other one has to steal.
+    auto slow = executor.NewStrand();
+    executor.NewStrand();
+    auto fast = executor.NewStrand();
+
+    executor.Post(slow, Item(0, 0));
+    slow_started.get_future().wait();
+    executor.Post(fast, Item(1, 0));
+
+    EXPECT_EQ(fast_done.get_future().wait_for(std::chrono::seconds(5)),
+          std::future_status::ready);
+    release.set_value();
+}
+
+TEST(SubscriberExecutor, Post_After_Stop_N_Anytime)
+{
+    std::atomic_int count(0);
+    Executor executor(2, false, [&](Item &item) { count++; });
+    auto strand = executor.NewStrand();
+
+    executor.Stop();
+    executor.Post(strand, Item(0, 0));
+    EXPECT_EQ(count, 0);
+}
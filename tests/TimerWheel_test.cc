@@ -0,0 +1,107 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "TimerWheel.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using aitt::TimerWheel;
+
+TEST(TimerWheel, Expire_P_Anytime)
+{
+    TimerWheel wheel(1000);
+    wheel.Add(1, 1010);
+    wheel.Add(2, 1005);
+    wheel.Add(3, 1010);
+    EXPECT_EQ(wheel.Size(), 3U);
+    EXPECT_EQ(wheel.NextExpire(), 1005U);
+
+    std::vector<unsigned int> expired;
+    wheel.Expire(1004, expired);
+    EXPECT_TRUE(expired.empty());
+
+    wheel.Expire(1010, expired);
+    EXPECT_EQ(expired, std::vector<unsigned int>({2, 1, 3}));
+    EXPECT_EQ(wheel.Size(), 0U);
+    EXPECT_EQ(wheel.NextExpire(), UINT64_MAX);
+}
+
+TEST(TimerWheel, Expire_Upper_Levels_P_Anytime)
+{
+    const uint64_t start = 123456;
+    const uint64_t deadlines[] = {start + 63, start + 64, start + 5000, start + 300000,
+          start + 20000000, start + 100000000};
+    TimerWheel wheel(start);
+    for (unsigned int id = 0; id < sizeof(deadlines) / sizeof(deadlines[0]); id++)
+        wheel.Add(id, deadlines[id]);
+
+    // Jumping to the next expiration must not pass any deadline.
+    std::vector<unsigned int> expired;
+    uint64_t now = start;
+    while (wheel.Size()) {
+        uint64_t next = wheel.NextExpire();
+        ASSERT_GT(next, now);
+        now = next;
+
+        size_t count = expired.size();
+        wheel.Expire(now, expired);
+        for (size_t i = count; i < expired.size(); i++)
+            EXPECT_EQ(deadlines[expired[i]], now);
+    }
+    EXPECT_EQ(expired, std::vector<unsigned int>({0, 1, 2, 3, 4, 5}));
+}
+
+TEST(TimerWheel, Rearm_P_Anytime)
+{
+    TimerWheel wheel(0);
+    wheel.Add(1, 10);
+    wheel.Add(1, 5000);
+    EXPECT_EQ(wheel.Size(), 1U);
+
+    std::vector<unsigned int> expired;
+    wheel.Expire(4999, expired);
+    EXPECT_TRUE(expired.empty());
+    wheel.Expire(5000, expired);
+    EXPECT_EQ(expired, std::vector<unsigned int>({1}));
+}
+
+TEST(TimerWheel, Add_Past_P_Anytime)
+{
+    TimerWheel wheel(100);
+    wheel.Add(1, 50);
+
+    std::vector<unsigned int> expired;
+    wheel.Expire(101, expired);
+    EXPECT_EQ(expired, std::vector<unsigned int>({1}));
+}
+
+TEST(TimerWheel, Cancel_N_Anytime)
+{
+    TimerWheel wheel(0);
+    wheel.Add(1, 100);
+    wheel.Add(2, 100000);
+
+    EXPECT_TRUE(wheel.Cancel(1));
+    EXPECT_FALSE(wheel.Cancel(1));
+    EXPECT_FALSE(wheel.Cancel(3));
+    EXPECT_TRUE(wheel.Cancel(2));
+    EXPECT_EQ(wheel.Size(), 0U);
+
+    std::vector<unsigned int> expired;
+    wheel.Expire(200000, expired);
+    EXPECT_TRUE(expired.empty());
+}
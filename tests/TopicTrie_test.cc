@@ -0,0 +1,110 @@
+/*
+ * Copyright 2023 Samsung Electronics Co., Ltd. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "TopicTrie.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using aitt::TopicFilter;
+using aitt::TopicTrie;
+
+struct TopicCase {
+    const char *filter;
+    const char *topic;
+    bool expected;
+};
+
+static const TopicCase topic_cases[] = {
+      {"a/b/c", "a/b/c", true},
+      {"a/b/c", "a/b", false},
+      {"a/b", "a/b/c", false},
+      {"a/+/c", "a/b/c", true},
+      {"a/+/c", "a/b/d", false},
+      {"a/+", "a", false},
+      {"a/+", "a/", true},
+      {"+/+", "/a", true},
+      {"a/#", "a", true},
+      {"a/#", "a/b/c", true},
+      {"a/#", "b/c", false},
+      {"#", "a/b", true},
+      {"+", "a", true},
+      {"+", "a/b", false},
+      {"#", "$SYS/a", false},
+      {"+/a", "$SYS/a", false},
+      {"$SYS/#", "$SYS/a", true},
+      {"$SYS/+", "$SYS/a", true},
+};
+
+TEST(TopicFilter, Matches_P_Anytime)
+{
+    for (const auto &it : topic_cases)
+        EXPECT_EQ(TopicFilter::Matches(it.filter, it.topic), it.expected)
+              << it.filter << " : " << it.topic;
+}
+
+TEST(TopicTrie, Match_P_Anytime)
+{
+    for (const auto &it : topic_cases) {
+        TopicTrie<int> trie;
+        trie.Insert(it.filter, 1);
+        EXPECT_EQ(trie.Count(it.topic), it.expected ? 1U : 0U) << it.filter << " : " << it.topic;
+    }
+}
+
+TEST(TopicTrie, Match_Multiple_P_Anytime)
+{
+    TopicTrie<int> trie;
+    trie.Insert("a/b/c", 1);
+    trie.Insert("a/+/c", 2);
+    trie.Insert("a/#", 3);
+    trie.Insert("#", 4);
+    trie.Insert("b/#", 5);
+    trie.Insert("a/b/c", 6);
+
+    std::vector<int> matched;
+    trie.Match("a/b/c", [&matched](const int &value) { matched.push_back(value); });
+    std::sort(matched.begin(), matched.end());
+
+    EXPECT_EQ(matched, std::vector<int>({1, 2, 3, 4, 6}));
+    EXPECT_EQ(trie.Size(), 6U);
+}
+
+TEST(TopicTrie, Remove_P_Anytime)
+{
+    TopicTrie<int> trie;
+    trie.Insert("a/+/c", 1);
+    trie.Insert("a/+/c", 2);
+
+    EXPECT_TRUE(trie.Remove("a/+/c", 1));
+    EXPECT_EQ(trie.Count("a/b/c"), 1U);
+    EXPECT_TRUE(trie.Remove("a/+/c", 2));
+    EXPECT_EQ(trie.Count("a/b/c"), 0U);
+    EXPECT_EQ(trie.Size(), 0U);
+}
+
+TEST(TopicTrie, Remove_N_Anytime)
+{
+    TopicTrie<int> trie;
+    trie.Insert("a/b", 1);
+
+    EXPECT_FALSE(trie.Remove("a/b", 2));
+    EXPECT_FALSE(trie.Remove("a/c", 1));
+    EXPECT_FALSE(trie.Remove("a/b/c", 1));
+    EXPECT_EQ(trie.Count("a/b"), 1U);
+}
@@ -118,6 +118,34 @@ TEST(AITT_C_INTERFACE, option_P_Anytime)
     EXPECT_EQ(ret, AITT_ERROR_NONE);
     EXPECT_STREQ("false", aitt_option_get(option, AITT_OPT_CUSTOM_BROKER));
 
+    ret = aitt_option_set(option, AITT_OPT_SEND_QUEUE_SIZE, "32");
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+    EXPECT_STREQ("32", aitt_option_get(option, AITT_OPT_SEND_QUEUE_SIZE));
+
+    ret = aitt_option_set(option, AITT_OPT_SEND_OVERFLOW, "drop_oldest");
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+    EXPECT_STREQ("drop_oldest", aitt_option_get(option, AITT_OPT_SEND_OVERFLOW));
+
+    ret = aitt_option_set(option, AITT_OPT_LOCAL_DELIVERY, "true");
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+    EXPECT_STREQ("true", aitt_option_get(option, AITT_OPT_LOCAL_DELIVERY));
+
+    ret = aitt_option_set(option, AITT_OPT_MAX_INFLIGHT, "16");
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+    EXPECT_STREQ("16", aitt_option_get(option, AITT_OPT_MAX_INFLIGHT));
+
+    ret = aitt_option_set(option, AITT_OPT_STREAM_CHUNKS, "true");
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+    EXPECT_STREQ("true", aitt_option_get(option, AITT_OPT_STREAM_CHUNKS));
+
+    ret = aitt_option_set(option, AITT_OPT_RECEIVE_THREADS, "4");
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+    EXPECT_STREQ("4", aitt_option_get(option, AITT_OPT_RECEIVE_THREADS));
+
+    ret = aitt_option_set(option, AITT_OPT_INFLIGHT_BLOCKING, "false");
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+    EXPECT_STREQ("false", aitt_option_get(option, AITT_OPT_INFLIGHT_BLOCKING));
+
     aitt_option_destroy(option);
 }
 
@@ -137,6 +165,9 @@ TEST(AITT_C_INTERFACE, option_N_Anytime)
     ret = aitt_option_set(option, AITT_OPT_CUSTOM_BROKER, "Off");
     EXPECT_EQ(ret, AITT_ERROR_INVALID_PARAMETER);
 
+    ret = aitt_option_set(option, AITT_OPT_SEND_OVERFLOW, "drop");
+    EXPECT_EQ(ret, AITT_ERROR_INVALID_PARAMETER);
+
     ret = aitt_option_set(nullptr, AITT_OPT_MY_IP, LOCAL_IP);
     EXPECT_EQ(ret, AITT_ERROR_INVALID_PARAMETER);
 
@@ -356,6 +387,46 @@ TEST(AITT_C_INTERFACE, pub_invalid_param_N_Anytime)
     aitt_destroy(handle);
 }
 
+TEST(AITT_C_INTERFACE, pub_batch_N_Anytime)
+{
+    int ret;
+
+    aitt_option_h option = aitt_option_new();
+    ASSERT_NE(option, nullptr);
+
+    ret = aitt_option_set(option, AITT_OPT_MY_IP, LOCAL_IP);
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+
+    aitt_h handle = aitt_new("test9", option);
+    aitt_option_destroy(option);
+    ASSERT_NE(handle, nullptr);
+
+    aitt_batch_msg_s msgs[] = {
+          {TEST_C_TOPIC, TEST_C_MSG, static_cast<int>(strlen(TEST_C_MSG))},
+          {TEST_C_TOPIC, TEST_C_MSG, 0},
+    };
+    ret = aitt_publish_batch(nullptr, msgs, 2, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE);
+    EXPECT_EQ(ret, AITT_ERROR_INVALID_PARAMETER);
+
+    ret = aitt_publish_batch(handle, msgs, 2, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE);
+    EXPECT_EQ(ret, AITT_ERROR_NOT_READY);
+
+    ret = aitt_connect(handle, LOCAL_IP, 1883);
+    ASSERT_EQ(ret, AITT_ERROR_NONE);
+
+    ret = aitt_publish_batch(handle, nullptr, 2, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE);
+    EXPECT_EQ(ret, AITT_ERROR_INVALID_PARAMETER);
+
+    ret = aitt_publish_batch(handle, msgs, 0, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE);
+    EXPECT_EQ(ret, AITT_ERROR_INVALID_PARAMETER);
+
+    ret = aitt_publish_batch(handle, msgs, 2, AITT_TYPE_MQTT, AITT_QOS_AT_MOST_ONCE);
+    EXPECT_EQ(ret, AITT_ERROR_NONE);
+
+    aitt_disconnect(handle);
+    aitt_destroy(handle);
+}
+
 TEST(AITT_C_INTERFACE, sub_N_Anytime)
 {
     int ret;
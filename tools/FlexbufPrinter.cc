@@ -19,11 +19,8 @@
 
 #include <iostream>
 
-#include "../modules/tcp/TCP.h"
 #include "aitt_internal.h"
 
-using namespace AittTCPNamespace;
-
 FlexbufPrinter::FlexbufPrinter() : tab(0)
 {
 }
@@ -161,32 +158,19 @@ void FlexbufPrinter::TCPTopicPrint(const flexbuffers::Map &map,
 {
     std::string topic = topics[idx].AsString().str();
 
-    if (STR_EQ == topic.compare("host")) {
-        return;
-    }
-
     tab++;
     std::cout << PrettyTab(false) << "topic : " << topic << std::endl;
-    auto connectInfo = map[topic].AsVector();
-    size_t vec_size = connectInfo.size();
-    int port = connectInfo[TCP::CONN_INFO_PORT].AsUInt16();
-    int num_of_cb = connectInfo[TCP::CONN_INFO_NUM_OF_CB].AsUInt16();
+    auto topicInfo = map[topic].AsVector();
+    if (topicInfo.size() < 2) {
+        ERR("Unknown Message");
+        tab--;
+        return;
+    }
+    uint32_t id = topicInfo[0].AsUInt32();
+    int num_of_cb = topicInfo[1].AsInt32();
 
-    std::cout << PrettyTab(false) << "[ port : " << port;
+    std::cout << PrettyTab(false) << "[ id : " << id;
     std::cout << ", num_of_cb : " << num_of_cb << " ]" << std::endl;
-
-    if (STR_EQ == protocol.compare("SECURE_TCP")) {
-        if (vec_size != TCP::CONN_INFO_MAX) {
-            ERR("Unknown Message");
-            tab--;
-            return;
-        }
-
-        DBG_HEX_DUMP(connectInfo[TCP::CONN_INFO_KEY].AsBlob().data(),
-              connectInfo[TCP::CONN_INFO_KEY].AsBlob().size());
-        DBG_HEX_DUMP(connectInfo[TCP::CONN_INFO_IV].AsBlob().data(),
-              connectInfo[TCP::CONN_INFO_IV].AsBlob().size());
-    }
     tab--;
 }
 
@@ -194,7 +178,8 @@ void FlexbufPrinter::TCPPrettyParsing(const std::string &name, const flexbuffers
       const std::string &protocol)
 {
     auto map = data.AsMap();
-    auto topics = map.Keys();
+    auto topic_map = map["topics"].AsMap();
+    auto topics = topic_map.Keys();
     std::vector<int> matched_topic_idx;
 
     if (!topic_.empty()) {
@@ -216,14 +201,19 @@ void FlexbufPrinter::TCPPrettyParsing(const std::string &name, const flexbuffers
     tab++;
 
     std::cout << PrettyTab(false) << "host : " << host << std::endl;
+    std::cout << PrettyTab(false) << "port : " << map["port"].AsUInt16() << std::endl;
+    if (STR_EQ == protocol.compare("SECURE_TCP")) {
+        DBG_HEX_DUMP(map["key"].AsBlob().data(), map["key"].AsBlob().size());
+        DBG_HEX_DUMP(map["iv"].AsBlob().data(), map["iv"].AsBlob().size());
+    }
     std::cout << PrettyTab(false) << "topic list : {" << std::endl;
     if (!matched_topic_idx.empty()) {
         for (const auto &idx : matched_topic_idx) {
-            TCPTopicPrint(map, topics, protocol, idx);
+            TCPTopicPrint(topic_map, topics, protocol, idx);
         }
     } else {
         for (size_t idx = 0; idx < topics.size(); ++idx) {
-            TCPTopicPrint(map, topics, protocol, idx);
+            TCPTopicPrint(topic_map, topics, protocol, idx);
         }
     }
     std::cout << PrettyTab(false) << "}" << std::endl;